@@ -11,35 +11,144 @@ void requestEvent(void);
 #endif
 
 //////////////////////////////////////////////////////////////////////////////
-/// @brief Convert the bytes from a charBuf back to a 16 Bit 
-///        signed/unsigned number
+/// Decoding of integers and packed records from byte buffers
 /// 
-/// @param charBuf      Buffer with byte data
-/// @return int16_t     Integer number put together from the charBuf data
-//////////////////////////////////////////////////////////////////////////////
-template <typename R, typename ARG1>
-R bufferToInt16(ARG1 charBuf) {
-  uint16_t val = 0;
-  val = *charBuf;
-  val = (val << 8) | *(charBuf+1);
-  return val;
+/// Everything is resolved at compile time: the byte count, the byte order
+/// and the signedness are template parameters, the recursion unrolls into
+/// plain shift/or code without loops or branches. No <type_traits>, so
+/// it also builds with cores without a C++ standard library.
+//////////////////////////////////////////////////////////////////////////////
+
+enum class Endian : uint8_t { Big, Little };
+
+template <typename T> struct UnsignedOf;
+template <> struct UnsignedOf<uint8_t>  { typedef uint8_t type; };
+template <> struct UnsignedOf<int8_t>   { typedef uint8_t type; };
+template <> struct UnsignedOf<uint16_t> { typedef uint16_t type; };
+template <> struct UnsignedOf<int16_t>  { typedef uint16_t type; };
+template <> struct UnsignedOf<uint32_t> { typedef uint32_t type; };
+template <> struct UnsignedOf<int32_t>  { typedef uint32_t type; };
+template <> struct UnsignedOf<uint64_t> { typedef uint64_t type; };
+template <> struct UnsignedOf<int64_t>  { typedef uint64_t type; };
+
+// Integer type with N bytes (1, 2, 4, 8), e.g. IntOfSize<2, true>::type = int16_t
+template <uint8_t N, bool SIGNED> struct IntOfSize;
+template <> struct IntOfSize<1, false> { typedef uint8_t type; };
+template <> struct IntOfSize<1, true>  { typedef int8_t type; };
+template <> struct IntOfSize<2, false> { typedef uint16_t type; };
+template <> struct IntOfSize<2, true>  { typedef int16_t type; };
+template <> struct IntOfSize<4, false> { typedef uint32_t type; };
+template <> struct IntOfSize<4, true>  { typedef int32_t type; };
+template <> struct IntOfSize<8, false> { typedef uint64_t type; };
+template <> struct IntOfSize<8, true>  { typedef int64_t type; };
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Unsigned value of the bytes p[0] .. p[N-1]
+/// 
+//////////////////////////////////////////////////////////////////////////////
+template <typename U, uint8_t N, Endian E>
+struct RawBytes {
+  static constexpr U get(const uint8_t* p) {
+    return E == Endian::Big
+      ? (U)((U)(RawBytes<U, N - 1, E>::get(p) << 8) | p[N - 1])
+      : (U)((U)((U)p[N - 1] << (8 * (N - 1))) | RawBytes<U, N - 1, E>::get(p));
+  }
+};
+
+template <typename U, Endian E>
+struct RawBytes<U, 0, E> {
+  static constexpr U get(const uint8_t*) { return 0; }
+};
+
+template <typename T, uint8_t N>
+constexpr typename UnsignedOf<T>::type signBit() {
+  return (typename UnsignedOf<T>::type)((typename UnsignedOf<T>::type)1 << (8 * N - 1));
 }
 
 //////////////////////////////////////////////////////////////////////////////
-/// @brief Convert the bytes from a charBuf back to a 32 Bit
-///        signed/unsigned number
+/// @brief Decode an integer of N bytes (default: the size of T). With
+///        N < sizeof(T) a signed T is sign extended from bit 8 * N - 1,
+///        e.g. decodeInt<int32_t, Endian::Big, 3>() for 24 bit values.
 /// 
-/// @param charBuf      Buffer with byte data
-/// @return int32_t     Integer number put together from the charBuf data
-//////////////////////////////////////////////////////////////////////////////
-template <typename R, typename ARG1>
-R bufferToInt32(ARG1 charBuf) { 
-  uint32_t val = 0;
-  val = charBuf[0];
-  val = (val << 8) | charBuf[1];
-  val = (val << 8) | charBuf[2];
-  val = (val << 8) | charBuf[3];
-  return val;
+/// @param p            First byte
+/// @return T           Value
+//////////////////////////////////////////////////////////////////////////////
+template <typename T, Endian E = Endian::Big, uint8_t N = sizeof(T)>
+constexpr T decodeInt(const uint8_t* p) {
+  static_assert(N >= 1 && N <= sizeof(T), "Field does not fit into the type");
+  // Sign extension of a short field: (raw ^ m) - m, m = sign bit of the field
+  return (T(-1) < T(0) && N < sizeof(T))
+    ? (T)((typename UnsignedOf<T>::type)(RawBytes<typename UnsignedOf<T>::type, N, E>::get(p) ^ signBit<T, N>())
+          - signBit<T, N>())
+    : (T)RawBytes<typename UnsignedOf<T>::type, N, E>::get(p);
 }
 
-#endif
\ No newline at end of file
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Field of a packed record: type, byte order and byte count
+/// 
+//////////////////////////////////////////////////////////////////////////////
+template <typename T, Endian E = Endian::Big, uint8_t N = sizeof(T)>
+struct Field {
+  typedef T type;
+  static constexpr uint8_t size = N;
+  static constexpr T get(const uint8_t* p) { return decodeInt<T, E, N>(p); }
+};
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Packed record described by a list of fields, e.g.
+///        PackedRecord<Field<uint16_t>, Field<int32_t, Endian::Little, 3>>
+///        (5 bytes). Offsets and the size are compile-time constants.
+/// 
+///        get<I>(buf)          Field I
+///        decode(buf, a, b)    All fields at once
+/// 
+//////////////////////////////////////////////////////////////////////////////
+template <typename... FIELDS>
+struct PackedRecord;
+
+template <>
+struct PackedRecord<> {
+  static constexpr uint8_t size = 0;
+  static constexpr uint8_t count = 0;
+  static void decode(const uint8_t*) {}
+};
+
+template <typename F, typename... REST>
+struct PackedRecord<F, REST...> {
+  typedef PackedRecord<REST...> Rest;
+  static constexpr uint8_t size = F::size + Rest::size;     // Bytes
+  static constexpr uint8_t count = 1 + sizeof...(REST);     // Fields
+
+  // Type and byte offset of field I
+  template <uint8_t I, bool HERE = (I == 0)>
+  struct FieldAt { typedef typename Rest::template FieldAt<I - 1>::type type; };
+  template <uint8_t I>
+  struct FieldAt<I, true> { typedef F type; };
+
+  template <uint8_t I, bool HERE = (I == 0)>
+  struct OffsetOf { static constexpr uint8_t value = F::size + Rest::template OffsetOf<I - 1>::value; };
+  template <uint8_t I>
+  struct OffsetOf<I, true> { static constexpr uint8_t value = 0; };
+
+  // Byte offset of field I
+  template <uint8_t I>
+  static constexpr uint8_t offset() {
+    return OffsetOf<I>::value;
+  }
+
+  // Decode field I
+  template <uint8_t I>
+  static constexpr typename FieldAt<I>::type::type get(const uint8_t* p) {
+    return FieldAt<I>::type::get(p + OffsetOf<I>::value);
+  }
+
+  // Decode all fields into the arguments
+  template <typename A, typename... ARGS>
+  static void decode(const uint8_t* p, A& a, ARGS&... args) {
+    static_assert(1 + sizeof...(ARGS) == count, "One argument per field");
+    a = F::get(p);
+    Rest::decode(p + F::size, args...);
+  }
+};
+
+#endif
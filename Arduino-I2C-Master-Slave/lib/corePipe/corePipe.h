@@ -0,0 +1,133 @@
+#ifndef _CORE_PIPE_H_
+#define _CORE_PIPE_H_
+
+#include <stdint.h>
+#include <string.h>
+#include "spscQueue.h"
+
+#define PIPE_DATA         32          // Payload bytes per item
+
+// Item types
+#define PIPE_CHUNK        1           // Bytes of I2C_REG_FIFO of a node
+#define PIPE_TEXT         2           // Bytes for the serial port (line or framed record)
+
+// Item flags
+#define PIPE_RESET        0x01        // Chunk: decoder of the node lost sync, reset it first
+#define PIPE_NEW          0x02        // Chunk: node new in the slave table, start a new decoder
+#define PIPE_EOL          0x04        // Text: line end after the bytes
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief One transfer between the bus core and the output core
+///
+//////////////////////////////////////////////////////////////////////////////
+struct PipeItem {
+  uint8_t type;                       // PIPE_CHUNK, PIPE_TEXT
+  uint8_t flags;
+  uint8_t node;                       // Slave table index (chunk)
+  uint8_t addr;                       // 7 bit address (chunk)
+  uint8_t len;                        // Used bytes of data
+  uint8_t data[PIPE_DATA];
+};
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Pipeline from the core that owns the I2C bus (producer) to the
+///        core that decodes, formats and writes the serial port (consumer).
+///
+///        The bus core reads FIFO chunks straight into a reserved item
+///        (beginChunk, commitChunk) and hands over its own text lines
+///        (status, messages) already formatted. A line longer than
+///        PIPE_DATA takes several items; they are published together or
+///        not at all, so the consumer never sees half a line. A chunk that
+///        finds the pipe full is not read at all: the data stays in the
+///        FIFO of the slave (chunksFull), a line is dropped (textDropped).
+///
+///        The consumer takes the items with queue.front() / queue.pop()
+///        in order, a chunk only when it has room for its samples.
+///
+//////////////////////////////////////////////////////////////////////////////
+template <uint16_t N>
+class CorePipe {
+public:
+  SpscQueue<PipeItem, N> queue;
+  uint32_t chunksFull = 0;            // Chunk reads put off, pipe full (producer)
+  uint32_t textDropped = 0;           // Lines / records dropped, pipe full (producer)
+
+  //////////////////////////////////////////////////////////////////////////////
+  /// @brief Bus core: reserve an item for a FIFO chunk
+  ///
+  /// @param node         Slave table index
+  /// @param addr         7 bit address
+  /// @param flags        PIPE_RESET, PIPE_NEW
+  /// @return uint8_t*    Buffer for PIPE_DATA bytes, nullptr if the pipe is full
+  //////////////////////////////////////////////////////////////////////////////
+  uint8_t* beginChunk(uint8_t node, uint8_t addr, uint8_t flags) {
+    if (!queue.reserve(1)) {
+      chunksFull++;
+      return nullptr;
+    }
+    PipeItem& item = queue.slot(0);
+    item.type = PIPE_CHUNK;
+    item.flags = flags;
+    item.node = node;
+    item.addr = addr;
+    return item.data;
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+  /// @brief Bus core: hand the chunk of beginChunk() to the output core
+  ///
+  /// @param len          Bytes read
+  //////////////////////////////////////////////////////////////////////////////
+  void commitChunk(uint8_t len) {
+    queue.slot(0).len = len;
+    queue.publish(1);
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+  /// @brief Bus core: hand over text, completely or not at all
+  ///
+  /// @param data         Bytes
+  /// @param len          Number of bytes
+  /// @param eol          Line end after the bytes (the output core adds it)
+  /// @return true        Queued
+  //////////////////////////////////////////////////////////////////////////////
+  bool text(const uint8_t* data, uint16_t len, bool eol) {
+    uint16_t items = len ? (len + PIPE_DATA - 1) / PIPE_DATA : 1;
+
+    if (items > N || !queue.reserve(items)) {
+      textDropped++;
+      return false;
+    }
+    for (uint16_t i = 0; i < items; ++i) {
+      PipeItem& item = queue.slot(i);
+      uint16_t n = len > PIPE_DATA ? PIPE_DATA : len;
+      item.type = PIPE_TEXT;
+      item.flags = (eol && i == items - 1) ? PIPE_EOL : 0;
+      item.len = n;
+      memcpy(item.data, data, n);
+      data += n;
+      len -= n;
+    }
+    queue.publish(items);
+    return true;
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+  /// @brief Output core: bytes a text item adds to the output
+  ///
+  //////////////////////////////////////////////////////////////////////////////
+  static uint16_t textLen(const PipeItem& item) {
+    return item.len + ((item.flags & PIPE_EOL) ? 2 : 0);
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+  /// @brief Empty the pipe and clear the counters. Neither core may use it.
+  ///
+  //////////////////////////////////////////////////////////////////////////////
+  void clear() {
+    queue.clear();
+    chunksFull = textDropped = 0;
+  }
+};
+
+#endif
@@ -0,0 +1,119 @@
+#ifndef _HISTORY_DECODER_H_
+#define _HISTORY_DECODER_H_
+
+#include <stdint.h>
+
+// Record format of the MSP430 sample history (see sample-history.c of the slave)
+#define HIST_PAD          0x00        // FIFO empty
+#define HIST_KEY          0x01        // Key record: KEY seq(16) value(16)
+#define HIST_KEY_LEN      5
+#define HIST_DELTA_BIAS   2           // Varint = zigzag(delta) + bias
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Rebuilds the sample series from the byte stream of the slave
+///        register I2C_REG_FIFO. The stream can be fed in chunks of any
+///        size, a record may span two reads.
+///
+///        Delta records before the first key record are skipped. A key
+///        record with a sequence number ahead of the expected one counts
+///        the missing samples as dropped, one behind counts duplicates.
+///
+//////////////////////////////////////////////////////////////////////////////
+class HistoryDecoder {
+public:
+  typedef void (*SampleFn)(uint16_t seq, uint16_t value);
+
+  uint32_t samples = 0;               // Decoded samples
+  uint32_t dropped = 0;               // Samples missing in the sequence
+  uint32_t duplicates = 0;            // Samples received twice
+  uint32_t skipped = 0;               // Delta records before the first key
+
+  //////////////////////////////////////////////////////////////////////////////
+  /// @brief Forget the sync state (e.g. after a bus error).
+  ///
+  //////////////////////////////////////////////////////////////////////////////
+  void reset() {
+    synced = false;
+    recLen = 0;
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+  /// @brief Decode a chunk of the stream
+  ///
+  /// @param buf          Bytes read from I2C_REG_FIFO
+  /// @param len          Number of bytes
+  /// @param fn           Called for every sample (may be nullptr)
+  /// @return uint8_t     Number of padding bytes (> 0: FIFO was drained)
+  //////////////////////////////////////////////////////////////////////////////
+  uint8_t feed(const uint8_t* buf, uint8_t len, SampleFn fn) {
+    uint8_t pads = 0;
+
+    for (uint8_t i = 0; i < len; ++i) {
+      uint8_t b = buf[i];
+      if (recLen == 0) {
+        if (b == HIST_PAD) {
+          pads++;
+          continue;
+        }
+        rec[recLen++] = b;
+        if (b == HIST_KEY || (b & 0x80)) {    // Key record or varint continues
+          continue;
+        }
+      } else {
+        rec[recLen++] = b;
+        if (rec[0] == HIST_KEY ? recLen < HIST_KEY_LEN : (b & 0x80) && recLen < 2) {
+          continue;
+        }
+      }
+      decodeRecord(fn);
+      recLen = 0;
+    }
+    return pads;
+  }
+
+  uint16_t lastSeq() const { return seq; }
+  uint16_t lastValue() const { return value; }
+  bool isSynced() const { return synced; }
+
+private:
+  uint8_t rec[HIST_KEY_LEN];
+  uint8_t recLen = 0;
+  bool synced = false;
+  uint16_t seq = 0;
+  uint16_t value = 0;
+
+  void decodeRecord(SampleFn fn) {
+    if (rec[0] == HIST_KEY) {
+      uint16_t keySeq = ((uint16_t)rec[1] << 8) | rec[2];
+      if (synced) {
+        uint16_t gap = keySeq - (uint16_t)(seq + 1);
+        if (gap < 0x8000) {
+          dropped += gap;
+        } else {
+          duplicates += (uint16_t)(seq + 1 - keySeq);
+        }
+      }
+      seq = keySeq;
+      value = ((uint16_t)rec[3] << 8) | rec[4];
+      synced = true;
+    } else {
+      uint16_t z = rec[0] & 0x7F;
+      if (recLen > 1) {
+        z |= (uint16_t)rec[1] << 7;
+      }
+      if (!synced) {
+        skipped++;
+        return;
+      }
+      z -= HIST_DELTA_BIAS;
+      seq++;
+      value += (uint16_t)((z >> 1) ^ (0 - (z & 0x01)));    // zigzag -> delta
+    }
+    samples++;
+    if (fn) {
+      fn(seq, value);
+    }
+  }
+};
+
+#endif
@@ -0,0 +1,221 @@
+#ifndef _SERIAL_RECORD_H_
+#define _SERIAL_RECORD_H_
+
+#include <stdint.h>
+
+// Binary records on the serial port. Every record starts with its type,
+// multi-byte fields are big endian (like the register map of the slave),
+// a CRC-16/CCITT (poly 0x1021, init 0xFFFF) over type and payload follows.
+// The record is COBS encoded and terminated with 0x00, so a receiver
+// resynchronizes at the next 0x00 after a lost byte.
+#define REC_SAMPLE        0x01        // addr(8) seq(16) value(16)
+#define REC_STATUS        0x02        // addr(8) count(16) value(16) min(16) max(16) status(8) online(8) reads/s(16) errors(32)
+#define REC_TEXT          0x03        // Text line without line end
+#define REC_SAMPLE_LEN    6
+#define REC_STATUS_LEN    18
+#define REC_MAX_LEN       128         // Type + payload
+#define REC_FRAME_MAX     (REC_MAX_LEN + 2 + 2 + REC_MAX_LEN / 254)   // CRC, COBS overhead, delimiter
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief CRC-16/CCITT-FALSE, bitwise (records are a few bytes long)
+/// 
+/// @param data         Bytes
+/// @param len          Number of bytes
+/// @return uint16_t    CRC
+//////////////////////////////////////////////////////////////////////////////
+inline uint16_t recordCrc16(const uint8_t* data, uint16_t len) {
+  uint16_t crc = 0xFFFF;
+  for (uint16_t i = 0; i < len; ++i) {
+    crc ^= (uint16_t)data[i] << 8;
+    for (uint8_t b = 0; b < 8; ++b) {
+      crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+    }
+  }
+  return crc;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief COBS encoding: removes every 0x00 from the data. The output is
+///        at most len + 1 + len / 254 bytes long (no delimiter).
+/// 
+/// @param src          Data
+/// @param len          Number of bytes
+/// @param dst          Encoded data
+/// @return uint16_t    Number of encoded bytes
+//////////////////////////////////////////////////////////////////////////////
+inline uint16_t cobsEncode(const uint8_t* src, uint16_t len, uint8_t* dst) {
+  uint16_t codeIdx = 0;               // Position of the current code byte
+  uint16_t out = 1;
+  uint8_t code = 1;
+
+  for (uint16_t i = 0; i < len; ++i) {
+    if (src[i] != 0) {
+      dst[out++] = src[i];
+      code++;
+    }
+    if (src[i] == 0 || code == 0xFF) {
+      dst[codeIdx] = code;
+      code = 1;
+      codeIdx = out;
+      if (src[i] == 0 || i + 1 < len) {
+        out++;
+      }
+    }
+  }
+  dst[codeIdx] = code;
+  return out;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief COBS decoding
+/// 
+/// @param src          Encoded data without delimiter
+/// @param len          Number of bytes
+/// @param dst          Decoded data (at most len - 1 bytes)
+/// @return uint16_t    Number of decoded bytes, 0 on a coding error
+//////////////////////////////////////////////////////////////////////////////
+inline uint16_t cobsDecode(const uint8_t* src, uint16_t len, uint8_t* dst) {
+  uint16_t out = 0;
+  uint16_t i = 0;
+
+  while (i < len) {
+    uint8_t code = src[i++];
+    if (code == 0 || i + code - 1 > len) {
+      return 0;
+    }
+    for (uint8_t j = 1; j < code; ++j) {
+      if (src[i] == 0) {
+        return 0;
+      }
+      dst[out++] = src[i++];
+    }
+    if (code != 0xFF && i < len) {
+      dst[out++] = 0;
+    }
+  }
+  return out;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Append the CRC to a record, COBS encode it and terminate it
+///        with 0x00.
+/// 
+/// @param rec          Record (type + payload), REC_MAX_LEN + 2 bytes space
+/// @param len          Length of type + payload
+/// @param frame        Frame buffer, REC_FRAME_MAX bytes
+/// @return uint16_t    Frame length incl. delimiter
+//////////////////////////////////////////////////////////////////////////////
+inline uint16_t frameRecord(uint8_t* rec, uint16_t len, uint8_t* frame) {
+  uint16_t crc = recordCrc16(rec, len);
+  rec[len] = crc >> 8;
+  rec[len + 1] = crc & 0xFF;
+  uint16_t n = cobsEncode(rec, len + 2, frame);
+  frame[n++] = 0x00;
+  return n;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Decode a frame and check its CRC
+/// 
+/// @param frame        Frame without the 0x00 delimiter
+/// @param len          Number of bytes
+/// @param rec          Record buffer (at least len bytes)
+/// @return uint16_t    Length of type + payload, 0 if the frame is damaged
+//////////////////////////////////////////////////////////////////////////////
+inline uint16_t unframeRecord(const uint8_t* frame, uint16_t len, uint8_t* rec) {
+  uint16_t n = cobsDecode(frame, len, rec);
+  if (n < 3 || recordCrc16(rec, n - 2) != (((uint16_t)rec[n - 2] << 8) | rec[n - 1])) {
+    return 0;
+  }
+  return n - 2;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Store a 16 bit value big endian
+/// 
+//////////////////////////////////////////////////////////////////////////////
+inline uint8_t* putRecord16(uint8_t* p, uint16_t val) {
+  p[0] = val >> 8;
+  p[1] = val & 0xFF;
+  return p + 2;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// Fixed-point text without printf: the digits are produced with integer
+/// division only, so no floating point library is linked for the output.
+//////////////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Append a string
+/// 
+/// @return char*       End of the text (not terminated)
+//////////////////////////////////////////////////////////////////////////////
+inline char* appendText(char* p, const char* text) {
+  while (*text) {
+    *p++ = *text++;
+  }
+  return p;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Append an unsigned decimal number with at least minDigits digits
+/// 
+/// @return char*       End of the text (not terminated)
+//////////////////////////////////////////////////////////////////////////////
+inline char* appendUInt(char* p, uint32_t val, uint8_t minDigits = 1) {
+  char digits[10];
+  uint8_t n = 0;
+  do {
+    digits[n++] = '0' + val % 10;
+    val /= 10;
+  } while (val != 0 || n < minDigits);
+  while (n > 0) {
+    *p++ = digits[--n];
+  }
+  return p;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Append a byte as two hex digits (upper case)
+/// 
+/// @return char*       End of the text (not terminated)
+//////////////////////////////////////////////////////////////////////////////
+inline char* appendHex8(char* p, uint8_t val) {
+  static const char hex[] = "0123456789ABCDEF";
+  *p++ = hex[val >> 4];
+  *p++ = hex[val & 0x0F];
+  return p;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Append a fixed-point number: val in units of 10^-decimals,
+///        e.g. val = 2735, decimals = 4 -> "0.2735"
+/// 
+/// @return char*       End of the text (not terminated)
+//////////////////////////////////////////////////////////////////////////////
+inline char* appendFixed(char* p, uint32_t val, uint8_t decimals) {
+  uint32_t scale = 1;
+  for (uint8_t i = 0; i < decimals; ++i) {
+    scale *= 10;
+  }
+  p = appendUInt(p, val / scale);
+  if (decimals > 0) {
+    *p++ = '.';
+    p = appendUInt(p, val % scale, decimals);
+  }
+  return p;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Scale a raw value, rounded: raw * fullScale / 65535
+/// 
+/// @param raw          16 bit ADC value
+/// @param fullScale    Value of raw = 65535 in the output unit (<= 65536,
+///                     the product fits into 32 bit)
+/// @return uint32_t    Scaled value
+//////////////////////////////////////////////////////////////////////////////
+inline uint32_t scaleRaw16(uint16_t raw, uint32_t fullScale) {
+  return ((uint32_t)raw * fullScale + 32767) / 65535;
+}
+
+#endif
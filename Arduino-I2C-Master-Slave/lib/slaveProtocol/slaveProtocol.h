@@ -0,0 +1,529 @@
+#ifndef _SLAVE_PROTOCOL_H_
+#define _SLAVE_PROTOCOL_H_
+
+#include <stdint.h>
+#include "bufferToInt.h"
+#include "smbusPec.h"
+
+//////////////////////////////////////////////////////////////////////////////
+/// Register protocol of the MSP430 slave (see msp430-i2c.c of the slave):
+/// the register map and the read and write helpers of the master. All
+/// helpers work with any Wire compatible interface.
+//////////////////////////////////////////////////////////////////////////////
+
+#define I2C_ADDR_MIN      0x08        // Range of the bus scan (7 bit addresses)
+#define I2C_ADDR_MAX      0x77
+
+// Register map of the MSP430 slave (see msp430-i2c.h of the slave)
+#define I2C_REG_VALUE       0x00      // Latest median (16 bit)
+#define I2C_REG_MIN         0x02      // Minimum since reset (16 bit)
+#define I2C_REG_MAX         0x04      // Maximum since reset (16 bit)
+#define I2C_REG_COUNT       0x06      // Sample counter of VALUE (16 bit)
+#define I2C_REG_STATUS      0x08      // Status bits
+#define I2C_REG_CONFIG      0x09      // Config bits (read/write)
+#define I2C_REG_ADDR        0x0A      // Own slave address (read/write)
+#define I2C_NUM_REGS        0x0B      // Size of the register map
+#define I2C_REG_FIFO        0x0B      // Sample history stream (see historyDecoder.h)
+#define I2C_REG_PEC         0x0C      // SMBus PEC, follows I2C_REG_ADDR
+#define I2C_PEC_BLOCK       8         // FIFO bytes between two PEC bytes
+#define I2C_REG_PROFILE     0x0D      // Acquisition profile of the slave (WITH_PROFILES), read/write
+#define I2C_PROFILES        4         // Normal, fast, smooth, slow (see sd16-acq.h of the slave)
+#define I2C_REG_AGG_WINDOW  0x0E      // Statistics window of the slave (WITH_AGG): 2^k samples, read/write
+#define I2C_REG_STATS       0x10      // Counter window of the slave (WITH_STATS), write clears
+#define I2C_STATS_STATES    9         // USI ISR states of the slave
+#define I2C_STATS_SIZE      (2 * (I2C_STATS_STATES + 4))  // Bytes of the counter window
+#define I2C_REG_SCAN        0x30      // Channel block of the slave (WITH_SCAN): COUNT + channels
+#define I2C_SCAN_CHANNELS   4         // Channels of the slave scan (must match the slave build)
+#define I2C_SCAN_SIZE       (2 + 2 * I2C_SCAN_CHANNELS)   // Bytes of the channel block
+#define I2C_REG_UNITS       0x40      // Calibrated values of the slave (WITH_CAL): COUNT + channels
+#define I2C_UNITS_SIZE      I2C_SCAN_SIZE                 // Bytes of the value block
+#define I2C_REG_CAL         0x50      // Calibration window of the slave (WITH_CAL): offset, gain per channel
+#define I2C_CAL_SIZE        (4 * I2C_SCAN_CHANNELS)       // Bytes of the calibration window
+#define I2C_REG_AGG         0x60      // Window statistics of the slave (WITH_AGG): COUNT N MIN MAX MEAN VAR
+#define I2C_AGG_SIZE        18        // Bytes of the statistics block
+
+#ifndef WITH_PEC
+//#define WITH_PEC                    // The slave sends a PEC: set by the *-registers envs (must match the slave build)
+#endif
+#define I2C_PEC_ERROR       0xFF      // readRegisters(): data received, but the PEC is wrong
+#define I2C_READ_MAX        32        // Wire buffer
+
+#define I2C_STATUS_RUNNING  0x01      // Acquisition is running
+#define I2C_STATUS_NEW      0x02      // Snapshot not read yet, the read clears it (slave WITH_DRDY)
+#define I2C_STATUS_BUSY     0x04      // Triggered burst running, VALUE is an older one (slave WITH_TRIGGER)
+#define I2C_STATUS_TRIGGERED 0x08     // VALUE is the mean of a triggered burst (slave WITH_TRIGGER)
+// CONFIG requests: the slave ORs a written byte into CONFIG and clears each
+// bit when it has taken the request over. A writer sends only its own bit,
+// requests still pending from other writers stay set.
+#define I2C_CFG_RESET_MINMAX 0x01     // Restart min/max (self-clearing)
+#define I2C_CFG_SAVE_ADDR   0x02      // Take over I2C_REG_ADDR, store it in flash (self-clearing)
+#define I2C_CFG_SAVE_CAL    0x04      // Take over I2C_REG_CAL, store it in flash (self-clearing)
+#define I2C_CFG_CLOSE_AGG   0x08      // End the statistics window with the next sample (self-clearing)
+#define I2C_CFG_TRIGGER     0x10      // Start a conversion burst (self-clearing, slave WITH_TRIGGER)
+
+// Register map VALUE .. ADDR of the MSP430 slave
+typedef PackedRecord<
+  Field<uint16_t>,                    // VALUE
+  Field<uint16_t>,                    // MIN
+  Field<uint16_t>,                    // MAX
+  Field<uint16_t>,                    // COUNT
+  Field<uint8_t>,                     // STATUS
+  Field<uint8_t>,                     // CONFIG
+  Field<uint8_t>                      // ADDR
+> RegisterMap;
+
+static_assert(RegisterMap::size == I2C_NUM_REGS, "RegisterMap does not match the register map");
+static_assert(RegisterMap::offset<3>() == I2C_REG_COUNT && RegisterMap::offset<6>() == I2C_REG_ADDR,
+              "RegisterMap does not match the register map");
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Read part of a combined read with PEC (the register pointer is
+///        written). The slave sends a PEC at the end of the register map
+///        and after every I2C_PEC_BLOCK bytes of the FIFO, so a map read
+///        always runs to I2C_REG_ADDR (a counter, channel, value or
+///        calibration read to the end of its window, the profile and the
+///        statistics window are windows of one byte), a FIFO read takes
+///        whole blocks.
+///        The CRC runs over the address bytes, the pointer, the data and
+///        the PEC bytes and has to be 0 at every PEC.
+/// 
+/// @param wire         I2C interface (e.g. Wire)
+/// @param addr         Slave address
+/// @param reg          First register (already written)
+/// @param buf          Buffer for len bytes
+/// @param len          Number of bytes (FIFO: multiple of I2C_PEC_BLOCK)
+/// @return uint8_t     len on success, I2C_PEC_ERROR, 0 on a short read
+//////////////////////////////////////////////////////////////////////////////
+template <typename WIRE>
+uint8_t readWithPec(WIRE& wire, uint8_t addr, uint8_t reg, uint8_t* buf, uint8_t len) {
+  uint8_t n;                          // Bytes on the bus incl. PEC
+  uint8_t got = 0;
+  uint8_t idx = 0;
+  uint8_t crc = pecByte(pecByte(pecByte(0, addr << 1), reg), (addr << 1) | 0x01);
+
+  if (reg == I2C_REG_FIFO && len % I2C_PEC_BLOCK == 0) {
+    n = len + len / I2C_PEC_BLOCK;
+  } else if (reg < I2C_NUM_REGS && len <= I2C_NUM_REGS - reg) {
+    n = I2C_NUM_REGS - reg + 1;
+  } else if ((reg == I2C_REG_PROFILE || reg == I2C_REG_AGG_WINDOW) && len == 1) {
+    n = 2;
+  } else if (reg >= I2C_REG_AGG && len <= I2C_REG_AGG + I2C_AGG_SIZE - reg) {
+    n = I2C_REG_AGG + I2C_AGG_SIZE - reg + 1;
+  } else if (reg >= I2C_REG_CAL && len <= I2C_REG_CAL + I2C_CAL_SIZE - reg) {
+    n = I2C_REG_CAL + I2C_CAL_SIZE - reg + 1;
+  } else if (reg >= I2C_REG_UNITS && len <= I2C_REG_UNITS + I2C_UNITS_SIZE - reg) {
+    n = I2C_REG_UNITS + I2C_UNITS_SIZE - reg + 1;
+  } else if (reg >= I2C_REG_SCAN && len <= I2C_REG_SCAN + I2C_SCAN_SIZE - reg) {
+    n = I2C_REG_SCAN + I2C_SCAN_SIZE - reg + 1;
+  } else if (reg >= I2C_REG_STATS && len <= I2C_REG_STATS + I2C_STATS_SIZE - reg) {
+    n = I2C_REG_STATS + I2C_STATS_SIZE - reg + 1;
+  } else {
+    return 0;
+  }
+  if (n > I2C_READ_MAX) {
+    return 0;
+  }
+  wire.requestFrom(addr, n);
+  while (wire.available() && got < n) {
+    uint8_t b = wire.read();
+    crc = pecByte(crc, b);
+    got++;
+    if (reg == I2C_REG_FIFO ? got % (I2C_PEC_BLOCK + 1) == 0 : got == n) {
+      if (crc != 0) {
+        return I2C_PEC_ERROR;
+      }
+    } else if (idx < len) {
+      buf[idx++] = b;
+    }
+  }
+  return got == n ? idx : 0;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Read consecutive registers of a slave in one transaction:
+///        write the register pointer, repeated start, read len bytes.
+/// 
+/// @param wire         I2C interface (e.g. Wire)
+/// @param addr         Slave address
+/// @param reg          First register
+/// @param buf          Buffer for len bytes
+/// @param len          Number of bytes to read
+/// @return uint8_t     Number of bytes received (len on success),
+///                     I2C_PEC_ERROR: corrupted transfer (WITH_PEC)
+//////////////////////////////////////////////////////////////////////////////
+template <typename WIRE>
+uint8_t readRegisters(WIRE& wire, uint8_t addr, uint8_t reg, uint8_t* buf, uint8_t len) {
+  wire.beginTransmission(addr);
+  wire.write(reg);
+  if (wire.endTransmission(false) != 0) {     // No stop: repeated start follows
+    return 0;
+  }
+#ifdef WITH_PEC
+  return readWithPec(wire, addr, reg, buf, len);
+#else
+  uint8_t idx = 0;
+  wire.requestFrom(addr, len);
+  while (wire.available() && idx < len) {
+    buf[idx++] = wire.read();
+  }
+  return idx;
+#endif
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Read a 16 Bit signed/unsigned register of a slave
+/// 
+/// @param wire         I2C interface (e.g. Wire)
+/// @param addr         Slave address
+/// @param reg          Register of the high byte
+/// @param val          Register value
+/// @return true        Success
+//////////////////////////////////////////////////////////////////////////////
+template <typename R, typename WIRE>
+bool readRegister16(WIRE& wire, uint8_t addr, uint8_t reg, R& val) {
+  uint8_t buf[2];
+  if (readRegisters(wire, addr, reg, buf, 2) != 2) {
+    return false;
+  }
+  val = decodeInt<R, Endian::Big, 2>(buf);
+  return true;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Write consecutive registers of a slave
+/// 
+/// @param wire         I2C interface (e.g. Wire)
+/// @param addr         Slave address
+/// @param reg          First register
+/// @param buf          Register values
+/// @param len          Number of registers
+/// @return true        Success
+//////////////////////////////////////////////////////////////////////////////
+template <typename WIRE>
+bool writeRegisters(WIRE& wire, uint8_t addr, uint8_t reg, const uint8_t* buf, uint8_t len) {
+  wire.beginTransmission(addr);
+  wire.write(reg);
+  wire.write(buf, len);
+  return wire.endTransmission() == 0;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Check whether a sensor node answers at an address: the address
+///        is acknowledged and the node reports it in I2C_REG_ADDR. Other
+///        devices on the bus are not taken for nodes.
+/// 
+/// @param wire         I2C interface (e.g. Wire)
+/// @param addr         Address to probe
+/// @return true        A node answers
+//////////////////////////////////////////////////////////////////////////////
+template <typename WIRE>
+bool probeSlave(WIRE& wire, uint8_t addr) {
+  uint8_t own;
+  return readRegisters(wire, addr, I2C_REG_ADDR, &own, 1) == 1 && own == addr;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Give a node a new address. The node stores it in its info flash
+///        and answers at the new address from then on. Only one node may
+///        answer at the old address.
+/// 
+///        The flash erase holds the slave CPU for about 15 ms, SCL is
+///        stretched meanwhile.
+/// 
+/// @param wire         I2C interface (e.g. Wire)
+/// @param addr         Current address
+/// @param newAddr      New address (I2C_ADDR_MIN .. I2C_ADDR_MAX)
+/// @return true        Request sent. Check the result with probeSlave()
+//////////////////////////////////////////////////////////////////////////////
+template <typename WIRE>
+bool setSlaveAddress(WIRE& wire, uint8_t addr, uint8_t newAddr) {
+  uint8_t cfg = I2C_CFG_SAVE_ADDR;
+  if (newAddr < I2C_ADDR_MIN || newAddr > I2C_ADDR_MAX) {
+    return false;
+  }
+  // Two transfers: the node must see ADDR before the SAVE request
+  return writeRegisters(wire, addr, I2C_REG_ADDR, &newAddr, 1)
+      && writeRegisters(wire, addr, I2C_REG_CONFIG, &cfg, 1);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Hot-path counters of a node (slave built WITH_STATS). 16 bit
+///        counters that wrap around: work with differences.
+//////////////////////////////////////////////////////////////////////////////
+struct NodeStats {
+  uint16_t isrState[I2C_STATS_STATES];  // USI ISR runs per state (IDLE .. PREP_START)
+  uint16_t nacks;                       // Address bytes for other nodes
+  uint16_t aborts;                      // START in the middle of a transfer
+  uint16_t conversions;                 // SD16 results
+  uint16_t latencyMax;                  // Worst conversion -> publish time, Timer_A ticks
+};
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Read the counters of a node in one transaction
+/// 
+/// @param wire         I2C interface (e.g. Wire)
+/// @param addr         Slave address
+/// @param stats        Counters
+/// @return true        Success
+//////////////////////////////////////////////////////////////////////////////
+template <typename WIRE>
+bool readNodeStats(WIRE& wire, uint8_t addr, NodeStats& stats) {
+  uint8_t buf[I2C_STATS_SIZE];
+  if (readRegisters(wire, addr, I2C_REG_STATS, buf, I2C_STATS_SIZE) != I2C_STATS_SIZE) {
+    return false;
+  }
+  for (uint8_t i = 0; i < I2C_STATS_STATES; ++i) {
+    stats.isrState[i] = decodeInt<uint16_t>(buf + 2 * i);
+  }
+  stats.nacks = decodeInt<uint16_t>(buf + 2 * I2C_STATS_STATES);
+  stats.aborts = decodeInt<uint16_t>(buf + 2 * I2C_STATS_STATES + 2);
+  stats.conversions = decodeInt<uint16_t>(buf + 2 * I2C_STATS_STATES + 4);
+  stats.latencyMax = decodeInt<uint16_t>(buf + 2 * I2C_STATS_STATES + 6);
+  return true;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Clear the counters of a node
+/// 
+/// @param wire         I2C interface (e.g. Wire)
+/// @param addr         Slave address
+/// @return true        Success
+//////////////////////////////////////////////////////////////////////////////
+template <typename WIRE>
+bool clearNodeStats(WIRE& wire, uint8_t addr) {
+  uint8_t any = 0;
+  return writeRegisters(wire, addr, I2C_REG_STATS, &any, 1);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Channel block of a node (slave built WITH_SCAN): the filtered
+///        value of every scanned input, all from the same scan.
+//////////////////////////////////////////////////////////////////////////////
+struct NodeScan {
+  uint16_t count;                       // Sample counter (= COUNT of the same snapshot)
+  uint16_t value[I2C_SCAN_CHANNELS];    // A1, battery (AVCC / 11), temperature, A2
+};
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Read the channel block of a node in one transaction
+/// 
+/// @param wire         I2C interface (e.g. Wire)
+/// @param addr         Slave address
+/// @param scan         Channel values
+/// @return true        Success
+//////////////////////////////////////////////////////////////////////////////
+template <typename WIRE>
+bool readNodeScan(WIRE& wire, uint8_t addr, NodeScan& scan) {
+  uint8_t buf[I2C_SCAN_SIZE];
+  if (readRegisters(wire, addr, I2C_REG_SCAN, buf, I2C_SCAN_SIZE) != I2C_SCAN_SIZE) {
+    return false;
+  }
+  scan.count = decodeInt<uint16_t>(buf);
+  for (uint8_t i = 0; i < I2C_SCAN_CHANNELS; ++i) {
+    scan.value[i] = decodeInt<uint16_t>(buf + 2 + 2 * i);
+  }
+  return true;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Value block of a node (slave built WITH_CAL): the channel block
+///        calibrated into engineering units by the slave.
+//////////////////////////////////////////////////////////////////////////////
+struct NodeUnits {
+  uint16_t count;                       // Sample counter (= COUNT of the same snapshot)
+  int16_t value[I2C_SCAN_CHANNELS];     // Defaults: A1 0.1 mV, battery mV, temperature 0.1 °C, A2 0.1 mV
+};
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Calibration of one channel: value = (raw - offset) * gain / 2^16
+//////////////////////////////////////////////////////////////////////////////
+struct NodeCal {
+  uint16_t offset;                      // Raw code of the value 0
+  uint16_t gain;                        // Units per raw LSB, Q0.16
+};
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Read the value block of a node in one transaction
+/// 
+/// @param wire         I2C interface (e.g. Wire)
+/// @param addr         Slave address
+/// @param units        Calibrated values
+/// @return true        Success
+//////////////////////////////////////////////////////////////////////////////
+template <typename WIRE>
+bool readNodeUnits(WIRE& wire, uint8_t addr, NodeUnits& units) {
+  uint8_t buf[I2C_UNITS_SIZE];
+  if (readRegisters(wire, addr, I2C_REG_UNITS, buf, I2C_UNITS_SIZE) != I2C_UNITS_SIZE) {
+    return false;
+  }
+  units.count = decodeInt<uint16_t>(buf);
+  for (uint8_t i = 0; i < I2C_SCAN_CHANNELS; ++i) {
+    units.value[i] = decodeInt<int16_t>(buf + 2 + 2 * i);
+  }
+  return true;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Read the active calibration of a node
+/// 
+/// @param wire         I2C interface (e.g. Wire)
+/// @param addr         Slave address
+/// @param cal          Coefficients of all channels
+/// @return true        Success
+//////////////////////////////////////////////////////////////////////////////
+template <typename WIRE>
+bool readCalibration(WIRE& wire, uint8_t addr, NodeCal (&cal)[I2C_SCAN_CHANNELS]) {
+  uint8_t buf[I2C_CAL_SIZE];
+  if (readRegisters(wire, addr, I2C_REG_CAL, buf, I2C_CAL_SIZE) != I2C_CAL_SIZE) {
+    return false;
+  }
+  for (uint8_t i = 0; i < I2C_SCAN_CHANNELS; ++i) {
+    cal[i].offset = decodeInt<uint16_t>(buf + 4 * i);
+    cal[i].gain = decodeInt<uint16_t>(buf + 4 * i + 2);
+  }
+  return true;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Calibrate one channel of a node. The node takes the coefficients
+///        over with its next sample and stores them in its info flash.
+/// 
+///        The flash erase holds the slave CPU for about 15 ms, SCL is
+///        stretched meanwhile.
+/// 
+/// @param wire         I2C interface (e.g. Wire)
+/// @param addr         Slave address
+/// @param ch           Channel
+/// @param cal          New coefficients
+/// @return true        Request sent. Check the result with readCalibration()
+//////////////////////////////////////////////////////////////////////////////
+template <typename WIRE>
+bool writeCalibration(WIRE& wire, uint8_t addr, uint8_t ch, const NodeCal& cal) {
+  uint8_t buf[4] = {
+    (uint8_t)(cal.offset >> 8), (uint8_t)cal.offset, (uint8_t)(cal.gain >> 8), (uint8_t)cal.gain
+  };
+  uint8_t cfg = I2C_CFG_SAVE_CAL;
+  if (ch >= I2C_SCAN_CHANNELS) {
+    return false;
+  }
+  // Two transfers: the node must see the window before the SAVE request
+  return writeRegisters(wire, addr, I2C_REG_CAL + 4 * ch, buf, 4)
+      && writeRegisters(wire, addr, I2C_REG_CONFIG, &cfg, 1);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Select the acquisition profile of a node (slave WITH_PROFILES).
+///        The node switches with its next sample; the samples per second
+///        and the noise change with the profile (see the slave README).
+/// 
+/// @param wire         I2C interface (e.g. Wire)
+/// @param addr         Slave address
+/// @param profile      Profile (0 .. I2C_PROFILES - 1)
+/// @return true        Request sent. Check the result with readProfile()
+//////////////////////////////////////////////////////////////////////////////
+template <typename WIRE>
+bool setProfile(WIRE& wire, uint8_t addr, uint8_t profile) {
+  if (profile >= I2C_PROFILES) {
+    return false;
+  }
+  return writeRegisters(wire, addr, I2C_REG_PROFILE, &profile, 1);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Read the acquisition profile of a node (slave WITH_PROFILES)
+/// 
+/// @param wire         I2C interface (e.g. Wire)
+/// @param addr         Slave address
+/// @param profile      Active (or just requested) profile
+/// @return true        Success
+//////////////////////////////////////////////////////////////////////////////
+template <typename WIRE>
+bool readProfile(WIRE& wire, uint8_t addr, uint8_t& profile) {
+  return readRegisters(wire, addr, I2C_REG_PROFILE, &profile, 1) == 1;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Window statistics of a node (slave WITH_AGG): min, max, mean and
+///        variance of the medians of the last closed window.
+//////////////////////////////////////////////////////////////////////////////
+struct NodeAggregate {
+  uint16_t count;                       // Sample counter of the last sample of the window
+  uint16_t n;                           // Samples in the window
+  uint16_t min;
+  uint16_t max;
+  uint32_t mean;                        // Raw LSB, Q16.16
+  uint64_t var;                         // Sample variance, LSB^2, Q32.16
+};
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Read the statistics block of a node in one transaction
+/// 
+/// @param wire         I2C interface (e.g. Wire)
+/// @param addr         Slave address
+/// @param agg          Statistics of the last closed window
+/// @return true        Success
+//////////////////////////////////////////////////////////////////////////////
+template <typename WIRE>
+bool readNodeAggregate(WIRE& wire, uint8_t addr, NodeAggregate& agg) {
+  uint8_t buf[I2C_AGG_SIZE];
+  if (readRegisters(wire, addr, I2C_REG_AGG, buf, I2C_AGG_SIZE) != I2C_AGG_SIZE) {
+    return false;
+  }
+  agg.count = decodeInt<uint16_t>(buf);
+  agg.n = decodeInt<uint16_t>(buf + 2);
+  agg.min = decodeInt<uint16_t>(buf + 4);
+  agg.max = decodeInt<uint16_t>(buf + 6);
+  agg.mean = decodeInt<uint32_t>(buf + 8);
+  agg.var = decodeInt<uint64_t, Endian::Big, 6>(buf + 12);
+  return true;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief End the statistics window of a node with its next sample. The
+///        block holds the closed window from then on, the next one starts.
+/// 
+/// @param wire         I2C interface (e.g. Wire)
+/// @param addr         Slave address
+/// @return true        Request sent
+//////////////////////////////////////////////////////////////////////////////
+template <typename WIRE>
+bool closeAggregate(WIRE& wire, uint8_t addr) {
+  uint8_t cfg = I2C_CFG_CLOSE_AGG;
+  return writeRegisters(wire, addr, I2C_REG_CONFIG, &cfg, 1);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Ask a node for a fresh value (slave WITH_TRIGGER): the node starts
+///        a conversion burst at once. Read the map until STATUS has
+///        I2C_STATUS_TRIGGERED instead of I2C_STATUS_BUSY (after ~ 2 ms,
+///        or on the data-ready line, cleared after this call: a pulse
+///        before was a paced sample); VALUE is then the mean of the burst.
+/// 
+/// @param wire         I2C interface (e.g. Wire)
+/// @param addr         Slave address
+/// @return true        Request sent
+//////////////////////////////////////////////////////////////////////////////
+template <typename WIRE>
+bool triggerConversion(WIRE& wire, uint8_t addr) {
+  uint8_t cfg = I2C_CFG_TRIGGER;
+  return writeRegisters(wire, addr, I2C_REG_CONFIG, &cfg, 1);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Set the longest statistics window of a node: 2^k samples.
+///        With k = 0 a window only ends with closeAggregate().
+/// 
+/// @param wire         I2C interface (e.g. Wire)
+/// @param addr         Slave address
+/// @param k            0 .. 15
+/// @return true        Request sent
+//////////////////////////////////////////////////////////////////////////////
+template <typename WIRE>
+bool setAggWindow(WIRE& wire, uint8_t addr, uint8_t k) {
+  if (k > 15) {
+    return false;
+  }
+  return writeRegisters(wire, addr, I2C_REG_AGG_WINDOW, &k, 1);
+}
+
+#endif
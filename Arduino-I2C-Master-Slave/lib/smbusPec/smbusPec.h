@@ -0,0 +1,107 @@
+#ifndef _SMBUSPEC_H_
+#define _SMBUSPEC_H_
+
+#include <stdint.h>
+
+//////////////////////////////////////////////////////////////////////////////
+/// SMBus Packet Error Code: CRC-8, polynomial 0x07, init 0 (same as
+/// smbus-pec.c of the slave). The CRC over a message followed by its PEC
+/// is 0, so a receiver runs the CRC over everything and checks for 0.
+///
+/// The implementation is a template parameter; both tables are built by
+/// the compiler from pecBits(), nothing is typed in by hand.
+//////////////////////////////////////////////////////////////////////////////
+
+enum class PecImpl : uint8_t { Bitwise, Nibble, Table };
+
+#ifndef MASTER_PEC_IMPL
+#define MASTER_PEC_IMPL PecImpl::Table    // Implementation used by pecByte()
+#endif
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Shift BITS bits through the CRC (message bits already xored in)
+///
+//////////////////////////////////////////////////////////////////////////////
+constexpr uint8_t pecBits(uint8_t crc, uint8_t bits = 8) {
+  return bits == 0 ? crc
+    : pecBits((crc & 0x80) ? (uint8_t)((crc << 1) ^ 0x07) : (uint8_t)(crc << 1), bits - 1);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Lookup table for BITS bits per step: entry i is the CRC of the
+///        BITS bit value i (in the top bits). Built by recursion over the
+///        entries, PecTableOf<BITS, 0, ...> holds the finished list.
+///
+//////////////////////////////////////////////////////////////////////////////
+template <uint8_t BITS, uint16_t N, uint8_t... V>
+struct PecTableOf : PecTableOf<BITS, N - 1, pecBits((uint8_t)((N - 1) << (8 - BITS)), BITS), V...> {};
+
+template <uint8_t BITS, uint8_t... V>
+struct PecTableOf<BITS, 0, V...> {
+  static const uint8_t table[sizeof...(V)];
+};
+
+template <uint8_t BITS, uint8_t... V>
+const uint8_t PecTableOf<BITS, 0, V...>::table[sizeof...(V)] = { V... };
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief CRC-8 of one more byte: Pec<I>::update(crc, data)
+///
+//////////////////////////////////////////////////////////////////////////////
+template <PecImpl I> struct Pec;
+
+template <> struct Pec<PecImpl::Bitwise> {
+  static const uint16_t tableSize = 0;
+  static uint8_t update(uint8_t crc, uint8_t data) {
+    crc ^= data;
+    for (uint8_t i = 0; i < 8; ++i) {
+      crc = (crc & 0x80) ? (uint8_t)((crc << 1) ^ 0x07) : (uint8_t)(crc << 1);
+    }
+    return crc;
+  }
+};
+
+template <> struct Pec<PecImpl::Nibble> {
+  static const uint16_t tableSize = 16;
+  static uint8_t update(uint8_t crc, uint8_t data) {
+    const uint8_t* t = PecTableOf<4, 16>::table;
+    crc ^= data;
+    crc = (uint8_t)(crc << 4) ^ t[crc >> 4];
+    return (uint8_t)(crc << 4) ^ t[crc >> 4];
+  }
+};
+
+template <> struct Pec<PecImpl::Table> {
+  static const uint16_t tableSize = 256;
+  static uint8_t update(uint8_t crc, uint8_t data) {
+    return PecTableOf<8, 256>::table[(uint8_t)(crc ^ data)];
+  }
+};
+
+static_assert(pecBits(0x01) == 0x07 && pecBits(0x80) == 0x89, "CRC-8 polynomial 0x07");
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief CRC-8 of one more byte with the implementation MASTER_PEC_IMPL
+///
+//////////////////////////////////////////////////////////////////////////////
+inline uint8_t pecByte(uint8_t crc, uint8_t data) {
+  return Pec<MASTER_PEC_IMPL>::update(crc, data);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief CRC-8 of more bytes
+///
+/// @param crc          CRC so far (0 at the start of a message)
+/// @param buf          Bytes
+/// @param len          Number of bytes
+/// @return uint8_t     New CRC
+//////////////////////////////////////////////////////////////////////////////
+template <PecImpl I = MASTER_PEC_IMPL>
+uint8_t pecBlock(uint8_t crc, const uint8_t* buf, uint8_t len) {
+  for (uint8_t i = 0; i < len; ++i) {
+    crc = Pec<I>::update(crc, buf[i]);
+  }
+  return crc;
+}
+
+#endif
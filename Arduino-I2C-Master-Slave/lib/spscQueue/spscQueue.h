@@ -0,0 +1,132 @@
+#ifndef _SPSC_QUEUE_H_
+#define _SPSC_QUEUE_H_
+
+#include <stdint.h>
+#include <atomic>
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Lock-free ring of N slots between exactly one producer and one
+///        consumer, e.g. the two cores of the RP2040.
+///
+///        head is only written by the producer, tail only by the consumer.
+///        The producer fills slots in place (reserve, slot, publish) and
+///        makes them visible with a release store of head; the consumer
+///        reads them in place (front) and gives them back with a release
+///        store of tail. Only atomic loads and stores are used, no
+///        read-modify-write: that is lock-free on a Cortex-M0+ as well.
+///        Each side keeps a copy of the other index and only loads it
+///        again when the copy says full (empty).
+///
+///        The indices run freely over 16 bit, N has to be a power of 2.
+///
+//////////////////////////////////////////////////////////////////////////////
+template <typename T, uint16_t N>
+class SpscQueue {
+  static_assert(N >= 2 && N <= 0x8000 && (N & (N - 1)) == 0, "N has to be a power of 2");
+
+public:
+  uint16_t maxDepth = 0;              // Highest depth seen by publish (producer)
+
+  //////////////////////////////////////////////////////////////////////////////
+  /// @brief Producer: make sure n slots are free
+  ///
+  /// @param n            Number of slots
+  /// @return true        slot(0) .. slot(n - 1) may be filled
+  //////////////////////////////////////////////////////////////////////////////
+  bool reserve(uint16_t n) {
+    uint16_t h = head.load(std::memory_order_relaxed);
+    if ((uint16_t)(h - tailCache) + n <= N) {
+      return true;
+    }
+    tailCache = tail.load(std::memory_order_acquire);
+    return (uint16_t)(h - tailCache) + n <= N;
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+  /// @brief Producer: the i-th reserved slot
+  ///
+  //////////////////////////////////////////////////////////////////////////////
+  T& slot(uint16_t i) {
+    return slots[(uint16_t)(head.load(std::memory_order_relaxed) + i) & (N - 1)];
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+  /// @brief Producer: hand the first n reserved slots to the consumer
+  ///
+  //////////////////////////////////////////////////////////////////////////////
+  void publish(uint16_t n = 1) {
+    uint16_t h = head.load(std::memory_order_relaxed) + n;
+    uint16_t depth = h - tail.load(std::memory_order_relaxed);
+    if (depth > maxDepth) {
+      maxDepth = depth;
+    }
+    head.store(h, std::memory_order_release);
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+  /// @brief Producer: copy one element into the queue
+  ///
+  /// @return true        Queued, false: queue full
+  //////////////////////////////////////////////////////////////////////////////
+  bool push(const T& val) {
+    if (!reserve(1)) {
+      return false;
+    }
+    slot(0) = val;
+    publish(1);
+    return true;
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+  /// @brief Consumer: the oldest element, it stays in the queue until pop()
+  ///
+  /// @return T*          Element, nullptr if the queue is empty
+  //////////////////////////////////////////////////////////////////////////////
+  T* front() {
+    uint16_t t = tail.load(std::memory_order_relaxed);
+    if (t == headCache) {
+      headCache = head.load(std::memory_order_acquire);
+      if (t == headCache) {
+        return nullptr;
+      }
+    }
+    return &slots[t & (N - 1)];
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+  /// @brief Consumer: drop the element returned by front()
+  ///
+  //////////////////////////////////////////////////////////////////////////////
+  void pop() {
+    tail.store(tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+  /// @brief Elements in the queue. Exact only on a side that is idle, a
+  ///        snapshot otherwise (statistics).
+  ///
+  //////////////////////////////////////////////////////////////////////////////
+  uint16_t depth() const {
+    return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire);
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+  /// @brief Empty the queue and clear the statistics. Neither side may run.
+  ///
+  //////////////////////////////////////////////////////////////////////////////
+  void clear() {
+    head.store(0, std::memory_order_relaxed);
+    tail.store(0, std::memory_order_relaxed);
+    tailCache = headCache = 0;
+    maxDepth = 0;
+  }
+
+private:
+  std::atomic<uint16_t> head{0};      // Next slot to publish (producer)
+  uint16_t tailCache = 0;             // Last tail seen by the producer
+  std::atomic<uint16_t> tail{0};      // Next slot to consume (consumer)
+  uint16_t headCache = 0;             // Last head seen by the consumer
+  T slots[N];
+};
+
+#endif
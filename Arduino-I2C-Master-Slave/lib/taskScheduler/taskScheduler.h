@@ -0,0 +1,174 @@
+#ifndef _TASK_SCHEDULER_H_
+#define _TASK_SCHEDULER_H_
+
+#include <stdint.h>
+
+#define SCHED_HIST_BINS 8             // Bins of the latency histogram
+
+// Upper limits (µs) of the latency bins, the last bin takes everything above
+static const uint32_t schedBinLimits[SCHED_HIST_BINS - 1] = {
+  10, 50, 100, 500, 1000, 2000, 5000
+};
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief A periodic task and its timing statistics. All times in µs.
+///
+///        Latency is the time from the release (due) of a task to its
+///        start. A start after the next release was due counts as one
+///        miss, however many periods have passed: the releases in between
+///        are skipped, the task keeps its phase.
+///
+//////////////////////////////////////////////////////////////////////////////
+struct SchedTask {
+  const char* name;
+  void (*fn)(void);
+  void (*fnArg)(void*);               // Instead of fn: task with argument
+  void* arg;
+  uint32_t period;                    // 0: run whenever nothing else is due
+  uint32_t due;                       // Next release (micros())
+
+  uint32_t runs;                      // Started releases
+  uint32_t misses;                    // Starts later than one period
+  uint32_t maxLatency;                // Worst release to start time
+  uint32_t maxRun;                    // Worst run time
+  uint32_t hist[SCHED_HIST_BINS];     // Release to start latency
+};
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Cooperative scheduler for up to N periodic tasks.
+///
+///        run() starts at most one task: the due task with the earliest
+///        release (earliest deadline first), and returns. Tasks must not
+///        block; they do a bounded piece of work and hand the rest over
+///        to the next stage (e.g. through a queue).
+///
+///        TIME is a clock function like micros(), wrap-around safe.
+///
+//////////////////////////////////////////////////////////////////////////////
+template <uint8_t N, unsigned long (*TIME)(void)>
+class TaskScheduler {
+public:
+  SchedTask tasks[N];
+  uint8_t count = 0;
+
+  //////////////////////////////////////////////////////////////////////////////
+  /// @brief Add a task. The first release is one period from now.
+  ///
+  /// @param name         Name for the statistics
+  /// @param fn           Task function
+  /// @param period       Period in µs
+  /// @return SchedTask*  The task, nullptr if the table is full
+  //////////////////////////////////////////////////////////////////////////////
+  SchedTask* add(const char* name, void (*fn)(void), uint32_t period) {
+    if (count >= N) {
+      return nullptr;
+    }
+    SchedTask* t = &tasks[count++];
+    *t = SchedTask();
+    t->name = name;
+    t->fn = fn;
+    t->period = period;
+    t->due = (uint32_t)TIME() + period;
+    return t;
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+  /// @brief Add a task that is called with an argument, e.g. one task per
+  ///        bus device sharing the same function.
+  ///
+  /// @param name         Name for the statistics
+  /// @param fn           Task function
+  /// @param arg          Argument of fn
+  /// @param period       Period in µs
+  /// @return SchedTask*  The task, nullptr if the table is full
+  //////////////////////////////////////////////////////////////////////////////
+  SchedTask* add(const char* name, void (*fn)(void*), void* arg, uint32_t period) {
+    SchedTask* t = add(name, (void (*)(void))nullptr, period);
+    if (t != nullptr) {
+      t->fnArg = fn;
+      t->arg = arg;
+    }
+    return t;
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+  /// @brief Run the most urgent due task, if any.
+  ///
+  /// @return true        A task was run
+  //////////////////////////////////////////////////////////////////////////////
+  bool run() {
+    uint32_t now = (uint32_t)TIME();
+    SchedTask* next = nullptr;
+    uint32_t nextLate = 0;
+
+    for (uint8_t i = 0; i < count; ++i) {
+      uint32_t late = now - tasks[i].due;
+      if ((int32_t)late >= 0 && (next == nullptr || late > nextLate)) {
+        next = &tasks[i];
+        nextLate = late;
+      }
+    }
+    if (next == nullptr) {
+      return false;
+    }
+
+    if (next->period == 0) {
+      next->due = now;                // Background task: due again at once
+    } else {
+      if (nextLate >= next->period) {
+        next->misses++;               // One late start, the skipped releases do not run
+        next->due += (nextLate / next->period) * next->period;
+      }
+      next->due += next->period;
+    }
+    next->runs++;
+    record(next, nextLate);
+
+    if (next->fnArg != nullptr) {
+      next->fnArg(next->arg);
+    } else {
+      next->fn();
+    }
+    uint32_t runTime = (uint32_t)TIME() - now;
+    if (runTime > next->maxRun) {
+      next->maxRun = runTime;
+    }
+    return true;
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+  /// @brief Remove all tasks.
+  ///
+  //////////////////////////////////////////////////////////////////////////////
+  void clear() {
+    count = 0;
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+  /// @brief Clear the statistics of all tasks.
+  ///
+  //////////////////////////////////////////////////////////////////////////////
+  void resetStats() {
+    for (uint8_t i = 0; i < count; ++i) {
+      SchedTask* t = &tasks[i];
+      t->runs = t->misses = t->maxLatency = t->maxRun = 0;
+      for (uint8_t b = 0; b < SCHED_HIST_BINS; ++b) {
+        t->hist[b] = 0;
+      }
+    }
+  }
+
+private:
+  static void record(SchedTask* t, uint32_t latency) {
+    uint8_t b = 0;
+    while (b < SCHED_HIST_BINS - 1 && latency > schedBinLimits[b]) {
+      ++b;
+    }
+    t->hist[b]++;
+    if (latency > t->maxLatency) {
+      t->maxLatency = latency;
+    }
+  }
+};
+
+#endif
@@ -14,22 +14,180 @@
 #include <Wire.h>
 
 #include "bufferToInt.h"
+#include "slaveProtocol.h"
+#include "historyDecoder.h"
+#include "serialRecord.h"
+#include "taskScheduler.h"
 
 #define UNSIGNED                    // Display values are unsigned. Comment out for display signed values 
-#define NUMBER_OF_BYTES 2           // Can be 2 or 4.
+#define NUMBER_OF_BYTES 2           // Can be 1 .. 4 (plain reads)
+//#define READ_REGISTERS            // Read the register map of the MSP430 slave instead of plain reads (set by the
+                                    // *-registers envs)
+//#define READ_HISTORY              // Drain the sample history of the slave (needs READ_REGISTERS, *-registers envs)
+#define HISTORY_CHUNK   8           // Bytes per FIFO read. Short reads keep the bus stage short
+//#define READ_SCAN                 // Print the channel block of every node (slave WITH_SCAN, needs READ_REGISTERS).
+                                    // A block read holds the scheduler for ~ 4 ms with a slave at 1 MHz
+//#define READ_UNITS                // Print the calibrated channels of every node (slave WITH_CAL, needs READ_REGISTERS).
+                                    // The slave converts, the master only formats integers. Holds the scheduler like READ_SCAN
+//#define READ_AGG                  // Print the window statistics of every node (slave WITH_AGG, needs READ_REGISTERS).
+                                    // One block read per AGG_PERIOD_US replaces the polls for host side aggregates
+//#define DATA_READY                // Read when the data-ready line falls (slave WITH_DRDY) instead of polling blindly.
+                                    // Register mode: POLL_PERIOD_US becomes READY_TIMEOUT_US (lost pulses, nodes without it)
+#define DATA_READY_PIN  14          // Data-ready line, shared by all nodes, pull-up. GPIO14 (D5) of the esp12e, GP14
+                                    // of the pico: no boot strap pin (esp12e GPIO0/2/15), not SDA/SCL (GPIO4/5 on both)
+//#define DUAL_CORE                 // RP2040 (set by the pico-registers env): core 0 owns the bus and the scheduler, core 1
+                                    // (loop1) decodes, formats and writes the serial port. Needs READ_REGISTERS
+
+// Serial output format of the register mode, see "format" command
+#define OUT_TEXT        0           // Text, voltages with sprintf("%f") (floating point)
+#define OUT_FIXED       1           // Same text, integer fixed-point formatting
+#define OUT_COBS        2           // COBS framed binary records (serialRecord.h)
+#ifndef OUTPUT_FORMAT
+#define OUTPUT_FORMAT   OUT_TEXT    // The *-registers envs set OUT_FIXED
+#endif
+#define VREF_100UV      6000        // 0.6 V full scale of the SD16 in 0.1 mV
+#define VBAT_MV         3250        // Battery voltage at full scale in mV
+
+// Slave table of the register mode. The bus is scanned at startup (and on
+// the serial command "scan"), every node found gets its own poll task.
+#define MAX_SLAVES         8        // Nodes in the slave table
+#define NODE_MAX_ERRORS    3        // Consecutive failed transfers until a node is offline
+#define NODE_RETRY_US      1000000  // Poll period of an offline node
+#define ADDR_SETTLE_US     100000   // Scan after an address change: the node stores it first
+
+// Task periods of the register mode (µs)
+#define POLL_PERIOD_US     5000     // Register read (VALUE .. ADDR) per node, see "rate" command
+#define READY_TIMEOUT_US   1000000  // Register read per node without a data-ready pulse (DATA_READY)
+#define HISTORY_PERIOD_US  20000    // FIFO read per node. The slave FIFO holds 16 (F2013) or 128 (G2553) bytes
+#define DECODE_PERIOD_US   5000     // Decode one FIFO chunk, format the samples. Longer than a bus read (~ 3.3 ms)
+#define SERIAL_PERIOD_US   5000     // Feed the serial port without blocking. 128 byte UART FIFO: ~ 11 ms at 115200
+#define COMMAND_PERIOD_US  20000    // Serial commands
+#define STATUS_PERIOD_US   1000000  // Register values and counters
+#define STATS_PERIOD_US    10000000 // Scheduler latency histograms
+#define DUMP_PERIOD_US     1000000  // Slave counters of the "dump" command
+#define SCAN_PERIOD_US     1000000  // Channel block of every node
+#define UNITS_PERIOD_US    1000000  // Value block of every node
+#define AGG_PERIOD_US      2000000  // Statistics block of every node, then the next window is requested
+#define RAW_CHUNKS         4        // FIFO chunks between bus and decode stage
+#define PIPE_DEPTH         64       // Items between bus core and output core (DUAL_CORE), 37 bytes each
+#define CHUNK_OUT_SPACE    384      // Text buffer space the output core needs for the samples of a chunk
+#define OUT_BUFFER_SIZE    2048     // Text between format and serial stage
+#define COMMAND_SIZE       24       // Serial command line
 
 //////////////////////////////////////////////////////////////////////////////
 /// global variable(s)
 //////////////////////////////////////////////////////////////////////////////
-#if (NUMBER_OF_BYTES == 2)
-  uint8_t buffer[NUMBER_OF_BYTES] = {0,0};
-#elif (NUMBER_OF_BYTES == 4)
-  uint8_t buffer[NUMBER_OF_BYTES] = {0,0,0,0};
+#if (NUMBER_OF_BYTES < 1) || (NUMBER_OF_BYTES > 4)
+  #error Incorrect value specified for NUMBER_OF_BYTES. Only the values 1 .. 4 may be specified.
+#endif
+#ifdef DUAL_CORE
+  #ifndef READ_REGISTERS
+    #error DUAL_CORE pipelines the register mode, it needs READ_REGISTERS
+  #endif
+  #include "corePipe.h"             // std::atomic: only built where there is a second core
+#endif
+  uint8_t buffer[NUMBER_OF_BYTES] = {0};
+#ifdef UNSIGNED
+  typedef uint32_t PlainValue;      // Value of a plain read (NUMBER_OF_BYTES, big endian)
+  typedef unsigned long PlainPrint;
 #else
-  #error Incorrect value specified for NUMBER_OF_BYTES. Only the value 2 or 4 may be specified.
+  typedef int32_t PlainValue;
+  typedef long PlainPrint;
+#endif
+
+#ifdef READ_REGISTERS
+  //////////////////////////////////////////////////////////////////////////////
+  /// @brief A sensor node found by the bus scan
+  /// 
+  //////////////////////////////////////////////////////////////////////////////
+  struct SlaveNode {
+    uint8_t addr;                   // 7 bit address
+    uint8_t regs[I2C_NUM_REGS];     // Register map VALUE .. ADDR
+    uint32_t period;                // Poll period while online (µs)
+    uint32_t reads;                 // Successful register reads
+    uint32_t errors;                // Failed transfers
+    uint32_t lastReads;             // reads at the last status line (rate)
+    uint8_t errorRun;               // Consecutive failed transfers
+    bool online;
+    char pollName[8];
+    SchedTask* pollTask;
+  #ifdef READ_HISTORY
+    char fifoName[8];
+    #ifdef DUAL_CORE
+    uint8_t pipeFlags;              // PIPE_NEW / PIPE_RESET for the decoder on the output core
+    #else
+    HistoryDecoder history;
+    #endif
+    SchedTask* historyTask;
+  #endif
+  };
+
+  SlaveNode nodes[MAX_SLAVES];      // Slave table, sorted by address
+  uint8_t nodeCount = 0;
+  uint32_t regReads = 0;            // Successful register reads (all nodes)
+  uint32_t busErrors = 0;           // Failed transfers (all nodes)
+  uint32_t pecErrors = 0;           // Transfers with a wrong PEC (part of busErrors)
+  bool rescan = false;              // Scan the bus at rescanAt
+  uint32_t rescanAt = 0;
+
+  TaskScheduler<2 * MAX_SLAVES + 9, micros> scheduler;
+
+  char outBuffer[OUT_BUFFER_SIZE];  // Ring buffer: format stage -> serial stage
+  uint16_t outHead = 0;
+  uint16_t outTail = 0;
+  uint32_t outDropped = 0;          // Lines dropped, buffer full
+
+  char command[COMMAND_SIZE];       // Serial command line
+  uint8_t commandLen = 0;
+  uint8_t outFormat = OUTPUT_FORMAT;
+  uint8_t dumpAddr = 0;             // Node of the counter dump, 0: off
+#endif
+#if defined(READ_HISTORY) && defined(WITH_PEC)
+  static_assert(HISTORY_CHUNK % I2C_PEC_BLOCK == 0, "FIFO reads with PEC take whole blocks");
+#endif
+#ifdef DUAL_CORE
+  CorePipe<PIPE_DEPTH> busPipe;     // Bus core -> output core: FIFO chunks and text
+#endif
+#ifdef READ_HISTORY
+  #ifdef DUAL_CORE
+  static_assert(HISTORY_CHUNK <= PIPE_DATA, "A FIFO chunk has to fit into a pipe item");
+  HistoryDecoder histories[MAX_SLAVES];   // Decoder per slave table index (output core)
+  #else
+  uint8_t rawChunks[RAW_CHUNKS][HISTORY_CHUNK];   // Queue: bus stage -> decode stage
+  uint8_t rawNode[RAW_CHUNKS];      // Slave table index of each chunk
+  uint8_t rawHead = 0;
+  uint8_t rawTail = 0;
+  uint32_t rawFull = 0;             // FIFO reads skipped, queue full
+  #endif
+  uint8_t decodeAddr = 0;           // Node of the chunk in the decode stage
+#endif
+
+#ifdef DATA_READY
+  volatile bool dataReady = false;  // Set by the data-ready interrupt
+  #ifdef READ_REGISTERS
+  uint32_t staleReads = 0;          // Register reads without I2C_STATUS_NEW (all nodes)
+  #endif
 #endif
 
 #ifndef IAM_SLAVE
+#ifdef READ_REGISTERS
+void schedulerSetup();
+#endif
+#ifdef DATA_READY
+#ifndef IRAM_ATTR
+#define IRAM_ATTR                   // Handler in IRAM, needed by the ESP8266 core only
+#endif
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Data-ready interrupt: a node has published a new sample. The
+///        read itself runs in loop().
+/// 
+//////////////////////////////////////////////////////////////////////////////
+void IRAM_ATTR onDataReady()
+{
+  dataReady = true;
+}
+#endif
+
 //////////////////////////////////////////////////////////////////////////////
 /// @brief I2C Master:  This is an I2C to Serial Converter. 
 ///                     Numbers are received from an I2C slave and displayed 
@@ -40,8 +198,866 @@ void setup()
 {
   Wire.begin(); 
   Serial.begin(115200);
+#ifdef DATA_READY
+  pinMode(DATA_READY_PIN, INPUT_PULLUP);
+  attachInterrupt(digitalPinToInterrupt(DATA_READY_PIN), onDataReady, FALLING);
+#endif
+#ifdef READ_REGISTERS
+  schedulerSetup();
+#endif
+}
+
+#ifdef READ_REGISTERS
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Free space in the text buffer between format and serial stage
+/// 
+//////////////////////////////////////////////////////////////////////////////
+uint16_t outFree()
+{
+  return OUT_BUFFER_SIZE - 1 - (outHead - outTail + OUT_BUFFER_SIZE) % OUT_BUFFER_SIZE;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Queue bytes for the serial stage (caller checked the space)
+/// 
+//////////////////////////////////////////////////////////////////////////////
+void outPut(const uint8_t* data, uint16_t len)
+{
+  for (uint16_t i = 0; i < len; ++i) {
+    outBuffer[outHead] = data[i];
+    outHead = (outHead + 1) % OUT_BUFFER_SIZE;
+  }
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Queue bytes for the serial stage. Never blocks: if the buffer
+///        is full, the whole line or record is dropped. With DUAL_CORE
+///        the bus core hands them to the output core through the pipe.
+/// 
+/// @param data         Bytes
+/// @param len          Number of bytes
+/// @return true        Bytes queued
+//////////////////////////////////////////////////////////////////////////////
+bool outBytes(const uint8_t* data, uint16_t len)
+{
+#ifdef DUAL_CORE
+  if (rp2040.cpuid() == 0) {        // Bus core: through the pipe
+    return busPipe.text(data, len, false);
+  }
+#endif
+  if (len > outFree()) {
+    outDropped++;
+    return false;
+  }
+  outPut(data, len);
+  return true;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Frame a binary record and queue it
+/// 
+/// @param rec          Type + payload, 2 bytes space for the CRC
+/// @param len          Length of type + payload
+/// @return true        Record queued
+//////////////////////////////////////////////////////////////////////////////
+bool outRecord(uint8_t* rec, uint16_t len)
+{
+  uint8_t frame[REC_FRAME_MAX];
+  return outBytes(frame, frameRecord(rec, len, frame));
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Queue a line for the serial stage. In the binary format the
+///        line goes out as REC_TEXT record. With DUAL_CORE the bus core
+///        hands it to the output core through the pipe.
+/// 
+/// @param text         Line without line end
+/// @return true        Line queued
+//////////////////////////////////////////////////////////////////////////////
+bool outLine(const char* text)
+{
+  uint16_t len = strlen(text);
+
+  if (outFormat == OUT_COBS) {
+    uint8_t rec[REC_MAX_LEN + 2];
+    if (len > REC_MAX_LEN - 1) {
+      len = REC_MAX_LEN - 1;
+    }
+    rec[0] = REC_TEXT;
+    memcpy(rec + 1, text, len);
+    return outRecord(rec, len + 1);
+  }
+#ifdef DUAL_CORE
+  if (rp2040.cpuid() == 0) {        // Bus core: the output core adds the line end
+    return busPipe.text((const uint8_t*)text, len, true);
+  }
+#endif
+  if (len + 2 > outFree()) {
+    outDropped++;
+    return false;
+  }
+  outPut((const uint8_t*)text, len);
+  outPut((const uint8_t*)"\r\n", 2);
+  return true;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Serial stage: write as much as the UART takes without blocking.
+/// 
+//////////////////////////////////////////////////////////////////////////////
+void serialTask()
+{
+  while (outTail != outHead) {
+    int space = Serial.availableForWrite();
+    if (space <= 0) {
+      return;
+    }
+    uint16_t end = (outHead > outTail) ? outHead : OUT_BUFFER_SIZE;
+    uint16_t len = end - outTail;
+    if (len > (uint16_t)space) {
+      len = space;
+    }
+    Serial.write((const uint8_t*)outBuffer + outTail, len);
+    outTail = (outTail + len) % OUT_BUFFER_SIZE;
+  }
+}
+
+#ifdef READ_HISTORY
+//////////////////////////////////////////////////////////////////////////////
+/// @brief History decoder of the node at index i of the slave table.
+///        With DUAL_CORE it belongs to the output core, the bus core only
+///        reads its counters.
+/// 
+//////////////////////////////////////////////////////////////////////////////
+HistoryDecoder& nodeHistory(uint8_t i)
+{
+#ifdef DUAL_CORE
+  return histories[i];
+#else
+  return nodes[i].history;
+#endif
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Samples of a node were lost: its decoder waits for a key record.
+///        With DUAL_CORE the reset goes with the next chunk of the node.
+/// 
+//////////////////////////////////////////////////////////////////////////////
+void historyReset(SlaveNode* node)
+{
+#ifdef DUAL_CORE
+  node->pipeFlags |= PIPE_RESET;
+#else
+  node->history.reset();
+#endif
+}
+#endif
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Count a failed transfer. After NODE_MAX_ERRORS in a row the node
+///        is offline and only polled every NODE_RETRY_US. Corrupted data
+///        (wrong PEC) is dropped like a failed transfer.
+/// 
+/// @param result       Result of readRegisters()
+//////////////////////////////////////////////////////////////////////////////
+void nodeError(SlaveNode* node, uint8_t result = 0)
+{
+  char outText[32];
+
+  node->errors++;
+  busErrors++;
+  if (result == I2C_PEC_ERROR) {
+    pecErrors++;
+  }
+  if (node->errorRun < 0xFF) {
+    node->errorRun++;
+  }
+  if (node->online && node->errorRun >= NODE_MAX_ERRORS) {
+    node->online = false;
+    node->pollTask->period = NODE_RETRY_US;
+    sprintf(outText,"Slave 0x%02X offline", node->addr);
+    outLine(outText);
+  }
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Count a successful transfer, a node that was offline gets its
+///        poll period back.
+/// 
+//////////////////////////////////////////////////////////////////////////////
+void nodeOk(SlaveNode* node)
+{
+  char outText[32];
+
+  node->errorRun = 0;
+  if (!node->online) {
+    node->online = true;
+    node->pollTask->period = node->period;
+#ifdef READ_HISTORY
+    historyReset(node);             // Samples were lost: wait for a key record
+#endif
+    sprintf(outText,"Slave 0x%02X online", node->addr);
+    outLine(outText);
+  }
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Bus stage: read the register map of one node in one combined
+///        transaction (register pointer, repeated start, burst read).
+///        VALUE, MIN, MAX and COUNT are taken from the same slave snapshot.
+///        The node keeps its last values unless the read is complete (and
+///        its PEC is right).
+/// 
+/// @param arg          SlaveNode
+//////////////////////////////////////////////////////////////////////////////
+void pollRegisters(void* arg)
+{
+  SlaveNode* node = (SlaveNode*)arg;
+  uint8_t regs[I2C_NUM_REGS];
+  uint8_t result = readRegisters(Wire, node->addr, I2C_REG_VALUE, regs, I2C_NUM_REGS);
+
+  if (result == I2C_NUM_REGS) {
+    memcpy(node->regs, regs, I2C_NUM_REGS);
+    node->reads++;
+    regReads++;
+#ifdef DATA_READY
+    if (!(regs[I2C_REG_STATUS] & I2C_STATUS_NEW)) {
+      staleReads++;                 // Pulse of another node or the timeout
+    }
+#endif
+    nodeOk(node);
+  } else {
+    nodeError(node, result);
+  }
+}
+
+#ifdef READ_HISTORY
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Bus stage: one long read of the stream register I2C_REG_FIFO
+///        of one node into the chunk queue. The slave pads with 0 when its
+///        FIFO is empty; a chunk that ends with data means there is more,
+///        so the task is released again at once. Offline nodes are left
+///        to the poll task. With DUAL_CORE the chunk is read straight into
+///        the pipe to the output core; if that is full, the read waits for
+///        the next release and the data stays in the FIFO of the slave.
+/// 
+/// @param arg          SlaveNode
+//////////////////////////////////////////////////////////////////////////////
+void readHistory(void* arg)
+{
+  SlaveNode* node = (SlaveNode*)arg;
+
+  if (!node->online) {
+    return;
+  }
+#ifdef DUAL_CORE
+  uint8_t* chunk = busPipe.beginChunk(node - nodes, node->addr, node->pipeFlags);
+  if (chunk == nullptr) {
+    return;                         // Counted in busPipe.chunksFull
+  }
+#else
+  uint8_t* chunk = rawChunks[rawHead % RAW_CHUNKS];
+  if ((uint8_t)(rawHead - rawTail) >= RAW_CHUNKS) {
+    rawFull++;
+    return;
+  }
+#endif
+  uint8_t result = readRegisters(Wire, node->addr, I2C_REG_FIFO, chunk, HISTORY_CHUNK);
+  if (result != HISTORY_CHUNK) {
+    nodeError(node, result);
+    historyReset(node);             // Bytes may be lost: wait for the next key record
+    return;
+  }
+  bool more = chunk[HISTORY_CHUNK - 1] != HIST_PAD;
+#ifdef DUAL_CORE
+  node->pipeFlags = 0;
+  busPipe.commitChunk(HISTORY_CHUNK);
+#else
+  rawNode[rawHead % RAW_CHUNKS] = node - nodes;
+  rawHead++;
+#endif
+  if (more) {
+    node->historyTask->due = micros();    // FIFO not drained yet
+  }
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Format one sample of the history in the selected output format
+/// 
+//////////////////////////////////////////////////////////////////////////////
+void printSample(uint16_t seq, uint16_t value)
+{
+  char outText[48];
+  uint8_t rec[REC_SAMPLE_LEN + 2];
+  char* p;
+
+  switch (outFormat) {
+  case OUT_COBS:
+    rec[0] = REC_SAMPLE;
+    rec[1] = decodeAddr;
+    putRecord16(putRecord16(rec + 2, seq), value);
+    outRecord(rec, REC_SAMPLE_LEN);
+    break;
+
+  case OUT_FIXED:                     // "0x24 #12: 29876 -> 0.2735 V"
+    p = appendHex8(appendText(outText, "0x"), decodeAddr);
+    p = appendUInt(appendText(p, " #"), seq);
+    p = appendUInt(appendText(p, ": "), value);
+    p = appendFixed(appendText(p, " -> "), scaleRaw16(value, VREF_100UV), 4);
+    appendText(p, " V")[0] = 0;
+    outLine(outText);
+    break;
+
+  default:
+    sprintf(outText,"0x%02X #%u: %u -> %1.4f V", decodeAddr, seq, value, (0.6 / 65535) * value);
+    outLine(outText);
+    break;
+  }
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Decode stage: rebuild the samples of one chunk
+/// 
+//////////////////////////////////////////////////////////////////////////////
+#ifndef DUAL_CORE
+void decodeHistory()
+{
+  if (rawTail != rawHead) {
+    SlaveNode& node = nodes[rawNode[rawTail % RAW_CHUNKS]];
+    decodeAddr = node.addr;
+    node.history.feed(rawChunks[rawTail % RAW_CHUNKS], HISTORY_CHUNK, printSample);
+    rawTail++;
+  }
+}
+#endif
+#endif
+
+#ifdef DUAL_CORE
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Output core: take the items of the bus core in order. Text goes
+///        into the text buffer as it is, a chunk is decoded and its
+///        samples are formatted. Stops when the text buffer has no room
+///        for the next item: the serial stage drains it first, the pipe
+///        fills up and the bus core puts off its FIFO reads.
+/// 
+//////////////////////////////////////////////////////////////////////////////
+void pipeTask()
+{
+  PipeItem* item;
+
+  while ((item = busPipe.queue.front()) != nullptr) {
+    if (item->type == PIPE_TEXT) {
+      if (CorePipe<PIPE_DEPTH>::textLen(*item) > outFree()) {
+        return;
+      }
+      outPut(item->data, item->len);
+      if (item->flags & PIPE_EOL) {
+        outPut((const uint8_t*)"\r\n", 2);
+      }
+    }
+#ifdef READ_HISTORY
+    if (item->type == PIPE_CHUNK) {
+      if (outFree() < CHUNK_OUT_SPACE) {
+        return;
+      }
+      HistoryDecoder& history = histories[item->node];
+      if (item->flags & PIPE_NEW) {
+        history = HistoryDecoder();
+      } else if (item->flags & PIPE_RESET) {
+        history.reset();
+      }
+      decodeAddr = item->addr;
+      history.feed(item->data, item->len, printSample);
+    }
+#endif
+    busPipe.queue.pop();
+  }
+}
+#endif
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Format the last register values and the counters of every node
+/// 
+//////////////////////////////////////////////////////////////////////////////
+void printStatus()
+{
+  char outText[128];
+
+  for (uint8_t i = 0; i < nodeCount; ++i) {
+    SlaveNode& node = nodes[i];
+    uint16_t adcValue, minValue, maxValue, count;
+    uint8_t status, config, addr;
+    RegisterMap::decode(node.regs, adcValue, minValue, maxValue, count, status, config, addr);
+    uint32_t rate = (uint32_t)((node.reads - node.lastReads) * 1000000ULL / STATUS_PERIOD_US);
+    node.lastReads = node.reads;
+
+    if (outFormat == OUT_COBS) {
+      uint8_t rec[REC_STATUS_LEN + 2];
+      uint8_t* p = rec + 2;
+      rec[0] = REC_STATUS;
+      rec[1] = node.addr;
+      p = putRecord16(p, count);
+      p = putRecord16(p, adcValue);
+      p = putRecord16(p, minValue);
+      p = putRecord16(p, maxValue);
+      *p++ = status;
+      *p++ = node.online;
+      p = putRecord16(p, rate > 0xFFFF ? 0xFFFF : rate);
+      p = putRecord16(putRecord16(p, node.errors >> 16), node.errors & 0xFFFF);
+      outRecord(rec, REC_STATUS_LEN);
+      continue;
+    }
+    if (outFormat == OUT_FIXED) {
+      char* p = appendHex8(appendText(outText, "0x"), node.addr);
+      p = appendText(p, node.online ? " online  ADC: " : " offline ADC: ");
+      p = appendUInt(p, adcValue);
+      p = appendFixed(appendText(p, " -> "), scaleRaw16(adcValue, VREF_100UV), 4);
+      p = appendUInt(appendText(p, " V Min: "), minValue);
+      p = appendUInt(appendText(p, " Max: "), maxValue);
+      p = appendUInt(appendText(p, " Count: "), count);
+      p = appendHex8(appendText(p, " Status: 0x"), status);
+      p = appendUInt(appendText(p, " | "), rate);
+      p = appendUInt(appendText(p, " reads/s, "), node.errors);
+      appendText(p, " errors")[0] = 0;
+      outLine(outText);
+      continue;
+    }
+    sprintf(outText,"0x%02X %-7s ADC: %u -> %1.4f V Min: %u Max: %u Count: %u Status: 0x%02X | %lu reads/s, %lu errors",
+            node.addr, node.online ? "online" : "offline",
+            adcValue, (0.6 / 65535) * adcValue, minValue, maxValue, count,
+            status, (unsigned long)rate, (unsigned long)node.errors);
+    outLine(outText);
+  }
+  sprintf(outText,"Slaves: %u, reads: %lu, bus errors: %lu (PEC: %lu), lines dropped: %lu",
+          nodeCount, (unsigned long)regReads, (unsigned long)busErrors, (unsigned long)pecErrors,
+          (unsigned long)outDropped);
+  outLine(outText);
+#ifdef DATA_READY
+  sprintf(outText,"Stale reads: %lu", (unsigned long)staleReads);
+  outLine(outText);
+#endif
+#ifdef READ_HISTORY
+  for (uint8_t i = 0; i < nodeCount; ++i) {
+    const HistoryDecoder& history = nodeHistory(i);
+    sprintf(outText,"0x%02X history: %lu samples, %lu dropped, %lu duplicates",
+            nodes[i].addr, (unsigned long)history.samples, (unsigned long)history.dropped,
+            (unsigned long)history.duplicates);
+    outLine(outText);
+  }
+#ifndef DUAL_CORE
+  sprintf(outText,"History queue full: %lu", (unsigned long)rawFull);
+  outLine(outText);
+#endif
+#endif
+#ifdef DUAL_CORE
+  sprintf(outText,"Pipe: depth %u, max %u, chunk reads put off %lu, lines dropped %lu",
+          busPipe.queue.depth(), busPipe.queue.maxDepth, (unsigned long)busPipe.chunksFull,
+          (unsigned long)busPipe.textDropped);
+  outLine(outText);
+#endif
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Format the latency histogram of every task (release to start)
+/// 
+//////////////////////////////////////////////////////////////////////////////
+void printStats()
+{
+  char outText[128];
+  int len;
+
+  for (uint8_t i = 0; i < scheduler.count; ++i) {
+    const SchedTask& t = scheduler.tasks[i];
+    len = sprintf(outText,"%-8s runs %lu miss %lu lat max %lu us run max %lu us |",
+                  t.name, (unsigned long)t.runs, (unsigned long)t.misses,
+                  (unsigned long)t.maxLatency, (unsigned long)t.maxRun);
+    for (uint8_t b = 0; b < SCHED_HIST_BINS; ++b) {
+      len += sprintf(outText + len, " %lu", (unsigned long)t.hist[b]);
+    }
+    outLine(outText);
+  }
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Format the hot-path counters of the node selected with "dump"
+///        (slave built WITH_STATS). The counters wrap around at 65535.
+/// 
+//////////////////////////////////////////////////////////////////////////////
+void printNodeStats()
+{
+  static const char* const stateNames[I2C_STATS_STATES] = {
+    "IDLE", "ADDR", "PADDR", "RXD", "RXC", "TXD", "ACKN", "TXC", "PREP"
+  };
+  char outText[128];
+  NodeStats stats;
+  int len;
+
+  if (dumpAddr == 0) {
+    return;
+  }
+  if (!readNodeStats(Wire, dumpAddr, stats)) {
+    sprintf(outText,"0x%02X counters: read failed", dumpAddr);
+    outLine(outText);
+    return;
+  }
+  len = sprintf(outText,"0x%02X ISR:", dumpAddr);
+  for (uint8_t i = 0; i < I2C_STATS_STATES; ++i) {
+    len += sprintf(outText + len, " %s %u", stateNames[i], stats.isrState[i]);
+  }
+  outLine(outText);
+  sprintf(outText,"0x%02X NACKed %u aborted %u conversions %u latency max %u ticks",
+          dumpAddr, stats.nacks, stats.aborts, stats.conversions, stats.latencyMax);
+  outLine(outText);
+}
+
+#ifdef READ_SCAN
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Read the channel block of every online node in one transaction
+///        each and format it. All values of a line come from the same
+///        slave scan. Nodes without the block (slave built without
+///        WITH_SCAN) are skipped.
+/// 
+//////////////////////////////////////////////////////////////////////////////
+void printChannels()
+{
+  char outText[64];
+  NodeScan scan;
+  int len;
+
+  for (uint8_t i = 0; i < nodeCount; ++i) {
+    if (!nodes[i].online || !readNodeScan(Wire, nodes[i].addr, scan)) {
+      continue;
+    }
+    len = sprintf(outText,"0x%02X #%u channels:", nodes[i].addr, scan.count);
+    for (uint8_t ch = 0; ch < I2C_SCAN_CHANNELS; ++ch) {
+      len += sprintf(outText + len, " %u", scan.value[ch]);
+    }
+    outLine(outText);
+  }
+}
+#endif
+
+#ifdef READ_UNITS
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Read the value block of every online node and format it, integer
+///        only: the slave did the calibration. Units and decimals are the
+///        ones of the slave defaults (calibration.h of the slave).
+/// 
+//////////////////////////////////////////////////////////////////////////////
+void printUnits()
+{
+  static const char* const unitNames[I2C_SCAN_CHANNELS] = {" mV", " mV", " C", " mV"};
+  static const uint8_t unitDecimals[I2C_SCAN_CHANNELS] = {1, 0, 1, 1};
+  char outText[80];
+  NodeUnits units;
+
+  for (uint8_t i = 0; i < nodeCount; ++i) {
+    if (!nodes[i].online || !readNodeUnits(Wire, nodes[i].addr, units)) {
+      continue;
+    }
+    char* p = appendHex8(appendText(outText, "0x"), nodes[i].addr);
+    p = appendText(appendUInt(appendText(p, " #"), units.count), " units:");
+    for (uint8_t ch = 0; ch < I2C_SCAN_CHANNELS; ++ch) {
+      int16_t v = units.value[ch];
+      p = appendText(p, v < 0 ? " -" : " ");
+      p = appendFixed(p, v < 0 ? -(int32_t)v : v, unitDecimals[ch]);
+      p = appendText(p, unitNames[ch]);
+    }
+    *p = 0;
+    outLine(outText);
+  }
+}
+#endif
+
+#ifdef READ_AGG
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Integer square root, rounded down
+/// 
+//////////////////////////////////////////////////////////////////////////////
+static uint32_t isqrt64(uint64_t v)
+{
+  uint64_t root = 0;
+  uint64_t bit = (uint64_t)1 << 62;
+
+  while (bit > v) {
+    bit >>= 2;
+  }
+  while (bit) {
+    if (v >= root + bit) {
+      v -= root + bit;
+      root = (root >> 1) + bit;
+    } else {
+      root >>= 1;
+    }
+    bit >>= 2;
+  }
+  return (uint32_t)root;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Read the statistics block of every online node, format it
+///        (raw LSB, integer only) and request the next window. The block
+///        read returns the window ended by the previous request, so the
+///        windows follow each other without gaps or overlaps; the window
+///        register of the slave only limits their length.
+/// 
+//////////////////////////////////////////////////////////////////////////////
+void printAggregate()
+{
+  char outText[80];
+  NodeAggregate agg;
+
+  for (uint8_t i = 0; i < nodeCount; ++i) {
+    if (!nodes[i].online || !readNodeAggregate(Wire, nodes[i].addr, agg)) {
+      continue;
+    }
+    closeAggregate(Wire, nodes[i].addr);
+    uint32_t sd = isqrt64(agg.var);       // Q16.8
+    char* p = appendHex8(appendText(outText, "0x"), nodes[i].addr);
+    p = appendText(appendUInt(appendText(p, " #"), agg.count), " n ");
+    p = appendText(appendUInt(p, agg.n), " min ");
+    p = appendText(appendUInt(p, agg.min), " max ");
+    p = appendText(appendUInt(p, agg.max), " mean ");
+    p = appendText(appendFixed(p, (uint32_t)(((uint64_t)agg.mean * 100 + 0x8000) >> 16), 2), " sd ");
+    p = appendFixed(p, (sd * 100 + 0x80) >> 8, 2);
+    *p = 0;
+    outLine(outText);
+  }
+}
+#endif
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Find a node in the slave table
+/// 
+/// @param addr         7 bit address
+/// @return SlaveNode*  The node, nullptr if not found
+//////////////////////////////////////////////////////////////////////////////
+SlaveNode* findNode(uint8_t addr)
+{
+  for (uint8_t i = 0; i < nodeCount; ++i) {
+    if (nodes[i].addr == addr) {
+      return &nodes[i];
+    }
+  }
+  return nullptr;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Probe every address and rebuild the slave table (stops when it
+///        is full). Blocks for about 30 ms at 100 kHz: every START of the
+///        scan is also stretched by the USI slaves on the bus.
+/// 
+//////////////////////////////////////////////////////////////////////////////
+void scanBus()
+{
+  char outText[32];
+
+  nodeCount = 0;
+  for (uint8_t addr = I2C_ADDR_MIN; addr <= I2C_ADDR_MAX && nodeCount < MAX_SLAVES; ++addr) {
+    if (probeSlave(Wire, addr)) {
+      SlaveNode& node = nodes[nodeCount++];
+      node = SlaveNode();
+      node.addr = addr;
+#ifdef DATA_READY
+      node.period = READY_TIMEOUT_US;
+#else
+      node.period = POLL_PERIOD_US;
+#endif
+      node.online = true;
+      sprintf(node.pollName, "poll%02X", addr);
+#ifdef READ_HISTORY
+      sprintf(node.fifoName, "fifo%02X", addr);
+  #ifdef DUAL_CORE
+      node.pipeFlags = PIPE_NEW;    // The table index may have had another node
+  #endif
+#endif
+    }
+  }
+  sprintf(outText,"Scan: %u slave(s)", nodeCount);
+  outLine(outText);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Serial commands, one per line (addresses in hex):
+///        scan                 Scan the bus again
+///        addr <old> <new>     Give the node at <old> the address <new>
+///        rate <addr> <us>     Poll period of a node
+///        text | fixed | cobs  Output format
+///        dump <addr> [clear]  Counters of a node every second (clear: reset them first)
+///        dump off             Stop the counter dump
+///        cal <addr> <ch> <offset> <gain>   Calibration of a channel (decimal, slave WITH_CAL)
+///        profile <addr> <n>   Acquisition profile 0 .. 3 of a node (slave WITH_PROFILES)
+///        agg <addr> <k>       Longest statistics window 2^k samples of a node (slave WITH_AGG)
+/// 
+//////////////////////////////////////////////////////////////////////////////
+void commandTask()
+{
+  char outText[48];
+  unsigned int addr;
+  unsigned int arg;
+  unsigned int offset;
+  unsigned int gain;
+  int end = 0;
+  SlaveNode* node;
+
+  while (Serial.available() > 0) {
+    char c = Serial.read();
+    if (c != '\r' && c != '\n') {
+      if (commandLen < COMMAND_SIZE - 1) {
+        command[commandLen++] = c;
+      }
+      continue;
+    }
+    command[commandLen] = 0;
+    if (commandLen == 0) {
+      continue;
+    }
+    commandLen = 0;
+    if (!strcmp(command, "text")) {
+      outFormat = OUT_TEXT;
+    } else if (!strcmp(command, "fixed")) {
+      outFormat = OUT_FIXED;
+    } else if (!strcmp(command, "cobs")) {
+      outFormat = OUT_COBS;
+    } else if (!strcmp(command, "scan")) {
+      rescan = true;
+      rescanAt = micros();
+    } else if (!strcmp(command, "dump off")) {
+      dumpAddr = 0;
+    } else if (sscanf(command, "dump %x%n", &addr, &end) == 1) {
+      dumpAddr = addr;
+      if (!strcmp(command + end, " clear") && !clearNodeStats(Wire, addr)) {
+        sprintf(outText,"Clear counters 0x%02X: failed", addr);
+        outLine(outText);
+      }
+    } else if (sscanf(command, "addr %x %x", &addr, &arg) == 2) {
+      bool ok = setSlaveAddress(Wire, addr, arg);
+      sprintf(outText,"Address 0x%02X -> 0x%02X: %s", addr, arg, ok ? "sent" : "failed");
+      outLine(outText);
+      rescan = true;                // The node takes the address with its next sample
+      rescanAt = micros() + ADDR_SETTLE_US;
+    } else if (sscanf(command, "cal %x %u %u %u", &addr, &arg, &offset, &gain) == 4) {
+      NodeCal cal = {(uint16_t)offset, (uint16_t)gain};
+      bool ok = writeCalibration(Wire, addr, arg, cal);
+      sprintf(outText,"Calibration 0x%02X ch %u: %s", addr, arg, ok ? "sent" : "failed");
+      outLine(outText);
+    } else if (sscanf(command, "profile %x %u", &addr, &arg) == 2) {
+      bool ok = setProfile(Wire, addr, arg);
+      sprintf(outText,"Profile 0x%02X -> %u: %s", addr, arg, ok ? "sent" : "failed");
+      outLine(outText);
+    } else if (sscanf(command, "agg %x %u", &addr, &arg) == 2) {
+      bool ok = setAggWindow(Wire, addr, arg);
+      sprintf(outText,"Window 0x%02X -> 2^%u: %s", addr, arg, ok ? "sent" : "failed");
+      outLine(outText);
+    } else if (sscanf(command, "rate %x %u", &addr, &arg) == 2 && (node = findNode(addr)) != nullptr) {
+      node->period = arg;
+      if (node->online) {
+        node->pollTask->period = arg;
+      }
+    } else {
+      sprintf(outText,"Unknown command: %.24s", command);
+      outLine(outText);
+    }
+  }
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Reset the pipeline, scan the bus and register the stages. The
+///        order decides nothing, the scheduler always starts the task that
+///        is waiting longest. The first releases of the node tasks are
+///        spread over the period, so the nodes are polled round-robin
+///        instead of in bursts.
+/// 
+//////////////////////////////////////////////////////////////////////////////
+void schedulerSetup()
+{
+  regReads = busErrors = pecErrors = outDropped = 0;
+#ifdef DATA_READY
+  staleReads = 0;
+#endif
+#ifndef DUAL_CORE
+  outHead = outTail = 0;            // With DUAL_CORE the output core owns the buffer
+  #ifdef READ_HISTORY
+  rawHead = rawTail = 0;
+  rawFull = 0;
+  #endif
+#endif
+  scanBus();
+  scheduler.clear();
+  for (uint8_t i = 0; i < nodeCount; ++i) {
+    SlaveNode& node = nodes[i];
+    node.pollTask = scheduler.add(node.pollName, pollRegisters, &node, node.period);
+    node.pollTask->due += i * node.period / nodeCount;
+#ifdef READ_HISTORY
+    node.historyTask = scheduler.add(node.fifoName, readHistory, &node, HISTORY_PERIOD_US);
+    node.historyTask->due += i * HISTORY_PERIOD_US / nodeCount;
+#endif
+  }
+#ifndef DUAL_CORE
+  #ifdef READ_HISTORY
+  scheduler.add("decode", decodeHistory, DECODE_PERIOD_US);
+  #endif
+  scheduler.add("serial", serialTask, SERIAL_PERIOD_US);
+#endif
+  scheduler.add("command", commandTask, COMMAND_PERIOD_US);
+  scheduler.add("status", printStatus, STATUS_PERIOD_US);
+  scheduler.add("stats", printStats, STATS_PERIOD_US);
+  scheduler.add("dump", printNodeStats, DUMP_PERIOD_US);
+#ifdef READ_SCAN
+  scheduler.add("channels", printChannels, SCAN_PERIOD_US);
+#endif
+#ifdef READ_UNITS
+  scheduler.add("units", printUnits, UNITS_PERIOD_US);
+#endif
+#ifdef READ_AGG
+  scheduler.add("aggregate", printAggregate, AGG_PERIOD_US);
+#endif
 }
 
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Register mode: loop() never waits, it starts at most one due
+///        task of the cooperative scheduler and returns. A bus scan
+///        requested by a command runs here, outside of the scheduler.
+///        With DATA_READY a pulse releases the poll tasks of all online
+///        nodes at once (the line is shared, I2C_STATUS_NEW tells which
+///        node has published).
+/// 
+//////////////////////////////////////////////////////////////////////////////
+void loop()
+{
+  if (rescan && (int32_t)(micros() - rescanAt) >= 0) {
+    rescan = false;
+    schedulerSetup();
+  }
+#ifdef DATA_READY
+  if (dataReady) {
+    dataReady = false;
+    uint32_t now = micros();
+    for (uint8_t i = 0; i < nodeCount; ++i) {
+      if (nodes[i].online) {
+        nodes[i].pollTask->due = now;
+      }
+    }
+  }
+#endif
+  scheduler.run();
+}
+
+#ifdef DUAL_CORE
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Output core (RP2040 core 1): decode, format and serial stage,
+///        fed only through the pipe. It never touches the bus or the slave
+///        table; the serial port is shared with the command task of the
+///        bus core (reads there, writes here).
+/// 
+//////////////////////////////////////////////////////////////////////////////
+void loop1()
+{
+  pipeTask();
+  serialTask();
+}
+#endif
+#else
 void loop()
 {
   static char outText[61];
@@ -50,6 +1066,12 @@ void loop()
   static double batVoltage = 0;
   int idx = 0;
   
+#ifdef DATA_READY
+  if (!dataReady) {
+    return;                         // Wait for the next sample of the slave
+  }
+  dataReady = false;                // A pulse during the read releases the next one
+#endif
   Wire.requestFrom(I2C_SLAVE_ADDRESS, NUMBER_OF_BYTES);   // request NUMBER_OF_BYTES byte
                                                           // from slave device I2C_SLAVE_ADDRESS
   //Serial.print("Received: ");
@@ -63,25 +1085,20 @@ void loop()
     }
   }
 
-#if NUMBER_OF_BYTES == 2
-  #ifdef UNSIGNED
-    adcValue = bufferToInt16<uint16_t>(buffer);
-    voltage = (0.6 / 65535) * adcValue;
-    batVoltage = voltage * 3.25 / 0.6;
-    sprintf(outText,"ADC-Value: %d -> Voltage: %1.4f V Battery: %1.3f V",adcValue, voltage, batVoltage);
-    Serial.println(outText);
-  #else
-    Serial.println(bufferToInt16<int16_t>(buffer));
-  #endif
+#if (NUMBER_OF_BYTES == 2) && defined(UNSIGNED)
+  adcValue = decodeInt<uint16_t>(buffer);
+  voltage = (0.6 / 65535) * adcValue;
+  batVoltage = voltage * 3.25 / 0.6;
+  sprintf(outText,"ADC-Value: %d -> Voltage: %1.4f V Battery: %1.3f V",adcValue, voltage, batVoltage);
+  Serial.println(outText);
 #else
-  #ifdef UNSIGNED
-  Serial.println(bufferToInt32<uint32_t>(buffer));
-  #else
-  Serial.println(bufferToInt32<int32_t>(buffer));
-  #endif
+  Serial.println((PlainPrint)decodeInt<PlainValue, Endian::Big, NUMBER_OF_BYTES>(buffer));
+#endif
+#ifndef DATA_READY
+  delay(1000);                      // With the data-ready line the slave paces the reads
 #endif
-  delay(1000);
 }
+#endif
 #else
 void setup() {
   pinMode(PIN_LED,OUTPUT);
@@ -0,0 +1,100 @@
+//////////////////////////////////////////////////////////////////////////////
+/// @file capture.h
+/// @brief Capture of the serial output of the master into a ring file
+///        (Linux).
+///
+//////////////////////////////////////////////////////////////////////////////
+
+#ifndef _CAPTURE_H_
+#define _CAPTURE_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include "ringFile.h"
+#include "streamDecoder.h"
+
+//////////////////////////////////////////////////////////////////////////////
+/// Global definitions
+//////////////////////////////////////////////////////////////////////////////
+
+#define CAPTURE_BAUD      115200      // monitor_speed of the master
+#define CAPTURE_CAPACITY  65536       // Records per slave (1 MB per slave)
+#define CAPTURE_READ_SIZE 4096        // Bytes per read() of the serial port
+
+#define VREF_100UV        6000        // 0.6 V full scale of the SD16 in 0.1 mV (main.cpp of the master)
+
+// Output formats of the master (OUTPUT_FORMAT in main.cpp), REPLAY_MIXED switches every second
+#define OUT_TEXT          0
+#define OUT_FIXED         1
+#define OUT_COBS          2
+#define REPLAY_MIXED      3
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Decoder sink that stores into the ring file. All samples of one
+///        read() get its capture time.
+///
+//////////////////////////////////////////////////////////////////////////////
+struct RingSink {
+  RingFile& ring;
+  uint64_t timeNs = 0;
+
+  explicit RingSink(RingFile& ring) : ring(ring) {}
+
+  void sample(uint8_t addr, uint16_t seq, uint16_t value, bool cobs) {
+    ring.putSample(addr, seq, value, cobs ? RING_COBS : 0, timeNs);
+  }
+
+  void status(const StreamStatus& st) {
+    RingStatus rs = {st.count, st.value, st.min, st.max, st.status, st.online, st.rate, st.errors, timeNs};
+    ring.putStatus(st.addr, rs);
+  }
+
+  void text(const char* line, uint16_t len) {
+    (void)line;
+    (void)len;
+    ring.header->textLines.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  void error() {
+    ring.header->errors.fetch_add(1, std::memory_order_relaxed);
+  }
+};
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Output of a master with some nodes, for replay and benchmark:
+///        the samples of every node in chunks like the FIFO decoder emits
+///        them, a status line per node every rate samples, now and then a
+///        message line. Every value is a function of address and seq
+///        (replayValue), so a reader can check what it gets.
+///
+//////////////////////////////////////////////////////////////////////////////
+struct ReplayGen {
+  uint8_t nodes = 4;                  // Addresses 0x24, 0x25 ...
+  uint8_t format = OUT_FIXED;         // OUT_x or REPLAY_MIXED
+  uint16_t rate = 100;                // Samples per node and status line
+  uint16_t chunk = 3;                 // Samples of one node in a row
+  uint32_t skipEvery = 0;             // Leave out every n-th sample of node 0 (gaps), 0: none
+
+  uint32_t samples = 0;               // Samples generated
+  uint32_t skipped = 0;               // Samples left out
+  uint16_t seq[RING_SLOTS] = {};      // Next seq per node
+  uint32_t step = 0;
+
+  size_t generate(uint8_t* buf, size_t size);
+};
+
+//////////////////////////////////////////////////////////////////////////////
+/// Forward declaration(s)
+//////////////////////////////////////////////////////////////////////////////
+
+uint64_t captureTimeNs(void);
+int serialOpen(const char* dev, uint32_t baud);
+int serialRaw(int fd, uint32_t baud);
+int capture(int fd, RingFile& ring, volatile bool* stop);
+int ptyOpen(char* slaveName, size_t size);
+uint16_t replayValue(uint8_t addr, uint16_t seq);
+int replay(int fd, ReplayGen& gen, const char* file, uint32_t baud, uint32_t seconds, volatile bool* stop);
+int readRing(const char* path, int addr, uint32_t last, bool follow, volatile bool* stop);
+void benchCapture(uint32_t loops);
+
+#endif
@@ -0,0 +1,361 @@
+#ifndef _RING_FILE_H_
+#define _RING_FILE_H_
+
+#include <stdint.h>
+#include <string.h>
+#include <atomic>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define RING_MAGIC        "I2CRING1"
+#define RING_VERSION      1
+#define RING_SLOTS        16          // Slaves per file (the master has MAX_SLAVES 8)
+#define RING_SLOT_FREE    0xFF        // Slot without a slave (7 bit addresses end at 0x7F)
+#define RING_ADDR_PLAIN   0x00        // Plain loop of the master: no address in the line
+#define RING_WRITING      0xFFFFFFFF  // Record seq while the writer changes it
+#define RING_HEADER_SIZE  4096        // Header page, the records follow
+
+// Record flags
+#define RING_COBS         0x01        // From a binary record (else a text line)
+#define RING_GAP          0x02        // Samples missing before this one
+#define RING_RESTART      0x04        // Sequence number jumped back (slave reset)
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief One sample, 16 bytes. seq is the sequence number of the slave,
+///        extended to 32 bit by the capture (the low 16 bit are the ones
+///        the master printed).
+///
+//////////////////////////////////////////////////////////////////////////////
+struct RingRecord {
+  std::atomic<uint32_t> seq;          // RING_WRITING while it changes
+  uint16_t value;                     // Raw SD16 value
+  uint8_t addr;                       // 7 bit address
+  uint8_t flags;                      // RING_COBS, RING_GAP, RING_RESTART
+  uint64_t timeNs;                    // Capture time (CLOCK_REALTIME)
+};
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Last status line of a slave
+///
+//////////////////////////////////////////////////////////////////////////////
+struct RingStatus {
+  uint16_t count;                     // Sample counter of VALUE
+  uint16_t value;
+  uint16_t min;
+  uint16_t max;
+  uint8_t status;                     // STATUS register
+  uint8_t online;                     // Node online at the master
+  uint16_t rate;                      // Register reads/s of the master
+  uint32_t errors;                    // Failed transfers at the master
+  uint64_t timeNs;                    // Capture time
+};
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Ring of one slave. next is one past the newest seq, 0: empty.
+///
+//////////////////////////////////////////////////////////////////////////////
+struct RingSlot {
+  std::atomic<uint8_t> addr;          // RING_SLOT_FREE until the 1st sample
+  uint8_t reserved[3];
+  std::atomic<uint32_t> next;         // Readers: newest seq + 1
+  std::atomic<uint32_t> statusVersion;  // Odd while the status changes
+  uint32_t gaps;                      // Samples missing (writer)
+  uint32_t duplicates;                // Samples seen twice (writer)
+  uint32_t restarts;                  // Sequence number jumped back (writer)
+  RingStatus status;
+};
+
+struct RingHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t recordSize;
+  uint32_t capacity;                  // Records per slot, power of 2
+  uint32_t slots;
+  std::atomic<uint64_t> samples;      // Samples stored
+  std::atomic<uint64_t> statusLines;  // Status lines / records stored
+  std::atomic<uint64_t> textLines;    // Other lines (not stored)
+  std::atomic<uint64_t> errors;       // Damaged frames, lines that do not parse
+  RingSlot slot[RING_SLOTS];
+};
+
+static_assert(sizeof(RingRecord) == 16, "RingRecord has to stay 16 bytes");
+static_assert(sizeof(RingHeader) <= RING_HEADER_SIZE, "RingHeader too big");
+static_assert(std::atomic<uint32_t>::is_always_lock_free, "Shared memory needs lock-free atomics");
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Time series of the captured samples in a memory-mapped file, one
+///        ring of fixed-size records per slave, indexed by the sequence
+///        number: the record of seq is at seq % capacity of its slave. A
+///        gap in the sequence leaves the old records in place, they are
+///        recognized by their seq.
+///
+///        One writer (the capture), any number of readers in other
+///        processes, without locks. Readers map the file read-only and
+///        use the records in place (find, at): a record is valid while its
+///        seq is unchanged. The writer sets seq to RING_WRITING, changes
+///        the record and stores the new seq with release semantics, so a
+///        reader takes the seq (acquire), uses the record and checks with
+///        stillValid() that it was not overwritten meanwhile. The status
+///        of a slave is protected the same way by statusVersion.
+///
+//////////////////////////////////////////////////////////////////////////////
+class RingFile {
+public:
+  RingHeader* header = nullptr;
+
+  ~RingFile() {
+    close();
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+  /// @brief Writer: create (or replace) a ring file
+  ///
+  /// @param path         File name
+  /// @param capacity     Records per slave, power of 2
+  /// @return true        Mapped read/write
+  //////////////////////////////////////////////////////////////////////////////
+  bool create(const char* path, uint32_t capacity) {
+    if (capacity < 2 || (capacity & (capacity - 1))) {
+      return false;
+    }
+    close();
+    int fd = ::open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+      return false;
+    }
+    mapSize = RING_HEADER_SIZE + (size_t)RING_SLOTS * capacity * sizeof(RingRecord);
+    bool ok = ftruncate(fd, mapSize) == 0 && map(fd, true);   // Zero filled
+    ::close(fd);
+    if (!ok) {
+      return false;
+    }
+    header->version = RING_VERSION;
+    header->recordSize = sizeof(RingRecord);
+    header->capacity = capacity;
+    header->slots = RING_SLOTS;
+    for (uint8_t i = 0; i < RING_SLOTS; ++i) {
+      header->slot[i].addr.store(RING_SLOT_FREE, std::memory_order_relaxed);
+    }
+    memcpy(header->magic, RING_MAGIC, sizeof(header->magic));   // Valid from now on
+    return true;
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+  /// @brief Reader: map an existing ring file read-only
+  ///
+  /// @return true        Mapped, magic and layout match
+  //////////////////////////////////////////////////////////////////////////////
+  bool open(const char* path) {
+    struct stat st;
+
+    close();
+    int fd = ::open(path, O_RDONLY);
+    if (fd < 0) {
+      return false;
+    }
+    mapSize = fstat(fd, &st) == 0 ? st.st_size : 0;
+    bool ok = mapSize >= RING_HEADER_SIZE && map(fd, false);
+    ::close(fd);
+    if (ok && (memcmp(header->magic, RING_MAGIC, sizeof(header->magic)) != 0 ||
+               header->version != RING_VERSION || header->recordSize != sizeof(RingRecord) ||
+               header->slots != RING_SLOTS ||
+               mapSize < RING_HEADER_SIZE + (size_t)RING_SLOTS * header->capacity * sizeof(RingRecord))) {
+      close();
+      ok = false;
+    }
+    return ok;
+  }
+
+  void close() {
+    if (header) {
+      munmap(header, mapSize);
+      header = nullptr;
+    }
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+  /// @brief Slot of a slave
+  ///
+  /// @return int8_t      Index, -1 if the slave has no records
+  //////////////////////////////////////////////////////////////////////////////
+  int8_t slotOf(uint8_t addr) const {
+    for (uint8_t i = 0; i < RING_SLOTS; ++i) {
+      uint8_t a = header->slot[i].addr.load(std::memory_order_acquire);
+      if (a == addr) {
+        return i;
+      }
+      if (a == RING_SLOT_FREE) {
+        break;                        // Slots are taken in order
+      }
+    }
+    return -1;
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+  /// @brief Reader: the record at seq, in place
+  ///
+  /// @param slot         slotOf()
+  /// @param seq          Extended sequence number
+  /// @return const RingRecord*   nullptr if seq is not (or no longer) stored
+  //////////////////////////////////////////////////////////////////////////////
+  const RingRecord* find(int8_t slot, uint32_t seq) const {
+    if (slot < 0) {
+      return nullptr;
+    }
+    const RingRecord* rec = at(slot, seq);
+    return rec->seq.load(std::memory_order_acquire) == seq ? rec : nullptr;
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+  /// @brief Reader: the record of find() was not overwritten while it was
+  ///        used
+  ///
+  //////////////////////////////////////////////////////////////////////////////
+  static bool stillValid(const RingRecord* rec, uint32_t seq) {
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return rec->seq.load(std::memory_order_relaxed) == seq;
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+  /// @brief Reader: one past the newest seq of a slot, 0: empty
+  ///
+  //////////////////////////////////////////////////////////////////////////////
+  uint32_t next(int8_t slot) const {
+    return slot < 0 ? 0 : header->slot[slot].next.load(std::memory_order_acquire);
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+  /// @brief Reader: the extended seq of the newest sample whose low 16 bit
+  ///        are seq16 (the number the master printed)
+  ///
+  //////////////////////////////////////////////////////////////////////////////
+  uint32_t extend(int8_t slot, uint16_t seq16) const {
+    uint32_t newest = next(slot) - 1;
+    return newest - (uint16_t)((uint16_t)newest - seq16);
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+  /// @brief Reader: copy of the last status of a slot
+  ///
+  /// @return true        Consistent copy (false: no status yet)
+  //////////////////////////////////////////////////////////////////////////////
+  bool status(int8_t slot, RingStatus& out) const {
+    if (slot < 0) {
+      return false;
+    }
+    const RingSlot& s = header->slot[slot];
+    uint32_t v;
+    do {
+      while ((v = s.statusVersion.load(std::memory_order_acquire)) & 1) {
+      }
+      memcpy(&out, (const void*)&s.status, sizeof(out));
+      std::atomic_thread_fence(std::memory_order_acquire);
+    } while (s.statusVersion.load(std::memory_order_relaxed) != v);
+    return v != 0;
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+  /// @brief Writer: store a sample
+  ///
+  /// @param addr         7 bit address
+  /// @param seq16        Sequence number printed by the master
+  /// @param value        Raw value
+  /// @param flags        RING_COBS
+  /// @param timeNs       Capture time
+  /// @return bool        Stored (false: all slots taken, or a duplicate)
+  //////////////////////////////////////////////////////////////////////////////
+  bool putSample(uint8_t addr, uint16_t seq16, uint16_t value, uint8_t flags, uint64_t timeNs) {
+    int8_t i = takeSlot(addr);
+    if (i < 0) {
+      header->errors.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+    RingSlot& s = header->slot[i];
+    uint32_t next = s.next.load(std::memory_order_relaxed);
+    uint32_t seq = seq16;
+    if (next != 0) {                  // Unwrap against the newest one
+      int16_t delta = (int16_t)(seq16 - (uint16_t)next);
+      if (delta < -1) {               // Back: new run, above all old ones
+        seq = ((next - 1) & 0xFFFF0000u) + 0x10000u + seq16;
+        flags |= RING_RESTART;
+        s.restarts++;
+      } else if (delta == -1) {
+        s.duplicates++;
+        return false;
+      } else {
+        seq = next + delta;
+        if (delta > 0) {
+          flags |= RING_GAP;
+          s.gaps += delta;
+        }
+      }
+    }
+    RingRecord* rec = at(i, seq);
+    rec->seq.store(RING_WRITING, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    rec->value = value;
+    rec->addr = addr;
+    rec->flags = flags;
+    rec->timeNs = timeNs;
+    rec->seq.store(seq, std::memory_order_release);
+    s.next.store(seq + 1, std::memory_order_release);
+    header->samples.fetch_add(1, std::memory_order_relaxed);
+    return true;
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+  /// @brief Writer: store the status of a slave
+  ///
+  //////////////////////////////////////////////////////////////////////////////
+  bool putStatus(uint8_t addr, const RingStatus& st) {
+    int8_t i = takeSlot(addr);
+    if (i < 0) {
+      header->errors.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+    RingSlot& s = header->slot[i];
+    uint32_t v = s.statusVersion.load(std::memory_order_relaxed);
+    s.statusVersion.store(v + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    memcpy((void*)&s.status, &st, sizeof(st));
+    s.statusVersion.store(v + 2, std::memory_order_release);
+    header->statusLines.fetch_add(1, std::memory_order_relaxed);
+    return true;
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+  /// @brief Record position of seq in a slot (whatever it holds)
+  ///
+  //////////////////////////////////////////////////////////////////////////////
+  RingRecord* at(int8_t slot, uint32_t seq) const {
+    RingRecord* recs = (RingRecord*)((uint8_t*)header + RING_HEADER_SIZE);
+    return recs + (size_t)slot * header->capacity + (seq & (header->capacity - 1));
+  }
+
+private:
+  size_t mapSize = 0;
+
+  bool map(int fd, bool writable) {
+    void* p = mmap(nullptr, mapSize, writable ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, fd, 0);
+    header = p == MAP_FAILED ? nullptr : (RingHeader*)p;
+    return header != nullptr;
+  }
+
+  int8_t takeSlot(uint8_t addr) {
+    for (uint8_t i = 0; i < RING_SLOTS; ++i) {
+      uint8_t a = header->slot[i].addr.load(std::memory_order_relaxed);
+      if (a == addr) {
+        return i;
+      }
+      if (a == RING_SLOT_FREE) {
+        header->slot[i].addr.store(addr, std::memory_order_release);
+        return i;
+      }
+    }
+    return -1;
+  }
+};
+
+#endif
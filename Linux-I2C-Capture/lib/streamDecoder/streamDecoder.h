@@ -0,0 +1,228 @@
+#ifndef _STREAM_DECODER_H_
+#define _STREAM_DECODER_H_
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "serialRecord.h"
+
+#define STREAM_LINE_MAX   (REC_FRAME_MAX + 64)  // Longest line or frame kept
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Status line or REC_STATUS record of the master
+///
+//////////////////////////////////////////////////////////////////////////////
+struct StreamStatus {
+  uint8_t addr;
+  uint8_t status;
+  uint8_t online;
+  uint16_t count;
+  uint16_t value;
+  uint16_t min;
+  uint16_t max;
+  uint16_t rate;
+  uint32_t errors;
+};
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Splits the serial output of the master (all OUTPUT_FORMATs, also
+///        mixed after a "format" command) into samples, status lines and
+///        other text and hands them to a Sink:
+///
+///        void sample(uint8_t addr, uint16_t seq, uint16_t value, bool cobs)
+///        void status(const StreamStatus& st)
+///        void text(const char* line, uint16_t len)
+///        void error()
+///
+///        A text line ends with '\n', a COBS frame with 0x00. A frame never
+///        starts with a printable byte (the COBS code of a record shorter
+///        than 31 bytes is < 0x20), so a '\n' ends a line only if the line
+///        started printable; inside a frame it is data. Damaged frames and
+///        overlong lines are counted as errors and skipped up to the next
+///        delimiter.
+///
+///        Text lines are parsed by hand, sample lines ("0x24 #12: 29876 ->
+///        ...", OUT_TEXT and OUT_FIXED) first. The plain loop of the master
+///        prints "ADC-Value: n -> ..." without address and number: address
+///        RING_ADDR_PLAIN, numbered by the decoder.
+///
+//////////////////////////////////////////////////////////////////////////////
+template <class Sink>
+class StreamDecoder {
+public:
+  explicit StreamDecoder(Sink& sink) : sink(sink) {}
+
+  //////////////////////////////////////////////////////////////////////////////
+  /// @brief Feed received bytes, any chunk size
+  ///
+  //////////////////////////////////////////////////////////////////////////////
+  void feed(const uint8_t* data, size_t len) {
+    for (size_t i = 0; i < len; ++i) {
+      uint8_t c = data[i];
+      if (c == 0x00) {
+        if (len_ > 0 && !overflow) {
+          frame();
+        } else if (overflow) {
+          sink.error();
+        }
+        len_ = 0;
+        overflow = false;
+      } else if (c == '\n' && (len_ == 0 || buf[0] >= 0x20)) {
+        if (overflow) {
+          sink.error();
+        } else {
+          line();
+        }
+        len_ = 0;
+        overflow = false;
+      } else if (len_ < STREAM_LINE_MAX) {
+        buf[len_++] = c;
+      } else {
+        overflow = true;
+      }
+    }
+  }
+
+private:
+  Sink& sink;
+  uint8_t buf[STREAM_LINE_MAX];
+  uint16_t len_ = 0;
+  bool overflow = false;
+  uint16_t plainSeq = 0;
+
+  //////////////////////////////////////////////////////////////////////////////
+  /// @brief Unsigned decimal at p, advances p
+  ///
+  //////////////////////////////////////////////////////////////////////////////
+  static bool parseUInt(const char*& p, const char* end, uint32_t& val) {
+    const char* start = p;
+    val = 0;
+    while (p < end && *p >= '0' && *p <= '9') {
+      val = val * 10 + (*p++ - '0');
+    }
+    return p != start;
+  }
+
+  static bool parseHex8(const char*& p, const char* end, uint8_t& val) {
+    uint8_t n = 0;
+    val = 0;
+    for (; n < 2 && p < end; ++n, ++p) {
+      char c = *p;
+      uint8_t d = (c >= '0' && c <= '9') ? c - '0' : (c >= 'A' && c <= 'F') ? c - 'A' + 10 :
+                  (c >= 'a' && c <= 'f') ? c - 'a' + 10 : 0xFF;
+      if (d == 0xFF) {
+        break;
+      }
+      val = (val << 4) | d;
+    }
+    return n == 2;
+  }
+
+  static bool skip(const char*& p, const char* end, const char* text) {
+    size_t n = strlen(text);
+    if ((size_t)(end - p) < n || memcmp(p, text, n) != 0) {
+      return false;
+    }
+    p += n;
+    return true;
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+  /// @brief A text line (without '\n', maybe with '\r')
+  ///
+  //////////////////////////////////////////////////////////////////////////////
+  void line() {
+    const char* p = (const char*)buf;
+    const char* end = p + len_;
+    uint32_t seq, value;
+    uint8_t addr;
+
+    if (end > p && end[-1] == '\r') {
+      end--;
+    }
+    if (skip(p, end, "0x") && parseHex8(p, end, addr)) {
+      if (skip(p, end, " #") && parseUInt(p, end, seq) && skip(p, end, ": ") &&
+          parseUInt(p, end, value)) {
+        sink.sample(addr, (uint16_t)seq, (uint16_t)value, false);
+        return;
+      }
+      if (statusLine((const char*)buf, end)) {
+        return;
+      }
+    }
+    p = (const char*)buf;
+    if (skip(p, end, "ADC-Value: ") && parseUInt(p, end, value)) {
+      sink.sample(0, plainSeq++, (uint16_t)value, false);
+      return;
+    }
+    sink.text((const char*)buf, end - (const char*)buf);
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+  /// @brief Status line of printStatus() (once a second per node, sscanf
+  ///        is good enough here)
+  ///
+  //////////////////////////////////////////////////////////////////////////////
+  bool statusLine(const char* text, const char* end) {
+    char line[STREAM_LINE_MAX + 1];
+    char online[8];
+    unsigned addr, value, min, max, count, status, rate;
+    unsigned long errors;
+
+    memcpy(line, text, end - text);
+    line[end - text] = 0;
+    if (sscanf(line, "0x%2x %7s ADC: %u -> %*s V Min: %u Max: %u Count: %u Status: 0x%2x | %u reads/s, %lu errors",
+               &addr, online, &value, &min, &max, &count, &status, &rate, &errors) != 9) {
+      return false;
+    }
+    StreamStatus st;
+    st.addr = addr;
+    st.online = strcmp(online, "online") == 0;
+    st.value = value;
+    st.min = min;
+    st.max = max;
+    st.count = count;
+    st.status = status;
+    st.rate = rate > 0xFFFF ? 0xFFFF : rate;
+    st.errors = errors;
+    sink.status(st);
+    return true;
+  }
+
+  static uint16_t get16(const uint8_t* p) {
+    return ((uint16_t)p[0] << 8) | p[1];
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+  /// @brief A COBS frame (without the 0x00)
+  ///
+  //////////////////////////////////////////////////////////////////////////////
+  void frame() {
+    uint8_t rec[STREAM_LINE_MAX];
+    uint16_t n = unframeRecord(buf, len_, rec);
+
+    if (n == 0) {
+      sink.error();
+    } else if (rec[0] == REC_SAMPLE && n == REC_SAMPLE_LEN) {
+      sink.sample(rec[1], get16(rec + 2), get16(rec + 4), true);
+    } else if (rec[0] == REC_STATUS && n == REC_STATUS_LEN) {
+      StreamStatus st;
+      st.addr = rec[1];
+      st.count = get16(rec + 2);
+      st.value = get16(rec + 4);
+      st.min = get16(rec + 6);
+      st.max = get16(rec + 8);
+      st.status = rec[10];
+      st.online = rec[11];
+      st.rate = get16(rec + 12);
+      st.errors = ((uint32_t)get16(rec + 14) << 16) | get16(rec + 16);
+      sink.status(st);
+    } else if (rec[0] == REC_TEXT) {
+      sink.text((const char*)rec + 1, n - 1);
+    } else {
+      sink.error();
+    }
+  }
+};
+
+#endif
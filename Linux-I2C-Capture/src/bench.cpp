@@ -0,0 +1,328 @@
+//////////////////////////////////////////////////////////////////////////////
+/// @file bench.cpp
+/// @brief Capture benchmark, no hardware needed:
+///
+///        1. Decoder: host time per sample for every output format of the
+///           master, against a line-by-line sscanf() parser (what an
+///           ingestion script does per line).
+///        2. Ring file: time per stored sample and per lookup.
+///        3. Replay over a pty into the capture loop as fast as it goes,
+///           4 nodes, the format switching every second, every 1000th
+///           sample of one node missing. A reader thread follows one
+///           slave in the mapped file meanwhile. Afterwards every sample
+///           in the ring is checked against the generated value, the gaps
+///           against the left out samples. The CPU time per byte gives the
+///           load of the capture at a baud rate.
+///
+//////////////////////////////////////////////////////////////////////////////
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <thread>
+#include <vector>
+#include <sys/ioctl.h>
+#include <sys/resource.h>
+
+#include "capture.h"
+
+#define BENCH_NODES       4
+#define BENCH_SKIP        1000        // Every n-th sample of the 1st node is missing
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Sink that only counts
+///
+//////////////////////////////////////////////////////////////////////////////
+struct CountSink {
+  uint32_t samples = 0;
+  uint32_t statusLines = 0;
+  uint32_t textLines = 0;
+  uint32_t errors = 0;
+  uint32_t sum = 0;
+
+  void sample(uint8_t addr, uint16_t seq, uint16_t value, bool cobs) {
+    (void)cobs;
+    samples++;
+    sum += addr + seq + value;
+  }
+  void status(const StreamStatus& st) {
+    statusLines++;
+    sum += st.count;
+  }
+  void text(const char* line, uint16_t len) {
+    (void)line;
+    (void)len;
+    textLines++;
+  }
+  void error() {
+    errors++;
+  }
+};
+
+static double nowNs(void) {
+  return (double)captureTimeNs();
+}
+
+static double cpuNs(void) {
+  struct rusage ru;
+  getrusage(RUSAGE_SELF, &ru);
+  return (ru.ru_utime.tv_sec + ru.ru_stime.tv_sec) * 1e9 + (ru.ru_utime.tv_usec + ru.ru_stime.tv_usec) * 1e3;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief The ingestion script: one sscanf() per line
+///
+//////////////////////////////////////////////////////////////////////////////
+static void scanfParse(const std::vector<uint8_t>& data, CountSink& sink) {
+  const char* p = (const char*)data.data();
+  const char* end = p + data.size();
+  char line[256];
+
+  while (p < end) {
+    const char* nl = (const char*)memchr(p, '\n', end - p);
+    size_t len = (nl ? nl : end) - p;
+    if (len >= sizeof(line)) {
+      len = sizeof(line) - 1;
+    }
+    memcpy(line, p, len);
+    line[len] = 0;
+    p = nl ? nl + 1 : end;
+    unsigned addr, seq, value;
+    float volt;
+    if (sscanf(line, "0x%x #%u: %u -> %f V", &addr, &seq, &value, &volt) == 4) {
+      sink.sample(addr, seq, value, false);
+    } else {
+      StreamStatus st = {};
+      unsigned min, max, count, status, rate;
+      unsigned long errors;
+      char online[8];
+      if (sscanf(line, "0x%2x %7s ADC: %u -> %f V Min: %u Max: %u Count: %u Status: 0x%2x | %u reads/s, %lu errors",
+                 &addr, online, &value, &volt, &min, &max, &count, &status, &rate, &errors) == 10) {
+        st.count = count;
+        sink.status(st);
+      } else {
+        sink.text(line, len);
+      }
+    }
+  }
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Decoder time per sample of one format
+///
+//////////////////////////////////////////////////////////////////////////////
+static void runDecoder(uint8_t format, const char* name, uint32_t loops) {
+  ReplayGen gen;
+  std::vector<uint8_t> data(256 * 1024);
+  gen.nodes = BENCH_NODES;
+  gen.format = format;
+  data.resize(gen.generate(data.data(), data.size()));
+
+  CountSink sink;
+  StreamDecoder<CountSink> decoder(sink);
+  double t0 = nowNs();
+  for (uint32_t i = 0; i < loops; ++i) {
+    decoder.feed(data.data(), data.size());
+  }
+  double ns = (nowNs() - t0) / ((double)gen.samples * loops);
+  bool ok = sink.samples == gen.samples * loops && sink.errors == 0;
+
+  char ref[32] = "-";
+  if (format == OUT_TEXT || format == OUT_FIXED) {
+    CountSink refSink;
+    uint32_t refLoops = loops / 10 + 1;
+    t0 = nowNs();
+    for (uint32_t i = 0; i < refLoops; ++i) {
+      scanfParse(data, refSink);
+    }
+    double refNs = (nowNs() - t0) / ((double)gen.samples * refLoops);
+    ok = ok && refSink.samples == gen.samples * refLoops && refSink.statusLines == sink.statusLines / loops * refLoops;
+    snprintf(ref, sizeof(ref), "%7.0f  %5.1fx", refNs, refNs / ns);
+  }
+  printf("%-6s | %6.1f B | %7.1f | %-15s | %8.2f M | %s\n", name, (double)data.size() / gen.samples,
+         ns, ref, 1000.0 / ns, ok ? "ok" : "WRONG");
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Ring file: store and look up
+///
+//////////////////////////////////////////////////////////////////////////////
+static void runRing(const char* path, uint32_t loops) {
+  RingFile ring;
+  uint32_t n = loops * 1000;
+  uint32_t wrong = 0;
+
+  if (!ring.create(path, CAPTURE_CAPACITY)) {
+    printf("Ring file %s: cannot create\n", path);
+    return;
+  }
+  double t0 = nowNs();
+  for (uint32_t i = 0; i < n; ++i) {
+    uint8_t addr = 0x24 + (i & 3);
+    uint16_t seq = i >> 2;
+    ring.putSample(addr, seq, replayValue(addr, seq), 0, i);
+  }
+  double putNs = (nowNs() - t0) / n;
+  int8_t slot = ring.slotOf(0x24);
+  uint32_t next = ring.next(slot);
+  uint32_t span = next < CAPTURE_CAPACITY ? next : CAPTURE_CAPACITY;
+  t0 = nowNs();
+  for (uint32_t i = 0; i < n; ++i) {
+    uint32_t seq = next - 1 - (i % span);
+    const RingRecord* rec = ring.find(slot, seq);
+    wrong += rec == nullptr || rec->value != replayValue(0x24, (uint16_t)seq) || !RingFile::stillValid(rec, seq);
+  }
+  double findNs = (nowNs() - t0) / n;
+  printf("Ring file: put %.1f ns/sample, find + check %.1f ns, %lu MB mapped | %s\n", putNs, findNs,
+         (unsigned long)((RING_HEADER_SIZE + (size_t)RING_SLOTS * CAPTURE_CAPACITY * sizeof(RingRecord)) >> 20),
+         wrong ? "WRONG" : "ok");
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Replay over a pty into the capture loop, follower thread, check
+///
+//////////////////////////////////////////////////////////////////////////////
+static void runPty(const char* path, uint32_t loops) {
+  char slaveName[64];
+  volatile bool stop = false;
+  volatile bool done = false;
+  RingFile ring;
+  ReplayGen gen;
+
+  int master = ptyOpen(slaveName, sizeof(slaveName));
+  int fd = master < 0 ? -1 : serialOpen(slaveName, CAPTURE_BAUD);
+  if (fd < 0 || !ring.create(path, CAPTURE_CAPACITY)) {
+    printf("pty / ring file: cannot open\n");
+    return;
+  }
+  gen.nodes = BENCH_NODES;
+  gen.format = REPLAY_MIXED;
+  gen.skipEvery = BENCH_SKIP;
+  uint32_t target = loops * 200;      // Samples
+
+  // Reader in the same file, its own read-only mapping
+  uint32_t followed = 0, torn = 0, followWrong = 0;
+  std::thread follower([&]() {
+    RingFile view;
+    while (!view.open(path)) {
+    }
+    uint32_t seq = 0;
+    int8_t slot = -1;
+    while (!done || seq != view.next(slot)) {
+      if (slot < 0) {
+        slot = view.slotOf(0x25);
+        continue;
+      }
+      uint32_t next = view.next(slot);
+      if (seq == next) {
+        std::this_thread::yield();
+        continue;
+      }
+      const RingRecord* rec = view.find(slot, seq);
+      if (rec == nullptr) {
+        followWrong++;                // Node 0x25 has no gaps
+      } else {
+        uint16_t value = rec->value;
+        if (!RingFile::stillValid(rec, seq)) {
+          torn++;
+        } else if (value != replayValue(0x25, (uint16_t)seq)) {
+          followWrong++;
+        }
+      }
+      followed++;
+      seq++;
+    }
+  });
+
+  uint64_t bytes = 0;
+  std::thread writer([&]() {
+    static uint8_t buf[16 * 1024];
+    while (gen.samples < target) {
+      size_t n = gen.generate(buf, sizeof(buf));
+      for (size_t off = 0; off < n;) {
+        ssize_t w = write(master, buf + off, n - off);
+        if (w <= 0) {
+          break;
+        }
+        off += w;
+      }
+      bytes += n;
+    }
+    int left;
+    do {                              // The capture has read everything
+      std::this_thread::yield();
+    } while (ioctl(fd, FIONREAD, &left) == 0 && left > 0);
+    stop = true;
+    uint8_t wake = 0x00;              // Empty frame: ends the read()
+    (void)!write(master, &wake, 1);
+  });
+
+  double t0 = nowNs();
+  double c0 = cpuNs();
+  capture(fd, ring, &stop);
+  double wall = nowNs() - t0;
+  double cpu = cpuNs() - c0;
+  writer.join();
+  done = true;
+  follower.join();
+
+  // Every sample in the ring against the generator, gaps against the left out ones
+  uint32_t wrong = 0, stored = 0;
+  for (uint8_t node = 0; node < BENCH_NODES; ++node) {
+    uint8_t addr = 0x24 + node;
+    int8_t slot = ring.slotOf(addr);
+    uint32_t next = ring.next(slot);
+    wrong += next != gen.seq[node];
+    for (uint32_t seq = 0; seq < next; ++seq) {
+      const RingRecord* rec = ring.find(slot, seq);
+      bool skipped = node == 0 && seq % BENCH_SKIP == BENCH_SKIP - 1;
+      if (rec == nullptr) {
+        wrong += !skipped;
+        continue;
+      }
+      stored++;
+      wrong += skipped || rec->value != replayValue(addr, (uint16_t)seq);
+    }
+  }
+  RingHeader* h = ring.header;
+  wrong += h->errors.load() != 0 || h->samples.load() != gen.samples || stored != gen.samples ||
+           h->slot[0].gaps != gen.skipped;
+
+  double nsPerByte = cpu / bytes;
+  printf("pty replay: %lu samples, %lu status, %lu text lines, %.1f MB in %.0f ms: %.2f M samples/s, %.1f MB/s\n",
+         (unsigned long)h->samples.load(), (unsigned long)h->statusLines.load(),
+         (unsigned long)h->textLines.load(), bytes / 1e6, wall / 1e6,
+         h->samples.load() * 1e3 / wall, bytes * 1e3 / wall);
+  printf("  gaps %lu (left out %lu), errors %lu, check %s\n", (unsigned long)h->slot[0].gaps,
+         (unsigned long)gen.skipped, (unsigned long)h->errors.load(), wrong ? "WRONG" : "ok");
+  printf("  follower: %lu records of 0x25 read in place, %lu overwritten while read, %s\n",
+         (unsigned long)followed, (unsigned long)torn, followWrong ? "WRONG" : "ok");
+  printf("  CPU %.1f ns/byte (capture, replay and follower): %.3f %% at 115200 baud, %.2f %% at 921600 baud\n",
+         nsPerByte, nsPerByte * 11520 / 1e7, nsPerByte * 92160 / 1e7);
+  close(fd);
+  close(master);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Capture benchmark
+///
+/// @param loops      Decoder passes over 256 kB, ring file and replay size
+//////////////////////////////////////////////////////////////////////////////
+void benchCapture(uint32_t loops) {
+  const char* tmp = getenv("TMPDIR");
+  char path[256];
+  snprintf(path, sizeof(path), "%s/i2c-capture-bench.ring", tmp ? tmp : "/tmp");
+
+  printf("\n== Decoder: master output -> samples (%u nodes, status line every 100 samples) ==\n", BENCH_NODES);
+  printf("Format | per smpl | ns/smpl | sscanf  speedup | samples/s  |\n");
+  runDecoder(OUT_TEXT, "text", loops);
+  runDecoder(OUT_FIXED, "fixed", loops);
+  runDecoder(OUT_COBS, "cobs", loops);
+  runDecoder(REPLAY_MIXED, "mixed", loops);
+
+  printf("\n== Ring file ==\n");
+  runRing(path, loops);
+
+  printf("\n== Replay over a pty -> capture -> ring file ==\n");
+  runPty(path, loops);
+  unlink(path);
+}
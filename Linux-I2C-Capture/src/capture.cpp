@@ -0,0 +1,184 @@
+//////////////////////////////////////////////////////////////////////////////
+/// @file capture.cpp
+/// @brief Serial port, capture loop and the reader of the ring file.
+///
+//////////////////////////////////////////////////////////////////////////////
+
+#include <stdio.h>
+#include <errno.h>
+#include <time.h>
+#include <termios.h>
+
+#include "capture.h"
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Capture time
+///
+//////////////////////////////////////////////////////////////////////////////
+uint64_t captureTimeNs(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_REALTIME, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static speed_t baudConst(uint32_t baud) {
+  switch (baud) {
+    case 9600:    return B9600;
+    case 19200:   return B19200;
+    case 38400:   return B38400;
+    case 57600:   return B57600;
+    case 230400:  return B230400;
+    case 460800:  return B460800;
+    case 921600:  return B921600;
+    default:      return B115200;
+  }
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Raw mode, 8N1, no flow control, reads return what is there
+///
+/// @return int         0, -1 on error (errno)
+//////////////////////////////////////////////////////////////////////////////
+int serialRaw(int fd, uint32_t baud) {
+  struct termios tio;
+
+  if (tcgetattr(fd, &tio) != 0) {
+    return -1;
+  }
+  cfmakeraw(&tio);
+  tio.c_cflag |= CLOCAL | CREAD;
+  tio.c_cflag &= ~(CSTOPB | CRTSCTS);
+  tio.c_cc[VMIN] = 1;
+  tio.c_cc[VTIME] = 0;
+  cfsetispeed(&tio, baudConst(baud));
+  cfsetospeed(&tio, baudConst(baud));
+  return tcsetattr(fd, TCSANOW, &tio);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Open the serial port of the master (tty or the slave side of a
+///        pty)
+///
+/// @return int         File descriptor, -1 on error
+//////////////////////////////////////////////////////////////////////////////
+int serialOpen(const char* dev, uint32_t baud) {
+  int fd = open(dev, O_RDWR | O_NOCTTY);
+  if (fd < 0) {
+    return -1;
+  }
+  if (serialRaw(fd, baud) != 0) {
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Decode the stream into the ring until EOF, an error or stop
+///
+/// @return int         0: EOF or stop, -1: read error
+//////////////////////////////////////////////////////////////////////////////
+int capture(int fd, RingFile& ring, volatile bool* stop) {
+  uint8_t buf[CAPTURE_READ_SIZE];
+  RingSink sink(ring);
+  StreamDecoder<RingSink> decoder(sink);
+
+  while (!*stop) {
+    ssize_t n = read(fd, buf, sizeof(buf));
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n < 0 && errno == EIO) {      // pty: the writer closed its side
+      return 0;
+    }
+    if (n <= 0) {
+      return n == 0 ? 0 : -1;
+    }
+    sink.timeNs = captureTimeNs();
+    decoder.feed(buf, n);
+  }
+  return 0;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Print a record (used in place)
+///
+/// @return true        Printed, the record was not overwritten meanwhile
+//////////////////////////////////////////////////////////////////////////////
+static bool printRecord(const RingFile& ring, int8_t slot, uint32_t seq) {
+  const RingRecord* rec = ring.find(slot, seq);
+  if (rec == nullptr) {
+    return false;
+  }
+  uint64_t t = rec->timeNs;
+  uint16_t value = rec->value;
+  uint8_t addr = rec->addr;
+  uint8_t flags = rec->flags;
+  if (!RingFile::stillValid(rec, seq)) {
+    return false;
+  }
+  printf("0x%02X %10lu %5u %llu.%09llu%s%s\n", addr, (unsigned long)seq, value,
+         (unsigned long long)(t / 1000000000ULL), (unsigned long long)(t % 1000000000ULL),
+         (flags & RING_GAP) ? " gap" : "", (flags & RING_RESTART) ? " restart" : "");
+  return true;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Reader: print the last records of every slave (or one), the
+///        status and the counters; with follow also the new records
+///
+/// @param addr         7 bit address, -1: all
+/// @param last         Records per slave
+/// @return int         0, -1: no ring file
+//////////////////////////////////////////////////////////////////////////////
+int readRing(const char* path, int addr, uint32_t last, bool follow, volatile bool* stop) {
+  RingFile ring;
+  uint32_t from[RING_SLOTS];
+
+  if (!ring.open(path)) {
+    return -1;
+  }
+  RingHeader* h = ring.header;
+  printf("%s: %u records per slave, %llu samples, %llu status, %llu text, %llu errors\n", path,
+         h->capacity, (unsigned long long)h->samples.load(), (unsigned long long)h->statusLines.load(),
+         (unsigned long long)h->textLines.load(), (unsigned long long)h->errors.load());
+  for (int8_t s = 0; s < RING_SLOTS; ++s) {
+    uint8_t a = h->slot[s].addr.load(std::memory_order_acquire);
+    uint32_t next = ring.next(s);
+    from[s] = next;
+    if (a == RING_SLOT_FREE || (addr >= 0 && a != addr)) {
+      continue;
+    }
+    RingStatus st;
+    printf("Slave 0x%02X: next seq %lu, gaps %lu, restarts %lu", a, (unsigned long)next,
+           (unsigned long)h->slot[s].gaps, (unsigned long)h->slot[s].restarts);
+    if (ring.status(s, st)) {
+      printf(", %s COUNT %u VALUE %u MIN %u MAX %u STATUS 0x%02X, %u reads/s, %lu errors",
+             st.online ? "online" : "offline", st.count, st.value, st.min, st.max, st.status,
+             st.rate, (unsigned long)st.errors);
+    }
+    printf("\n");
+    uint32_t n = next < last ? next : last;
+    for (uint32_t seq = next - n; seq != next; ++seq) {
+      printRecord(ring, s, seq);
+    }
+  }
+  while (follow && !*stop) {
+    fflush(stdout);
+    usleep(10000);
+    for (int8_t s = 0; s < RING_SLOTS; ++s) {
+      uint8_t a = h->slot[s].addr.load(std::memory_order_acquire);
+      if (a == RING_SLOT_FREE || (addr >= 0 && a != addr)) {
+        continue;
+      }
+      uint32_t next = ring.next(s);
+      if (next - from[s] > h->capacity) {   // Fell behind: the oldest are gone
+        from[s] = next - h->capacity;
+      }
+      for (; from[s] != next; ++from[s]) {
+        printRecord(ring, s, from[s]);
+      }
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,146 @@
+//////////////////////////////////////////////////////////////////////////////
+/// @file main.cpp
+/// @brief Capture daemon for the serial output of the master (Linux).
+///
+///        Usage: program capture <tty> <ring> [--baud N] [--capacity N]
+///               program read <ring> [--addr A] [--last N] [--follow]
+///               program replay [--format text|fixed|cobs|mixed] [--nodes N] [--rate N] [--baud N] [--seconds N] [--file F]
+///               program bench [--loops N]
+///
+//////////////////////////////////////////////////////////////////////////////
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+
+#include "capture.h"
+
+static volatile bool stop = false;
+
+static void onSignal(int sig) {
+  (void)sig;
+  stop = true;
+}
+
+static int usage(const char* name) {
+  printf("Usage: %s capture <tty> <ring> [--baud N] [--capacity N]\n"
+         "       %s read <ring> [--addr A] [--last N] [--follow]\n"
+         "       %s replay [--format text|fixed|cobs|mixed] [--nodes N] [--rate N] [--baud N] [--seconds N] [--file F]\n"
+         "       %s bench [--loops N]\n", name, name, name, name);
+  return 1;
+}
+
+static uint8_t formatOf(const char* name) {
+  if (!strcmp(name, "text")) {
+    return OUT_TEXT;
+  }
+  if (!strcmp(name, "cobs")) {
+    return OUT_COBS;
+  }
+  if (!strcmp(name, "mixed")) {
+    return REPLAY_MIXED;
+  }
+  return OUT_FIXED;
+}
+
+int main(int argc, char* argv[]) {
+  const char* arg[2] = {nullptr, nullptr};
+  const char* file = nullptr;
+  uint32_t baud = CAPTURE_BAUD;
+  uint32_t capacity = CAPTURE_CAPACITY;
+  uint32_t last = 10;
+  uint32_t seconds = 0;
+  uint32_t loops = 1000;
+  int addr = -1;
+  bool follow = false;
+  ReplayGen gen;
+  uint8_t nArgs = 0;
+
+  if (argc < 2) {
+    return usage(argv[0]);
+  }
+  const char* cmd = argv[1];
+  for (int i = 2; i < argc; ++i) {
+    if (!strcmp(argv[i], "--baud") && i + 1 < argc) {
+      baud = (uint32_t)strtoul(argv[++i], NULL, 0);
+    } else if (!strcmp(argv[i], "--capacity") && i + 1 < argc) {
+      capacity = (uint32_t)strtoul(argv[++i], NULL, 0);
+    } else if (!strcmp(argv[i], "--addr") && i + 1 < argc) {
+      addr = (int)strtoul(argv[++i], NULL, 0);
+    } else if (!strcmp(argv[i], "--last") && i + 1 < argc) {
+      last = (uint32_t)strtoul(argv[++i], NULL, 0);
+    } else if (!strcmp(argv[i], "--follow")) {
+      follow = true;
+    } else if (!strcmp(argv[i], "--format") && i + 1 < argc) {
+      gen.format = formatOf(argv[++i]);
+    } else if (!strcmp(argv[i], "--nodes") && i + 1 < argc) {
+      gen.nodes = (uint8_t)strtoul(argv[++i], NULL, 0);
+    } else if (!strcmp(argv[i], "--rate") && i + 1 < argc) {
+      gen.rate = (uint16_t)strtoul(argv[++i], NULL, 0);
+    } else if (!strcmp(argv[i], "--seconds") && i + 1 < argc) {
+      seconds = (uint32_t)strtoul(argv[++i], NULL, 0);
+    } else if (!strcmp(argv[i], "--file") && i + 1 < argc) {
+      file = argv[++i];
+    } else if (!strcmp(argv[i], "--loops") && i + 1 < argc) {
+      loops = (uint32_t)strtoul(argv[++i], NULL, 0);
+    } else if (argv[i][0] != '-' && nArgs < 2) {
+      arg[nArgs++] = argv[i];
+    } else {
+      return usage(argv[0]);
+    }
+  }
+  if (gen.nodes == 0 || gen.nodes > RING_SLOTS || gen.rate == 0) {
+    return usage(argv[0]);
+  }
+  signal(SIGINT, onSignal);
+  signal(SIGTERM, onSignal);
+
+  if (!strcmp(cmd, "capture") && nArgs == 2) {
+    RingFile ring;
+    int fd = serialOpen(arg[0], baud);
+    if (fd < 0) {
+      perror(arg[0]);
+      return 1;
+    }
+    if (!ring.create(arg[1], capacity)) {
+      perror(arg[1]);
+      return 1;
+    }
+    fprintf(stderr, "Capturing %s into %s, %u records per slave\n", arg[0], arg[1], ring.header->capacity);
+    int rc = capture(fd, ring, &stop);
+    fprintf(stderr, "%llu samples, %llu status, %llu text, %llu errors\n",
+            (unsigned long long)ring.header->samples.load(), (unsigned long long)ring.header->statusLines.load(),
+            (unsigned long long)ring.header->textLines.load(), (unsigned long long)ring.header->errors.load());
+    close(fd);
+    return rc == 0 ? 0 : 1;
+  }
+  if (!strcmp(cmd, "read") && nArgs == 1) {
+    if (readRing(arg[0], addr, last, follow, &stop) != 0) {
+      fprintf(stderr, "%s: no ring file\n", arg[0]);
+      return 1;
+    }
+    return 0;
+  }
+  if (!strcmp(cmd, "replay") && nArgs == 0) {
+    char slaveName[64];
+    int fd = ptyOpen(slaveName, sizeof(slaveName));
+    if (fd < 0) {
+      perror("pty");
+      return 1;
+    }
+    printf("%s\n", slaveName);
+    fflush(stdout);
+    int rc = replay(fd, gen, file, baud, seconds, &stop);
+    if (rc != 0 && file) {
+      perror(file);
+    }
+    close(fd);
+    return rc == 0 ? 0 : 1;
+  }
+  if (!strcmp(cmd, "bench") && nArgs == 0) {
+    benchCapture(loops);
+    return 0;
+  }
+  return usage(argv[0]);
+}
@@ -0,0 +1,231 @@
+//////////////////////////////////////////////////////////////////////////////
+/// @file replay.cpp
+/// @brief Replay of master output over a pseudo-terminal: generated (some
+///        nodes, any output format) or a recorded stream from a file, at
+///        the byte rate of a baud rate or as fast as the reader takes it.
+///
+//////////////////////////////////////////////////////////////////////////////
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <time.h>
+
+#include "capture.h"
+
+#define REPLAY_ITEM_MAX   (REC_FRAME_MAX + 32)  // Longest line or frame of generate()
+#define REPLAY_SLICE_US   10000                 // Pacing interval
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Open a pty in raw mode. The slave side stays open, so the
+///        master side does not see EIO while no reader has it open.
+///
+/// @param slaveName    Device name of the slave side for the reader
+/// @return int         Master side, -1 on error
+//////////////////////////////////////////////////////////////////////////////
+int ptyOpen(char* slaveName, size_t size) {
+  int fd = posix_openpt(O_RDWR | O_NOCTTY);
+  if (fd < 0) {
+    return -1;
+  }
+  if (grantpt(fd) != 0 || unlockpt(fd) != 0 || ptsname_r(fd, slaveName, size) != 0) {
+    close(fd);
+    return -1;
+  }
+  int slave = serialOpen(slaveName, CAPTURE_BAUD);  // Raw: no echo, no CR/LF mapping
+  if (slave < 0) {
+    close(fd);
+    return -1;
+  }
+  return fd;                          // slave is kept open on purpose
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Value of a generated sample
+///
+//////////////////////////////////////////////////////////////////////////////
+uint16_t replayValue(uint8_t addr, uint16_t seq) {
+  uint32_t x = (uint32_t)addr * 2654435761u ^ (uint32_t)seq * 40503u;
+  return (uint16_t)(x ^ (x >> 16));
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief A line in the given format: text as it is plus CR LF, or a
+///        REC_TEXT frame
+///
+//////////////////////////////////////////////////////////////////////////////
+static size_t putLine(uint8_t* p, const char* text, size_t len, uint8_t format) {
+  if (format == OUT_COBS) {
+    uint8_t rec[REC_MAX_LEN + 2];
+    rec[0] = REC_TEXT;
+    memcpy(rec + 1, text, len);
+    return frameRecord(rec, len + 1, p);
+  }
+  memcpy(p, text, len);
+  p[len] = '\r';
+  p[len + 1] = '\n';
+  return len + 2;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief One sample, as printSample() of the master
+///
+//////////////////////////////////////////////////////////////////////////////
+static size_t putSample(uint8_t* out, uint8_t addr, uint16_t seq, uint16_t value, uint8_t format) {
+  char text[48];
+  uint8_t rec[REC_SAMPLE_LEN + 2];
+  char* p;
+
+  switch (format) {
+  case OUT_COBS:
+    rec[0] = REC_SAMPLE;
+    rec[1] = addr;
+    putRecord16(putRecord16(rec + 2, seq), value);
+    return frameRecord(rec, REC_SAMPLE_LEN, out);
+
+  case OUT_FIXED:
+    p = appendHex8(appendText(text, "0x"), addr);
+    p = appendUInt(appendText(p, " #"), seq);
+    p = appendUInt(appendText(p, ": "), value);
+    p = appendFixed(appendText(p, " -> "), scaleRaw16(value, VREF_100UV), 4);
+    p = appendText(p, " V");
+    return putLine(out, text, p - text, format);
+
+  default:
+    return putLine(out, text, sprintf(text, "0x%02X #%u: %u -> %1.4f V", addr, seq, value,
+                                      (0.6 / 65535) * value), format);
+  }
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief The status of a node, as printStatus() of the master
+///
+//////////////////////////////////////////////////////////////////////////////
+static size_t putStatus(uint8_t* out, uint8_t addr, uint16_t count, uint32_t errors, uint8_t format) {
+  char text[128];
+  uint16_t value = replayValue(addr, count);
+
+  if (format == OUT_COBS) {
+    uint8_t rec[REC_STATUS_LEN + 2];
+    uint8_t* p = rec + 2;
+    rec[0] = REC_STATUS;
+    rec[1] = addr;
+    p = putRecord16(p, count);
+    p = putRecord16(p, value);
+    p = putRecord16(p, 0x0123);
+    p = putRecord16(p, 0xFEDC);
+    *p++ = 0x01;
+    *p++ = 1;
+    p = putRecord16(p, 200);
+    putRecord16(putRecord16(p, errors >> 16), errors & 0xFFFF);
+    return frameRecord(rec, REC_STATUS_LEN, out);
+  }
+  int n = sprintf(text, "0x%02X %-7s ADC: %u -> %1.4f V Min: %u Max: %u Count: %u Status: 0x%02X | %lu reads/s, %lu errors",
+                  addr, "online", value, (0.6 / 65535) * value, 0x0123, 0xFEDC, count, 0x01,
+                  200UL, (unsigned long)errors);
+  return putLine(out, text, n, format);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Fill buf with whole lines / frames
+///
+/// @return size_t      Bytes
+//////////////////////////////////////////////////////////////////////////////
+size_t ReplayGen::generate(uint8_t* buf, size_t size) {
+  size_t n = 0;
+
+  while (n + 2 * REPLAY_ITEM_MAX <= size) {
+    uint8_t node = (step / chunk) % nodes;
+    uint8_t addr = 0x24 + node;
+    uint8_t fmt = format == REPLAY_MIXED ? (samples / ((uint32_t)rate * nodes)) % 3 : format;
+    step++;
+    if (node == 0 && skipEvery && seq[0] % skipEvery == skipEvery - 1) {
+      seq[0]++;                       // Lost in the slave FIFO
+      skipped++;
+    }
+    uint16_t s = seq[node]++;
+    n += putSample(buf + n, addr, s, replayValue(addr, s), fmt);
+    samples++;
+    if (seq[node] % rate == 0) {
+      n += putStatus(buf + n, addr, s, node, fmt);
+    }
+    if (samples % (10u * rate) == 0) {
+      static const char message[] = "Node 0x25 online";
+      n += putLine(buf + n, message, sizeof(message) - 1, fmt);
+    }
+  }
+  return n;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Write everything, the reader may take it in small pieces
+///
+//////////////////////////////////////////////////////////////////////////////
+static bool writeAll(int fd, const uint8_t* p, size_t len) {
+  while (len > 0) {
+    ssize_t n = write(fd, p, len);
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n <= 0) {
+      return false;
+    }
+    p += n;
+    len -= n;
+  }
+  return true;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Replay generated output or a file
+///
+/// @param fd           Output (pty master side, file)
+/// @param file         Recorded stream, nullptr: generate
+/// @param baud         Byte rate of a serial port (10 bits per byte), 0: no pacing
+/// @param seconds      Run time, 0: until stop (or the end of the file)
+/// @return int         0, -1: write error or no file
+//////////////////////////////////////////////////////////////////////////////
+int replay(int fd, ReplayGen& gen, const char* file, uint32_t baud, uint32_t seconds, volatile bool* stop) {
+  static uint8_t buf[64 * 1024];
+  FILE* in = nullptr;
+  size_t slice = baud ? baud / 10 * REPLAY_SLICE_US / 1000000 : sizeof(buf);
+  uint64_t t0 = captureTimeNs();
+  uint64_t due = t0;
+  size_t have = 0;
+  size_t pos = 0;
+
+  if (slice < 2 * REPLAY_ITEM_MAX) {
+    slice = 2 * REPLAY_ITEM_MAX;      // Whole items; pacing by the average
+  }
+  if (slice > sizeof(buf)) {
+    slice = sizeof(buf);
+  }
+  if (file && (in = fopen(file, "rb")) == nullptr) {
+    return -1;
+  }
+  while (!*stop && (seconds == 0 || captureTimeNs() - t0 < (uint64_t)seconds * 1000000000ULL)) {
+    if (pos == have) {
+      have = in ? fread(buf, 1, slice, in) : gen.generate(buf, slice);
+      pos = 0;
+      if (have == 0) {
+        break;                        // End of the file
+      }
+    }
+    if (!writeAll(fd, buf + pos, have - pos)) {
+      break;
+    }
+    if (baud) {                       // Keep the average byte rate
+      due += (uint64_t)(have - pos) * 10 * 1000000000ULL / baud;
+      uint64_t now = captureTimeNs();
+      if (due > now) {
+        struct timespec ts = {(time_t)((due - now) / 1000000000ULL), (long)((due - now) % 1000000000ULL)};
+        nanosleep(&ts, nullptr);
+      }
+    }
+    pos = have;
+  }
+  if (in) {
+    fclose(in);
+  }
+  return 0;
+}
@@ -0,0 +1,91 @@
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Calibration of the filtered channel values into engineering
+///        units, integer only (the MSP430 has no FPU).
+///
+///        value = round((raw - offset) * gain / 2^16)
+///
+///        offset is the raw code of the value 0, gain the value of one raw
+///        LSB as Q0.16 fraction. The magnitude |raw - offset| is multiplied
+///        unsigned 16 x 16 -> 32 bit, the high word is the result, so
+///        nothing overflows; values beyond the int16 range saturate.
+///        The F2013 has no hardware multiplier: the product is a call of
+///        the libgcc shift-add loop, ~ 200 cycles per channel in total.
+///
+///        The coefficients are read straight from info flash (no RAM copy).
+///        calRegs is the I2C window: the master writes new coefficients
+///        there and requests I2C_CFG_SAVE_CAL; the main loop takes them
+///        over with calTakeOver() (erase + program of info segment D).
+///        Until then the old coefficients stay active. Without valid
+///        coefficients in info flash the firmware defaults are used.
+///
+//////////////////////////////////////////////////////////////////////////////
+
+#include "calibration.h"
+#include "info-flash.h"
+
+//////////////////////////////////////////////////////////////////////////////
+/// Global variables
+//////////////////////////////////////////////////////////////////////////////
+
+volatile uint8_t calRegs[CAL_SIZE];         // I2C window, written by the ISR
+
+//////////////////////////////////////////////////////////////////////////////
+/// Module global variables
+//////////////////////////////////////////////////////////////////////////////
+
+static const CalCoeff calDefault[SCAN_CHANNELS] = CAL_DEFAULTS;
+static const CalCoeff* calTable = calDefault;   // Active: info flash or defaults
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Select the active coefficients and copy them into the window
+///
+//////////////////////////////////////////////////////////////////////////////
+void calInit(void) {
+  const CalCoeff* stored = infoCal();
+  uint8_t ch;
+
+  calTable = stored ? stored : calDefault;
+  for (ch = 0; ch < SCAN_CHANNELS; ++ch) {
+    calRegs[4 * ch] = calTable[ch].offset >> 8;
+    calRegs[4 * ch + 1] = calTable[ch].offset & 0xFF;
+    calRegs[4 * ch + 2] = calTable[ch].gain >> 8;
+    calRegs[4 * ch + 3] = calTable[ch].gain & 0xFF;
+  }
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Calibrated value of a channel
+///
+/// @param ch         Channel (SCAN_CHANNELS)
+/// @param raw        Filtered raw value
+/// @return int16_t   Value in the unit of the channel, rounded, saturated
+//////////////////////////////////////////////////////////////////////////////
+int16_t calApply(uint8_t ch, uint16_t raw) {
+  uint16_t offset = calTable[ch].offset;
+  uint16_t diff;
+  uint16_t val;
+
+  diff = raw >= offset ? raw - offset : offset - raw;
+  val = ((uint32_t)diff * calTable[ch].gain + 0x8000) >> 16;   // 16 x 16 bit multiply
+  if (val > INT16_MAX) {
+    val = INT16_MAX;
+  }
+  return raw >= offset ? (int16_t)val : -(int16_t)val;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Take over the coefficients of the window (master request) and
+///        store them in info flash. Holds the CPU for the flash erase.
+///
+//////////////////////////////////////////////////////////////////////////////
+void calTakeOver(void) {
+  CalCoeff cal[SCAN_CHANNELS];
+  uint8_t ch;
+
+  for (ch = 0; ch < SCAN_CHANNELS; ++ch) {
+    cal[ch].offset = (calRegs[4 * ch] << 8) | calRegs[4 * ch + 1];
+    cal[ch].gain = (calRegs[4 * ch + 2] << 8) | calRegs[4 * ch + 3];
+  }
+  infoSetCal(cal);
+  calInit();                              // Window shows what is active
+}
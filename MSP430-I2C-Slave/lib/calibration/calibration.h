@@ -0,0 +1,54 @@
+#ifndef _CALIBRATION_H_
+#define _CALIBRATION_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif //__cplusplus
+
+#include <stdint.h>
+#include "sd16-acq.h"
+
+//////////////////////////////////////////////////////////////////////////////
+/// Global definitions
+//////////////////////////////////////////////////////////////////////////////
+
+//#define WITH_CAL                          // Calibrated values at I2C_REG_UNITS, coefficients at I2C_REG_CAL
+                                            // (see calibration.c), ~ 12 bytes more RAM with one channel
+
+#define CAL_SIZE          (4 * SCAN_CHANNELS)   // Coefficient window: offset, gain per channel
+#define UNITS_SIZE        (2 + 2 * SCAN_CHANNELS)   // Value block: COUNT + one value per channel
+#define CAL_MAGIC         0x5A              // Info flash holds valid coefficients
+
+typedef struct CalCoeffStruct {             // value = (raw - offset) * gain / 2^16
+  uint16_t offset;                          // Raw code of the value 0
+  uint16_t gain;                            // Units per raw LSB, Q0.16 (< 1 unit per LSB)
+} CalCoeff;
+
+// Firmware defaults, nominal data of the SD16_A (internal 1.2 V reference):
+// A1 / A2 in 0.1 mV (0.6 V = 65535), battery in mV (AVCC / 11: 6.6 V full
+// scale), temperature in 0.1 °C (bipolar: 397 mV at 0 °C, 1.32 mV/K)
+#ifdef WITH_SCAN
+#define CAL_DEFAULTS      {{0, 6000}, {0, 6600}, {54451, 9091}, {0, 6000}}
+#else
+#define CAL_DEFAULTS      {{0, 6000}}
+#endif
+
+//////////////////////////////////////////////////////////////////////////////
+/// Global variables
+//////////////////////////////////////////////////////////////////////////////
+
+extern volatile uint8_t calRegs[CAL_SIZE];  // Coefficient window (big endian), see calTakeOver()
+
+//////////////////////////////////////////////////////////////////////////////
+/// Forward declaration(s)
+//////////////////////////////////////////////////////////////////////////////
+
+void calInit(void);
+int16_t calApply(uint8_t ch, uint16_t raw);
+void calTakeOver(void);
+
+#ifdef __cplusplus
+}
+#endif //__cplusplus
+
+#endif
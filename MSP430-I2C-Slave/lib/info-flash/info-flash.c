@@ -0,0 +1,133 @@
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Node configuration in info flash (segment D, 64 bytes).
+///
+///        Segment A holds the DCO calibration and is never touched. The
+///        configuration is written as a whole: erase the segment, program
+///        the bytes. The flash timing generator runs from MCLK / 3
+///        (333 kHz at 1 MHz, allowed: 257 - 476 kHz).
+///
+///        An erase takes about 15 ms. The CPU is held during the erase, so
+///        no interrupt is served and the USI stretches SCL for that time.
+///        Only write the configuration on request of the master.
+///
+//////////////////////////////////////////////////////////////////////////////
+
+#include <msp430.h>
+#include "info-flash.h"
+#include "msp430-i2c.h"
+
+//////////////////////////////////////////////////////////////////////////////
+/// Global variables
+//////////////////////////////////////////////////////////////////////////////
+
+// Programmed with the firmware. Later changes are written by infoWrite().
+InfoConfig infoConfig __attribute__((section(".infod"))) = {
+  INFO_MAGIC, SLAVE_ADDR, (uint8_t)~SLAVE_ADDR, CAL_MAGIC, CAL_DEFAULTS
+};
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Stored slave address
+///
+/// @return uint8_t   7 bit address, 0 if the segment holds no valid config
+//////////////////////////////////////////////////////////////////////////////
+uint8_t infoSlaveAddr(void) {
+  if (infoConfig.magic != INFO_MAGIC
+      || (uint8_t)(infoConfig.slaveAddr ^ infoConfig.slaveAddrInv) != 0xFF
+      || infoConfig.slaveAddr < INFO_ADDR_MIN || infoConfig.slaveAddr > INFO_ADDR_MAX) {
+    return 0;
+  }
+  return infoConfig.slaveAddr;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Store a new slave address (only if it changed)
+///
+/// @param addr       7 bit address
+/// @return uint8_t   1: stored, 0: invalid address
+//////////////////////////////////////////////////////////////////////////////
+uint8_t infoSetSlaveAddr(uint8_t addr) {
+  InfoConfig cfg;
+
+  if (addr < INFO_ADDR_MIN || addr > INFO_ADDR_MAX) {
+    return 0;
+  }
+  if (infoSlaveAddr() != addr) {
+    cfg = infoConfig;
+    cfg.magic = INFO_MAGIC;
+    cfg.slaveAddr = addr;
+    cfg.slaveAddrInv = ~addr;
+    infoWrite(&cfg);
+  }
+  return 1;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Stored calibration coefficients
+///
+/// @return const CalCoeff*   SCAN_CHANNELS coefficients (in flash), NULL if
+///                           the segment holds none (e.g. older layout)
+//////////////////////////////////////////////////////////////////////////////
+const CalCoeff* infoCal(void) {
+  if (infoConfig.magic != INFO_MAGIC || infoConfig.calMagic != CAL_MAGIC) {
+    return 0;
+  }
+  return infoConfig.cal;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Store new calibration coefficients (only if they changed). The
+///        slave address is kept.
+///
+/// @param cal        SCAN_CHANNELS coefficients
+//////////////////////////////////////////////////////////////////////////////
+void infoSetCal(const CalCoeff* cal) {
+  InfoConfig cfg;
+  const CalCoeff* stored = infoCal();
+  uint8_t ch;
+
+  for (ch = 0; stored && ch < SCAN_CHANNELS; ++ch) {
+    if (stored[ch].offset != cal[ch].offset || stored[ch].gain != cal[ch].gain) {
+      break;
+    }
+  }
+  if (stored && ch == SCAN_CHANNELS) {
+    return;
+  }
+  cfg = infoConfig;
+  if (infoSlaveAddr() == 0) {             // Keep a valid header
+    cfg.slaveAddr = SLAVE_ADDR;
+    cfg.slaveAddrInv = ~SLAVE_ADDR;
+  }
+  cfg.magic = INFO_MAGIC;
+  cfg.calMagic = CAL_MAGIC;
+  for (ch = 0; ch < SCAN_CHANNELS; ++ch) {
+    cfg.cal[ch] = cal[ch];
+  }
+  infoWrite(&cfg);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Erase info segment D and program a new configuration.
+///        Interrupts are disabled during the flash operation and enabled
+///        again afterwards.
+///
+/// @param cfg        New configuration (in RAM)
+//////////////////////////////////////////////////////////////////////////////
+void infoWrite(const InfoConfig* cfg) {
+  const uint8_t* src = (const uint8_t*)cfg;
+  volatile uint8_t* dst = (volatile uint8_t*)&infoConfig;
+  uint8_t i;
+
+  __disable_interrupt();
+  FCTL2 = FWKEY | FSSEL_1 | FN1;          // MCLK / 3
+  FCTL3 = FWKEY;                          // Unlock (LOCKA unchanged)
+  FCTL1 = FWKEY | ERASE;                  // Segment erase
+  *dst = 0;                               // Dummy write starts the erase
+  FCTL1 = FWKEY | WRT;                    // Byte write
+  for (i = 0; i < sizeof(InfoConfig); ++i) {
+    dst[i] = src[i];
+  }
+  FCTL1 = FWKEY;
+  FCTL3 = FWKEY | LOCK;                   // Lock again
+  __enable_interrupt();
+}
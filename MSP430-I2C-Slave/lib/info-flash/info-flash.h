@@ -0,0 +1,47 @@
+#ifndef _INFO_FLASH_H_
+#define _INFO_FLASH_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif //__cplusplus
+
+#include <stdint.h>
+#include "calibration.h"
+
+//////////////////////////////////////////////////////////////////////////////
+/// Global definitions
+//////////////////////////////////////////////////////////////////////////////
+
+#define INFO_MAGIC        0xA5              // Segment holds a valid config
+#define INFO_ADDR_MIN     0x08              // Valid 7 bit slave addresses
+#define INFO_ADDR_MAX     0x77
+
+typedef struct InfoConfigStruct {           // Node configuration in info segment D
+  uint8_t magic;                            // INFO_MAGIC
+  uint8_t slaveAddr;                        // 7 bit I2C slave address
+  uint8_t slaveAddrInv;                     // ~slaveAddr (check)
+  uint8_t calMagic;                         // CAL_MAGIC: cal holds valid coefficients
+  CalCoeff cal[SCAN_CHANNELS];              // Calibration (see calibration.h)
+} InfoConfig;
+
+//////////////////////////////////////////////////////////////////////////////
+/// Global variables
+//////////////////////////////////////////////////////////////////////////////
+
+extern InfoConfig infoConfig;               // Located in info flash
+
+//////////////////////////////////////////////////////////////////////////////
+/// Forward declaration(s)
+//////////////////////////////////////////////////////////////////////////////
+
+uint8_t infoSlaveAddr(void);
+uint8_t infoSetSlaveAddr(uint8_t addr);
+const CalCoeff* infoCal(void);
+void infoSetCal(const CalCoeff* cal);
+void infoWrite(const InfoConfig* cfg);
+
+#ifdef __cplusplus
+}
+#endif //__cplusplus
+
+#endif
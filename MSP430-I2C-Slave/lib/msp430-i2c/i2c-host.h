@@ -0,0 +1,86 @@
+//////////////////////////////////////////////////////////////////////////////
+/// @file i2c-host.h
+/// @brief I2C slave backend without a peripheral: the bus events of a
+///        transaction as function calls, for the benchmarks and checks of
+///        the native env. Same protocol as the USI and USCI backends
+///        (i2c-slave-sm.h), nothing else in between.
+///
+///        A transaction: i2cHostStart(), then i2cHostWrite() or
+///        i2cHostRead() per byte, i2cHostStop(). A read ends with a NACK
+///        (ack = 0) on its last byte, like on the bus.
+///
+//////////////////////////////////////////////////////////////////////////////
+
+#ifndef _I2C_HOST_H_
+#define _I2C_HOST_H_
+
+#include "i2c-slave-sm.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif //__cplusplus
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief START or repeated START and the address byte
+///
+/// @param addrByte   7 bit address << 1 | R/W
+/// @param repeated   Repeated START: the PEC goes on
+/// @return uint8_t   1: ACKed (own address)
+//////////////////////////////////////////////////////////////////////////////
+static inline uint8_t i2cHostStart(uint8_t addrByte, uint8_t repeated) {
+  i2cSmStart();
+  if (!repeated) {
+    i2cSmNewPec();
+  }
+  i2cSmBegin();
+  if (!i2cSmMatch(addrByte)) {
+    return 0;
+  }
+  i2cSmAddressed(addrByte);
+  if (addrByte & 0x01) {
+    i2cSmTxStage();
+  } else {
+    i2cSmWriteStart();
+  }
+  return 1;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Master writes a byte (ACKed)
+///
+//////////////////////////////////////////////////////////////////////////////
+static inline void i2cHostWrite(uint8_t val) {
+  i2cSmRxByte(val);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Master reads a byte
+///
+/// @param ack        0: NACK, the last byte of the read
+/// @return uint8_t   Byte sent by the slave
+//////////////////////////////////////////////////////////////////////////////
+static inline uint8_t i2cHostRead(uint8_t ack) {
+  uint8_t val = i2cSlave.txNext;
+
+  i2cSmTxSent();
+  if (ack) {
+    i2cSmTxStage();
+  } else {
+    i2cSmTxEnd();
+  }
+  return val;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief STOP. Nothing to do: the read ended with its NACK, the next
+///        START without repeated starts a new PEC.
+///
+//////////////////////////////////////////////////////////////////////////////
+static inline void i2cHostStop(void) {
+}
+
+#ifdef __cplusplus
+}
+#endif //__cplusplus
+
+#endif
@@ -0,0 +1,388 @@
+//////////////////////////////////////////////////////////////////////////////
+/// @file i2c-slave-sm.h
+/// @brief Protocol state machine of the I2C slave: register pointer,
+///        register map, snapshot double buffer, FIFO stream and PEC (the
+///        protocol is described in msp430-i2c.c).
+///
+///        Header only and free of peripheral registers. A backend owns the
+///        peripheral and its interrupts and reports the bus events with
+///        the inline functions below; the backend is chosen at compile
+///        time (I2C_BACKEND), so every call inlines into its ISR:
+///
+///        i2c-usi.c   USI (MSP430F20x2/3), bit level, USI_TXRX. Stages the
+///                    next TX byte while the current one is shifted out.
+///        i2c-usci.c  USCI_B0 (MSP430G2xx3), byte level, address match,
+///                    ACK and SCL stretching in hardware.
+///        i2c-host.h  No peripheral: bus events as function calls, for
+///                    the benchmarks of the native env.
+///
+///        Reading a byte is split in two, so a backend can fetch it ahead
+///        without losing it when the master ends the read early:
+///        i2cSmTxStage() fetches the byte at the register pointer into
+///        txNext without side effects (a FIFO byte is only peeked),
+///        i2cSmTxSent() is called once the byte really goes out: it takes
+///        it out of the FIFO, adds it to the PEC and moves the pointer on.
+///        A staged byte that is never sent is simply dropped.
+///
+//////////////////////////////////////////////////////////////////////////////
+
+#ifndef _I2C_SLAVE_SM_H_
+#define _I2C_SLAVE_SM_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif //__cplusplus
+
+#include <stdint.h>
+#include <msp430.h>
+#include "msp430-i2c.h"
+#include "sample-history.h"
+#include "smbus-pec.h"
+#include "slave-stats.h"
+#include "sd16-acq.h"
+#include "calibration.h"
+#include "running-stats.h"
+
+//////////////////////////////////////////////////////////////////////////////
+/// Global definitions
+//////////////////////////////////////////////////////////////////////////////
+
+#ifndef I2C_BACKEND                         // Peripheral of the device
+#if defined(__MSP430_HAS_USCI__) && !defined(__MSP430_HAS_USI__)
+#define I2C_BACKEND         I2C_BACKEND_USCI
+#else
+#define I2C_BACKEND         I2C_BACKEND_USI
+#endif
+#endif
+
+#ifdef WITH_AGG
+#define I2C_DATA_SIZE       (NUMBER_OF_BYTES + I2C_SCAN_BYTES + I2C_UNITS_BYTES + AGG_SIZE)   // Snapshot incl. statistics block
+#else
+#define I2C_DATA_SIZE       (NUMBER_OF_BYTES + I2C_SCAN_BYTES + I2C_UNITS_BYTES)  // Snapshot incl. channel and value block
+#endif
+
+#ifdef WITH_STATS
+#define I2C_IS_STATS(reg)   ((uint8_t)((reg) - I2C_REG_STATS) < STATS_SIZE)
+#define I2C_END_STATS(reg)  ((reg) == I2C_REG_STATS + STATS_SIZE - 1)
+#else
+#define I2C_END_STATS(reg)  0
+#endif
+#ifdef WITH_SCAN
+#define I2C_IS_SCAN(reg)    ((uint8_t)((reg) - I2C_REG_SCAN) < SCAN_SIZE)
+#define I2C_END_SCAN(reg)   ((reg) == I2C_REG_SCAN + SCAN_SIZE - 1)
+#else
+#define I2C_END_SCAN(reg)   0
+#endif
+#ifdef WITH_CAL
+#define I2C_IS_UNITS(reg)   ((uint8_t)((reg) - I2C_REG_UNITS) < UNITS_SIZE)
+#define I2C_IS_CAL(reg)     ((uint8_t)((reg) - I2C_REG_CAL) < CAL_SIZE)
+#define I2C_END_CAL(reg)    ((reg) == I2C_REG_UNITS + UNITS_SIZE - 1 || (reg) == I2C_REG_CAL + CAL_SIZE - 1)
+#else
+#define I2C_END_CAL(reg)    0
+#endif
+#ifdef WITH_PROFILES
+#define I2C_END_PROFILE(reg) ((reg) == I2C_REG_PROFILE)
+#else
+#define I2C_END_PROFILE(reg) 0
+#endif
+#ifdef WITH_AGG
+#define I2C_IS_AGG(reg)     ((uint8_t)((reg) - I2C_REG_AGG) < AGG_SIZE)
+#define I2C_END_AGG(reg)    ((reg) == I2C_REG_AGG + AGG_SIZE - 1 || (reg) == I2C_REG_AGG_WINDOW)
+#else
+#define I2C_END_AGG(reg)    0
+#endif
+                                            // Last register of a block: the PEC follows
+#define I2C_REG_LAST(reg)   ((reg) == I2C_REG_ADDR || I2C_END_STATS(reg) || I2C_END_SCAN(reg) || \
+                             I2C_END_CAL(reg) || I2C_END_PROFILE(reg) || I2C_END_AGG(reg))
+
+#ifdef WITH_TRIGGER
+#define I2C_TRIG_IDLE       0
+#define I2C_TRIG_BUSY       1               // Burst accepted: every published snapshot gets I2C_STATUS_BUSY
+#define I2C_TRIG_END        2               // Mean committed: no BUSY from its swap on
+#endif
+
+#ifndef I2C_STATE_TRACE
+#define I2C_STATE_TRACE(state)              // Hook of the native env (cycle model), state | 1: short branch
+#endif
+
+typedef struct I2cSlaveStruct {
+  volatile uint8_t data[2][I2C_DATA_SIZE];  // Snapshot double buffer
+  volatile uint8_t txBuf;                   // Buffer used by the ISR
+  volatile uint8_t swapPending;             // Back buffer holds a new sample
+  uint8_t regPtr;                           // Register pointer
+  uint8_t rxFirst;                          // Next RX byte is the pointer
+  uint8_t txNext;                           // Staged TX byte
+  uint8_t txTake;                           // txNext is a FIFO byte: take it out when sent
+#ifdef WITH_PEC
+  uint8_t pec;                              // CRC of the transaction so far
+  uint8_t pecCount;                         // FIFO bytes since the last PEC
+#endif
+#ifdef WITH_TRIGGER
+  volatile uint8_t trigBusy;                // I2C_TRIG_x, BUSY is set by the ISR only (msp430-i2c.c)
+#endif
+} I2cSlave;
+
+//////////////////////////////////////////////////////////////////////////////
+/// Global variables
+//////////////////////////////////////////////////////////////////////////////
+
+extern I2cSlave i2cSlave;                   // msp430-i2c.c
+extern uint8_t i2cSlaveAddr;                // Own address, 7 Bit Address is << 1 for R/W
+
+//////////////////////////////////////////////////////////////////////////////
+/// Forward declaration(s)
+//////////////////////////////////////////////////////////////////////////////
+
+void usiSetup(void);                        // Backends (i2c-usi.c, i2c-usci.c)
+void usciSetup(void);
+void usciSetAddress(uint8_t addr);
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief START or repeated START: publish the new sample, if there is one.
+///        Between two transactions, so a read never mixes two samples.
+///
+//////////////////////////////////////////////////////////////////////////////
+static inline void i2cSmStart(void) {
+  if (i2cSlave.swapPending) {
+    i2cSlave.txBuf ^= 0x01;
+    i2cSlave.swapPending = 0;
+#ifdef WITH_TRIGGER
+    if (i2cSlave.trigBusy == I2C_TRIG_END) {          // The mean of the burst
+      i2cSlave.trigBusy = I2C_TRIG_IDLE;
+    } else if (i2cSlave.trigBusy) {                   // A sample from before it
+      i2cSlave.data[i2cSlave.txBuf][I2C_REG_STATUS] |= I2C_STATUS_BUSY;
+    }
+#endif
+  }
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief The START follows a STOP: new transaction, new PEC. A repeated
+///        START keeps it.
+///
+//////////////////////////////////////////////////////////////////////////////
+static inline void i2cSmNewPec(void) {
+#ifdef WITH_PEC
+  i2cSlave.pec = 0;
+#endif
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief A transfer begins (address byte): new FIFO PEC block
+///
+//////////////////////////////////////////////////////////////////////////////
+static inline void i2cSmBegin(void) {
+#ifdef WITH_PEC
+  i2cSlave.pecCount = 0;
+#endif
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Address byte for this node?
+///
+/// @param val        Address byte incl. R/W
+//////////////////////////////////////////////////////////////////////////////
+static inline uint8_t i2cSmMatch(uint8_t val) {
+  return (val & 0xFE) == i2cSlaveAddr;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Own address byte ACKed: it is part of the PEC
+///
+//////////////////////////////////////////////////////////////////////////////
+static inline void i2cSmAddressed(uint8_t val) {
+#ifdef WITH_PEC
+  i2cSlave.pec = pecUpdate(i2cSlave.pec, val);
+#else
+  (void)val;
+#endif
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Master read: a byte staged before the address byte was known
+///        may be the PEC, which has to include the address byte.
+///
+//////////////////////////////////////////////////////////////////////////////
+static inline void i2cSmReadStart(void) {
+#ifdef WITH_PEC
+  if (i2cSlave.regPtr == I2C_REG_PEC) {
+    i2cSlave.txNext = i2cSlave.pec;
+  }
+#endif
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Master write: the 1st byte is the register pointer
+///
+//////////////////////////////////////////////////////////////////////////////
+static inline void i2cSmWriteStart(void) {
+  i2cSlave.rxFirst = 1;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Byte received (and ACKed): register pointer or register write
+///        with auto-increment
+///
+//////////////////////////////////////////////////////////////////////////////
+static inline void i2cSmRxByte(uint8_t val) {
+#ifdef WITH_PEC
+  i2cSlave.pec = pecUpdate(i2cSlave.pec, val);
+#endif
+  if (i2cSlave.rxFirst) {
+    i2cSlave.regPtr = val;                // Set register pointer
+    i2cSlave.rxFirst = 0;
+  } else {
+    writeReg(i2cSlave.regPtr++, val);     // Write register, auto-increment
+  }
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Fetch the byte for the register pointer into txNext without
+///        side effects
+///
+//////////////////////////////////////////////////////////////////////////////
+static inline void i2cSmTxStage(void) {
+  uint8_t reg = i2cSlave.regPtr;
+
+  i2cSlave.txTake = 0;
+#ifdef WITH_PEC
+  if (reg == I2C_REG_PEC || (reg == I2C_REG_FIFO && i2cSlave.pecCount == I2C_PEC_BLOCK)) {
+    i2cSlave.txNext = i2cSlave.pec;
+    return;
+  }
+#endif
+  if (reg < I2C_CTRL_BASE) {
+    i2cSlave.txNext = i2cSlave.data[i2cSlave.txBuf][reg];   // Data registers (snapshot)
+  } else if (reg < I2C_NUM_REGS) {
+    i2cSlave.txNext = i2cCtrl[reg - I2C_CTRL_BASE];
+#ifdef WITH_HISTORY
+  } else if (reg == I2C_REG_FIFO) {       // Peek only: a NACK may follow
+    i2cSlave.txTake = histLevel() != 0;
+    i2cSlave.txNext = i2cSlave.txTake ? histPeek() : HIST_PAD;
+#endif
+#ifdef WITH_STATS
+  } else if (I2C_IS_STATS(reg)) {
+    i2cSlave.txNext = statsPeek(reg - I2C_REG_STATS);   // Latched in i2cSmTxSent()
+#endif
+#ifdef WITH_SCAN
+  } else if (I2C_IS_SCAN(reg)) {
+    i2cSlave.txNext = i2cSlave.data[i2cSlave.txBuf][I2C_SCAN_DATA(reg)];    // Channel block (snapshot)
+#endif
+#ifdef WITH_CAL
+  } else if (I2C_IS_UNITS(reg)) {
+    i2cSlave.txNext = i2cSlave.data[i2cSlave.txBuf][I2C_UNITS_DATA(reg)];   // Value block (snapshot)
+  } else if (I2C_IS_CAL(reg)) {
+    i2cSlave.txNext = calRegs[reg - I2C_REG_CAL];
+#endif
+#ifdef WITH_PROFILES
+  } else if (reg == I2C_REG_PROFILE) {
+    i2cSlave.txNext = acqProfileReg;
+#endif
+#ifdef WITH_AGG
+  } else if (I2C_IS_AGG(reg)) {
+    i2cSlave.txNext = i2cSlave.data[i2cSlave.txBuf][I2C_AGG_DATA(reg)];     // Statistics block (snapshot)
+  } else if (reg == I2C_REG_AGG_WINDOW) {
+    i2cSlave.txNext = aggWindowReg;
+#endif
+  } else {
+    i2cSlave.txNext = 0xFF;
+  }
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief txNext goes out: take it out of the FIFO, update the PEC and
+///        move the register pointer on
+///
+//////////////////////////////////////////////////////////////////////////////
+static inline void i2cSmTxSent(void) {
+#ifdef WITH_HISTORY
+  if (i2cSlave.txTake) {
+    histDrop();
+  }
+#endif
+#ifdef WITH_STATS
+  if (I2C_IS_STATS(i2cSlave.regPtr)) {
+    statsTake(i2cSlave.regPtr - I2C_REG_STATS);   // Even offset latches the low byte
+  }
+#endif
+#ifdef WITH_DRDY
+  if (i2cSlave.regPtr == I2C_REG_STATUS) {  // The master has this sample
+    i2cSlave.data[i2cSlave.txBuf][I2C_REG_STATUS] &= ~I2C_STATUS_NEW;
+  }
+#endif
+#ifdef WITH_PEC
+  i2cSlave.pec = pecUpdate(i2cSlave.pec, i2cSlave.txNext);
+  if (i2cSlave.regPtr == I2C_REG_FIFO) {
+    i2cSlave.pecCount = (i2cSlave.pecCount == I2C_PEC_BLOCK) ? 0 : i2cSlave.pecCount + 1;
+  } else if (I2C_REG_LAST(i2cSlave.regPtr)) {   // After the map: PEC
+    i2cSlave.regPtr = I2C_REG_PEC;
+  } else if (i2cSlave.regPtr != I2C_REG_PEC) {
+    i2cSlave.regPtr++;
+  }
+#else
+  if (i2cSlave.regPtr != I2C_REG_FIFO) {    // The stream register stays
+    i2cSlave.regPtr++;
+  }
+#endif
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Fetch and send in one step (backends that load the byte straight
+///        into the shift register): the byte for the register pointer,
+///        consumed. Must be followed by i2cSmTxDone().
+///
+//////////////////////////////////////////////////////////////////////////////
+static inline uint8_t i2cSmTxFetch(void) {
+#ifdef WITH_PEC
+  if (i2cSlave.regPtr == I2C_REG_PEC ||
+      (i2cSlave.regPtr == I2C_REG_FIFO && i2cSlave.pecCount++ == I2C_PEC_BLOCK)) {
+    i2cSlave.pecCount = 0;                // End of the map or a FIFO block
+    return i2cSlave.pec;
+  }
+#endif
+  return readReg(i2cSlave.regPtr);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief The byte of i2cSmTxFetch() is being sent: PEC and register
+///        pointer
+///
+//////////////////////////////////////////////////////////////////////////////
+static inline void i2cSmTxDone(uint8_t val) {
+#ifdef WITH_PEC
+  i2cSlave.pec = pecUpdate(i2cSlave.pec, val);  // (while the byte is shifted out)
+#else
+  (void)val;
+#endif
+#ifdef WITH_DRDY
+  if (i2cSlave.regPtr == I2C_REG_STATUS) {  // The master has this sample
+    i2cSlave.data[i2cSlave.txBuf][I2C_REG_STATUS] &= ~I2C_STATUS_NEW;
+  }
+#endif
+#ifdef WITH_PEC
+  if (I2C_REG_LAST(i2cSlave.regPtr)) {      // After the map: PEC
+    i2cSlave.regPtr = I2C_REG_PEC;
+  } else if (i2cSlave.regPtr != I2C_REG_FIFO && i2cSlave.regPtr != I2C_REG_PEC) {
+    i2cSlave.regPtr++;                      // FIFO and PEC stay
+  }
+#else
+  if (i2cSlave.regPtr != I2C_REG_FIFO) {    // The stream register stays
+    i2cSlave.regPtr++;
+  }
+#endif
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Read done (NACK, or STOP / START after a read): the pointer falls
+///        back to I2C_REG_VALUE
+///
+//////////////////////////////////////////////////////////////////////////////
+static inline void i2cSmTxEnd(void) {
+  i2cSlave.regPtr = I2C_REG_VALUE;
+}
+
+#ifdef __cplusplus
+}
+#endif //__cplusplus
+
+#endif
@@ -0,0 +1,147 @@
+//////////////////////////////////////////////////////////////////////////////
+/// @brief I2C slave backend for the USCI_B0 (MSP430G2xx3): byte level. The
+///        module matches the own address, sends the ACKs and holds SCL low
+///        until a byte is taken or loaded, so there are two interrupts per
+///        byte at most instead of four. The protocol is the one of
+///        i2c-slave-sm.h.
+///
+///        USCIAB0RX_VECTOR (state): START incl. repeated START with the own
+///        address (UCSTTIFG) and STOP (UCSTPIFG).
+///        USCIAB0TX_VECTOR (data): byte received (UCB0RXIFG), TX buffer
+///        free (UCB0TXIFG).
+///
+///        The module moves the TX buffer into the shift register as soon as
+///        the previous byte is ACKed, so the ISR keeps one byte loaded
+///        ahead: UCB0TXIFG means the loaded byte goes out now
+///        (i2cSmTxSent), and the next one is staged and loaded. The byte
+///        loaded when the master NACKs is never sent; it was only peeked
+///        (i2cSmTxStage). There is no NACK interrupt for a slave, the read
+///        ends with the STOP or repeated START.
+///
+///        Not counted (WITH_STATS): nacks (the module does not interrupt
+///        for other addresses) and aborts.
+///
+///  CONTROL REGISTERS
+///
+///  UCB0CTL0 = UCMODE_3 | UCSYNC     ->  I2C mode, slave (UCMST = 0), 7 bit own address
+///  UCB0CTL1 = UCSWRST during setup  ->  clock not used by a slave
+///  UCB0I2COA                        ->  own 7 bit address, no general call
+///  UCB0I2CIE = UCSTPIE | UCSTTIE    ->  START and STOP interrupts
+///  IE2 |= UCB0RXIE | UCB0TXIE       ->  data interrupts
+///  P1SEL, P1SEL2 BIT6 | BIT7        ->  P1.6 = UCB0SCL, P1.7 = UCB0SDA
+///
+//////////////////////////////////////////////////////////////////////////////
+
+#include <msp430.h>
+#include "i2c-slave-sm.h"
+
+#if I2C_BACKEND == I2C_BACKEND_USCI || defined(I2C_ALL_BACKENDS)
+
+static uint8_t usciTx = 0;                  // Master read in progress
+static uint8_t usciLoaded = 0;              // txNext is in UCB0TXBUF
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief End of a master read: the pointer falls back to I2C_REG_VALUE
+///
+//////////////////////////////////////////////////////////////////////////////
+static inline void usciReadEnd(void) {
+  if (usciTx) {
+    i2cSmTxEnd();
+    usciTx = 0;
+  }
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief State interrupt: STOP and (repeated) START with the own address.
+///        A STOP and the next START may both be pending: the STOP first.
+///
+//////////////////////////////////////////////////////////////////////////////
+#pragma vector = USCIAB0RX_VECTOR
+__interrupt void USCIAB0RX_ISR (void)
+{
+  static uint8_t usciStop = 1;              // The last transaction ended with a STOP
+  uint8_t addrByte;
+
+  if (UCB0STAT & UCSTPIFG) {                // STOP
+    UCB0STAT &= ~UCSTPIFG;
+    STATS_STATE(I2C_IDLE);
+    usciReadEnd();
+    usciStop = 1;
+  }
+  if (UCB0STAT & UCSTTIFG) {                // START + own address, ACKed
+    UCB0STAT &= ~UCSTTIFG;
+    STATS_STATE(I2C_ADDRESS);
+    usciReadEnd();                          // Repeated START after a read
+    i2cSmStart();                           // Between transactions: publish the new sample
+    if (usciStop) {                         // START after STOP: new PEC,
+      i2cSmNewPec();                        // a repeated START keeps it
+      usciStop = 0;
+    }
+    i2cSmBegin();
+    addrByte = i2cSlaveAddr | ((UCB0CTL1 & UCTR) ? 0x01 : 0x00);
+    i2cSmAddressed(addrByte);
+    usciLoaded = 0;
+    if (addrByte & 0x01) {                  // Master read: 1st byte for UCB0TXIFG
+      usciTx = 1;
+      i2cSmTxStage();
+    } else {
+      i2cSmWriteStart();
+    }
+  }
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Data interrupt: take the received byte, or load the next one
+///        to send. SCL is held low until then.
+///
+//////////////////////////////////////////////////////////////////////////////
+#pragma vector = USCIAB0TX_VECTOR
+__interrupt void USCIAB0TX_ISR (void)
+{
+  if (IFG2 & UCB0RXIFG) {                   // Byte received (reading clears the flag)
+    STATS_STATE(I2C_RX_CHECK);
+    i2cSmRxByte(UCB0RXBUF);                 // Register pointer or register write
+  }
+  if (IFG2 & UCB0TXIFG) {                   // TX buffer free
+    STATS_STATE(I2C_TX_DATA);
+    if (usciLoaded) {                       // The loaded byte is in the shift register
+      i2cSmTxSent();
+      i2cSmTxStage();                       // Peek the next one
+    }
+    usciLoaded = 1;
+    UCB0TXBUF = i2cSlave.txNext;            // Clears UCB0TXIFG
+  }
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Port and USCI_B0 init, slave with the own address
+///
+//////////////////////////////////////////////////////////////////////////////
+void usciSetup(void) {
+  UCB0CTL1 |= UCSWRST;                      // Do config -> Disable USCI
+  UCB0CTL0 = UCMODE_3 | UCSYNC;             // I2C slave
+  UCB0I2COA = i2cSlaveAddr >> 1;            // Own address
+  P1SEL |= BIT6 | BIT7;                     // P1.6 = SCL, P1.7 = SDA
+  P1SEL2 |= BIT6 | BIT7;
+  UCB0CTL1 &= ~UCSWRST;                     // Config ready -> Enable USCI
+  UCB0I2CIE = UCSTPIE | UCSTTIE;            // START and STOP interrupts
+  IE2 |= UCB0RXIE | UCB0TXIE;               // Data interrupts
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief New own address. UCB0I2COA may only change in reset: a
+///        transfer running at this moment is cut off.
+///
+/// @param addr       7 bit address
+//////////////////////////////////////////////////////////////////////////////
+void usciSetAddress(uint8_t addr) {
+  UCB0CTL1 |= UCSWRST;
+  UCB0I2COA = addr;
+  UCB0CTL1 &= ~UCSWRST;                     // Reset cleared the interrupt enables
+  UCB0I2CIE = UCSTPIE | UCSTTIE;
+  IE2 |= UCB0RXIE | UCB0TXIE;
+  usciReadEnd();
+  usciLoaded = 0;
+}
+
+#endif
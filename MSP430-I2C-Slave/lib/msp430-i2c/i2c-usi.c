@@ -0,0 +1,412 @@
+//////////////////////////////////////////////////////////////////////////////
+/// @brief I2C slave backend for the USI (MSP430F20x2/3): bit level, the
+///        ISR sends the (N)ACK bits and matches the address itself. The
+///        protocol is the one of i2c-slave-sm.h.
+///
+///  CONTROL REGISTERS
+///
+///  USICTL0 -> Control Register 0
+///  --------------------------------------------------------
+///    7   |  6   |  5   |  4   |   3  | 2   |  1  |    0   | 
+///  --------------------------------------------------------
+///  USIPE7|USIPE6|USIPE5|USILSB|USIMST|USIGE|USIOE|USISWRST|
+///  USIPE7    (USI SDI/SDA port enable) = 1  ->  USI function enabled
+///  USIPE6    (USI SDO/SCL port enable) = 1  ->  USI function enabled
+///  USIPE5    (USI SCLK port enable)    = 0  ->  SCLK disable
+///  USILSB    (LSB first)               = 0  ->  MSB first
+///  USIMST    (Master)                  = 0  ->  Slave mode
+///  USIGE     (Output latch control)    = 0  ->  Output latch enable depends on shift clock
+///  USIOE     (Serial data output enable)     = 0b  ->  Output enabled
+///  USISWRST  (USI software reset)      = 1  ->  Software reset
+///
+///  USICTL1 -> Control Register 1
+///  --------------------------------------------------------------
+///  |   7    |  6   |   5    |  4  | 3   |  2   |    1    |  0   |
+///  |------------------------------------------------------------|
+///  |USICKPH |USII2C|USISTTIE|USIIE|USIAL|USISTP|USISTTIFG|USIIFG|
+///  |------------------------------------------------------------|
+///  USICKPH   (Clock phase select)               = 0  ->  Data is changed on the first SCLK edge and captured on the following edge.
+///  USII2C    (I2C mode enable)                  = 1  ->  I2C mode enabled
+///  USISTTIE  (START condition interrupt-enable) = 1  ->  Interrupt on START condition enabled
+///  USIIE     (USI counter interrupt enable)     = 1  ->  Interrupt enabled
+///  USIAL     (Arbitration lost)                 = 0  ->  Not used
+///  USISTP    (STOP condition received)          = 0  ->  Not used
+///  USISTTIFG (START condition interrupt flag)   = 0  ->  Not used
+///  USIIFG    (USI counter interrupt flag)       = 0  ->  No interrupt pending
+///                
+///  USICKCTL, USI Clock Control Register
+///  -------------------------------------
+///  |   7-5  |   4-2   |   1   |   0    |
+///  ------------------------------------
+///  |USIDIVx |USISSELx |USICKPL|USISWCLK|
+///  -------------------------------------
+///  USIDIVx (Clock divider)   = 000 -> Divide by 1
+///  USISSELx (Clock source)   = 000 -> SCLK 
+///  USICKPL (Clock polarity)  = 1   -> Inactive state is high
+///  USISWCLK (Software clock) = 0 (not used)
+///               
+///  USICNT, USI Bit Counter Register
+///  --------------------------------------
+///  |     7   |   6   |     5    |  4-0  |
+///  ------------------------------------
+///  |USISCLREL| USI16B |USIIFGCC |USICNTx|
+///  --------------------------------------
+///  USISCLREL (SCL release)                     = 0 -> SCL line is held low if USIIFG is set
+///  USI16B (16-bit shift register enable)       = 0 -> 8-bit shift register mode
+///  USIIFGCC (USI interrupt flag clear control) = 1 -> USIIFG is not cleared automatically
+///  USICNTx (USI bit count)                     = 00000 (not relevant at this moment)
+///
+//////////////////////////////////////////////////////////////////////////////
+
+#include <msp430.h>
+#include "i2c-slave-sm.h"
+
+#if I2C_BACKEND == I2C_BACKEND_USI
+
+#ifdef I2C_FAST_MODE
+static uint8_t i2cState = I2C_IDLE;
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Interrupt function for processing the I2C protocol, fast mode
+///        (400 kHz). Same protocol as the standard ISR below, but:
+///        - every state first sets up the next bit transfer and clears
+///          USIIFG, which releases SCL; the remaining work runs while
+///          the bits are on the bus
+///        - the next TX byte is staged (i2cSmTxStage) while the current
+///          one is shifted out, the 1st one while the address comes in (it
+///          is simply not used for a write). The (N)ACK bit alone is too
+///          short for it at 400 kHz (40 cycles at 16 MHz); after the ACK
+///          only the shift register is loaded
+///        - dense jump table over the even state values (__even_in_range)
+///        - no read-modify-write of USICNT (USIIFGCC is the only bit set
+///          in the upper bits), no LED
+///        Per-state cycle counts: see the table at the end of this file.
+///
+//////////////////////////////////////////////////////////////////////////////
+#pragma vector = USI_VECTOR
+__interrupt void USI_TXRX (void)
+{
+  uint8_t val;
+
+  if (USICTL1 & USISTTIFG)  {             // Start entry?
+    i2cSmStart();                         // Between transactions: publish the new sample
+#ifdef WITH_STATS
+    if (i2cState != I2C_IDLE && i2cState != I2C_RX_CHECK && i2cState != I2C_PREP_START) {
+      STATS_INC(aborts);                  // START in the middle of a transfer
+    }
+#endif
+#ifdef WITH_PEC
+    if (USICTL1 & USISTP) {               // START after STOP: new PEC,
+      USICTL1 &= ~USISTP;                 // a repeated START keeps it
+      i2cSmNewPec();
+    }
+#endif
+    i2cState = I2C_ADDRESS;               // Enter 1st state on start
+  }
+
+  I2C_STATE_TRACE(i2cState);
+  STATS_STATE(i2cState);
+  switch (__even_in_range(i2cState, I2C_PREP_START)) {
+    case I2C_IDLE:             // Idle, wait for next start
+      USICTL1 &= ~USIIFG;
+      break;
+
+    case I2C_ADDRESS:          // RX Address
+      USICNT = USIIFGCC | 0x08;           // Bit counter = 8, RX address
+      USICTL1 &= ~(USISTTIFG | USIIFG);   // Clear start flag, release SCL
+      i2cSmBegin();
+      i2cSmTxStage();                     // 1st byte, in case of a read
+      i2cState = I2C_PROCESS_ADDRESS;
+      break;
+
+    case I2C_PROCESS_ADDRESS:  // Process Address and send (N)Ack
+      val = USISRL;
+      USICTL0 |= USIOE;                   // SDA = output
+      if (i2cSmMatch(val)) {
+        USISRL = 0x00;                    // Send Ack
+        USICNT = USIIFGCC | 0x01;
+        USICTL1 &= ~USIIFG;               // SCL released: ACK bit runs
+        i2cSmAddressed(val);
+        if (val & 0x01) {                 // Master read
+          i2cSmReadStart();               // Staged before the address byte
+          i2cState = I2C_TX_DATA;
+        } else {                          // Master write
+          I2C_STATE_TRACE(I2C_PROCESS_ADDRESS | 1);
+          i2cSmWriteStart();              // 1st byte is the register pointer
+          i2cState = I2C_RX_DATA;
+        }
+      } else {
+        I2C_STATE_TRACE(I2C_PROCESS_ADDRESS | 1);
+        STATS_INC(nacks);
+        USISRL = 0xFF;                    // Send NAck
+        USICNT = USIIFGCC | 0x01;
+        USICTL1 &= ~USIIFG;
+        i2cState = I2C_PREP_START;
+      }
+      break;
+
+    case I2C_RX_DATA:          // Receive data byte
+      USICTL0 &= ~USIOE;                  // SDA = input
+      USICNT = USIIFGCC | 0x08;           // Bit counter = 8, RX data
+      USICTL1 &= ~USIIFG;
+      i2cState = I2C_RX_CHECK;
+      break;
+
+    case I2C_RX_CHECK:         // Send Ack, then process the data byte
+      val = USISRL;
+      USICTL0 |= USIOE;                   // SDA = output
+      USISRL = 0x00;                      // Send Ack
+      USICNT = USIIFGCC | 0x01;
+      USICTL1 &= ~USIIFG;                 // SCL released: ACK bit runs
+      i2cSmRxByte(val);                   // Register pointer or register write
+      i2cState = I2C_RX_DATA;
+      break;
+
+    case I2C_PREP_START:       // Address NAck sent -> Prep next start
+      USICTL0 &= ~USIOE;                  // SDA = input
+      USICTL1 &= ~USIIFG;
+      i2cState = I2C_IDLE;
+      break;
+
+    case I2C_TX_DATA:          // Address ACK sent: send the staged byte
+      USISRL = i2cSlave.txNext;
+      USICNT = USIIFGCC | 0x08;           // Bit counter = 8, TX data
+      USICTL1 &= ~USIIFG;
+      i2cSmTxSent();
+      i2cSmTxStage();                     // Next byte while this one is sent
+      i2cState = I2C_ACK_NACK;
+      break;
+
+    case I2C_ACK_NACK:         // Receive Data (N)Ack
+      USICTL0 &= ~USIOE;                  // SDA = input
+      USICNT = USIIFGCC | 0x01;           // Bit counter = 1, receive (N)Ack
+      USICTL1 &= ~USIIFG;
+      i2cState = I2C_TX_CHECK;
+      break;
+
+    case I2C_TX_CHECK:         // Process Data Ack/NAck
+      if (USISRL & 0x01) {                // Nack: read done
+        I2C_STATE_TRACE(I2C_TX_CHECK | 1);
+        USICTL1 &= ~USIIFG;
+        i2cSmTxEnd();                     // Pointer back to 0
+        i2cState = I2C_IDLE;
+      } else {                            // Ack: send the staged byte
+        USICTL0 |= USIOE;                 // SDA = output
+        USISRL = i2cSlave.txNext;
+        USICNT = USIIFGCC | 0x08;
+        USICTL1 &= ~USIIFG;
+        i2cSmTxSent();
+        i2cSmTxStage();
+        i2cState = I2C_ACK_NACK;
+      }
+      break;
+  }
+}
+#else
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Transfer of a data byte: the one at the register pointer, which
+///        moves on.
+///
+/// @return uint8_t   next I2C state
+//////////////////////////////////////////////////////////////////////////////
+static uint8_t txData(void) {
+  uint8_t val;
+
+  USICTL0 |= USIOE;                       // SDA = output
+  val = i2cSmTxFetch();
+  USISRL = val;
+  USICNT |=  0x08;                        // Bit counter = 8, TX data
+  i2cSmTxDone(val);
+  return I2C_ACK_NACK;                    // next state: receive (N)Ack
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Reset I2C to Idle and wait for the next start
+///
+/// @return uint8_t next I2C state
+//////////////////////////////////////////////////////////////////////////////
+static uint8_t prepStart(void) {
+  USICTL0 &= ~USIOE;                      // SDA = input
+  return I2C_IDLE;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Interrupt function for processing the I2C protocol.
+///        Master write: 1st byte = register pointer, further bytes are
+///        written to the control registers (pointer auto-increment).
+///        Master read: registers from the pointer on (auto-increment).
+///        After a read the pointer falls back to 0 (I2C_REG_VALUE).
+///
+//////////////////////////////////////////////////////////////////////////////
+#pragma vector = USI_VECTOR
+__interrupt void USI_TXRX (void)
+{
+  static uint8_t i2cState;
+  if (USICTL1 & USISTTIFG)  {             // Start entry?
+#ifdef WITH_LED
+    P1OUT |= 0x01;                        // LED on: sequence start
+#endif
+    i2cSmStart();                         // Between transactions: publish the new sample
+#ifdef WITH_STATS
+    if (i2cState != I2C_IDLE && i2cState != I2C_RX_CHECK && i2cState != I2C_PREP_START) {
+      STATS_INC(aborts);                  // START in the middle of a transfer
+    }
+#endif
+#ifdef WITH_PEC
+    if (USICTL1 & USISTP) {               // START after STOP: new PEC,
+      USICTL1 &= ~USISTP;                 // a repeated START keeps it
+      i2cSmNewPec();
+    }
+#endif
+    i2cState = I2C_ADDRESS;               // Enter 1st state on start
+  }
+
+  I2C_STATE_TRACE(i2cState);
+  STATS_STATE(i2cState);
+  switch(i2cState)  {
+    case I2C_IDLE:             // Idle, wait for next start
+      break;
+
+    case I2C_ADDRESS:          // RX Address
+      USICNT = (USICNT & 0xE0) + 0x08;    // Bit counter = 8, RX address
+      USICTL1 &= ~USISTTIFG;              // Clear start flag
+      i2cState = I2C_PROCESS_ADDRESS;     // Check address
+      break;
+
+    case I2C_PROCESS_ADDRESS:  // Process Address and send (N)Ack
+      USICTL0 |= USIOE;                   // SDA = output
+      if (i2cSmMatch(USISRL)) {           // Oh. Somebody wants something from me.
+        i2cSmAddressed(USISRL);
+        i2cSmBegin();
+        if (USISRL & 0x01) {              // Master read
+          i2cState = I2C_TX_DATA;         // send data
+        } else {                          // Master write
+          i2cSmWriteStart();              // 1st byte is the register pointer
+          i2cState = I2C_RX_DATA;         // receive data
+        }
+        USISRL = 0x00;                    // Send Ack
+#ifdef WITH_LED
+        P1OUT &= ~0x01;                   // LED off
+#endif
+      } else {
+        USISRL = 0xFF;                    // No. That's none of my business. Send NAck
+        STATS_INC(nacks);
+#ifdef WITH_LED
+        P1OUT |= 0x01;                    // LED on
+#endif
+        i2cState = I2C_PREP_START;        // prep for next Start
+      }
+      USICNT |= 0x01;                     // Bit counter = 1, send (N)Ack bit
+      break;
+
+    case I2C_RX_DATA:          // Receive data byte
+      USICTL0 &= ~USIOE;                  // SDA = input
+      USICNT |= 0x08;                     // Bit counter = 8, RX data
+      i2cState = I2C_RX_CHECK;            // Check data and send Ack
+      break;
+
+    case I2C_RX_CHECK:         // Process data byte and send Ack
+      i2cSmRxByte(USISRL);                // Register pointer or register write
+      USICTL0 |= USIOE;                   // SDA = output
+      USISRL = 0x00;                      // Send Ack
+      USICNT |= 0x01;                     // Bit counter = 1, send Ack bit
+      i2cState = I2C_RX_DATA;             // Next byte (or STOP/START)
+      break;
+
+    case I2C_PREP_START:       // Address NAck sent -> Prep next start
+      i2cState = prepStart();
+      break;
+
+    case I2C_TX_DATA:          // Send first data byte
+      i2cState = txData();
+      break;
+
+    // This status checks the (N)ACK status between each data byte.
+    case I2C_ACK_NACK:         // Receive Data (N)Ack
+      USICTL0 &= ~USIOE;                  // SDA = input
+      USICNT |= 0x01;                     // Bit counter = 1, receive (N)Ack
+      i2cState = I2C_TX_CHECK;            // Check (N)Ack
+      break;
+
+    case I2C_TX_CHECK:         // Process Data Ack/NAck
+      if (USISRL & 0x01) {                // If Nack received...
+        I2C_STATE_TRACE(I2C_TX_CHECK | 1);
+        i2cState = prepStart();
+        i2cSmTxEnd();                     // Read done: pointer back to 0
+      } else {                            // ... else Ack received
+        i2cState = txData();              // TX next byte
+#ifdef WITH_LED
+        P1OUT &= ~0x01;                   // LED off
+#endif
+      }
+      break;
+  }
+  USICTL1 &= ~USIIFG;                     // Clear pending flags
+}
+#endif
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Initialize the USI as I2C slave (P1.6 SCL, P1.7 SDA).
+///
+//////////////////////////////////////////////////////////////////////////////
+void usiSetup(void) {
+  P1OUT = BIT6 | BIT7;                    // P1.6 & P1.7 OUT
+  //P1REN |= BIT6 + BIT7                  // P1.6 & P1.7 Pullups
+
+  USICTL0 |= USISWRST;                    // Do config -> Disable USI
+  USICTL0 = USIPE6+USIPE7+USISWRST;       // Port & USI mode setup
+  USICTL1 = USII2C+USIIE+USISTTIE;        // Enable I2C mode & USI interrupts
+  USICKCTL = USICKPL;                     // Setup clock polarity
+  USICNT |= USIIFGCC;                     // Disable automatic clear control
+  USICTL0 &= ~USISWRST;                   // Config ready -> Enable USI
+  USICTL1 &= ~USIIFG;                     // Clear pending flag
+}
+#endif
+
+//////////////////////////////////////////////////////////////////////////////
+///
+///  USI ISR CYCLES PER STATE
+///
+///  Counted by hand from the MSP430 instruction timings for the code at
+///  -Os (WITH_PEC with PEC_TABLE, WITH_HISTORY, WITH_LED): interrupt
+///  acceptance 6, reti 5, push 3 / pop 2 (R12..R15: the ISR calls into
+///  sample-history), mov.b #n,&abs 4..5, bic.b/bis.b #cg,&abs 4,
+///  mov.b &abs,&abs 6, call 5 + ret 3. Worst branch of every state, so
+///  check the listing after compiler updates. The same numbers drive the
+///  cycle model of the native env (sim/usi-cycles.h, --bench isr).
+///
+///  HOLD:  cycles from the interrupt until USIIFG is cleared (SCL held)
+///  TOTAL: cycles until reti
+///
+///                      STANDARD        FAST
+///  STATE               HOLD  TOTAL     HOLD  TOTAL
+///  START (added)         36     36       32     32
+///  I2C_IDLE              39     54       35     50
+///  I2C_ADDRESS           57     72       41    128   fast: stages the 1st TX byte
+///  I2C_PROCESS_ADDRESS   94    109       59    105   fast write / NACK: 59/96
+///  I2C_RX_DATA           51     66       44     63
+///  I2C_RX_CHECK         110    125       51    115
+///  I2C_TX_DATA          150    165       46    179   fast: sent + next staged
+///  I2C_ACK_NACK          52     67       44     64
+///  I2C_TX_CHECK         160    175       56    189   NACK: 66/81, fast 41/64
+///  I2C_PREP_START        56     71       39     58
+///
+///  Worst case at 16 MHz: ISR 10.9 / 11.8 us, SCL held 10 us (standard) vs.
+///  4.6 us (fast, START + address). At 400 kHz the fast ISR stretches SCL
+///  by at most 4.25 us beyond the low phase of the master, the standard
+///  one by 8.75 us. The ACK bit is 40 cycles at 16 MHz, so the fast ISR
+///  does its long work (i2cSmTxSent, i2cSmTxStage) only while 8 bits are shifted.
+///  At 1 MHz every ISR stretches SCL (100 kHz = 10 cycles per bit); the
+///  fast ISR still holds SCL for less (98 us vs. 165 us worst at 100 kHz).
+///
+///  WITH_SCAN adds one compare (~ 3 cycles, end of the channel block) to
+///  txData/i2cSmTxSent, WITH_CAL two more (~ 6 cycles), WITH_PROFILES one more,
+///  WITH_AGG two more, WITH_DRDY one more (STATUS sent); they are not in
+///  the table.
+///
+///  WITH_STATS adds ~ 5 cycles to HOLD and TOTAL of every state
+///  (STATS_STATE() runs before the switch: add #1 to an indexed word) and
+///  ~ 12 to a START (abort check). Without it the macros are empty.
+///
+//////////////////////////////////////////////////////////////////////////////
@@ -1,222 +1,378 @@
 //////////////////////////////////////////////////////////////////////////////
-/// @brief I2C Slave Transmitter, multiple bytes using the USI
-///        Data can only be sent but not received.
+/// @brief I2C Slave with a register map: protocol, state and the API of
+///        the main program. The bus side is in i2c-slave-sm.h (protocol
+///        state machine) and one backend per peripheral: i2c-usi.c (USI,
+///        MSP430F20x2/3) or i2c-usci.c (USCI_B0, MSP430G2xx3), chosen with
+///        I2C_BACKEND (default: the peripheral of the device).
 ///         
-/// 
-//////////////////////////////////////////////////////////////////////////////
+///  PROTOCOL
+///
+///  Read:   S addr+R [reg reg+1 ...] P        (starts at the register pointer)
+///  Write:  S addr+W ptr [val val ...] P      (sets the pointer, writes regs)
+///  Combined read (one transaction):
+///          S addr+W ptr Sr addr+R [reg reg+1 ...] P
+///
+///  The register pointer auto-increments. After a read it falls back to
+///  I2C_REG_VALUE, so plain reads (without a pointer write) always return
+///  the latest value first, like the former fixed buffer.
+///
+///  The bits of I2C_REG_CONFIG are requests that the main loop clears when
+///  it has taken them over. A write sets bits, it does not clear any: a
+///  request still pending from an earlier write stays, so the master never
+///  reads CONFIG before writing it.
+///
+///  I2C_REG_FIFO is a stream register behind the map: the pointer does not
+///  increment there, every byte read takes the next byte out of the sample
+///  history (lib/sample-history), so the master drains it in one long read.
+///
+///  PEC (WITH_PEC, lib/smbus-pec)
+///
+///  Reads carry an SMBus Packet Error Code: a CRC-8 over all bytes of the
+///  transaction, address bytes included:
+///          S addr+W ptr Sr addr+R [reg ... I2C_REG_ADDR] PEC P
+///          S addr+W I2C_REG_FIFO Sr addr+R [8 bytes] PEC [8 bytes] PEC ... P
+///  The auto-increment goes from I2C_REG_ADDR to the virtual register
+///  I2C_REG_PEC, so a read up to the end of the map ends with the PEC.
+///  The FIFO stream has a PEC after every I2C_PEC_BLOCK bytes. The CRC
+///  runs on over the PEC bytes; as the CRC of a message and its PEC is 0,
+///  every PEC covers the bytes since the previous one.
+///  A START after a STOP (USISTP) starts a new CRC, a repeated START keeps
+///  it. Writes are not checked.
+///
+///  STATISTICS (WITH_STATS, lib/slave-stats)
+///
+///  I2C_REG_STATS is a read-only window of STATS_SIZE bytes with the
+///  hot-path counters (ISR runs per state, NACKed addresses, aborted
+///  transfers, conversions, worst publish latency). Reads start at an even
+///  offset; after the last byte the pointer goes to I2C_REG_PEC, like after
+///  I2C_REG_ADDR. Writing any byte to I2C_REG_STATS clears the counters:
+///          S addr+W I2C_REG_STATS 0x00 P
+///
+///  CHANNEL BLOCK (WITH_SCAN, lib/sd16-acq)
+///
+///  I2C_REG_SCAN is a read-only block of SCAN_SIZE bytes: the sample
+///  counter and the filtered value of every scanned channel (16 bit,
+///  big endian). It is part of the snapshot, so one read returns all
+///  channels of the same scan:
+///          S addr+W I2C_REG_SCAN Sr addr+R [COUNT CH0 CH1 ...] PEC P
+///  After the last byte the pointer goes to I2C_REG_PEC.
+///
+///  CALIBRATION (WITH_CAL, lib/calibration)
+///
+///  I2C_REG_UNITS is a read-only block like the channel block, with the
+///  calibrated value of every channel (int16, e.g. 0.1 mV) instead of the
+///  raw one. I2C_REG_CAL is a read/write window of CAL_SIZE bytes: offset
+///  and gain of every channel (16 bit each). Written coefficients become
+///  active with the request I2C_CFG_SAVE_CAL, which also stores them in
+///  info flash:
+///          S addr+W I2C_REG_CAL+4*ch off off gain gain P
+///          S addr+W I2C_REG_CONFIG I2C_CFG_SAVE_CAL P
+///  Both end with I2C_REG_PEC on reads.
+///
+///  ACQUISITION PROFILE (WITH_PROFILES, lib/sd16-acq)
+///
+///  I2C_REG_PROFILE is a single read/write register behind the PEC: the
+///  master writes the wanted profile (ACQ_PROFILE_x), the main loop
+///  switches with its next sample and writes back the active one (an
+///  invalid value is replaced by it). Reads end with I2C_REG_PEC:
+///          S addr+W I2C_REG_PROFILE profile P
+///          S addr+W I2C_REG_PROFILE Sr addr+R profile PEC P
+///
+///  WINDOW STATISTICS (WITH_AGG, lib/running-stats)
+///
+///  I2C_REG_AGG is a read-only block of AGG_SIZE bytes, part of the
+///  snapshot: sample counter of the last sample, samples, min, max, mean
+///  and variance of the last closed window of VALUE (big endian):
+///          S addr+W I2C_REG_AGG Sr addr+R [COUNT N MIN MAX MEAN(4) VAR(6)] PEC P
+///  I2C_REG_AGG_WINDOW is a single read/write register: a window ends
+///  after 2^k samples, with k = 0 only on the request I2C_CFG_CLOSE_AGG,
+///  which also ends a window early. Both end with I2C_REG_PEC on reads.
+///
+///  DATA READY (WITH_DRDY)
+///
+///  commitTxData() pulls the line DRDY_BIT low for a few cycles after it
+///  has marked the new sample, so the master reads when there is something
+///  to read instead of polling blindly (e.g. on an external interrupt).
+///  The pin is driven low or released only (open drain, pull-up at the
+///  master): the lines of several nodes can be wired together. The
+///  committed snapshot carries I2C_STATUS_NEW in STATUS; the ISR clears it
+///  in the snapshot when STATUS is sent, so a master on a shared line
+///  sees which nodes have published since its last read, and a read with
+///  the flag cleared is stale.
+///
+///  TRIGGER (WITH_TRIGGER, lib/sd16-acq)
+///
+///  Writing I2C_CFG_TRIGGER to CONFIG starts a burst of TRIG_BURST
+///  conversions at once, from the ISR that receives the byte:
+///          S addr+W I2C_REG_CONFIG I2C_CFG_TRIGGER P
+///  The bit clears itself. Until the mean of the burst is published, STATUS
+///  reads I2C_STATUS_BUSY; the sample with the mean carries
+///  I2C_STATUS_TRIGGERED instead. Only the ISR sets BUSY, and only in the
+///  published buffer: at once when it accepts the trigger and with every
+///  swap until the snapshot with TRIGGERED comes in (i2cSlave.trigBusy).
+///  The main loop writes STATUS of the back buffer without it, so nothing
+///  has to be masked. It may set TRIGGERED only in the snapshot of a burst
+///  mean, i.e. while the next trigger is refused. So the master polls the
+///  map until BUSY is gone (or waits for the data-ready line) and has a
+///  value that was converted after its request. SCL is not held while the
+///  burst runs: it would block the bus for all nodes for ~ 2 ms. A trigger
+///  while BUSY is ignored.
 ///
-///  CONTROL REGISTERS
-///
-///  USICTL0 -> Control Register 0
-///  --------------------------------------------------------
-///    7   |  6   |  5   |  4   |   3  | 2   |  1  |    0   | 
-///  --------------------------------------------------------
-///  USIPE7|USIPE6|USIPE5|USILSB|USIMST|USIGE|USIOE|USISWRST|
-///  USIPE7    (USI SDI/SDA port enable) = 1  ->  USI function enabled
-///  USIPE6    (USI SDO/SCL port enable) = 1  ->  USI function enabled
-///  USIPE5    (USI SCLK port enable)    = 0  ->  SCLK disable
-///  USILSB    (LSB first)               = 0  ->  MSB first
-///  USIMST    (Master)                  = 0  ->  Slave mode
-///  USIGE     (Output latch control)    = 0  ->  Output latch enable depends on shift clock
-///  USIOE     (Serial data output enable)     = 0b  ->  Output enabled
-///  USISWRST  (USI software reset)      = 1  ->  Software reset
-///
-///  USICTL1 -> Control Register 1
-///  --------------------------------------------------------------
-///  |   7    |  6   |   5    |  4  | 3   |  2   |    1    |  0   |
-///  |------------------------------------------------------------|
-///  |USICKPH |USII2C|USISTTIE|USIIE|USIAL|USISTP|USISTTIFG|USIIFG|
-///  |------------------------------------------------------------|
-///  USICKPH   (Clock phase select)               = 0  ->  Data is changed on the first SCLK edge and captured on the following edge.
-///  USII2C    (I2C mode enable)                  = 1  ->  I2C mode enabled
-///  USISTTIE  (START condition interrupt-enable) = 1  ->  Interrupt on START condition enabled
-///  USIIE     (USI counter interrupt enable)     = 1  ->  Interrupt enabled
-///  USIAL     (Arbitration lost)                 = 0  ->  Not used
-///  USISTP    (STOP condition received)          = 0  ->  Not used
-///  USISTTIFG (START condition interrupt flag)   = 0  ->  Not used
-///  USIIFG    (USI counter interrupt flag)       = 0  ->  No interrupt pending
-///                
-///  USICKCTL, USI Clock Control Register
-///  -------------------------------------
-///  |   7-5  |   4-2   |   1   |   0    |
-///  ------------------------------------
-///  |USIDIVx |USISSELx |USICKPL|USISWCLK|
-///  -------------------------------------
-///  USIDIVx (Clock divider)   = 000 -> Divide by 1
-///  USISSELx (Clock source)   = 000 -> SCLK 
-///  USICKPL (Clock polarity)  = 1   -> Inactive state is high
-///  USISWCLK (Software clock) = 0 (not used)
-///               
-///  USICNT, USI Bit Counter Register
-///  --------------------------------------
-///  |     7   |   6   |     5    |  4-0  |
-///  ------------------------------------
-///  |USISCLREL| USI16B |USIIFGCC |USICNTx|
-///  --------------------------------------
-///  USISCLREL (SCL release)                     = 0 -> SCL line is held low if USIIFG is set
-///  USI16B (16-bit shift register enable)       = 0 -> 8-bit shift register mode
-///  USIIFGCC (USI interrupt flag clear control) = 1 -> USIIFG is not cleared automatically
-///  USICNTx (USI bit count)                     = 00000 (not relevant at this moment)
+///  PUBLISHING (double buffer)
 ///
+///  i2cSlave.data holds two buffers (data registers, channel block, value
+///  block, statistics block). The ISR sends from data[txBuf], the main
+///  program writes into the other one (beginTxData) and marks it ready
+///  (commitTxData). The ISR swaps the buffers only on a START condition,
+///  i.e. between two transactions, so the master always gets the bytes of
+///  one sample and the writer never has to mask interrupts.
+///  beginTxData() clears swapPending before it picks the back buffer, so the
+///  ISR cannot swap while the back buffer is being written. A commit that
+///  was not swapped in yet stays in the back buffer and is updated in
+///  place; txBuf is read before and after, so a swap between reading and
+///  clearing swapPending is seen and the published buffer is copied.
+/// 
 //////////////////////////////////////////////////////////////////////////////
 
 #include <msp430.h>
 #include "msp430-i2c.h"
+#include "i2c-slave-sm.h"
 
 //////////////////////////////////////////////////////////////////////////////
-/// Module global variables
+/// Global variables
 //////////////////////////////////////////////////////////////////////////////
-//extern uint8_t slvData[NUMBER_OF_BYTES];
-uint8_t slvData[NUMBER_OF_BYTES]; 
-
+I2cSlave i2cSlave;                          // Protocol state (i2c-slave-sm.h)
+uint8_t i2cSlaveAddr = (SLAVE_ADDR << 1);   // Own address, 7 Bit Address is << 1 for R/W
+volatile uint8_t i2cCtrl[I2C_CTRL_SIZE];    // Control registers (read/write)
 
 //////////////////////////////////////////////////////////////////////////////
-/// @brief Interrupt function for processing the I2C protocol. 
-///        Only data is sent, not received.
+/// @brief Initialize this microcontroller as an I2C slave.
 /// 
 //////////////////////////////////////////////////////////////////////////////
-#pragma vector = USI_VECTOR
-__interrupt void USI_TXRX (void)
-{
-  static uint8_t i2cState;     
-  static uint8_t dataIdx = 0;
-  if (USICTL1 & USISTTIFG)  {             // Start entry?
-#ifdef WITH_LED
-    P1OUT |= 0x01;                        // LED on: sequence start
+void i2cSlaveSetup(void){
+#if I2C_BACKEND == I2C_BACKEND_USCI
+  usciSetup();
+#else
+  usiSetup();
 #endif
-    i2cState = I2C_ADDRESS;               // Enter 1st state on start
-  }
-
-  switch(i2cState)  {
-    case I2C_IDLE:             // Idle, wait for next start
-      break;
-
-    case I2C_ADDRESS:          // RX Address
-      USICNT = (USICNT & 0xE0) + 0x08;    // Bit counter = 8, RX address
-      USICTL1 &= ~USISTTIFG;              // Clear start flag
-      i2cState = I2C_PROCESS_ADDRESS;     // Check address
-      break;
-
-    case I2C_PROCESS_ADDRESS:  // Process Address and send (N)Ack
-      if (USISRL & 0x01) {                // If master read...
-        slvAddr++;                        // Save R/W bit
-      }
-      USICTL0 |= USIOE;                   // SDA = output
-      if (USISRL == slvAddr) {            // Oh. Somebody wants something from me.
-        USISRL = 0x00;                    // Send Ack
-#ifdef WITH_LED
-        P1OUT &= ~0x01;                   // LED off
-#endif
-        i2cState = I2C_TX_DATA;           // send data
-      } else {                              
-        USISRL = 0xFF;                    // No. That's none of my business. Send NAck
-#ifdef WITH_LED
-        P1OUT |= 0x01;                    // LED on
-#endif
-        i2cState = I2C_RX_CHECK;          // prep for next Start
-      } 
-      USICNT |= 0x01;                     // Bit counter = 1, send (N)Ack bit
-      break; 
+  I2C_CTRL(I2C_REG_ADDR) = i2cSlaveAddr >> 1;
+#ifdef WITH_DRDY
+  DRDY_OUT &= ~DRDY_BIT;                  // Open drain: low when driven
+  DRDY_SEL &= ~DRDY_BIT;                  // I/O instead of XIN
+  DRDY_DIR &= ~DRDY_BIT;                  // Released
+#endif
+  __enable_interrupt();
+}
 
-    case I2C_RX_CHECK:                    // This slave does not receive anything. -> Prep next start
-      i2cState = prepStart();
-      break;
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Set the own slave address. Takes effect with the next START.
+///        I2C_REG_ADDR reads the new address.
+/// 
+/// @param addr       7 bit address
+//////////////////////////////////////////////////////////////////////////////
+void i2cSetAddress(uint8_t addr) {
+  i2cSlaveAddr = addr << 1;
+  I2C_CTRL(I2C_REG_ADDR) = addr;
+#if I2C_BACKEND == I2C_BACKEND_USCI
+  usciSetAddress(addr);                   // Address match in hardware
+#endif
+}
 
-    case I2C_TX_DATA:          // Send first data byte
-      i2cState = txData(&dataIdx);        // Attention! dataIdx will be incremented!
-      break;
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Get the own slave address.
+/// 
+/// @return uint8_t   7 bit address
+//////////////////////////////////////////////////////////////////////////////
+uint8_t i2cGetAddress(void) {
+  return i2cSlaveAddr >> 1;
+}
 
-    // This status checks the (N)ACK status between each data byte.
-    case I2C_ACK_NACK:         // Receive Data (N)Ack
-      USICTL0 &= ~USIOE;                  // SDA = input
-      USICNT |= 0x01;                     // Bit counter = 1, receive (N)Ack
-      i2cState = I2C_TX_CHECK;            // Check (N)Ack
-      break;
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Read a register of the register map.
+///        Attention: reading I2C_REG_FIFO removes a byte from the history!
+/// 
+/// @param reg        Register address
+/// @return uint8_t   Register value, 0xFF for unmapped addresses
+//////////////////////////////////////////////////////////////////////////////
+uint8_t readReg(uint8_t reg) {
+  if (reg < I2C_CTRL_BASE) {
+    return i2cSlave.data[i2cSlave.txBuf][reg];           // Data registers (snapshot)
+  }
+  if (reg < I2C_NUM_REGS) {
+    return i2cCtrl[reg - I2C_CTRL_BASE];  // Control registers
+  }
+#ifdef WITH_HISTORY
+  if (reg == I2C_REG_FIFO) {
+    return histRead();                    // Stream: consumes the byte
+  }
+#endif
+#ifdef WITH_STATS
+  if (I2C_IS_STATS(reg)) {
+    return statsRead(reg - I2C_REG_STATS);  // Even offset latches the low byte
+  }
+#endif
+#ifdef WITH_SCAN
+  if (I2C_IS_SCAN(reg)) {
+    return i2cSlave.data[i2cSlave.txBuf][I2C_SCAN_DATA(reg)];  // Channel block (snapshot)
+  }
+#endif
+#ifdef WITH_CAL
+  if (I2C_IS_UNITS(reg)) {
+    return i2cSlave.data[i2cSlave.txBuf][I2C_UNITS_DATA(reg)];   // Value block (snapshot)
+  }
+  if (I2C_IS_CAL(reg)) {
+    return calRegs[reg - I2C_REG_CAL];    // Coefficient window
+  }
+#endif
+#ifdef WITH_PROFILES
+  if (reg == I2C_REG_PROFILE) {
+    return acqProfileReg;
+  }
+#endif
+#ifdef WITH_AGG
+  if (I2C_IS_AGG(reg)) {
+    return i2cSlave.data[i2cSlave.txBuf][I2C_AGG_DATA(reg)];   // Statistics block (snapshot)
+  }
+  if (reg == I2C_REG_AGG_WINDOW) {
+    return aggWindowReg;
+  }
+#endif
+  return 0xFF;
+}
 
-    case I2C_TX_CHECK:         // Process Data Ack/NAck
-      if (USISRL & 0x01) {                // If Nack received...
-        i2cState = prepStart();
-        dataIdx=0;                        // Reset data index
-      } else {                            // ... else Ack received
-        if (dataIdx < NUMBER_OF_BYTES) {
-          i2cState = txData(&dataIdx);    // TX next byte. Attention! dataIdx will be incremented!
-        } else {
-          i2cState = prepStart();
-          dataIdx=0;                      // Reset data index
-        }
-#ifdef WITH_LED
-        P1OUT &= ~0x01;                   // LED off
-#endif
-      }
-      break;
-  }
-  USICTL1 &= ~USIIFG;                     // Clear pending flags
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Write a register of the register map. Only the control 
+///        registers, the calibration window, the profile and the
+///        statistics window are writable (and
+///        I2C_REG_STATS, which clears the counters), other writes are
+///        ignored. CONFIG bits are ORed in (pending requests stay);
+///        I2C_CFG_TRIGGER starts a conversion burst.
+/// 
+/// @param reg        Register address
+/// @param val        New value
+//////////////////////////////////////////////////////////////////////////////
+void writeReg(uint8_t reg, uint8_t val) {
+  if (reg == I2C_REG_CONFIG) {
+    I2C_CTRL(I2C_REG_CONFIG) |= val;      // Requests, cleared by the main loop
+  } else if (reg >= I2C_CTRL_BASE && reg < I2C_NUM_REGS) {
+    i2cCtrl[reg - I2C_CTRL_BASE] = val;
+  }
+#ifdef WITH_TRIGGER
+  if (reg == I2C_REG_CONFIG && (val & I2C_CFG_TRIGGER)) {
+    I2C_CTRL(I2C_REG_CONFIG) &= ~I2C_CFG_TRIGGER;
+    if (acqTrigger()) {                   // Burst starts now
+      i2cSlave.trigBusy = I2C_TRIG_BUSY;  // Later snapshots get BUSY with their swap
+      i2cSlave.data[i2cSlave.txBuf][I2C_REG_STATUS] |= I2C_STATUS_BUSY;
+    }
+  }
+#endif
+#ifdef WITH_STATS
+  if (reg == I2C_REG_STATS) {
+    statsClear();                         // Any value
+  }
+#endif
+#ifdef WITH_CAL
+  if (I2C_IS_CAL(reg)) {
+    calRegs[reg - I2C_REG_CAL] = val;     // Active with I2C_CFG_SAVE_CAL
+  }
+#endif
+#ifdef WITH_PROFILES
+  if (reg == I2C_REG_PROFILE) {
+    acqProfileReg = val;                  // Taken over by the main loop
+  }
+#endif
+#ifdef WITH_AGG
+  if (reg == I2C_REG_AGG_WINDOW) {
+    aggWindowReg = val;                   // From the next window on
+  }
+#endif
 }
 
 //////////////////////////////////////////////////////////////////////////////
-/// @brief Initialize this microcontroller as an I2C slave.
+/// @brief Get the back buffer for the next sample. Must be followed by
+///        commitTxData(). Interrupts stay enabled. The back buffer starts
+///        with the newest data, so it can be updated partially: a copy of
+///        the published buffer, or the committed one that no START has
+///        swapped in yet.
 /// 
+/// @return volatile uint8_t*   Buffer with NUMBER_OF_BYTES bytes, the
+///                             channel block (I2C_SCAN_DATA()) and the
+///                             value block (I2C_UNITS_DATA()) behind
 //////////////////////////////////////////////////////////////////////////////
-void i2cSlaveSetup(void){
-  P1OUT = BIT6 | BIT7;                    // P1.6 & P1.7 OUT
-  //P1REN |= BIT6 + BIT7                  // P1.6 & P1.7 Pullups
+volatile uint8_t* beginTxData(void) {
+  volatile uint8_t* back;
+  uint8_t buf = i2cSlave.txBuf;
+  uint8_t pending = i2cSlave.swapPending;
+  uint8_t i;
 
-  USICTL0 |= USISWRST;                    // Do config -> Disable USI
-  USICTL0 = USIPE6+USIPE7+USISWRST;       // Port & USI mode setup
-  USICTL1 = USII2C+USIIE+USISTTIE;        // Enable I2C mode & USI interrupts
-  USICKCTL = USICKPL;                     // Setup clock polarity
-  USICNT |= USIIFGCC;                     // Disable automatic clear control
-  USICTL0 &= ~USISWRST;                   // Config ready -> Enable USI
-  USICTL1 &= ~USIIFG;                     // Clear pending flag
-  __enable_interrupt();
+  i2cSlave.swapPending = 0;                        // No swap while we are writing
+  back = i2cSlave.data[i2cSlave.txBuf ^ 0x01];
+  if (pending && i2cSlave.txBuf == buf) {
+    return back;                                   // Last commit not published: go on with it
+  }
+  for (i = 0; i < I2C_DATA_SIZE; ++i) {
+    back[i] = i2cSlave.data[i2cSlave.txBuf][i];
+  }
+  return back;
 }
 
 //////////////////////////////////////////////////////////////////////////////
-/// @brief Transfer of a data byte.
+/// @brief Publish the back buffer with the next START condition. With
+///        WITH_DRDY it is marked new and the data-ready line pulses.
 /// 
-/// @param pIdx       Pointer to the index of the data field.
-///                   Attention: the index value will be inkremented!
-/// @return uint8_t   next I2C state  
-//////////////////////////////////////////////////////////////////////////////
-uint8_t txData(unsigned char* pIdx) {
-  USICTL0 |= USIOE;                       // SDA = output
-  USISRL = slvData[*pIdx];
-  USICNT |=  0x08;                        // Bit counter = 8, TX data
-  (*pIdx)++;
-  return I2C_ACK_NACK;                    // next state: receive (N)Ack
+//////////////////////////////////////////////////////////////////////////////
+void commitTxData(void) {
+#ifdef WITH_DRDY
+  i2cSlave.data[i2cSlave.txBuf ^ 0x01][I2C_REG_STATUS] |= I2C_STATUS_NEW;
+#endif
+#ifdef WITH_TRIGGER
+  if (i2cSlave.data[i2cSlave.txBuf ^ 0x01][I2C_REG_STATUS] & I2C_STATUS_TRIGGERED) {
+    i2cSlave.trigBusy = I2C_TRIG_END;     // Before the swap can happen
+  }
+#endif
+  i2cSlave.swapPending = 1;
+#ifdef WITH_DRDY
+  DRDY_DIR |= DRDY_BIT;                   // Line low for ~ 5 cycles (bis.b/bic.b &abs)
+  DRDY_DIR &= ~DRDY_BIT;
+#endif
 }
 
 //////////////////////////////////////////////////////////////////////////////
-/// @brief Reset I2C to Idle and wait for the next start 
+/// @brief Put a 16 Bit value (big endian) into a buffer from beginTxData()
 /// 
-/// @return uint8_t next I2C state 
+/// @param buf        Back buffer
+/// @param reg        Register address of the high byte
+/// @param val        The 16 Bit integer value
 //////////////////////////////////////////////////////////////////////////////
-uint8_t prepStart(void) {
-  USICTL0 &= ~USIOE;                      // SDA = input
-  slvAddr = (SLAVE_ADDR << 1);            // Reset slave address
-  return I2C_IDLE;
+void putTxData16(volatile uint8_t* buf, uint8_t reg, uint16_t val) {
+  buf[reg] = (val>>8) & 0xFF;
+  buf[reg + 1] = val & 0xFF;
 }
 
 //////////////////////////////////////////////////////////////////////////////
 /// @brief Break down the 16 Bit integer number into individual bytes 
-///        for transmission
+///        for transmission (register I2C_REG_VALUE)
 /// 
 /// @param val The 16 Bit integer value
 //////////////////////////////////////////////////////////////////////////////
 void setTxData16(uint16_t val) {
-  slvData[0] = (val>>8) & 0xFF;
-  slvData[1] = val & 0xFF;
+  volatile uint8_t* buf = beginTxData();
+  buf[0] = (val>>8) & 0xFF;
+  buf[1] = val & 0xFF;
+  commitTxData();
 }
 
 //////////////////////////////////////////////////////////////////////////////
 /// @brief Break down the 32 Bit integer number into individual bytes 
-///        for transmission
+///        for transmission (registers I2C_REG_VALUE and I2C_REG_MIN)
 /// 
 /// @param val The 32 Bit integer value
 //////////////////////////////////////////////////////////////////////////////
 void setTxData32(uint32_t val) {
-  slvData[0] = (val>>24) & 0xFF;
-  slvData[1] = (val>>16) & 0xFF;
-  slvData[2] = (val>>8) & 0xFF;
-  slvData[3] = val & 0xFF;
+  volatile uint8_t* buf = beginTxData();
+  buf[0] = (val>>24) & 0xFF;
+  buf[1] = (val>>16) & 0xFF;
+  buf[2] = (val>>8) & 0xFF;
+  buf[3] = val & 0xFF;
+  commitTxData();
 }
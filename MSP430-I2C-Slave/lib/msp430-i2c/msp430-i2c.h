@@ -6,14 +6,78 @@ extern "C" {
 #endif //__cplusplus
 
 #include <stdint.h>
+#include "sd16-acq.h"                       // SCAN_SIZE of the snapshot layout
+#include "calibration.h"                    // UNITS_SIZE
+#include "running-stats.h"                  // AGG_SIZE
 
 //////////////////////////////////////////////////////////////////////////////
 /// Global definitions
 //////////////////////////////////////////////////////////////////////////////
 
-#define SLAVE_ADDR  0x24                    // Slave-Address 
-#define NUMBER_OF_BYTES  4U                 // Bytes for transfer data buffer (2 or 4)
-#define WITH_LED
+#define SLAVE_ADDR  0x24                    // Default slave address (info flash, see info-flash.h)
+#define I2C_FAST_MODE                       // 400 kHz ISR: early SCL release, TX bytes staged ahead, no LED (see i2c-usi.c)
+#ifndef I2C_FAST_MODE
+#define WITH_LED                            // Status LED on P1.0, standard USI ISR only
+#endif
+//#define I2C_BACKEND I2C_BACKEND_USI       // Bus peripheral, default: the one of the device (see i2c-slave-sm.h)
+//#define WITH_DRDY                         // Data-ready line: pulse with every commitTxData(), I2C_STATUS_NEW (see msp430-i2c.c)
+
+#define I2C_BACKEND_USI     1               // USI: MSP430F20x2/3 (i2c-usi.c)
+#define I2C_BACKEND_USCI    2               // USCI_B0: MSP430G2xx3 (i2c-usci.c)
+
+#define DRDY_SEL            P2SEL           // Data-ready line: P2.6 (XIN, no crystal), open drain, active low
+#define DRDY_DIR            P2DIR
+#define DRDY_OUT            P2OUT
+#define DRDY_BIT            BIT6
+
+// Register map (16 bit values are big endian)
+// Data registers: read only, published as one snapshot (double buffer)
+#define I2C_REG_VALUE       0x00            // Latest median (16 bit)
+#define I2C_REG_MIN         0x02            // Minimum since reset (16 bit)
+#define I2C_REG_MAX         0x04            // Maximum since reset (16 bit)
+#define I2C_REG_COUNT       0x06            // Sample counter of VALUE (16 bit)
+#define I2C_REG_STATUS      0x08            // Status bits (I2C_STATUS_x)
+#define I2C_CTRL_BASE       0x09            // Control registers: read/write
+#define I2C_REG_CONFIG      0x09            // Config bits (I2C_CFG_x)
+#define I2C_REG_ADDR        0x0A            // Own 7 bit address, new one for I2C_CFG_SAVE_ADDR
+#define I2C_NUM_REGS        0x0B            // Size of the register map
+#define I2C_REG_FIFO        0x0B            // Sample history stream (no auto-increment)
+#define I2C_REG_PEC         0x0C            // SMBus PEC, follows I2C_REG_ADDR (WITH_PEC)
+#define I2C_PEC_BLOCK       8               // FIFO bytes between two PEC bytes (WITH_PEC)
+#define I2C_REG_PROFILE     0x0D            // Acquisition profile ACQ_PROFILE_x, read/write (WITH_PROFILES)
+#define I2C_REG_AGG_WINDOW  0x0E            // Statistics window 2^k samples, read/write (WITH_AGG)
+#define I2C_REG_STATS       0x10            // Counter window, STATS_SIZE bytes, write clears (WITH_STATS)
+#define I2C_REG_SCAN        0x30            // Channel block, SCAN_SIZE bytes, part of the snapshot (WITH_SCAN)
+#define I2C_REG_UNITS       0x40            // Calibrated values, UNITS_SIZE bytes, part of the snapshot (WITH_CAL)
+#define I2C_REG_CAL         0x50            // Calibration window, CAL_SIZE bytes, read/write (WITH_CAL)
+#define I2C_REG_AGG         0x60            // Window statistics, AGG_SIZE bytes, part of the snapshot (WITH_AGG)
+
+#define NUMBER_OF_BYTES     I2C_CTRL_BASE   // Bytes for transfer data buffer
+#define I2C_CTRL_SIZE       (I2C_NUM_REGS - I2C_CTRL_BASE)
+#define I2C_CTRL(reg)       i2cCtrl[(reg) - I2C_CTRL_BASE]
+#define I2C_SCAN_DATA(reg)  (I2C_CTRL_BASE + (reg) - I2C_REG_SCAN)  // Index of a channel block register in the buffer of beginTxData()
+#ifdef WITH_SCAN
+#define I2C_SCAN_BYTES      SCAN_SIZE       // Channel block in the snapshot
+#else
+#define I2C_SCAN_BYTES      0
+#endif
+#define I2C_UNITS_DATA(reg) (I2C_CTRL_BASE + I2C_SCAN_BYTES + (reg) - I2C_REG_UNITS)  // Index of a value block register, behind the channel block
+#ifdef WITH_CAL
+#define I2C_UNITS_BYTES     UNITS_SIZE      // Value block in the snapshot
+#else
+#define I2C_UNITS_BYTES     0
+#endif
+#define I2C_AGG_DATA(reg)   (I2C_CTRL_BASE + I2C_SCAN_BYTES + I2C_UNITS_BYTES + (reg) - I2C_REG_AGG)  // Index of a statistics block register, behind the value block
+
+#define I2C_STATUS_RUNNING  0x01            // Acquisition is running
+#define I2C_STATUS_NEW      0x02            // Snapshot not read yet, cleared when STATUS is sent (WITH_DRDY)
+#define I2C_STATUS_BUSY     0x04            // Triggered burst running, VALUE is an older one (WITH_TRIGGER)
+#define I2C_STATUS_TRIGGERED 0x08           // VALUE is the mean of a triggered burst, not the median (WITH_TRIGGER)
+#define I2C_CFG_RESET_MINMAX 0x01           // Restart min/max (self-clearing)
+#define I2C_CFG_SAVE_ADDR   0x02            // Take over I2C_REG_ADDR, store it in info flash (self-clearing)
+#define I2C_CFG_SAVE_CAL    0x04            // Take over I2C_REG_CAL, store it in info flash (self-clearing)
+#define I2C_CFG_CLOSE_AGG   0x08            // End the statistics window with the next sample (self-clearing)
+#define I2C_CFG_TRIGGER     0x10            // Start a conversion burst at once (self-clearing, WITH_TRIGGER)
 
 typedef enum I2C_ModeEnum{                  // States for Statemachine
     I2C_IDLE = 0,
@@ -23,23 +87,28 @@ typedef enum I2C_ModeEnum{                  // States for Statemachine
     I2C_RX_CHECK = 8,
     I2C_TX_DATA = 10,
     I2C_ACK_NACK = 12,
-    I2C_TX_CHECK = 14
+    I2C_TX_CHECK = 14,
+    I2C_PREP_START = 16
 } I2C_Mode;
 
 //////////////////////////////////////////////////////////////////////////////
 /// Global variables
 //////////////////////////////////////////////////////////////////////////////
 
-static uint8_t slvAddr = (SLAVE_ADDR << 1);        // Init Address of this slave 
-                                                   // 7 Bit Address is << 1 for R/W       
+extern volatile uint8_t i2cCtrl[I2C_CTRL_SIZE];    // Control registers
 
 //////////////////////////////////////////////////////////////////////////////
 /// Forward declaration(s)
 //////////////////////////////////////////////////////////////////////////////
 
 void i2cSlaveSetup(void);
-uint8_t txData(uint8_t* data_idx);
-uint8_t prepStart(void);
+void i2cSetAddress(uint8_t addr);
+uint8_t i2cGetAddress(void);
+uint8_t readReg(uint8_t reg);
+void writeReg(uint8_t reg, uint8_t val);
+volatile uint8_t* beginTxData(void);
+void commitTxData(void);
+void putTxData16(volatile uint8_t* buf, uint8_t reg, uint16_t val);
 void setTxData16(uint16_t val);
 void setTxData32(uint32_t val);
 
@@ -0,0 +1,104 @@
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Streaming median filter over a sliding window of ADC samples.
+///
+///        The window is kept sorted. Each sorted value carries the age slot
+///        (sample number modulo window size) it was inserted with. A new
+///        sample replaces the value with the oldest slot and is moved to
+///        its sorted position in the same pass, so one update costs O(n)
+///        compares/moves instead of the O(n²) of a full sort. The median
+///        is always the middle element.
+///
+///        RAM: 3 bytes per window element + 6 bytes (pointers, size, next).
+///
+//////////////////////////////////////////////////////////////////////////////
+
+#include "running-median.h"
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Initialize the filter. All window values are set to an initial
+///        value (e.g. the first conversion), so the filter is valid at once.
+///
+/// @param rm         Filter state
+/// @param values     Storage for the window values (size elements)
+/// @param slots      Storage for the age slots (size elements)
+/// @param size       Window size, has to be odd
+/// @param initial    Initial value of all window elements
+//////////////////////////////////////////////////////////////////////////////
+void medianInit(RunningMedian* rm, uint16_t* values, uint8_t* slots,
+                uint8_t size, uint16_t initial) {
+  uint8_t i;
+
+  rm->values = values;
+  rm->slots = slots;
+  rm->size = size;
+  rm->next = 0;
+  for (i = 0; i < size; ++i) {
+    values[i] = initial;
+    slots[i] = i;
+  }
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Insert a new sample, evict the oldest one and return the median
+///        of the window.
+///
+/// @param rm         Filter state
+/// @param sample     New measured value
+/// @return uint16_t  Median of the current window
+//////////////////////////////////////////////////////////////////////////////
+uint16_t medianPush(RunningMedian* rm, uint16_t sample) {
+  uint16_t* val = rm->values;
+  uint8_t* slot = rm->slots;
+  uint8_t last = rm->size - 1;
+  uint8_t i = 0;
+
+  while (slot[i] != rm->next) {             // Find the oldest value
+    ++i;
+  }
+  if (i > 0 && val[i - 1] > sample) {       // Move the gap down ...
+    do {
+      val[i] = val[i - 1];
+      slot[i] = slot[i - 1];
+      --i;
+    } while (i > 0 && val[i - 1] > sample);
+  } else {                                  // ... or up to the sorted position
+    while (i < last && val[i + 1] < sample) {
+      val[i] = val[i + 1];
+      slot[i] = slot[i + 1];
+      ++i;
+    }
+  }
+  val[i] = sample;
+  slot[i] = rm->next;
+  if (++rm->next > last) {
+    rm->next = 0;
+  }
+  return val[last >> 1];
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Determining the median from a list of measured values.
+///        Batch version (bubble sort, the data is sorted in place).
+///
+/// @param data           Measured values
+/// @param items          Number of measured values
+/// @return uint16_t      Return median value
+//////////////////////////////////////////////////////////////////////////////
+uint16_t getMedian(uint16_t* data, uint8_t items)
+{
+  uint16_t tmp;
+  uint8_t i, j;
+
+  for (i = 0; i < items; ++i) {
+    for (j = 0; j < items - i - 1; ++j) {
+      if (data[j] > data[j + 1]) {
+        tmp = data[j];
+        data[j] = data[j + 1];
+        data[j + 1] = tmp;
+      }
+    }
+  }
+  tmp = (items >> 1);                     // items/2
+  return data[tmp];                       // The result set is odd. Simply return
+                                          // the mean value of the set of values.
+}
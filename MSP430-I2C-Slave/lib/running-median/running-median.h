@@ -0,0 +1,42 @@
+#ifndef _RUNNING_MEDIAN_H_
+#define _RUNNING_MEDIAN_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif //__cplusplus
+
+#include <stdint.h>
+
+//////////////////////////////////////////////////////////////////////////////
+/// Global definitions
+//////////////////////////////////////////////////////////////////////////////
+
+#ifndef MEDIAN_WINDOW
+#define MEDIAN_WINDOW 11                    // Window size (has to be odd)
+#endif
+
+#if ((MEDIAN_WINDOW & 0x01) == 0) || (MEDIAN_WINDOW < 3) || (MEDIAN_WINDOW > 255)
+#error MEDIAN_WINDOW has to be an odd value between 3 and 255
+#endif
+
+typedef struct RunningMedianStruct {        // Sliding window median filter
+  uint16_t* values;                         // Window, sorted ascending
+  uint8_t* slots;                           // Age slot of each sorted value
+  uint8_t size;                             // Window size (odd)
+  uint8_t next;                             // Slot replaced by the next sample
+} RunningMedian;
+
+//////////////////////////////////////////////////////////////////////////////
+/// Forward declaration(s)
+//////////////////////////////////////////////////////////////////////////////
+
+void medianInit(RunningMedian* rm, uint16_t* values, uint8_t* slots,
+                uint8_t size, uint16_t initial);
+uint16_t medianPush(RunningMedian* rm, uint16_t sample);
+uint16_t getMedian(uint16_t* data, uint8_t items);
+
+#ifdef __cplusplus
+}
+#endif //__cplusplus
+
+#endif
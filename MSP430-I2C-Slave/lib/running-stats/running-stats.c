@@ -0,0 +1,98 @@
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Incremental window statistics (min, max, mean, variance) of the
+///        published values, so the master reads one block every few
+///        seconds instead of polling every sample.
+///
+///        Per sample only sums are updated (runStatsPush):
+///          d = x - ref,  sum += d,  sumSq += d^2
+///        ref is the first sample of the window, so the sums stay small
+///        for a signal with little spread. The sums are exact integers:
+///        the cancellation that Welford's update avoids in floating point
+///        does not happen, and there is no division per sample. The F2013
+///        has no hardware multiplier: d^2 is a libgcc 16 x 16 bit multiply,
+///        ~ 200 cycles per sample in total.
+///
+///        At the end of a window runStatsResult() divides once:
+///          mean = ref + sum / n                       (Q16.16, rounded)
+///          var  = (n sumSq - sum^2) / (n (n - 1))     (Q32.16, rounded)
+///        with 64 bit integer divisions, a few thousand cycles per window.
+///        Both are the exact values rounded once to the fixed point format.
+///
+///        A window ends after 2^k samples (aggWindowReg, k = 1 .. 15) or
+///        on a close request of the master; with k = 0 on the request only,
+///        and at AGG_MAX_SAMPLES at the latest. The main loop publishes the
+///        result of the last closed window in every snapshot.
+///
+//////////////////////////////////////////////////////////////////////////////
+
+#include "running-stats.h"
+
+#ifdef WITH_AGG
+volatile uint8_t aggWindowReg = AGG_WINDOW; // I2C window, written by the ISR
+#endif
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Start a new window
+///
+/// @param rs         Accumulators
+//////////////////////////////////////////////////////////////////////////////
+void runStatsReset(RunningStats* rs) {
+  rs->n = 0;
+  rs->sum = 0;
+  rs->sumSq = 0;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Add a sample to the window
+///
+/// @param rs         Accumulators
+/// @param x          Sample
+/// @return uint16_t  Samples in the window
+//////////////////////////////////////////////////////////////////////////////
+uint16_t runStatsPush(RunningStats* rs, uint16_t x) {
+  uint16_t d;
+
+  if (rs->n == 0) {
+    rs->ref = rs->min = rs->max = x;
+  }
+  if (x < rs->min) {
+    rs->min = x;
+  }
+  if (x > rs->max) {
+    rs->max = x;
+  }
+  if (x >= rs->ref) {
+    d = x - rs->ref;
+    rs->sum += d;
+  } else {
+    d = rs->ref - x;
+    rs->sum -= d;
+  }
+  rs->sumSq += (uint32_t)d * d;           // 16 x 16 bit multiply
+  return ++rs->n;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Statistics of the window (at least one sample). res->count is
+///        left to the caller.
+///
+/// @param rs         Accumulators
+/// @param res        Out: n, min, max, mean, variance
+//////////////////////////////////////////////////////////////////////////////
+void runStatsResult(const RunningStats* rs, AggResult* res) {
+  uint16_t n = rs->n;
+  uint32_t s = rs->sum < 0 ? -(uint32_t)rs->sum : (uint32_t)rs->sum;
+  uint32_t frac = (((uint64_t)s << 16) + n / 2) / n;  // No ties: n <= 2^15
+
+  res->n = n;
+  res->min = rs->min;
+  res->max = rs->max;
+  res->mean = rs->sum < 0 ? ((uint32_t)rs->ref << 16) - frac : ((uint32_t)rs->ref << 16) + frac;
+  if (n > 1) {
+    uint32_t den = (uint32_t)n * (n - 1);
+    uint64_t q = n * rs->sumSq - (uint64_t)s * s;  // n * M2, 62 bit at most
+    res->var = ((q / den) << 16) + (((q % den) << 16) + den / 2) / den;
+  } else {
+    res->var = 0;
+  }
+}
@@ -0,0 +1,63 @@
+#ifndef _RUNNING_STATS_H_
+#define _RUNNING_STATS_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif //__cplusplus
+
+#include <stdint.h>
+
+//////////////////////////////////////////////////////////////////////////////
+/// Global definitions
+//////////////////////////////////////////////////////////////////////////////
+
+//#define WITH_AGG                          // Window statistics of VALUE at I2C_REG_AGG (see running-stats.c),
+                                            // ~ 75 bytes more RAM: MSP430G2553
+
+#define AGG_SIZE          18                // Statistics block: COUNT, N, MIN, MAX, MEAN (4), VAR (6)
+#define AGG_MAX_SAMPLES   0x8000            // Longest window (the sum has to fit into 31 bit)
+#ifndef AGG_WINDOW
+#define AGG_WINDOW        8                 // Default window: 2^8 samples (2.56 s at 100 samples/s)
+#endif
+                                            // Samples of a window 2^k, 0 (or > 15): until a close request
+#define AGG_LIMIT(k)      (((k) == 0 || (k) > 15) ? AGG_MAX_SAMPLES : (1U << (k)))
+
+typedef struct RunningStatsStruct {         // Accumulators of the running window
+  uint16_t n;                               // Samples
+  uint16_t ref;                             // First sample: the sums run over x - ref
+  uint16_t min;
+  uint16_t max;
+  int32_t sum;                              // Sum of x - ref
+  uint64_t sumSq;                           // Sum of (x - ref)^2, 47 bit at most
+} RunningStats;
+
+typedef struct AggResultStruct {            // Statistics of a closed window
+  uint16_t count;                           // Sample counter of the last sample
+  uint16_t n;                               // Samples
+  uint16_t min;
+  uint16_t max;
+  uint32_t mean;                            // Q16.16
+  uint64_t var;                             // Sample variance (n - 1), LSB^2, Q32.16 (48 bit)
+} AggResult;
+
+//////////////////////////////////////////////////////////////////////////////
+/// Global variables
+//////////////////////////////////////////////////////////////////////////////
+
+#ifdef WITH_AGG
+extern volatile uint8_t aggWindowReg;       // I2C_REG_AGG_WINDOW: k of the window 2^k
+#endif
+
+//////////////////////////////////////////////////////////////////////////////
+/// Forward declaration(s)
+//////////////////////////////////////////////////////////////////////////////
+
+void runStatsReset(RunningStats* rs);
+uint16_t runStatsPush(RunningStats* rs, uint16_t x);
+void runStatsResult(const RunningStats* rs, AggResult* res);
+
+#ifdef __cplusplus
+}
+#endif //__cplusplus
+
+#endif
@@ -0,0 +1,141 @@
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Sample history: a byte FIFO of delta encoded samples that the
+///        master drains through the stream register I2C_REG_FIFO.
+///
+///        Every sample carries the sample counter (seq) of the main loop.
+///        The samples are paced by Timer_A, so seq * ACQ_PERIOD is the
+///        time stamp of a sample.
+///
+///        RECORDS
+///
+///        0x00                     Padding, sent while the FIFO is empty
+///        0x01 seqH seqL valH valL Key record: absolute seq and value
+///        varint(zigzag(dv) + 2)   Delta record: seq + 1, value + dv
+///
+///        The varint has 7 bits per byte, LSB first, bit 7 = more bytes
+///        follow. It is limited to 2 bytes, larger steps are sent as key
+///        record. The first byte of a delta record is never 0x00 or 0x01.
+///        A key record is sent after a gap (FIFO full, record dropped) and
+///        every HIST_KEY_INTERVAL records, so a master can sync at any time.
+///        Noise of a few LSB costs 1 byte per sample.
+///
+///        LOCKING
+///
+///        Single producer (main loop) and single consumer (USI ISR). head
+///        and tail are free running 8 bit counters, only the owner writes
+///        them. A record is copied first and then published with one write
+///        of head, so the ISR never sees half a record.
+///
+///        RAM: HIST_SIZE + 7 bytes.
+///
+//////////////////////////////////////////////////////////////////////////////
+
+#include "sample-history.h"
+
+//////////////////////////////////////////////////////////////////////////////
+/// Module global variables
+//////////////////////////////////////////////////////////////////////////////
+
+static volatile uint8_t histBuf[HIST_SIZE];
+static volatile uint8_t histHead = 0;       // Written by histPush (main loop)
+static volatile uint8_t histTail = 0;       // Written by histRead (ISR)
+static uint16_t histSeq;                    // Last pushed sample
+static uint16_t histValue;
+static uint8_t histKeyCnt = 0;              // Records until the next key, 0 = key
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Reset the FIFO. Call before the interrupts are enabled.
+///
+//////////////////////////////////////////////////////////////////////////////
+void histInit(void) {
+  histHead = histTail = 0;
+  histKeyCnt = 0;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Append a sample. If the FIFO is full the sample is dropped and
+///        the next one is sent as key record.
+///
+/// @param seq        Sample counter
+/// @param value      Sample value
+//////////////////////////////////////////////////////////////////////////////
+void histPush(uint16_t seq, uint16_t value) {
+  uint8_t rec[HIST_KEY_LEN];
+  uint8_t len;
+  uint8_t i;
+  int16_t dv = (int16_t)(value - histValue);
+  uint16_t z = (uint16_t)(((uint16_t)dv << 1) ^ (uint16_t)(dv >> 15)) + HIST_DELTA_BIAS;
+
+  if (histKeyCnt == 0 || (uint16_t)(seq - histSeq) != 1 || z >= HIST_DELTA_LIMIT
+      || z < HIST_DELTA_BIAS) {            // zigzag(-32768) + bias wraps around
+    rec[0] = HIST_KEY;
+    rec[1] = seq >> 8;
+    rec[2] = seq & 0xFF;
+    rec[3] = value >> 8;
+    rec[4] = value & 0xFF;
+    len = HIST_KEY_LEN;
+  } else if (z < 0x80) {
+    rec[0] = (uint8_t)z;
+    len = 1;
+  } else {
+    rec[0] = (uint8_t)(z | 0x80);
+    rec[1] = (uint8_t)(z >> 7);
+    len = 2;
+  }
+
+  if ((uint8_t)(HIST_SIZE - (uint8_t)(histHead - histTail)) < len) {
+    histKeyCnt = 0;                         // Dropped: resync with a key
+    return;
+  }
+  for (i = 0; i < len; ++i) {
+    histBuf[(uint8_t)(histHead + i) & HIST_MASK] = rec[i];
+  }
+  histHead += len;                          // Publish the record
+  histKeyCnt = (len == HIST_KEY_LEN) ? HIST_KEY_INTERVAL : histKeyCnt - 1;
+  histSeq = seq;
+  histValue = value;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Take the next byte out of the FIFO (ISR context).
+///
+/// @return uint8_t   Next byte, HIST_PAD if the FIFO is empty
+//////////////////////////////////////////////////////////////////////////////
+uint8_t histRead(void) {
+  uint8_t tail = histTail;
+
+  if (tail == histHead) {
+    return HIST_PAD;
+  }
+  histTail = tail + 1;
+  return histBuf[tail & HIST_MASK];
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Next byte of the FIFO without taking it out (ISR context).
+///        Only valid if histLevel() > 0. The fast mode ISR stages the
+///        byte before it knows whether the master wants it.
+///
+/// @return uint8_t   Next byte
+//////////////////////////////////////////////////////////////////////////////
+uint8_t histPeek(void) {
+  return histBuf[histTail & HIST_MASK];
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Take out the byte returned by histPeek() (ISR context). The
+///        producer only appends, so it is still the next one.
+///
+//////////////////////////////////////////////////////////////////////////////
+void histDrop(void) {
+  histTail++;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Number of bytes in the FIFO.
+///
+/// @return uint8_t   Used bytes
+//////////////////////////////////////////////////////////////////////////////
+uint8_t histLevel(void) {
+  return (uint8_t)(histHead - histTail);
+}
@@ -0,0 +1,49 @@
+#ifndef _SAMPLE_HISTORY_H_
+#define _SAMPLE_HISTORY_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif //__cplusplus
+
+#include <stdint.h>
+
+//////////////////////////////////////////////////////////////////////////////
+/// Global definitions
+//////////////////////////////////////////////////////////////////////////////
+
+#define WITH_HISTORY                        // Sample history FIFO (register I2C_REG_FIFO)
+
+#ifndef HIST_SIZE
+#define HIST_SIZE         32                // FIFO size in bytes (power of 2)
+#endif
+#define HIST_MASK         (HIST_SIZE - 1)
+
+#if (HIST_SIZE & HIST_MASK) || (HIST_SIZE < 8) || (HIST_SIZE > 128)
+#error HIST_SIZE has to be a power of 2 between 8 and 128
+#endif
+
+#define HIST_KEY_INTERVAL 16                // Key record at least every n records
+
+// Record format (see sample-history.c)
+#define HIST_PAD          0x00              // FIFO empty
+#define HIST_KEY          0x01              // Key record: KEY seq(16) value(16)
+#define HIST_KEY_LEN      5
+#define HIST_DELTA_BIAS   2                 // Varint = zigzag(delta) + bias
+#define HIST_DELTA_LIMIT  0x4000            // Varint limit (2 bytes)
+
+//////////////////////////////////////////////////////////////////////////////
+/// Forward declaration(s)
+//////////////////////////////////////////////////////////////////////////////
+
+void histInit(void);
+void histPush(uint16_t seq, uint16_t value);
+uint8_t histRead(void);
+uint8_t histPeek(void);
+void histDrop(void);
+uint8_t histLevel(void);
+
+#ifdef __cplusplus
+}
+#endif //__cplusplus
+
+#endif
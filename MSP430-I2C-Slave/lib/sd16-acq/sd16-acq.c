@@ -0,0 +1,538 @@
+//////////////////////////////////////////////////////////////////////////////
+/// @brief SD16_A acquisition. Either polling (sd16Convert) or timer paced
+///        with interrupts, the CPU sleeps in LPM0 between the events
+///        (acqStart/acqWait).
+///
+///        Timer paced mode:
+///        Timer_A runs continuously from SMCLK/8. The CCR0 interrupt starts
+///        a single conversion every ACQ_PERIOD ticks (TACCR0 += ACQ_PERIOD,
+///        no drift). The SD16 interrupt stores the result and wakes up the
+///        main loop. SMCLK keeps running in LPM0, so Timer_A, SD16 and the
+///        USI (clocked by SCL) work while the CPU is off.
+///
+///        Channel scan (WITH_SCAN):
+///        Every period converts all SCAN_CHANNELS entries of scanTable, each
+///        with its own input, gain, polarity and OSR. The timer starts
+///        channel 0, the SD16 interrupt stores the result, switches the
+///        input mux and starts the next channel at once, so the channels of
+///        one scan are only a conversion apart. After the last channel the
+///        mux is set back to channel 0 for the next timer start and the main
+///        loop is woken up. acqWaitScan() returns the whole scan; the main
+///        loop has to take it before the next scan ends its 1st conversion.
+///        A conversion with interrupt on the 4th sample takes 4 * OSR SD16
+///        clocks (SMCLK): 1 / 1 / 4 / 1 ms for the table below at 1 MHz,
+///        7.2 ms per scan, so ACQ_SAMPLE_RATE has to stay below ~ 130.
+///
+///        Acquisition profiles (WITH_PROFILES):
+///        acqSetProfile() switches between the entries of acqProfiles, they
+///        trade sample rate against noise. ACQ_PROFILE_NORMAL is the timer
+///        paced mode above. The other profiles stop the timer starts and
+///        let the SD16 convert continuously (one result per OSR clocks); the
+///        SD16 interrupt feeds every result into a CIC decimator of order 1
+///        (boxcar: sum of R results) or 2 and wakes the main loop only with
+///        every R-th result, the decimated and rounded value:
+///          integrators (per result):  i1 += x, i2 += i1
+///          combs (per output):        c1 = i2 - i2', y = c1 - c1'
+///          output:                    (y + 2^shift / 2) >> shift
+///        The rounding constant comes from the profile table: the MSP430
+///        shifts one bit per instruction, so 1UL << shift would cost
+///        another 32 bit shift loop in the ISR.
+///        The 32 bit integrators wrap around, the combs undo that as long
+///        as R^order * 65535 fits into 32 bit. The 1st output of the 2nd
+///        order CIC is incomplete and dropped. With WITH_SCAN the
+///        continuous profiles convert channel 0 only, the other channels
+///        keep their last values.
+///        The decimated noise depends on the filter of the SD16 as well, see
+///        sim/bench-profiles.cpp for samples/s and noise of every profile.
+///        At 1 MHz the SD16 interrupt of ACQ_PROFILE_FAST (3906 per second,
+///        ~ 60 cycles each) takes ~ 25 % of the CPU.
+///
+///        Triggered conversions (WITH_TRIGGER):
+///        The master asks for a fresh value with I2C_CFG_TRIGGER. The I2C
+///        ISR calls acqTrigger() with the received byte, i.e. before the
+///        STOP: it stops the timer starts, aborts a running conversion (a
+///        WITH_SCAN scan starts again at channel 0 later) and lets the SD16
+///        convert channel 0 continuously. The SD16 interrupt adds up
+///        TRIG_BURST results, stops the converter and wakes the main loop
+///        with the rounded mean; the median filter is bypassed, so the
+///        value is from the last ~ 2 ms only: 4 * OSR clocks for the 1st
+///        result, OSR clocks for every further one (1.8 ms for 4 results
+///        at OSR 256 and 1 MHz). acqTriggerDone() restarts the timer
+///        paced conversions one period later, once the result is
+///        published. A trigger is refused while a burst or its result is
+///        pending and in the continuous profiles, which are fresh anyway.
+///
+///        Duty statistics (WITH_DUTY_STATS):
+///        acqWait() reads TAR before entering and after leaving LPM0. The
+///        differences are added up as active and sleep ticks. ISR run time
+///        (USI, Timer_A, SD16) is counted as sleep time.
+///
+//////////////////////////////////////////////////////////////////////////////
+
+#include <msp430.h>
+#include "sd16-acq.h"
+#include "slave-stats.h"
+
+//////////////////////////////////////////////////////////////////////////////
+/// Module global variables
+//////////////////////////////////////////////////////////////////////////////
+
+#ifndef WITH_SCAN
+static volatile uint16_t acqSample;         // Last conversion result
+#endif
+static volatile uint8_t acqReady = 0;       // New conversion result available
+
+#ifdef WITH_SCAN
+typedef struct ScanChannelStruct {
+  uint8_t input;                            // SD16INCTL0: gain | input channel
+  uint16_t mode;                            // SD16CCTL0: polarity | OSR
+} ScanChannel;
+
+// Order = channel number in the block I2C_REG_SCAN. Channel 0 feeds VALUE .. COUNT.
+static const ScanChannel scanTable[SCAN_CHANNELS] = {
+  {SD16GAIN_1 | SD16INCH_1, SD16UNI | SD16OSR_256},   // A1+: external input (as before)
+  {SD16GAIN_1 | SD16INCH_5, SD16UNI | SD16OSR_256},   // (AVCC - AVSS) / 11: battery
+  {SD16GAIN_1 | SD16INCH_6, SD16OSR_1024},            // Temperature sensor, bipolar
+  {SD16GAIN_1 | SD16INCH_2, SD16UNI | SD16OSR_256},   // A2+: 2nd external input
+};
+#define SCAN_CLOCKS   (4UL * (256 + 256 + 1024 + 256))  // SD16 clocks of one scan
+
+#if SCAN_CLOCKS >= ACQ_SMCLK_HZ / ACQ_SAMPLE_RATE
+#error A channel scan does not fit into ACQ_PERIOD: lower ACQ_SAMPLE_RATE
+#endif
+
+static volatile uint16_t scanRaw[SCAN_CHANNELS];    // Results of the last scan
+static volatile uint8_t scanCh = 0;         // Channel being converted
+#endif
+
+#ifdef WITH_PROFILES
+typedef struct AcqProfileStruct {
+  uint16_t osr;                             // SD16CCTL0: OSR of the continuous conversion
+  uint8_t decimate;                         // Results per output (R), 0: timer paced
+  uint8_t order;                            // CIC order: 1 (boxcar) or 2
+  uint8_t shift;                            // log2(R^order): gain of the CIC
+  uint16_t round;                           // 2^shift / 2: rounding of the output
+} AcqProfile;
+
+// Order = ACQ_PROFILE_x
+static const AcqProfile acqProfiles[ACQ_PROFILES] = {
+  {SD16OSR_256,  0,  1, 0,  0},             // ACQ_PROFILE_NORMAL
+  {SD16OSR_256,  4,  1, 2,  1 << 1},        // ACQ_PROFILE_FAST
+  {SD16OSR_512,  16, 1, 4,  1 << 3},        // ACQ_PROFILE_SMOOTH
+  {SD16OSR_1024, 64, 2, 12, 1 << 11},       // ACQ_PROFILE_SLOW
+};
+
+#ifdef WITH_SCAN
+#define ACQ_POLARITY  (scanTable[0].mode & SD16UNI)   // Of channel 0
+#else
+#define ACQ_POLARITY  SD16UNI
+#endif
+
+volatile uint8_t acqProfileReg = ACQ_PROFILE_NORMAL;
+static const AcqProfile* volatile acqProf = &acqProfiles[ACQ_PROFILE_NORMAL];
+static uint32_t cicInt1, cicInt2;           // Integrators
+static uint32_t cicComb1, cicComb2;         // Comb delays
+static uint8_t cicCount;                    // Results until the next output
+static uint8_t cicSkip;                     // Outputs to drop after a switch
+#endif
+
+#ifdef WITH_TRIGGER
+#define TRIG_IDLE   0
+#define TRIG_RUN    1                       // Burst running
+#define TRIG_DONE   2                       // Mean in acqSample / scanRaw[0], not yet published,
+                                            // or a burst aborted by acqSetProfile(): the next result
+
+static volatile uint8_t trigState = TRIG_IDLE;
+static uint8_t trigCount;                   // Results until the end of the burst
+static uint32_t trigSum;
+static uint8_t trigTaken;                   // The last acqWait() result is the mean
+#endif
+
+#ifdef WITH_DUTY_STATS
+volatile uint32_t acqActiveTicks = 0;
+volatile uint32_t acqSleepTicks = 0;
+static uint16_t acqStamp;                   // TAR at the last state change
+#endif
+
+#ifdef WITH_SCAN
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Switch the input mux, gain and OSR to a channel of scanTable.
+///        SD16IE is kept. Only while no conversion is running.
+///
+/// @param ch         Channel
+//////////////////////////////////////////////////////////////////////////////
+static inline void scanSelect(uint8_t ch) {
+  SD16INCTL0 = scanTable[ch].input;       // Interrupt on the 4th sample (SD16INTDLY_0)
+  SD16CCTL0 = scanTable[ch].mode | SD16SNGL | (SD16CCTL0 & SD16IE);
+}
+#endif
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Set up ADC in single mode without interrupt
+///
+//////////////////////////////////////////////////////////////////////////////
+void sd16Setup(void) {
+  //             no division       | of SMCLK   | internal reference 1200mV
+  SD16CTL = SD16XDIV_0 | SD16DIV_0 | SD16SSEL_1 | SD16REFON;
+#ifdef WITH_SCAN
+  scanSelect(0);              // Channel 0, no interrupts (SD16IE)
+  SD16AE = SD16AE2 | SD16AE4; // A1+ and A2+, A1- and A2- to internal GND
+#else
+  //          Unipolar| Single   | OSR = 256
+  SD16CCTL0 = SD16UNI | SD16SNGL | SD16OSR_256; // No interrupts (SD16IE)
+  //           gain = 1   | ADC-in A1+
+  SD16INCTL0 = SD16GAIN_1 | SD16INCH_1;         // No interrupt and stop (SD16INTDLY_X)
+  SD16AE = SD16AE2;           // Connect A1- to internal GND
+#endif
+  P1SEL = BIT3;               // Enable VRef to external capacitor
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Single conversion (polling)
+///
+/// @return uint16_t      Conversion result
+//////////////////////////////////////////////////////////////////////////////
+uint16_t sd16Convert(void) {
+  SD16CCTL0 &= ~SD16IFG;                  // clear ADC Interrupt Flag
+  SD16CCTL0 |= SD16SC;                    // start ADC
+  while (!(SD16CCTL0 & SD16IFG)) {
+  }                                       // AD conversion ended?
+  STATS_CONVERSION();
+  return SD16MEM0;
+}
+
+#ifdef WITH_SCAN
+//////////////////////////////////////////////////////////////////////////////
+/// @brief One scan of all channels (polling). The mux is left at
+///        channel 0.
+///
+/// @param raw        Out: SCAN_CHANNELS conversion results
+//////////////////////////////////////////////////////////////////////////////
+void sd16Scan(uint16_t* raw) {
+  uint8_t ch;
+
+  for (ch = 0; ch < SCAN_CHANNELS; ++ch) {
+    scanSelect(ch);
+    raw[ch] = sd16Convert();
+  }
+  scanSelect(0);
+}
+#endif
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Start timer paced conversions. sd16Setup() has to be called first.
+///        WITH_PROFILES: starts with ACQ_PROFILE_NORMAL.
+///
+//////////////////////////////////////////////////////////////////////////////
+void acqStart(void) {
+  TACTL = TASSEL_2 | ID_3 | MC_2 | TACLR; // SMCLK/8, continuous mode
+  TACCR0 = ACQ_PERIOD;
+  TACCTL0 = CCIE;                         // CCR0 interrupt paces the ADC
+#ifdef WITH_SCAN
+  scanCh = 0;                             // The mux is at channel 0 (sd16Setup)
+#endif
+  acqReady = 0;                           // No result of a former run
+#ifdef WITH_TRIGGER
+  trigState = TRIG_IDLE;
+#endif
+#ifdef WITH_PROFILES
+  acqProf = &acqProfiles[ACQ_PROFILE_NORMAL];
+  acqProfileReg = ACQ_PROFILE_NORMAL;
+#endif
+  SD16CCTL0 &= ~SD16IFG;
+  SD16CCTL0 |= SD16IE;                    // Conversion done interrupt
+#ifdef WITH_DUTY_STATS
+  acqStamp = TAR;
+#endif
+}
+
+#ifdef WITH_PROFILES
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Switch to an acquisition profile. acqStart() has to be called
+///        first. A running conversion is aborted, a result not yet taken
+///        by the main loop is lost. A running burst ends with the first
+///        result of the new profile, which acqTriggered() marks.
+///
+/// @param profile    ACQ_PROFILE_x
+/// @return uint8_t   0 for an invalid profile (the active one stays)
+//////////////////////////////////////////////////////////////////////////////
+uint8_t acqSetProfile(uint8_t profile) {
+  const AcqProfile* prof;
+
+  if (profile >= ACQ_PROFILES) {
+    return 0;
+  }
+  prof = &acqProfiles[profile];
+  __disable_interrupt();
+  SD16CCTL0 &= ~SD16SC;                   // Stop, SD16IFG is cleared below
+  TACCTL0 = 0;
+  cicInt1 = cicInt2 = cicComb1 = cicComb2 = 0;
+  cicCount = prof->decimate;
+  cicSkip = prof->order - 1;
+  acqProf = prof;
+  acqReady = 0;
+#ifdef WITH_TRIGGER
+  if (trigState == TRIG_RUN) {
+    trigState = TRIG_DONE;                // A burst is aborted: converted after it anyway
+  }
+#endif
+#ifdef WITH_SCAN
+  scanCh = 0;
+  SD16INCTL0 = scanTable[0].input;
+#endif
+  if (prof->decimate) {
+    SD16CCTL0 = ACQ_POLARITY | prof->osr | SD16IE;
+    SD16CCTL0 |= SD16SC;                  // Runs until the next switch
+  } else {
+#ifdef WITH_SCAN
+    SD16CCTL0 = scanTable[0].mode | SD16SNGL | SD16IE;
+#else
+    SD16CCTL0 = SD16UNI | SD16SNGL | SD16OSR_256 | SD16IE;
+#endif
+    TACCR0 = TAR + ACQ_PERIOD;
+    TACCTL0 = CCIE;                       // Timer paced again
+  }
+  __enable_interrupt();
+  return 1;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Active acquisition profile
+///
+/// @return uint8_t   ACQ_PROFILE_x
+//////////////////////////////////////////////////////////////////////////////
+uint8_t acqProfile(void) {
+  return (uint8_t)(acqProf - acqProfiles);
+}
+#endif
+
+#ifdef WITH_TRIGGER
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Start a conversion burst. Called from the I2C ISR (interrupts
+///        disabled). acqStart() has to be called first. A result of the
+///        timer paced mode not yet taken by the main loop is still
+///        returned by acqWait() (as not triggered), unless the burst ends
+///        first and replaces it.
+///
+/// @return uint8_t   0: refused (burst or result pending, continuous profile)
+//////////////////////////////////////////////////////////////////////////////
+uint8_t acqTrigger(void) {
+  if (trigState != TRIG_IDLE) {
+    return 0;
+  }
+#ifdef WITH_PROFILES
+  if (acqProf->decimate) {
+    return 0;
+  }
+#endif
+  TACCTL0 = 0;                            // No timer starts during the burst
+  SD16CCTL0 &= ~(SD16SC | SD16IFG);       // Abort a running conversion
+#ifdef WITH_SCAN
+  scanCh = 0;
+  scanSelect(0);
+#endif
+  trigSum = 0;
+  trigCount = TRIG_BURST;
+  trigState = TRIG_RUN;
+  SD16CCTL0 &= ~SD16SNGL;                 // Continuous until the last result
+  SD16CCTL0 |= SD16SC;
+  return 1;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief The result of the last acqWait()/acqWaitScan() is the mean of
+///        a triggered burst. Taken together with the result, so a burst
+///        that ends later does not mark a paced sample.
+///
+//////////////////////////////////////////////////////////////////////////////
+uint8_t acqTriggered(void) {
+  return trigTaken;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief The triggered result is published: accept the next trigger and
+///        go on with the timer paced conversions one period from now.
+///
+//////////////////////////////////////////////////////////////////////////////
+void acqTriggerDone(void) {
+  if (trigState == TRIG_DONE) {
+    trigState = TRIG_IDLE;
+#ifdef WITH_PROFILES
+    if (acqProf->decimate) {
+      return;                             // Aborted by a continuous profile
+    }
+#endif
+    TACCR0 = TAR + ACQ_PERIOD;
+    TACCTL0 = CCIE;
+  }
+}
+#endif
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Sleep in LPM0 until the next conversion result (or scan) is
+///        available. GIE and LPM0 are set with the same instruction, so a
+///        wake-up between the check and the sleep cannot get lost.
+///        Returns with interrupts disabled.
+///
+//////////////////////////////////////////////////////////////////////////////
+static void acqSleep(void) {
+#ifdef WITH_DUTY_STATS
+  uint16_t now;
+#endif
+
+  __disable_interrupt();
+  while (!acqReady) {
+#ifdef WITH_DUTY_STATS
+    now = TAR;
+    acqActiveTicks += (uint16_t)(now - acqStamp);
+    acqStamp = now;
+#endif
+    __bis_SR_register(LPM0_bits | GIE);   // CPU off, await ADC interrupt
+    __disable_interrupt();
+#ifdef WITH_DUTY_STATS
+    now = TAR;
+    acqSleepTicks += (uint16_t)(now - acqStamp);
+    acqStamp = now;
+#endif
+  }
+  acqReady = 0;
+#ifdef WITH_TRIGGER
+  trigTaken = trigState == TRIG_DONE;
+#endif
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Sleep in LPM0 until the next conversion result is available.
+///        With WITH_SCAN: channel 0 of the next scan.
+///
+/// @return uint16_t      Conversion result
+//////////////////////////////////////////////////////////////////////////////
+uint16_t acqWait(void) {
+  uint16_t sample;
+
+  acqSleep();
+#ifdef WITH_SCAN
+  sample = scanRaw[0];
+#else
+  sample = acqSample;
+#endif
+  __enable_interrupt();
+  return sample;
+}
+
+#ifdef WITH_SCAN
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Sleep in LPM0 until the next scan is complete.
+///
+/// @param raw        Out: SCAN_CHANNELS conversion results
+//////////////////////////////////////////////////////////////////////////////
+void acqWaitScan(uint16_t* raw) {
+  uint8_t ch;
+
+  acqSleep();
+  for (ch = 0; ch < SCAN_CHANNELS; ++ch) {
+    raw[ch] = scanRaw[ch];
+  }
+  __enable_interrupt();
+}
+#endif
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Timer_A CCR0: start the next conversion.
+///
+//////////////////////////////////////////////////////////////////////////////
+#pragma vector = TIMERA0_VECTOR
+__interrupt void TIMERA0_ISR(void)
+{
+  TACCR0 += ACQ_PERIOD;                   // Next compare, no drift
+  SD16CCTL0 |= SD16SC;                    // Start conversion
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief SD16: conversion done. Reading SD16MEM0 clears SD16IFG.
+///        WITH_SCAN: start the next channel, wake up after the last one.
+///
+//////////////////////////////////////////////////////////////////////////////
+#pragma vector = SD16_VECTOR
+__interrupt void SD16_ISR(void)
+{
+#ifdef WITH_TRIGGER
+  if (trigState == TRIG_RUN) {            // Triggered burst: mean of TRIG_BURST results
+    trigSum += SD16MEM0;
+    if (--trigCount) {
+      return;
+    }
+    SD16CCTL0 &= ~SD16SC;                 // Stop, back to single conversions
+    SD16CCTL0 |= SD16SNGL;
+#ifdef WITH_SCAN
+    scanRaw[0] = (uint16_t)((trigSum + (TRIG_BURST >> 1)) >> TRIG_BURST_SHIFT);
+#else
+    acqSample = (uint16_t)((trigSum + (TRIG_BURST >> 1)) >> TRIG_BURST_SHIFT);
+#endif
+    trigState = TRIG_DONE;
+    acqReady = 1;
+    STATS_CONVERSION();                   // Stamp for the publish latency
+    __bic_SR_register_on_exit(LPM0_bits); // Wake up main loop
+    return;
+  }
+#endif
+#ifdef WITH_PROFILES
+  const AcqProfile* prof = acqProf;
+
+  if (prof->decimate) {                   // Continuous profile: CIC decimator
+    uint32_t y;
+
+    cicInt1 += SD16MEM0;
+    if (prof->order == 2) {
+      cicInt2 += cicInt1;
+    }
+    if (--cicCount) {
+      return;
+    }
+    cicCount = prof->decimate;
+    if (prof->order == 2) {
+      y = cicInt2 - cicComb2;
+      cicComb2 = cicInt2;
+    } else {
+      y = cicInt1;
+    }
+    y -= cicComb1;
+    cicComb1 += y;                        // = c1 (order 2) or i1 (order 1)
+    if (cicSkip) {
+      cicSkip--;
+      return;
+    }
+    y = (y + prof->round) >> prof->shift; // No 32 bit shift for the constant
+#ifdef WITH_SCAN
+    scanRaw[0] = (uint16_t)y;
+#else
+    acqSample = (uint16_t)y;
+#endif
+    acqReady = 1;
+    STATS_CONVERSION();                   // Stamp for the publish latency
+    __bic_SR_register_on_exit(LPM0_bits); // Wake up main loop
+    return;
+  }
+#endif
+#ifdef WITH_SCAN
+  uint8_t ch = scanCh;
+
+  scanRaw[ch] = SD16MEM0;
+  STATS_CONVERSION();                     // Stamp for the publish latency
+  if (++ch < SCAN_CHANNELS) {
+    scanSelect(ch);
+    SD16CCTL0 |= SD16SC;                  // Next channel at once
+  } else {
+    ch = 0;
+    scanSelect(0);                        // Ready for the next timer start
+    acqReady = 1;
+    __bic_SR_register_on_exit(LPM0_bits); // Wake up main loop
+  }
+  scanCh = ch;
+#else
+  acqSample = SD16MEM0;
+  acqReady = 1;
+  STATS_CONVERSION();                     // Stamp for the publish latency
+  __bic_SR_register_on_exit(LPM0_bits);   // Wake up main loop
+#endif
+}
@@ -0,0 +1,108 @@
+#ifndef _SD16_ACQ_H_
+#define _SD16_ACQ_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif //__cplusplus
+
+#include <stdint.h>
+
+//////////////////////////////////////////////////////////////////////////////
+/// Global definitions
+//////////////////////////////////////////////////////////////////////////////
+
+#define WITH_LPM                            // Timer paced conversions, LPM0 in between
+#define WITH_DUTY_STATS                     // Count active and sleep timer ticks
+//#define WITH_SCAN                         // Convert all channels of scanTable per period (see sd16-acq.c),
+                                            // ~ 75 bytes more RAM: does not fit into the MSP430F2013
+//#define WITH_PROFILES                     // Acquisition profiles selectable by the master (see sd16-acq.c),
+                                            // ~ 22 bytes more RAM
+//#define WITH_TRIGGER                      // Conversion burst on request of the master (I2C_CFG_TRIGGER, see sd16-acq.c),
+                                            // ~ 6 bytes more RAM
+
+#define ACQ_SMCLK_HZ     1000000UL          // SMCLK (DCO calibrated to 1 MHz)
+#define ACQ_TIMER_HZ     (ACQ_SMCLK_HZ / 8) // Timer_A clock: SMCLK / 8
+#ifndef ACQ_SAMPLE_RATE
+#define ACQ_SAMPLE_RATE  100                // Conversions per second
+#endif
+#define ACQ_PERIOD       (ACQ_TIMER_HZ / ACQ_SAMPLE_RATE)   // Timer ticks
+
+// A single conversion (OSR 256, interrupt on the 4th sample) takes ~1 ms.
+// The period has to fit into the 16 bit timer.
+#if (ACQ_SAMPLE_RATE < 2) || (ACQ_SAMPLE_RATE > 500)
+#error ACQ_SAMPLE_RATE has to be between 2 and 500
+#endif
+
+#ifdef WITH_SCAN
+#define SCAN_CHANNELS    4                  // Entries of scanTable (sd16-acq.c)
+#ifndef SCAN_WINDOW
+#define SCAN_WINDOW      5                  // Median window of channels 1 .. (channel 0: MEDIAN_WINDOW)
+#endif
+#else
+#define SCAN_CHANNELS    1                  // The former single input A1
+#endif
+#define SCAN_SIZE        (2 + 2 * SCAN_CHANNELS)  // Channel block: COUNT + one value per channel
+
+#ifdef WITH_PROFILES                        // Samples per second at SMCLK 1 MHz
+#define ACQ_PROFILE_NORMAL 0                // Timer paced single conversions, OSR 256: ACQ_SAMPLE_RATE
+#define ACQ_PROFILE_FAST   1                // Continuous OSR 256, boxcar of 4: 976.6
+#define ACQ_PROFILE_SMOOTH 2                // Continuous OSR 512, boxcar of 16: 122.1
+#define ACQ_PROFILE_SLOW   3                // Continuous OSR 1024, 2nd order CIC of 64: 15.3
+#define ACQ_PROFILES       4
+#ifndef WITH_LPM
+#error WITH_PROFILES needs the interrupt driven acquisition (WITH_LPM)
+#endif
+#endif
+
+#ifdef WITH_TRIGGER
+#ifndef TRIG_BURST_SHIFT
+#define TRIG_BURST_SHIFT 2                  // log2 of the conversions per trigger, averaged
+#endif
+#define TRIG_BURST       (1 << TRIG_BURST_SHIFT)
+#if TRIG_BURST_SHIFT > 6
+#error TRIG_BURST_SHIFT has to be 0 .. 6
+#endif
+#ifndef WITH_LPM
+#error WITH_TRIGGER needs the interrupt driven acquisition (WITH_LPM)
+#endif
+#endif
+
+//////////////////////////////////////////////////////////////////////////////
+/// Global variables
+//////////////////////////////////////////////////////////////////////////////
+
+#ifdef WITH_DUTY_STATS
+extern volatile uint32_t acqActiveTicks;    // Timer ticks with CPU on (main loop)
+extern volatile uint32_t acqSleepTicks;     // Timer ticks in LPM0 (incl. ISRs)
+#endif
+#ifdef WITH_PROFILES
+extern volatile uint8_t acqProfileReg;      // I2C_REG_PROFILE: profile requested by the master
+#endif
+
+//////////////////////////////////////////////////////////////////////////////
+/// Forward declaration(s)
+//////////////////////////////////////////////////////////////////////////////
+
+void sd16Setup(void);
+uint16_t sd16Convert(void);
+void acqStart(void);
+uint16_t acqWait(void);
+#ifdef WITH_SCAN
+void sd16Scan(uint16_t* raw);
+void acqWaitScan(uint16_t* raw);
+#endif
+#ifdef WITH_PROFILES
+uint8_t acqSetProfile(uint8_t profile);
+uint8_t acqProfile(void);
+#endif
+#ifdef WITH_TRIGGER
+uint8_t acqTrigger(void);
+uint8_t acqTriggered(void);
+void acqTriggerDone(void);
+#endif
+
+#ifdef __cplusplus
+}
+#endif //__cplusplus
+
+#endif
@@ -0,0 +1,253 @@
+//////////////////////////////////////////////////////////////////////////////
+/// @file slave-loop.h
+/// @brief Main loop of the slave: filter the conversion results, take the
+///        requests of the master over and publish the register map.
+///
+///        slaveLoopInit() fills the filters and starts the acquisition,
+///        slaveStep() is one pass of the loop: wait for the next result
+///        (scan), run the median filters, serve the CONFIG requests and
+///        publish a snapshot. src/main.c calls it forever, the benchmarks
+///        of the native env (sim/bench-*.cpp) call it whenever the loop is
+///        released from LPM0, so they measure the firmware as it is.
+///
+///        Header only with static inline functions: slaveStep() has a
+///        single call site in src/main.c and inlines into main(), its
+///        state lives in the frame of main() as before (the RAM budget of
+///        the MSP430F2013 is in the README).
+///
+///        The native env charges the run time of the loop at the
+///        SLAVE_STEP_TRACE() points (cycle model of sim/mcu-model.h).
+///
+//////////////////////////////////////////////////////////////////////////////
+
+#ifndef _SLAVE_LOOP_H_
+#define _SLAVE_LOOP_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif //__cplusplus
+
+#include <stdint.h>
+#include <msp430.h>
+#include "calibration.h"
+#include "info-flash.h"
+#include "msp430-i2c.h"
+#include "running-median.h"
+#include "running-stats.h"
+#include "sample-history.h"
+#include "sd16-acq.h"
+#include "slave-stats.h"
+
+//////////////////////////////////////////////////////////////////////////////
+/// Global definitions
+//////////////////////////////////////////////////////////////////////////////
+
+#ifdef WITH_SCAN                            // Window storage of all channel filters
+#define MEDIAN_VALUES (MEDIAN_WINDOW + (SCAN_CHANNELS - 1) * SCAN_WINDOW)
+#else
+#define MEDIAN_VALUES MEDIAN_WINDOW
+#endif
+
+#define SLAVE_TRACE_SAMPLE  0               // Medians of the sample done
+#define SLAVE_TRACE_WINDOW  1               // Statistics window closed (WITH_AGG)
+#define SLAVE_TRACE_COMMIT  2               // Snapshot complete, before commitTxData()
+
+#ifndef SLAVE_STEP_TRACE
+#define SLAVE_STEP_TRACE(point)             // Hook of the native env (cycle model)
+#endif
+
+#ifdef WITH_PROFILES                        // Median window of channel 0 per ACQ_PROFILE_x (<= MEDIAN_WINDOW)
+static const uint8_t profileWindow[ACQ_PROFILES] = {MEDIAN_WINDOW, 1, 3, 5};
+#endif
+
+typedef struct SlaveLoopStruct {
+  uint16_t minVal;
+  uint16_t maxVal;
+  uint16_t sampleCount;                     // Sequence number of the median
+  uint16_t medianValues[MEDIAN_VALUES];     // Sliding windows for which
+  uint8_t medianSlots[MEDIAN_VALUES];       // the medians are to be found
+  RunningMedian filter[SCAN_CHANNELS];      // One filter per channel
+  uint16_t scan[SCAN_CHANNELS];             // Conversion results, then medians
+#ifdef WITH_AGG
+  RunningStats agg;                         // Running window
+  AggResult aggResult;                      // Last closed window
+#endif
+} SlaveLoop;
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Fill the filters with initial conversions and start the timer
+///        paced acquisition. I2C and SD16_A are set up already.
+///
+/// @param sl         Loop state
+//////////////////////////////////////////////////////////////////////////////
+static inline void slaveLoopInit(SlaveLoop* sl) {
+#ifdef WITH_SCAN
+  uint8_t ch;
+#endif
+#ifdef WITH_AGG
+  AggResult none = {0};
+#endif
+
+  sl->minVal = 0xFFFF;
+  sl->maxVal = 0;
+  sl->sampleCount = 0;
+#ifdef WITH_SCAN
+  sd16Scan(sl->scan);                     // Initial values of all filters
+  medianInit(&sl->filter[0], sl->medianValues, sl->medianSlots, MEDIAN_WINDOW, sl->scan[0]);
+  for (ch = 1; ch < SCAN_CHANNELS; ++ch) {
+    medianInit(&sl->filter[ch], sl->medianValues + MEDIAN_WINDOW + (ch - 1) * SCAN_WINDOW,
+               sl->medianSlots + MEDIAN_WINDOW + (ch - 1) * SCAN_WINDOW, SCAN_WINDOW, sl->scan[ch]);
+  }
+#else
+  medianInit(&sl->filter[0], sl->medianValues, sl->medianSlots, MEDIAN_WINDOW, sd16Convert());
+#endif
+#ifdef WITH_AGG
+  runStatsReset(&sl->agg);
+  sl->aggResult = none;                   // Nothing closed yet
+#endif
+#ifdef WITH_LPM
+  acqStart();                             // ACQ_SAMPLE_RATE conversions per second
+#endif
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief One pass of the main loop: the next sample from conversion to
+///        the published snapshot.
+///
+/// @param sl         Loop state
+/// @return uint16_t  Published VALUE
+//////////////////////////////////////////////////////////////////////////////
+static inline uint16_t slaveStep(SlaveLoop* sl) {
+  uint16_t median;
+  uint8_t addr;
+  uint8_t ch;
+  volatile uint8_t* tx;
+#ifdef WITH_TRIGGER
+  uint8_t triggered;                      // scan[0] is the mean of a triggered burst
+  uint16_t raw;
+#endif
+#ifdef WITH_AGG
+  uint8_t closeAgg;                       // I2C_CFG_CLOSE_AGG of this sample
+#endif
+
+#if defined(WITH_SCAN) && defined(WITH_LPM)
+  acqWaitScan(sl->scan);                  // Sleeps in LPM0
+#elif defined(WITH_SCAN)
+  sd16Scan(sl->scan);
+#elif defined(WITH_LPM)
+  sl->scan[0] = acqWait();                // Sleeps in LPM0
+#else
+  sl->scan[0] = sd16Convert();
+#endif
+#ifdef WITH_TRIGGER
+  triggered = acqTriggered();
+  raw = sl->scan[0];
+#endif
+  for (ch = 0; ch < SCAN_CHANNELS; ++ch) {
+    sl->scan[ch] = medianPush(&sl->filter[ch], sl->scan[ch]);
+  }
+#ifdef WITH_TRIGGER
+  if (triggered) {
+    sl->scan[0] = raw;                    // As it is: the median lags MEDIAN_WINDOW / 2 samples
+  }
+#endif
+  median = sl->scan[0];
+  sl->sampleCount++;
+  SLAVE_STEP_TRACE(SLAVE_TRACE_SAMPLE);
+#ifdef WITH_HISTORY
+  histPush(sl->sampleCount, median);      // Every median, drained by the master
+#endif
+  if (I2C_CTRL(I2C_REG_CONFIG) & I2C_CFG_RESET_MINMAX) {   // Master request
+    I2C_CTRL(I2C_REG_CONFIG) &= ~I2C_CFG_RESET_MINMAX;
+    sl->minVal = 0xFFFF;
+    sl->maxVal = 0;
+  }
+  if (I2C_CTRL(I2C_REG_CONFIG) & I2C_CFG_SAVE_ADDR) {      // Master request
+    I2C_CTRL(I2C_REG_CONFIG) &= ~I2C_CFG_SAVE_ADDR;
+    addr = I2C_CTRL(I2C_REG_ADDR);
+    if (infoSetSlaveAddr(addr)) {         // Erase + write, SCL stretched meanwhile
+      i2cSetAddress(addr);
+    } else {
+      I2C_CTRL(I2C_REG_ADDR) = i2cGetAddress();   // Invalid: keep the old one
+    }
+  }
+#ifdef WITH_CAL
+  if (I2C_CTRL(I2C_REG_CONFIG) & I2C_CFG_SAVE_CAL) {       // Master request
+    I2C_CTRL(I2C_REG_CONFIG) &= ~I2C_CFG_SAVE_CAL;
+    calTakeOver();                        // Erase + write, SCL stretched meanwhile
+  }
+#endif
+#ifdef WITH_PROFILES
+  if (acqProfileReg != acqProfile()) {    // Master request
+    if (acqSetProfile(acqProfileReg)) {   // Restart the filter of channel 0 at the current median
+      medianInit(&sl->filter[0], sl->medianValues, sl->medianSlots, profileWindow[acqProfile()], median);
+    }
+    acqProfileReg = acqProfile();         // Invalid: keep the old one
+  }
+#endif
+#ifdef WITH_AGG
+  closeAgg = I2C_CTRL(I2C_REG_CONFIG) & I2C_CFG_CLOSE_AGG;   // Master request
+  I2C_CTRL(I2C_REG_CONFIG) &= ~closeAgg;  // Taken, also when the window is full anyway
+  if (runStatsPush(&sl->agg, median) >= AGG_LIMIT(aggWindowReg) || closeAgg) {
+    runStatsResult(&sl->agg, &sl->aggResult);   // The divisions: once per window
+    sl->aggResult.count = sl->sampleCount;
+    runStatsReset(&sl->agg);
+    SLAVE_STEP_TRACE(SLAVE_TRACE_WINDOW);
+  }
+#endif
+  if (median < sl->minVal) {
+    sl->minVal = median;
+  }
+  if (median > sl->maxVal) {
+    sl->maxVal = median;
+  }
+  tx = beginTxData();                     // Update I2C data registers after
+  putTxData16(tx, I2C_REG_VALUE, median); // every conversion (lock-free)
+  putTxData16(tx, I2C_REG_MIN, sl->minVal);
+  putTxData16(tx, I2C_REG_MAX, sl->maxVal);
+  putTxData16(tx, I2C_REG_COUNT, sl->sampleCount);
+#ifdef WITH_TRIGGER
+  tx[I2C_REG_STATUS] = I2C_STATUS_RUNNING |     // I2C_STATUS_BUSY is set by the ISR
+                       (triggered ? I2C_STATUS_TRIGGERED : 0);
+#else
+  tx[I2C_REG_STATUS] = I2C_STATUS_RUNNING;
+#endif
+#ifdef WITH_SCAN
+  putTxData16(tx, I2C_SCAN_DATA(I2C_REG_SCAN), sl->sampleCount);
+  for (ch = 0; ch < SCAN_CHANNELS; ++ch) {     // Same snapshot as VALUE
+    putTxData16(tx, I2C_SCAN_DATA(I2C_REG_SCAN + 2 + 2 * ch), sl->scan[ch]);
+  }
+#endif
+#ifdef WITH_CAL
+  putTxData16(tx, I2C_UNITS_DATA(I2C_REG_UNITS), sl->sampleCount);
+  for (ch = 0; ch < SCAN_CHANNELS; ++ch) {     // ~ 200 cycles per channel
+    putTxData16(tx, I2C_UNITS_DATA(I2C_REG_UNITS + 2 + 2 * ch), (uint16_t)calApply(ch, sl->scan[ch]));
+  }
+#endif
+#ifdef WITH_AGG
+  putTxData16(tx, I2C_AGG_DATA(I2C_REG_AGG), sl->aggResult.count);
+  putTxData16(tx, I2C_AGG_DATA(I2C_REG_AGG + 2), sl->aggResult.n);
+  putTxData16(tx, I2C_AGG_DATA(I2C_REG_AGG + 4), sl->aggResult.min);
+  putTxData16(tx, I2C_AGG_DATA(I2C_REG_AGG + 6), sl->aggResult.max);
+  putTxData16(tx, I2C_AGG_DATA(I2C_REG_AGG + 8), sl->aggResult.mean >> 16);
+  putTxData16(tx, I2C_AGG_DATA(I2C_REG_AGG + 10), sl->aggResult.mean);
+  putTxData16(tx, I2C_AGG_DATA(I2C_REG_AGG + 12), sl->aggResult.var >> 32);
+  putTxData16(tx, I2C_AGG_DATA(I2C_REG_AGG + 14), sl->aggResult.var >> 16);
+  putTxData16(tx, I2C_AGG_DATA(I2C_REG_AGG + 16), sl->aggResult.var);
+#endif
+  SLAVE_STEP_TRACE(SLAVE_TRACE_COMMIT);
+  commitTxData();
+  STATS_PUBLISHED();                      // Conversion -> commit latency
+#ifdef WITH_TRIGGER
+  if (triggered) {
+    acqTriggerDone();                     // Next trigger, timer paced again
+  }
+#endif
+  return median;
+}
+
+#ifdef __cplusplus
+}
+#endif //__cplusplus
+
+#endif
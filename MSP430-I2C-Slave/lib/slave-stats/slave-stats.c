@@ -0,0 +1,134 @@
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Hot-path counters of the slave, read by the master through the
+///        register window I2C_REG_STATS (see msp430-i2c.h).
+///
+///        COUNTERS (SlaveStats, big endian on the bus)
+///
+///        isrState[9]   USI ISR runs per state (index: state / 2)
+///        nacks         Address bytes for other slaves (NACKed)
+///        aborts        START while a transfer was running, i.e. not in
+///                      I2C_IDLE, I2C_PREP_START or I2C_RX_CHECK (a write
+///                      may end there)
+///        conversions   SD16 results
+///        latencyMax    Worst time from the end of a conversion (SD16 ISR)
+///                      to the commit of its median, Timer_A ticks
+///                      (ACQ_TIMER_HZ). Timer_A only runs with WITH_LPM.
+///
+///        The counters are 16 bit and wrap around, the master works with
+///        differences. A write to I2C_REG_STATS clears them.
+///
+///        COST
+///
+///        Counting is done with macros (slave-stats.h) that are empty
+///        without WITH_STATS: no code, no RAM. With WITH_STATS the USI ISR
+///        needs ~ 7 cycles more per run (add #1 to the state counter,
+///        i2cState is even, so it is the byte offset already) and ~ 15 on a
+///        START (abort check), the SD16 ISR ~ 10 (counter, TAR).
+///        RAM: STATS_SIZE + 4 bytes. Off by default: the default
+///        MSP430F2013 build has about 66 of its 128 bytes in static data
+///        and main() alone needs about 41 bytes of stack (median window
+///        and slots, filter), the USI ISR and the calls come on top. On
+///        with -DWITH_STATS in the G2553 and the native envs.
+///
+///        READING
+///
+///        The ISR reads the window byte by byte, a counter may change
+///        between its two bytes. Reading the high byte latches the low
+///        byte, like the 16 bit timer registers of other MCUs, so reads
+///        have to start at an even offset. A backend that stages the next
+///        TX byte ahead (the fast USI ISR stages the 1st one before the
+///        address has matched) uses statsPeek() and statsTake(): the
+///        latch only moves when the high byte is sent.
+///
+//////////////////////////////////////////////////////////////////////////////
+
+#include <msp430.h>
+#include "slave-stats.h"
+
+#ifdef WITH_STATS
+
+//////////////////////////////////////////////////////////////////////////////
+/// Module global variables
+//////////////////////////////////////////////////////////////////////////////
+
+volatile SlaveStats slaveStats;
+volatile uint16_t statsConvStamp;
+static uint8_t statsLatch;                  // Low byte of the counter being read
+static uint8_t statsStaged;                 // Low byte that goes with a peeked high byte
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Read a byte of the counter window (ISR context)
+///
+/// @param offset     Byte offset, 0 .. STATS_SIZE - 1 (big endian counters)
+/// @return uint8_t   Byte
+//////////////////////////////////////////////////////////////////////////////
+uint8_t statsRead(uint8_t offset) {
+  uint16_t val;
+
+  if (offset & 0x01) {
+    return statsLatch;
+  }
+  val = ((volatile uint16_t*)&slaveStats)[offset >> 1];
+  statsLatch = val & 0xFF;
+  return val >> 8;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Byte of the counter window for a TX byte staged ahead (ISR
+///        context). Unlike statsRead() it leaves the latch alone: the low
+///        byte of an even offset only becomes the latch with statsTake(),
+///        once the high byte really goes out. A byte staged for a frame
+///        to another node or cut by a NACK changes nothing.
+///
+/// @param offset     Byte offset, 0 .. STATS_SIZE - 1 (big endian counters)
+/// @return uint8_t   Byte
+//////////////////////////////////////////////////////////////////////////////
+uint8_t statsPeek(uint8_t offset) {
+  uint16_t val;
+
+  if (offset & 0x01) {
+    return statsLatch;
+  }
+  val = ((volatile uint16_t*)&slaveStats)[offset >> 1];
+  statsStaged = val & 0xFF;
+  return val >> 8;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief The byte of statsPeek() is sent: an even offset latches the low
+///        byte of the same counter value (ISR context)
+///
+/// @param offset     Byte offset
+//////////////////////////////////////////////////////////////////////////////
+void statsTake(uint8_t offset) {
+  if (!(offset & 0x01)) {
+    statsLatch = statsStaged;
+  }
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Clear all counters (master write to I2C_REG_STATS)
+///
+//////////////////////////////////////////////////////////////////////////////
+void statsClear(void) {
+  uint8_t i;
+
+  for (i = 0; i < STATS_SIZE / 2; ++i) {
+    ((volatile uint16_t*)&slaveStats)[i] = 0;
+  }
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief A median has been committed: update the worst latency since
+///        the end of its conversion (main loop).
+///
+//////////////////////////////////////////////////////////////////////////////
+void statsPublished(void) {
+  uint16_t latency = TAR - statsConvStamp;
+
+  if (latency > slaveStats.latencyMax) {
+    slaveStats.latencyMax = latency;
+  }
+}
+
+#endif
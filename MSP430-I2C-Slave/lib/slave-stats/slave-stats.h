@@ -0,0 +1,64 @@
+#ifndef _SLAVE_STATS_H_
+#define _SLAVE_STATS_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif //__cplusplus
+
+#include <stdint.h>
+
+//////////////////////////////////////////////////////////////////////////////
+/// Global definitions
+//////////////////////////////////////////////////////////////////////////////
+
+//#define WITH_STATS                        // Hot-path counters at I2C_REG_STATS (see slave-stats.c),
+                                            // 30 bytes of RAM: not on the MSP430F2013 (see the RAM budget there)
+
+#define STATS_STATES      9                 // USI ISR states I2C_IDLE .. I2C_PREP_START
+#define STATS_SIZE        (2 * (STATS_STATES + 4))  // Bytes of the register window
+
+typedef struct SlaveStatsStruct {           // 16 bit counters, they wrap around
+  uint16_t isrState[STATS_STATES];          // USI ISR runs per state (index: state / 2)
+  uint16_t nacks;                           // Address bytes NACKed (other slaves)
+  uint16_t aborts;                          // START in the middle of a transfer
+  uint16_t conversions;                     // SD16 results
+  uint16_t latencyMax;                      // Conversion done -> published, Timer_A ticks
+} SlaveStats;
+
+// Counting: the macros are empty without WITH_STATS
+#ifdef WITH_STATS
+#define STATS_INC(counter)    (slaveStats.counter++)
+#define STATS_STATE(state)    (slaveStats.isrState[(state) >> 1]++)
+#define STATS_CONVERSION()    do { slaveStats.conversions++; statsConvStamp = TAR; } while (0)
+#define STATS_PUBLISHED()     statsPublished()
+#else
+#define STATS_INC(counter)
+#define STATS_STATE(state)
+#define STATS_CONVERSION()
+#define STATS_PUBLISHED()
+#endif
+
+//////////////////////////////////////////////////////////////////////////////
+/// Global variables
+//////////////////////////////////////////////////////////////////////////////
+
+#ifdef WITH_STATS
+extern volatile SlaveStats slaveStats;
+extern volatile uint16_t statsConvStamp;    // TAR at the end of the last conversion
+#endif
+
+//////////////////////////////////////////////////////////////////////////////
+/// Forward declaration(s)
+//////////////////////////////////////////////////////////////////////////////
+
+uint8_t statsRead(uint8_t offset);
+uint8_t statsPeek(uint8_t offset);
+void statsTake(uint8_t offset);
+void statsClear(void);
+void statsPublished(void);
+
+#ifdef __cplusplus
+}
+#endif //__cplusplus
+
+#endif
@@ -0,0 +1,59 @@
+#ifndef _SMBUS_PEC_H_
+#define _SMBUS_PEC_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif //__cplusplus
+
+#include <stdint.h>
+
+//////////////////////////////////////////////////////////////////////////////
+/// Global definitions
+//////////////////////////////////////////////////////////////////////////////
+
+#ifndef WITH_PEC
+#define WITH_PEC                            // SMBus PEC on reads (see msp430-i2c.c)
+#endif
+
+// CRC-8 implementations (estimates for the MSP430 at -Os, see smbus-pec.c)
+#define PEC_BITWISE       0                 // No table, ~ 70 cycles/byte
+#define PEC_NIBBLE        1                 // 16 byte table, ~ 35 cycles/byte
+#define PEC_TABLE         2                 // 256 byte table, ~ 5 cycles/byte (inline)
+
+#ifndef PEC_IMPL
+#define PEC_IMPL          PEC_TABLE         // e.g. -DPEC_IMPL=PEC_NIBBLE for the F2013
+#endif
+
+#define PEC_POLY          0x07              // x^8 + x^2 + x + 1, init 0
+
+//////////////////////////////////////////////////////////////////////////////
+/// Global variables
+//////////////////////////////////////////////////////////////////////////////
+
+#if (PEC_IMPL == PEC_TABLE) || defined(PEC_ALL_IMPL)
+extern const uint8_t pecTable[256];
+#endif
+
+//////////////////////////////////////////////////////////////////////////////
+/// Forward declaration(s)
+//////////////////////////////////////////////////////////////////////////////
+
+uint8_t pecBitwise(uint8_t crc, uint8_t data);
+uint8_t pecNibble(uint8_t crc, uint8_t data);
+
+// pecUpdate(crc, data): CRC after one more byte, with the selected implementation
+#if PEC_IMPL == PEC_TABLE
+#define pecUpdate(crc, data)  pecTable[(uint8_t)((crc) ^ (data))]
+#elif PEC_IMPL == PEC_NIBBLE
+#define pecUpdate(crc, data)  pecNibble(crc, data)
+#elif PEC_IMPL == PEC_BITWISE
+#define pecUpdate(crc, data)  pecBitwise(crc, data)
+#else
+#error PEC_IMPL has to be PEC_BITWISE, PEC_NIBBLE or PEC_TABLE
+#endif
+
+#ifdef __cplusplus
+}
+#endif //__cplusplus
+
+#endif
@@ -0,0 +1,277 @@
+//////////////////////////////////////////////////////////////////////////////
+/// @file arduino-mock.cpp
+/// @brief Arduino core and Wire stand-ins driven by the virtual bus.
+///
+//////////////////////////////////////////////////////////////////////////////
+
+#include <stdarg.h>
+
+#include <Arduino.h>
+#include <Wire.h>
+#include "virtual-bus.h"
+
+//////////////////////////////////////////////////////////////////////////////
+/// Module global variables
+//////////////////////////////////////////////////////////////////////////////
+
+HardwareSerial Serial;
+SimRp2040 rp2040;
+TwoWire Wire;
+
+bool simDelayEnabled = true;
+bool simSerialEcho = false;
+void (*simSerialTap)(const uint8_t* data, size_t len) = NULL;
+
+static SimTime serialDrainedAt = 0;         // TX FIFO is empty at this time
+static char serialRx[SIM_SERIAL_RX];        // Injected input
+static uint16_t serialRxLen = 0;
+static uint16_t serialRxIdx = 0;
+static uint8_t pinLevel[SIM_PINS];          // Input levels driven from outside, 0: HIGH (pull-up)
+static void (*pinIsr[SIM_PINS])(void);      // Pin interrupt handlers
+static int irqMode[SIM_PINS];
+
+//////////////////////////////////////////////////////////////////////////////
+/// Serial port
+//////////////////////////////////////////////////////////////////////////////
+
+void HardwareSerial::begin(unsigned long baud) {
+  baudRate = baud;
+  bytesWritten = 0;
+  bytesWhileBlocked = 0;
+  serialDrainedAt = simNow();
+}
+
+static SimTime byteTime(unsigned long baud) {
+  return SIM_PS_PER_SEC * 10 / baud;        // 8N1 = 10 bit per byte
+}
+
+int HardwareSerial::availableForWrite(void) {
+  SimTime now = simNow();
+  if (serialDrainedAt <= now) {
+    return SIM_SERIAL_FIFO;
+  }
+  SimTime bt = byteTime(baudRate);
+  uint32_t queued = (uint32_t)((serialDrainedAt - now + bt - 1) / bt);
+  return (queued >= SIM_SERIAL_FIFO) ? 0 : SIM_SERIAL_FIFO - queued;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Queue bytes into the TX FIFO. Blocks (advances the virtual time)
+///        while the FIFO is full, like the real cores do.
+///
+//////////////////////////////////////////////////////////////////////////////
+size_t HardwareSerial::write(const uint8_t* data, size_t len) {
+  SimTime bt = byteTime(baudRate);
+  for (size_t i = 0; i < len; ++i) {
+    if (!availableForWrite()) {
+      simWait(serialDrainedAt - simNow() - (SIM_SERIAL_FIFO - 1) * bt);
+      bytesWhileBlocked++;
+    }
+    if (serialDrainedAt < simNow()) {
+      serialDrainedAt = simNow();
+    }
+    serialDrainedAt += bt;
+  }
+  bytesWritten += len;
+  if (simSerialEcho) {
+    fwrite(data, 1, len, stdout);
+  }
+  if (simSerialTap) {
+    simSerialTap(data, len);
+  }
+  return len;
+}
+
+int HardwareSerial::available(void) {
+  return serialRxLen - serialRxIdx;
+}
+
+int HardwareSerial::read(void) {
+  return (serialRxIdx < serialRxLen) ? (uint8_t)serialRx[serialRxIdx++] : -1;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Characters "received" by the serial port, appended to the
+///        unread input.
+///
+//////////////////////////////////////////////////////////////////////////////
+void simSerialInput(const char* text) {
+  if (serialRxIdx == serialRxLen) {
+    serialRxIdx = serialRxLen = 0;
+  }
+  while (*text && serialRxLen < SIM_SERIAL_RX) {
+    serialRx[serialRxLen++] = *text++;
+  }
+}
+
+size_t HardwareSerial::printf_(const char* fmt, ...) {
+  char text[32];
+  va_list args;
+  va_start(args, fmt);
+  vsnprintf(text, sizeof(text), fmt, args);
+  va_end(args);
+  return print(text);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// Time and pins
+//////////////////////////////////////////////////////////////////////////////
+
+void delay(unsigned long ms) {
+  if (simDelayEnabled) {
+    simWait((SimTime)ms * (SIM_PS_PER_SEC / 1000));
+  }
+}
+
+void delayMicroseconds(unsigned int us) {
+  simWait((SimTime)us * (SIM_PS_PER_SEC / 1000000));
+}
+
+unsigned long millis(void) {
+  simWait((SimTime)SIM_CLOCK_READ_US * (SIM_PS_PER_SEC / 1000000));
+  return (unsigned long)(simNow() / (SIM_PS_PER_SEC / 1000));
+}
+
+unsigned long micros(void) {
+  simWait((SimTime)SIM_CLOCK_READ_US * (SIM_PS_PER_SEC / 1000000));
+  return (unsigned long)(simNow() / (SIM_PS_PER_SEC / 1000000));
+}
+
+void pinMode(uint8_t, uint8_t) {
+}
+
+void digitalWrite(uint8_t, uint8_t) {
+}
+
+int digitalRead(uint8_t pin) {
+  return pin < SIM_PINS && pinLevel[pin] ? LOW : HIGH;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Data-ready line of the USI slave: P2.6 open drain, low while
+///        driven.
+///
+//////////////////////////////////////////////////////////////////////////////
+static void slavePort(uint8_t p2dir, uint8_t p2out) {
+  simPinWrite(SIM_DRDY_PIN, (p2dir & BIT6) && !(p2out & BIT6) ? LOW : HIGH);
+}
+
+void attachInterrupt(uint8_t irq, void (*isr)(void), int mode) {
+  if (irq < SIM_PINS) {
+    pinIsr[irq] = isr;
+    irqMode[irq] = mode;
+    mcuPortHook = slavePort;
+  }
+}
+
+void detachInterrupt(uint8_t irq) {
+  if (irq < SIM_PINS) {
+    pinIsr[irq] = NULL;
+  }
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Drive an input pin from outside. An attached handler runs at
+///        once on a matching edge (the master CPU is not modelled).
+///
+//////////////////////////////////////////////////////////////////////////////
+void simPinWrite(uint8_t pin, uint8_t level) {
+  if (pin >= SIM_PINS || (pinLevel[pin] == 0) == (level == HIGH)) {
+    return;
+  }
+  pinLevel[pin] = level == HIGH ? 0 : 1;
+  int irq = digitalPinToInterrupt(pin);
+  if (irq != NOT_AN_INTERRUPT && pinIsr[irq] &&
+      (irqMode[irq] == CHANGE || irqMode[irq] == (level == HIGH ? RISING : FALLING))) {
+    pinIsr[irq]();
+  }
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// Wire
+//////////////////////////////////////////////////////////////////////////////
+
+void TwoWire::setClock(uint32_t hz) {
+  busSetClock(hz);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Master read transaction: START, address + R, quantity bytes,
+///        NACK on the last byte, STOP.
+///
+/// @return uint8_t   Number of bytes received
+//////////////////////////////////////////////////////////////////////////////
+uint8_t TwoWire::requestFrom(int address, int quantity, int sendStop) {
+  SimTime t0 = simNow();
+  if (quantity > SIM_WIRE_BUFFER) {
+    quantity = SIM_WIRE_BUFFER;
+  }
+  rxIdx = rxLen = 0;
+  busStart();
+  if (busWriteByte((uint8_t)((address << 1) | 0x01))) {
+    for (int i = 0; i < quantity; ++i) {
+      rxBuf[rxLen++] = busReadByte(i < quantity - 1);
+    }
+  }
+  if (sendStop) {
+    busStop();
+  }
+  busStats.transactions++;
+  if (rxLen != quantity) {
+    busStats.failures++;
+  }
+  busStats.busTime += simNow() - t0;
+  return rxLen;
+}
+
+void TwoWire::beginTransmission(int address) {
+  txAddr = (uint8_t)address;
+  txLen = 0;
+}
+
+size_t TwoWire::write(uint8_t data) {
+  if (txLen >= SIM_WIRE_BUFFER) {
+    return 0;
+  }
+  txBuf[txLen++] = data;
+  return 1;
+}
+
+size_t TwoWire::write(const uint8_t* data, size_t len) {
+  size_t n = 0;
+  while (n < len && write(data[n])) {
+    n++;
+  }
+  return n;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Master write transaction.
+///
+/// @param sendStop   false: keep the bus for a repeated START
+/// @return uint8_t   0: ok, 2: address NACK, 3: data NACK (Arduino codes)
+//////////////////////////////////////////////////////////////////////////////
+uint8_t TwoWire::endTransmission(bool sendStop) {
+  SimTime t0 = simNow();
+  uint8_t result = 0;
+  busStart();
+  if (!busWriteByte((uint8_t)(txAddr << 1))) {
+    result = 2;
+  } else {
+    for (uint8_t i = 0; i < txLen; ++i) {
+      if (!busWriteByte(txBuf[i])) {
+        result = 3;
+        break;
+      }
+    }
+  }
+  if (sendStop || result) {
+    busStop();
+  }
+  busStats.transactions++;
+  if (result) {
+    busStats.failures++;
+  }
+  busStats.busTime += simNow() - t0;
+  return result;
+}
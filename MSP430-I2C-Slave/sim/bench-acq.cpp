@@ -0,0 +1,84 @@
+//////////////////////////////////////////////////////////////////////////////
+/// @file bench-acq.cpp
+/// @brief Active vs. sleep time of the acquisition loop: polling
+///        (sd16Convert) compared with the timer paced LPM0 mode
+///        (acqStart/acqWait) of lib/sd16-acq.
+///
+///        The loop body is the one of src/main.c. The run time of the median
+///        and the publishing is charged with BENCH_PROCESS_CYCLES. The energy
+///        estimate only covers the CPU (MSP430F2013 datasheet, typical
+///        values at 1 MHz and 2.2 V); the SD16 and its reference are active
+///        in both modes for the time of a conversion.
+///
+//////////////////////////////////////////////////////////////////////////////
+
+#include <stdio.h>
+
+#include "msp430-i2c.h"
+#include "running-median.h"
+#include "sd16-acq.h"
+#include "virtual-bus.h"
+#include "bench.h"
+
+#define BENCH_PROCESS_CYCLES  250           // medianPush() + setTxData16()
+#define BENCH_I_ACTIVE_UA     220.0         // Active mode at 1 MHz
+#define BENCH_I_LPM0_UA       56.0          // LPM0 at 1 MHz
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Run the loop for a number of samples in one mode and print
+///        one result line.
+///
+//////////////////////////////////////////////////////////////////////////////
+static void runAcq(bool lpm, uint32_t samples) {
+  uint16_t values[MEDIAN_WINDOW];
+  uint8_t slots[MEDIAN_WINDOW];
+  RunningMedian filter;
+
+  simReset(1000000, 100000);
+  i2cSlaveSetup();
+  sd16Setup();
+  medianInit(&filter, values, slots, MEDIAN_WINDOW, sd16Convert());
+  if (lpm) {
+    acqStart();
+  }
+#ifdef WITH_DUTY_STATS
+  acqActiveTicks = acqSleepTicks = 0;
+#endif
+  mcuResetStats();
+  SimTime t0 = simNow();
+  for (uint32_t i = 0; i < samples; ++i) {
+    uint16_t median = medianPush(&filter, lpm ? acqWait() : sd16Convert());
+    simDelayCycles(BENCH_PROCESS_CYCLES);
+    setTxData16(median);
+  }
+
+  double total = (double)(simNow() - t0);
+  double isr = 0;
+  for (uint8_t irq = 0; irq < SIM_IRQ_NUM; ++irq) {
+    isr += (double)simCycles((uint32_t)mcuStats.isrCycles[irq]);
+  }
+  double active = total - (double)mcuStats.sleepTime + isr;
+  double duty = active / total;
+  double current = duty * BENCH_I_ACTIVE_UA + (1.0 - duty) * BENCH_I_LPM0_UA;
+  printf("%-8s | %8.1f | %6.2f %% | ", lpm ? "LPM0" : "polling",
+         samples / (total / SIM_PS_PER_SEC), 100.0 * duty);
+#ifdef WITH_DUTY_STATS
+  if (lpm) {
+    printf("%6.2f %%   | ", 100.0 * acqActiveTicks / (acqActiveTicks + acqSleepTicks));
+  } else {
+    printf("   -       | ");
+  }
+#else
+  printf("   -       | ");
+#endif
+  printf("%6.1f uA\n", current);
+}
+
+void benchAcq(uint32_t loops) {
+  printf("ACQ_SAMPLE_RATE = %u Hz, MEDIAN_WINDOW = %u, MCLK = 1 MHz\n",
+         (unsigned)ACQ_SAMPLE_RATE, (unsigned)MEDIAN_WINDOW);
+  printf("Mode     | sample/s | CPU duty | device duty | CPU current\n");
+  printf("         |          |  (sim)   | (TAR ticks) | (estimate)\n");
+  runAcq(false, loops);
+  runAcq(true, loops);
+}
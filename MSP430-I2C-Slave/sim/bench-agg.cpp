@@ -0,0 +1,233 @@
+//////////////////////////////////////////////////////////////////////////////
+/// @file bench-agg.cpp
+/// @brief Window statistics of the slave (lib/running-stats, WITH_AGG) vs.
+///        aggregates computed by the master from a poll of every sample.
+///
+///        1. runStatsPush()/runStatsResult() against an exact reference
+///           (128 bit integers) for windows of 1 .. AGG_MAX_SAMPLES samples
+///           of noise, full scale random values, ramps and constants.
+///        2. Host cycles per sample and per window, estimated MSP430 cycles
+///           (SIM_STEP_AGG_CYCLES, SIM_STEP_WINDOW_CYCLES of mcu-model.h).
+///        3. slaveStep() of src/main.c at 100 samples/s: the master
+///           either reads the register map after every sample and
+///           aggregates itself (poll), or reads the statistics block once
+///           per AGG_PERIOD and requests the next window (closeAggregate()).
+///           Bus transactions, bus time and USI ISR cycles of the slave per
+///           second; every block is checked against the published medians
+///           of its window (no gap, no overlap, exact statistics).
+///
+//////////////////////////////////////////////////////////////////////////////
+
+#include <math.h>
+#include <stdio.h>
+
+#include <Wire.h>
+#include "slaveProtocol.h"
+#include "msp430-i2c.h"
+#include "running-stats.h"
+#include "sd16-acq.h"
+#include "virtual-bus.h"
+#include "bench.h"
+
+#define BENCH_AGG_PERIOD_MS     2000        // Block read period of the master
+#define BENCH_VALUES            4096        // Samples per timing run
+
+#ifdef WITH_AGG
+
+static uint32_t rngState = 0x0F1E2D3C;      // State of nextRandom() (bench.h)
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Exact statistics of a window, rounded like runStatsResult()
+///
+//////////////////////////////////////////////////////////////////////////////
+static void reference(const uint16_t* x, uint32_t n, AggResult& res) {
+  unsigned __int128 s1 = 0;
+  unsigned __int128 s2 = 0;
+
+  res.n = (uint16_t)n;
+  res.min = 0xFFFF;
+  res.max = 0;
+  for (uint32_t i = 0; i < n; ++i) {
+    s1 += x[i];
+    s2 += (uint64_t)x[i] * x[i];
+    res.min = x[i] < res.min ? x[i] : res.min;
+    res.max = x[i] > res.max ? x[i] : res.max;
+  }
+  res.mean = (uint32_t)(((s1 << 16) + n / 2) / n);
+  if (n > 1) {                            // var * 2^16 = (n s2 - s1^2) 2^16 / (n (n - 1))
+    unsigned __int128 den = (unsigned __int128)n * (n - 1);
+    res.var = (uint64_t)((((n * s2 - s1 * s1) << 16) + den / 2) / den);
+  } else {
+    res.var = 0;
+  }
+}
+
+static uint16_t values[AGG_MAX_SAMPLES];
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Fill the window with one of the test signals
+///
+//////////////////////////////////////////////////////////////////////////////
+static void fill(uint8_t kind, uint32_t n) {
+  uint16_t base = (uint16_t)nextRandom(rngState);
+  for (uint32_t i = 0; i < n; ++i) {
+    switch (kind) {
+      case 0:  values[i] = 0x7400 + (nextRandom(rngState) & 0x3F); break;    // Noise
+      case 1:  values[i] = (uint16_t)nextRandom(rngState); break;             // Full scale
+      case 2:  values[i] = (uint16_t)(base + 7 * i); break;                   // Ramp (wraps)
+      default: values[i] = base; break;                                       // Constant
+    }
+  }
+  if (kind == 1 && n > 2) {
+    values[0] = 0xFFFF;                   // Extremes: largest deviations from ref
+    values[1] = 0;
+  }
+}
+
+static uint16_t published[65536];           // Median by sample counter
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Slave main loop at a SLAVE_TRACE_x point: note the median of
+///        the sample
+///
+//////////////////////////////////////////////////////////////////////////////
+static void onStep(uint8_t point) {
+  if (point == SLAVE_TRACE_SAMPLE) {
+    published[benchSlave.sampleCount] = benchSlave.scan[0];
+  }
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Run the slave for a number of samples, the master polls every
+///        sample or reads the statistics block. Prints one line.
+///
+//////////////////////////////////////////////////////////////////////////////
+static void runMaster(bool poll, uint32_t samples) {
+  uint32_t reads = 0;
+  uint32_t writes = 0;
+  uint32_t failed = 0;
+  uint32_t wrong = 0;
+  uint32_t windows = 0;
+  uint16_t lastEnd = 0;
+  SimTime busTime = 0;
+  double sum = 0;
+
+  simReset(1000000, 100000);
+  benchSlaveStart();
+  mcuStepHook = onStep;
+  Wire.begin();
+  mcuResetStats();
+  SimTime t0 = simNow();
+  SimTime nextRead = t0 + (SimTime)BENCH_AGG_PERIOD_MS * SIM_PS_PER_SEC / 1000;
+  for (uint32_t i = 0; i < samples; ++i) {
+    slaveStep(&benchSlave);
+    SimTime b0 = simNow();
+    if (poll) {                             // Register map, aggregate on the master
+      uint8_t regs[I2C_NUM_REGS];
+      reads++;
+      if (readRegisters(Wire, I2C_SLAVE_ADDRESS, I2C_REG_VALUE, regs, I2C_NUM_REGS) != I2C_NUM_REGS) {
+        failed++;
+      } else {
+        sum += decodeInt<uint16_t>(regs);
+      }
+    } else if (simNow() >= nextRead) {      // Statistics block, next window
+      NodeAggregate agg;
+      nextRead += (SimTime)BENCH_AGG_PERIOD_MS * SIM_PS_PER_SEC / 1000;
+      reads++;
+      writes++;
+      if (!readNodeAggregate(Wire, I2C_SLAVE_ADDRESS, agg) || !closeAggregate(Wire, I2C_SLAVE_ADDRESS)) {
+        failed++;
+      } else if (agg.n) {
+        AggResult ref;
+        reference(&published[(uint16_t)(agg.count - agg.n + 1)], agg.n, ref);
+        windows++;
+        if ((uint16_t)(agg.count - agg.n) != lastEnd || agg.min != ref.min || agg.max != ref.max ||
+            agg.mean != ref.mean || agg.var != ref.var) {
+          wrong++;
+        }
+        lastEnd = agg.count;
+      }
+    }
+    busTime += simNow() - b0;
+  }
+  mcuStepHook = NULL;
+  double secs = (double)(simNow() - t0) / SIM_PS_PER_SEC;
+  printf("%-12s | %7.2f | %8.2f | %9.0f | %12.0f | %7lu | %6lu | %lu\n",
+         poll ? "poll 10 ms" : "block 2 s", reads / secs, writes / secs,
+         (double)busTime * 1e6 / SIM_PS_PER_SEC / secs,
+         (double)mcuStats.isrCycles[SIM_IRQ_USI] / secs,
+         (unsigned long)windows, (unsigned long)failed, (unsigned long)wrong);
+  (void)sum;
+}
+#endif
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Window statistics benchmark
+///
+/// @param loops      Windows per signal of the check, samples of the bus runs
+//////////////////////////////////////////////////////////////////////////////
+void benchAgg(uint32_t loops) {
+#ifdef WITH_AGG
+  static const char* const kinds[] = {"noise", "full scale", "ramp", "constant"};
+  static const uint16_t sizes[] = {1, 2, 3, 11, 256, 1000, AGG_MAX_SAMPLES};
+
+  printf("Check vs. exact (128 bit), windows of 1 .. %u samples:\n", (unsigned)AGG_MAX_SAMPLES);
+  printf("Signal     | windows | mismatches\n");
+  for (uint8_t kind = 0; kind < 4; ++kind) {
+    uint32_t runs = 0;
+    uint32_t bad = 0;
+    for (uint32_t l = 0; l < (loops + 99) / 100; ++l) {
+      for (uint16_t n : sizes) {
+        RunningStats rs;
+        AggResult got;
+        AggResult ref;
+        fill(kind, n);
+        runStatsReset(&rs);
+        for (uint32_t i = 0; i < n; ++i) {
+          runStatsPush(&rs, values[i]);
+        }
+        runStatsResult(&rs, &got);
+        reference(values, n, ref);
+        runs++;
+        bad += got.n != ref.n || got.min != ref.min || got.max != ref.max ||
+               got.mean != ref.mean || got.var != ref.var;
+      }
+    }
+    printf("%-10s | %7lu | %lu\n", kinds[kind], (unsigned long)runs, (unsigned long)bad);
+  }
+
+  for (uint16_t i = 0; i < BENCH_VALUES; ++i) {
+    values[i] = 0x7400 + (nextRandom(rngState) & 0x3F);
+  }
+  uint64_t best = UINT64_MAX;
+  uint64_t bestResult = UINT64_MAX;
+  for (uint32_t l = 0; l < loops; ++l) {
+    RunningStats rs;
+    AggResult res;
+    runStatsReset(&rs);
+    uint64_t t0 = hostCycles();
+    for (uint16_t i = 0; i < BENCH_VALUES; ++i) {
+      runStatsPush(&rs, values[i]);
+    }
+    uint64_t t1 = hostCycles();
+    runStatsResult(&rs, &res);
+    uint64_t t2 = hostCycles();
+    best = t1 - t0 < best ? t1 - t0 : best;
+    bestResult = t2 - t1 < bestResult ? t2 - t1 : bestResult;
+  }
+  printf("Host cycles: %.2f per sample, %llu per window; MSP430 (est.): %u per sample, %u per window\n",
+         (double)best / BENCH_VALUES, (unsigned long long)bestResult,
+         (unsigned)SIM_STEP_AGG_CYCLES, (unsigned)SIM_STEP_WINDOW_CYCLES);
+  printf("Slave: %u Hz x %u cyc = %.1f %% of MCLK 1 MHz\n", (unsigned)ACQ_SAMPLE_RATE,
+         (unsigned)SIM_STEP_AGG_CYCLES, 100.0 * ACQ_SAMPLE_RATE * SIM_STEP_AGG_CYCLES / 1e6);
+
+  printf("Master aggregates, %u samples/s, bus 100 kHz, MCLK 1 MHz:\n", (unsigned)ACQ_SAMPLE_RATE);
+  printf("Master       | reads/s | writes/s | bus us/s  | slave USI    | windows | failed | wrong\n");
+  printf("             |         |          |           | cyc/s        |         |        |\n");
+  runMaster(true, loops);
+  runMaster(false, loops);
+#else
+  (void)loops;
+  printf("Slave built without WITH_AGG: aggregates on the master only\n");
+#endif
+}
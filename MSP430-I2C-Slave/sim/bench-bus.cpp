@@ -0,0 +1,127 @@
+//////////////////////////////////////////////////////////////////////////////
+/// @file bench-bus.cpp
+/// @brief End-to-end throughput benchmark on the virtual I2C bus.
+///
+///        The USI slave of lib/msp430-i2c and the master loop() of
+///        Arduino-I2C-Master-Slave run against each other on the virtual
+///        bus. The master polls back to back: delay(1000) of the plain mode
+///        is skipped, the poll task of the register mode runs with period 0.
+///
+//////////////////////////////////////////////////////////////////////////////
+
+#include <stdio.h>
+
+#include <Arduino.h>
+#include "msp430-i2c.h"
+#include "virtual-bus.h"
+#include "bench.h"
+
+//////////////////////////////////////////////////////////////////////////////
+/// Forward declaration(s)
+//////////////////////////////////////////////////////////////////////////////
+
+void setup(void);
+void simMasterStep(void);
+void simMasterSetPollPeriod(uint32_t us);
+uint16_t simMasterValue(void);
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Run the master loop() against the slave for one bus/CPU clock
+///        combination and print one result line.
+///
+/// @param busHz      SCL frequency
+/// @param cpuHz      MCLK of the MSP430
+/// @param loops      Number of master polls
+//////////////////////////////////////////////////////////////////////////////
+static void runBusBenchmark(uint32_t busHz, uint32_t cpuHz, uint32_t loops) {
+  uint32_t mismatches = 0;
+  uint16_t val = 0x1234;
+
+  simReset(cpuHz, busHz);
+  i2cSlaveSetup();
+  setup();                                  // Includes the bus scan
+  simMasterSetPollPeriod(0);
+  busResetStats();
+  SimTime start = simNow();
+  for (uint32_t i = 0; i < loops; ++i) {
+    val = (uint16_t)(val * 75 + 74);        // Changing test pattern
+    setTxData16(val);
+    simMasterStep();
+    if (simMasterValue() != val) {
+      mismatches++;
+    }
+  }
+
+  double seconds = (double)(simNow() - start) / SIM_PS_PER_SEC;
+  double busSeconds = (double)busStats.busTime / SIM_PS_PER_SEC;
+  printf("%4lu kHz %3lu MHz | %9.1f %10.1f | %6.2f %5lu | %8.2f %8.2f | %5.2f %%\n",
+         (unsigned long)(busHz / 1000), (unsigned long)(cpuHz / 1000000),
+         loops / seconds,
+         busStats.transactions / busSeconds,
+         (double)mcuStats.isrCalls[SIM_IRQ_USI] / busStats.bytes,
+         (unsigned long)mcuStats.isrMaxCycles[SIM_IRQ_USI],
+         busStats.sclHoldMax / 1e6,
+         busStats.sclHoldTotal / 1e6 / busStats.bytes,
+         100.0 * (busStats.failures + mismatches + busStats.stuck) / loops);
+}
+
+static uint8_t tornPattern = 0;
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Byte hook: publish a new sample while the transfer is running.
+///        High and low byte of a sample are always equal.
+///
+//////////////////////////////////////////////////////////////////////////////
+static void publishEveryByte(void) {
+  tornPattern++;
+  setTxData16((uint16_t)(tornPattern * 0x0101));
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Publish after every byte on the bus and count the reads whose
+///        bytes belong to different samples.
+///
+//////////////////////////////////////////////////////////////////////////////
+static void runTornCheck(uint32_t loops) {
+  uint32_t torn = 0;
+
+  simReset(1000000, 100000);
+  i2cSlaveSetup();
+  setup();
+  simMasterSetPollPeriod(0);
+  publishEveryByte();
+  busByteHook = publishEveryByte;
+  for (uint32_t i = 0; i < loops; ++i) {
+    simMasterStep();
+    uint16_t val = simMasterValue();
+    if ((val >> 8) != (val & 0xFF)) {
+      torn++;
+    }
+  }
+  busByteHook = NULL;
+  printf("Publishing after every bus byte: %lu of %lu reads torn\n",
+         (unsigned long)torn, (unsigned long)loops);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Bus benchmark at 100 kHz and 400 kHz with the MSP430 running at
+///        1 MHz and 16 MHz.
+///
+/// @param loops      Number of master polls per combination
+//////////////////////////////////////////////////////////////////////////////
+void benchBus(uint32_t loops) {
+  bool delayEnabled = simDelayEnabled;
+
+  simDelayEnabled = false;
+  printf("Bus      CPU     |    polls/s   reads/s | ISR/B  ISRmax | SCLhold  hold/B   | fail\n");
+  printf("                 |   (e2e)      (bus)   |        [cyc]  | max[us]  avg[us]  |\n");
+  const uint32_t busClocks[] = {100000, 400000};
+  const uint32_t cpuClocks[] = {1000000, 16000000};
+  for (uint32_t bus : busClocks) {
+    for (uint32_t cpu : cpuClocks) {
+      runBusBenchmark(bus, cpu, loops);
+    }
+  }
+  runTornCheck(loops);
+  simDelayEnabled = delayEnabled;
+}
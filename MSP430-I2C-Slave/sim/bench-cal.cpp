@@ -0,0 +1,234 @@
+//////////////////////////////////////////////////////////////////////////////
+/// @file bench-cal.cpp
+/// @brief Calibration on the slave (lib/calibration, WITH_CAL) vs. the
+///        conversion on the master.
+///
+///        1. calApply() for every raw value and every default channel
+///           against an exact reference, and the A1 channel against the
+///           float conversion of the master ((0.6 / 65535) * raw).
+///        2. Host cycles per value: the Q0.16 calibration of the slave,
+///           the float conversion and scaleRaw16() of the master.
+///        3. Estimated target cycles: MSP430F2013 (no hardware multiplier)
+///           per sample vs. ATmega328 (no FPU) per value read.
+///        4. Calibration over I2C: the master writes new coefficients
+///           (writeCalibration), the slave loop of src/main.c takes them
+///           over, every value block read is checked against calApply()
+///           of the published medians.
+///
+//////////////////////////////////////////////////////////////////////////////
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <Wire.h>
+#include "slaveProtocol.h"
+#include "calibration.h"
+#include "info-flash.h"
+#include "msp430-i2c.h"
+#include "serialRecord.h"
+#include "virtual-bus.h"
+#include "bench.h"
+
+// Target estimates (cycles per value), the slave: SIM_STEP_CAL_CYCLES (mcu-model.h)
+#define BENCH_AVR_FLOAT_CYCLES  280         // u16 -> float ~ 70, fmul ~ 140, float -> int ~ 70
+#define BENCH_AVR_SCALE_CYCLES  650         // scaleRaw16(): 32 bit multiply ~ 60, divide ~ 590
+#define BENCH_VALUES            4096        // Values per timing run
+
+#ifdef WITH_CAL
+
+static const CalCoeff benchDefault[SCAN_CHANNELS] = CAL_DEFAULTS;
+static uint16_t raws[BENCH_VALUES];
+static volatile int32_t sink;
+
+static uint32_t rngState = 0x13579BDF;      // State of nextRandom() (bench.h)
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Exact value of the calibration formula, rounded half away from
+///        zero and saturated like calApply()
+///
+//////////////////////////////////////////////////////////////////////////////
+static int32_t reference(const CalCoeff& c, uint16_t raw) {
+  double v = ((double)raw - c.offset) * c.gain / 65536.0;
+  v = v < 0 ? -floor(-v + 0.5) : floor(v + 0.5);
+  return v > INT16_MAX ? INT16_MAX : (v < -INT16_MAX ? -INT16_MAX : (int32_t)v);
+}
+
+// The variants per value, A1 in 0.1 mV
+static int32_t slaveCal(uint16_t raw) {
+  return calApply(0, raw);
+}
+
+static int32_t masterFloat(uint16_t raw) {
+  return (int32_t)((0.6 / 65535) * raw * 10000 + 0.5);
+}
+
+static int32_t masterScale(uint16_t raw) {
+  return (int32_t)scaleRaw16(raw, 6000);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Host cycles per value of one variant
+///
+//////////////////////////////////////////////////////////////////////////////
+template <int32_t (*CONVERT)(uint16_t)>
+static double hostCyclesPerValue(uint32_t loops) {
+  uint64_t best = UINT64_MAX;
+
+  for (uint32_t l = 0; l < loops; ++l) {
+    int32_t sum = 0;
+    uint64_t t0 = hostCycles();
+    for (uint16_t i = 0; i < BENCH_VALUES; ++i) {
+      sum += CONVERT(raws[i]);
+    }
+    uint64_t t = hostCycles() - t0;
+    sink = sum;
+    if (t < best) {
+      best = t;
+    }
+  }
+  return (double)best / BENCH_VALUES;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Slave main loop of src/main.c: publish a value block of filtered
+///        values, handle the calibration request of the master.
+///
+//////////////////////////////////////////////////////////////////////////////
+static void slaveSample(uint16_t seq, const uint16_t* scan) {
+  if (I2C_CTRL(I2C_REG_CONFIG) & I2C_CFG_SAVE_CAL) {
+    I2C_CTRL(I2C_REG_CONFIG) &= ~I2C_CFG_SAVE_CAL;
+    calTakeOver();
+  }
+  simDelayCycles(SCAN_CHANNELS * SIM_STEP_CAL_CYCLES);
+  volatile uint8_t* tx = beginTxData();
+  putTxData16(tx, I2C_REG_VALUE, scan[0]);
+  putTxData16(tx, I2C_REG_COUNT, seq);
+  putTxData16(tx, I2C_UNITS_DATA(I2C_REG_UNITS), seq);
+  for (uint8_t ch = 0; ch < SCAN_CHANNELS; ++ch) {
+    putTxData16(tx, I2C_UNITS_DATA(I2C_REG_UNITS + 2 + 2 * ch), (uint16_t)calApply(ch, scan[ch]));
+  }
+  commitTxData();
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Value block reads with the default and with new coefficients.
+///        Prints one line.
+///
+//////////////////////////////////////////////////////////////////////////////
+static void runUnits(uint32_t busHz, uint32_t samples) {
+  const NodeCal newCal = {0x0100, 6100};    // Channel 0: offset and gain error
+  uint16_t scan[SCAN_CHANNELS];
+  uint32_t reads = 0;
+  uint32_t failed = 0;
+  uint32_t wrong = 0;
+  SimTime readTime = 0;
+  bool taken = false;
+
+  simReset(1000000, busHz);
+  infoSetCal(benchDefault);
+  i2cSlaveSetup();
+  calInit();
+  Wire.begin();
+  for (uint32_t i = 1; i <= samples; ++i) {
+    for (uint8_t ch = 0; ch < SCAN_CHANNELS; ++ch) {
+      scan[ch] = (uint16_t)nextRandom(rngState);
+    }
+    slaveSample((uint16_t)i, scan);
+    if (i == samples / 2) {                 // Calibrate in the middle of the run
+      failed += !writeCalibration(Wire, I2C_SLAVE_ADDRESS, 0, newCal);
+      slaveSample((uint16_t)i, scan);       // Takes it over
+      NodeCal cal[I2C_SCAN_CHANNELS];
+      taken = readCalibration(Wire, I2C_SLAVE_ADDRESS, cal)
+           && cal[0].offset == newCal.offset && cal[0].gain == newCal.gain
+           && cal[1].gain == benchDefault[1].gain;
+    }
+
+    NodeUnits units;
+    SimTime r0 = simNow();
+    bool ok = readNodeUnits(Wire, I2C_SLAVE_ADDRESS, units);
+    readTime += simNow() - r0;
+    reads++;
+    if (!ok) {
+      failed++;
+      continue;
+    }
+    for (uint8_t ch = 0; ch < SCAN_CHANNELS; ++ch) {
+      CalCoeff c = benchDefault[ch];
+      if (ch == 0 && i >= samples / 2) {
+        c.offset = newCal.offset;
+        c.gain = newCal.gain;
+      }
+      if (units.count != (uint16_t)i || units.value[ch] != reference(c, scan[ch])) {
+        wrong++;
+        break;
+      }
+    }
+  }
+  printf("%3lu kHz  | %10.1f | %5lu | %6lu | %5lu | %s\n",
+         (unsigned long)(busHz / 1000), (double)readTime * 1e6 / SIM_PS_PER_SEC / reads,
+         (unsigned long)reads, (unsigned long)failed, (unsigned long)wrong,
+         taken ? "ok" : "FAILED");
+  infoSetCal(benchDefault);                 // Back to the defaults for the other benchmarks
+  calInit();
+}
+#endif
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Calibration benchmark
+///
+/// @param loops      Timing runs per variant, samples per bus run
+//////////////////////////////////////////////////////////////////////////////
+void benchCal(uint32_t loops) {
+#ifdef WITH_CAL
+  uint32_t mismatches = 0;
+  int32_t floatDiff = 0;
+
+  infoSetCal(benchDefault);
+  calInit();
+  for (uint32_t raw = 0; raw <= 0xFFFF; ++raw) {
+    for (uint8_t ch = 0; ch < SCAN_CHANNELS; ++ch) {
+      mismatches += calApply(ch, (uint16_t)raw) != reference(benchDefault[ch], (uint16_t)raw);
+    }
+    int32_t d = abs(calApply(0, (uint16_t)raw) - masterFloat((uint16_t)raw));
+    if (d > floatDiff) {
+      floatDiff = d;
+    }
+  }
+  printf("Check (65536 raw values x %u channels vs. exact): %lu mismatches, "
+         "A1 vs. master float: max %ld x 0.1 mV\n",
+         (unsigned)SCAN_CHANNELS, (unsigned long)mismatches, (long)floatDiff);
+
+  for (uint16_t i = 0; i < BENCH_VALUES; ++i) {
+    raws[i] = (uint16_t)nextRandom(rngState);
+  }
+  struct Variant {
+    const char* name;
+    double host;
+    uint16_t target;
+    const char* where;
+  } variants[] = {
+    {"slave calApply()",     hostCyclesPerValue<slaveCal>(loops),    SIM_STEP_CAL_CYCLES,    "MSP430"},
+    {"master float",         hostCyclesPerValue<masterFloat>(loops), BENCH_AVR_FLOAT_CYCLES, "AVR"},
+    {"master scaleRaw16()",  hostCyclesPerValue<masterScale>(loops), BENCH_AVR_SCALE_CYCLES, "AVR"},
+  };
+  printf("Variant              | host cyc/value | target cyc/value (est.)\n");
+  for (const Variant& v : variants) {
+    printf("%-20s | %14.2f | %5u %s\n", v.name, v.host, v.target, v.where);
+  }
+  printf("Slave: %u channels x %u Hz x %u cyc = %.2f %% of MCLK 1 MHz (every sample, also unread ones)\n",
+         (unsigned)SCAN_CHANNELS, (unsigned)ACQ_SAMPLE_RATE, (unsigned)SIM_STEP_CAL_CYCLES,
+         100.0 * SCAN_CHANNELS * ACQ_SAMPLE_RATE * SIM_STEP_CAL_CYCLES / 1e6);
+  printf("Master: %u channels x 200 reads/s x %u cyc = %.2f %% of 16 MHz (float, per consumer)\n",
+         (unsigned)SCAN_CHANNELS, (unsigned)BENCH_AVR_FLOAT_CYCLES,
+         100.0 * SCAN_CHANNELS * 200 * BENCH_AVR_FLOAT_CYCLES / 16e6);
+
+  printf("Value block reads, coefficients of channel 0 written in the middle:\n");
+  printf("Bus      | block read | reads | failed | wrong | taken over\n");
+  runUnits(100000, loops);
+  runUnits(400000, loops);
+#else
+  (void)loops;
+  printf("Slave built without WITH_CAL: raw values only\n");
+#endif
+}
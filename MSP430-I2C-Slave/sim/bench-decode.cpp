@@ -0,0 +1,143 @@
+//////////////////////////////////////////////////////////////////////////////
+/// @file bench-decode.cpp
+/// @brief Integer decoding of the master: the former bufferToInt16/32
+///        templates against decodeInt() and PackedRecord (bufferToInt.h).
+///
+///        Measures the host cycles per register snapshot and per 32 byte
+///        burst. The decoders are checked by test/test_decode.
+///
+//////////////////////////////////////////////////////////////////////////////
+
+#include <stdio.h>
+
+#include "slaveProtocol.h"
+#include "msp430-i2c.h"
+#include "bench.h"
+
+#define BENCH_SNAPSHOTS   4096              // Register snapshots in the test buffer
+#define BENCH_BURST       32                // Bytes of a burst (16 values)
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief The former templates of bufferToInt.h (reference)
+///
+//////////////////////////////////////////////////////////////////////////////
+template <typename R, typename ARG1>
+R legacyBufferToInt16(ARG1 charBuf) {
+  uint16_t val = 0;
+  val = *charBuf;
+  val = (val << 8) | *(charBuf+1);
+  return val;
+}
+
+template <typename R, typename ARG1>
+R legacyBufferToInt32(ARG1 charBuf) {
+  uint32_t val = 0;
+  val = charBuf[0];
+  val = (val << 8) | charBuf[1];
+  val = (val << 8) | charBuf[2];
+  val = (val << 8) | charBuf[3];
+  return val;
+}
+
+static uint8_t snapshots[BENCH_SNAPSHOTS][I2C_NUM_REGS];
+static volatile uint32_t sink;
+
+static uint32_t rngState = 0x12345678;      // State of nextRandom() (bench.h)
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Decoder microbenchmark
+///
+/// @param loops      Passes over the snapshot buffer
+//////////////////////////////////////////////////////////////////////////////
+void benchDecode(uint32_t loops) {
+  uint64_t t0, cyc[4];
+  uint32_t sum;
+
+  for (uint32_t i = 0; i < BENCH_SNAPSHOTS; ++i) {
+    for (uint8_t r = 0; r < I2C_NUM_REGS; ++r) {
+      snapshots[i][r] = (uint8_t)nextRandom(rngState);
+    }
+  }
+  if (loops < 10) {
+    loops = 10;
+  }
+
+  // Register map VALUE .. ADDR: former templates, decodeInt per field, PackedRecord
+  sum = 0;
+  t0 = hostCycles();
+  for (uint32_t l = 0; l < loops; ++l) {
+    for (uint32_t i = 0; i < BENCH_SNAPSHOTS; ++i) {
+      const uint8_t* p = snapshots[i];
+      sum += legacyBufferToInt16<uint16_t>(p + I2C_REG_VALUE) + legacyBufferToInt16<uint16_t>(p + I2C_REG_MIN)
+           + legacyBufferToInt16<uint16_t>(p + I2C_REG_MAX) + legacyBufferToInt16<uint16_t>(p + I2C_REG_COUNT)
+           + p[I2C_REG_STATUS] + p[I2C_REG_CONFIG] + p[I2C_REG_ADDR];
+    }
+  }
+  cyc[0] = hostCycles() - t0;
+  sink = sum;
+
+  sum = 0;
+  t0 = hostCycles();
+  for (uint32_t l = 0; l < loops; ++l) {
+    for (uint32_t i = 0; i < BENCH_SNAPSHOTS; ++i) {
+      const uint8_t* p = snapshots[i];
+      sum += decodeInt<uint16_t>(p + I2C_REG_VALUE) + decodeInt<uint16_t>(p + I2C_REG_MIN)
+           + decodeInt<uint16_t>(p + I2C_REG_MAX) + decodeInt<uint16_t>(p + I2C_REG_COUNT)
+           + decodeInt<uint8_t>(p + I2C_REG_STATUS) + decodeInt<uint8_t>(p + I2C_REG_CONFIG)
+           + decodeInt<uint8_t>(p + I2C_REG_ADDR);
+    }
+  }
+  cyc[1] = hostCycles() - t0;
+  sink = sum;
+
+  sum = 0;
+  t0 = hostCycles();
+  for (uint32_t l = 0; l < loops; ++l) {
+    for (uint32_t i = 0; i < BENCH_SNAPSHOTS; ++i) {
+      uint16_t value, minValue, maxValue, count;
+      uint8_t status, config, addr;
+      RegisterMap::decode(snapshots[i], value, minValue, maxValue, count, status, config, addr);
+      sum += value + minValue + maxValue + count + status + config + addr;
+    }
+  }
+  cyc[2] = hostCycles() - t0;
+  sink = sum;
+
+  double n = (double)loops * BENCH_SNAPSHOTS;
+  printf("Register snapshot (%u bytes, 7 fields), %lu decodes per variant:\n",
+         (unsigned)I2C_NUM_REGS, (unsigned long)n);
+  printf("  bufferToInt16 (former) %6.2f cyc\n", cyc[0] / n);
+  printf("  decodeInt per field    %6.2f cyc\n", cyc[1] / n);
+  printf("  RegisterMap::decode    %6.2f cyc\n", cyc[2] / n);
+
+  // Burst of 16 big endian 16 bit values
+  const uint8_t* bytes = &snapshots[0][0];
+  uint32_t bursts = BENCH_SNAPSHOTS * I2C_NUM_REGS / BENCH_BURST;
+  sum = 0;
+  t0 = hostCycles();
+  for (uint32_t l = 0; l < loops; ++l) {
+    for (uint32_t i = 0; i < bursts; ++i) {
+      for (uint8_t k = 0; k < BENCH_BURST; k += 2) {
+        sum += legacyBufferToInt16<uint16_t>(bytes + i * BENCH_BURST + k);
+      }
+    }
+  }
+  cyc[0] = hostCycles() - t0;
+  sink = sum;
+  sum = 0;
+  t0 = hostCycles();
+  for (uint32_t l = 0; l < loops; ++l) {
+    for (uint32_t i = 0; i < bursts; ++i) {
+      for (uint8_t k = 0; k < BENCH_BURST; k += 2) {
+        sum += decodeInt<uint16_t>(bytes + i * BENCH_BURST + k);
+      }
+    }
+  }
+  cyc[1] = hostCycles() - t0;
+  sink = sum;
+  n = (double)loops * bursts;
+  printf("Burst of %u bytes (16 x uint16):\n", (unsigned)BENCH_BURST);
+  printf("  bufferToInt16 (former) %6.2f cyc\n", cyc[0] / n);
+  printf("  decodeInt              %6.2f cyc\n", cyc[1] / n);
+  printf("Cycles are host cycles (TSC).\n");
+}
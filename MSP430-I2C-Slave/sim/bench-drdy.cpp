@@ -0,0 +1,181 @@
+//////////////////////////////////////////////////////////////////////////////
+/// @file bench-drdy.cpp
+/// @brief Data-ready line of the slave (WITH_DRDY) vs. fixed interval
+///        polling: sample to host latency, stale reads and missed samples.
+///
+///        The slave runs slaveStep() of src/main.c (timer paced at
+///        ACQ_SAMPLE_RATE); it is released whenever the SD16 interrupt
+///        leaves LPM0. The master reads the register map VALUE .. ADDR in
+///        one transaction either every poll period (1 s is the plain loop
+///        with delay(1000)) or when its pin interrupt saw the line fall.
+///        The master CPU is not modelled: it starts the read at once, but
+///        not while slaveStep() runs (1.6 ms per sample with the native
+///        build), so a poll that falls due then waits for its end. Its
+///        clock (ceramic resonator) runs BENCH_MASTER_PPM fast against the
+///        slave, so the polls drift through the sample period instead of
+///        always hitting the same phase.
+///
+///        Latency: from commitTxData() of a sample until the master has
+///        the complete read with it. A read without a new COUNT is stale,
+///        a sample that no read returned is missed. I2C_STATUS_NEW has to
+///        be set in exactly the reads with a new COUNT (flag errors).
+///
+//////////////////////////////////////////////////////////////////////////////
+
+#include <stdio.h>
+
+#include <Arduino.h>
+#include <Wire.h>
+#include "slaveProtocol.h"
+#include "msp430-i2c.h"
+#include "sd16-acq.h"
+#include "virtual-bus.h"
+#include "bench.h"
+
+#define BENCH_STEP_US         10            // Time step of the master between its events
+#define BENCH_MASTER_PPM      3700          // Master clock fast against the slave DCO
+
+#ifdef WITH_DRDY
+
+static SimTime publishedAt[65536];          // Time of commitTxData() by sample counter
+static volatile bool benchReady;
+static uint32_t benchPulses;
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Data-ready interrupt of the master
+///
+//////////////////////////////////////////////////////////////////////////////
+static void onReady(void) {
+  benchReady = true;
+  benchPulses++;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Slave main loop at a SLAVE_TRACE_x point: time of the commit
+///
+//////////////////////////////////////////////////////////////////////////////
+static void onStep(uint8_t point) {
+  if (point == SLAVE_TRACE_COMMIT) {
+    publishedAt[benchSlave.sampleCount] = simNow();
+  }
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Run slave and master for some seconds. Prints one line.
+///
+/// @param pollUs     Poll period of the master, 0: data-ready line
+/// @param seconds    Virtual run time
+//////////////////////////////////////////////////////////////////////////////
+static void runMaster(uint32_t pollUs, uint32_t seconds) {
+  uint32_t reads = 0;
+  uint32_t failed = 0;
+  uint32_t stale = 0;
+  uint32_t fresh = 0;
+  uint32_t flagErrors = 0;
+  uint16_t lastCount = 0;
+  double latSum = 0;
+  SimTime latMax = 0;
+  SimTime busTime = 0;
+
+  simReset(1000000, 100000);
+  benchSlaveStart();
+  mcuStepHook = onStep;
+  benchReady = false;
+  benchPulses = 0;
+  Wire.begin();
+  volatile uint8_t* tx = beginTxData();     // Start with COUNT 0, whatever a previous run left
+  putTxData16(tx, I2C_REG_COUNT, 0);
+  commitTxData();
+  uint8_t regs[I2C_NUM_REGS];
+  readRegisters(Wire, I2C_SLAVE_ADDRESS, I2C_REG_VALUE, regs, I2C_NUM_REGS);
+  attachInterrupt(digitalPinToInterrupt(SIM_DRDY_PIN), onReady, FALLING);
+  mcuResetStats();
+  uint32_t wakeups = 0;
+  SimTime t0 = simNow();
+  SimTime end = t0 + (SimTime)seconds * SIM_PS_PER_SEC;
+  SimTime pollPs = (SimTime)pollUs * (SIM_PS_PER_SEC / 1000000) / 1000000 * (1000000 - BENCH_MASTER_PPM);
+  SimTime nextPoll = t0 + pollPs;
+  while (simNow() < end) {
+    bool read = false;
+    if (mcuStats.wakeups != wakeups) {      // Slave main loop released
+      wakeups = mcuStats.wakeups;
+      slaveStep(&benchSlave);
+    }
+    if (pollUs == 0 && benchReady) {
+      benchReady = false;
+      read = true;
+    } else if (pollUs != 0 && simNow() >= nextPoll) {
+      nextPoll += pollPs;
+      read = true;
+    }
+    if (!read) {
+      SimTime t = simNow() + (SimTime)BENCH_STEP_US * (SIM_PS_PER_SEC / 1000000);
+      simWaitUntil(pollUs != 0 && nextPoll < t ? nextPoll : t);
+      continue;
+    }
+    SimTime b0 = simNow();
+    reads++;
+    uint8_t result = readRegisters(Wire, I2C_SLAVE_ADDRESS, I2C_REG_VALUE, regs, I2C_NUM_REGS);
+    busTime += simNow() - b0;
+    if (result != I2C_NUM_REGS) {
+      failed++;
+      continue;
+    }
+    uint16_t count = decodeInt<uint16_t>(regs + I2C_REG_COUNT);
+    bool isNew = (regs[I2C_REG_STATUS] & I2C_STATUS_NEW) != 0;
+    if (count == lastCount) {
+      stale++;
+      flagErrors += isNew;
+      continue;
+    }
+    flagErrors += !isNew;
+    lastCount = count;
+    fresh++;
+    SimTime lat = simNow() - publishedAt[count];
+    latSum += (double)lat;
+    latMax = lat > latMax ? lat : latMax;
+  }
+  detachInterrupt(digitalPinToInterrupt(SIM_DRDY_PIN));
+  mcuStepHook = NULL;
+
+  double secs = (double)(simNow() - t0) / SIM_PS_PER_SEC;
+  char name[16];
+  if (pollUs) {
+    snprintf(name, sizeof(name), "poll %lu ms", (unsigned long)(pollUs / 1000));
+  } else {
+    snprintf(name, sizeof(name), "data-ready");
+  }
+  printf("%-12s | %7.1f | %5.1f %% | %6.1f %% | %7.2f | %7.2f | %7.1f | %8.0f | %6lu | %lu\n",
+         name, reads / secs, reads ? 100.0 * stale / reads : 0.0,
+         benchSlave.sampleCount ? 100.0 * (benchSlave.sampleCount - fresh) / benchSlave.sampleCount : 0.0,
+         fresh ? latSum / fresh * 1e3 / SIM_PS_PER_SEC : 0.0, (double)latMax * 1e3 / SIM_PS_PER_SEC,
+         (double)busTime * 1e3 / SIM_PS_PER_SEC / secs, (double)mcuStats.isrCycles[SIM_IRQ_USI] / secs,
+         (unsigned long)failed, (unsigned long)flagErrors);
+  if (pollUs == 0) {
+    printf("Pulses %lu for %u samples\n", (unsigned long)benchPulses, (unsigned)benchSlave.sampleCount);
+  }
+}
+#endif
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Data-ready benchmark
+///
+/// @param loops      Virtual run time per master in 1/100 s
+//////////////////////////////////////////////////////////////////////////////
+void benchDrdy(uint32_t loops) {
+#ifdef WITH_DRDY
+  uint32_t seconds = loops / 100 ? loops / 100 : 1;
+  static const uint32_t polls[] = {1000000, 20000, 5000, 1000, 0};
+
+  printf("%lu s per master, %u samples/s, bus 100 kHz, MCLK 1 MHz, read VALUE .. ADDR + PEC\n",
+         (unsigned long)seconds, (unsigned)ACQ_SAMPLE_RATE);
+  printf("Master       | reads/s | stale   | missed   | latency | latency | bus     | slave    | failed | flag\n");
+  printf("             |         |         | samples  | avg ms  | max ms  | ms/s    | USI cyc/s|        | errors\n");
+  for (uint32_t p : polls) {
+    runMaster(p, seconds);
+  }
+#else
+  (void)loops;
+  printf("Slave built without WITH_DRDY: polling only\n");
+#endif
+}
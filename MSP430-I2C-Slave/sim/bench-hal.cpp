@@ -0,0 +1,272 @@
+//////////////////////////////////////////////////////////////////////////////
+/// @file bench-hal.cpp
+/// @brief One protocol state machine (i2c-slave-sm.h), three backends:
+///        USI (i2c-usi.c on the virtual bus), USCI_B0 (i2c-usci.c, both
+///        ISRs driven by a byte-level model of the module) and the host
+///        backend (i2c-host.h, plain function calls).
+///
+///        The same transactions run through every backend: register map
+///        read with PEC (pointer write, repeated START), FIFO drain over
+///        two PEC blocks and past the end of the data, register write and
+///        read back, read without pointer (pointer back at VALUE). Before each run the slave gets the same snapshot and
+///        FIFO contents, so the master has to see the same bytes on all
+///        three.
+///
+///        Cost per run of the transactions: host time (host backend), ISR
+///        runs and modelled ISR cycles of the USI (usi-cycles.h), ISR runs
+///        of the USCI. There is no cycle table for the USCI ISRs.
+///
+//////////////////////////////////////////////////////////////////////////////
+
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+
+#include "msp430-i2c.h"
+#include "i2c-host.h"
+#include "sample-history.h"
+#include "virtual-bus.h"
+#include "bench.h"
+
+#define BENCH_BYTES       96                // Bytes seen by the master per run (max)
+#define BENCH_FIFO_READ   22                // FIFO read: 2 PEC blocks and a few pad bytes
+#define BENCH_SAMPLES     12                // FIFO contents: key record + deltas
+
+extern "C" void USCIAB0RX_ISR(void);
+extern "C" void USCIAB0TX_ISR(void);
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Bus side of a backend, as seen by the master
+///
+//////////////////////////////////////////////////////////////////////////////
+struct HalBus {
+  const char* name;
+  bool (*start)(uint8_t addrByte, bool repeated);   // START + address byte, true: ACK
+  void (*write)(uint8_t val);
+  uint8_t (*read)(bool ack);
+  void (*stop)(void);
+};
+
+//////////////////////////////////////////////////////////////////////////////
+/// USI: the virtual bus
+//////////////////////////////////////////////////////////////////////////////
+
+static bool usiStart(uint8_t addrByte, bool repeated) {
+  (void)repeated;                           // The bus knows
+  busStart();
+  return busWriteByte(addrByte);
+}
+
+static void usiWrite(uint8_t val) {
+  busWriteByte(val);
+}
+
+static uint8_t usiRead(bool ack) {
+  return busReadByte(ack);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// USCI_B0: byte-level model. The module ACKs, stretches SCL until the
+/// ISR has served a flag and moves TXBUF into the shift register as soon
+/// as the previous byte is ACKed.
+//////////////////////////////////////////////////////////////////////////////
+
+static uint8_t usciShift;                   // Byte on the bus (slave transmitter)
+static uint32_t usciIsrRuns;
+
+static void usciStateIrq(uint8_t flags) {
+  *mcuRaw8(SIM_UCB0STAT) |= flags;
+  usciIsrRuns++;
+  USCIAB0RX_ISR();
+}
+
+static void usciDataIrq(uint8_t flag) {
+  *mcuRaw8(SIM_IFG2) |= flag;
+  usciIsrRuns++;
+  USCIAB0TX_ISR();
+  *mcuRaw8(SIM_IFG2) &= ~flag;              // RXBUF read or TXBUF written
+}
+
+static void usciLoad(void) {                // TXBUF -> shift register, TXBUF free again
+  usciShift = *mcuRaw8(SIM_UCB0TXBUF);
+  usciDataIrq(UCB0TXIFG);
+}
+
+static bool usciStart(uint8_t addrByte, bool repeated) {
+  (void)repeated;                           // No STOP in between: no UCSTPIFG
+  if ((addrByte >> 1) != *mcuRaw16(SIM_UCB0I2COA)) {
+    return false;                           // No interrupt for other addresses
+  }
+  if (addrByte & 0x01) {
+    *mcuRaw8(SIM_UCB0CTL1) |= UCTR;
+  } else {
+    *mcuRaw8(SIM_UCB0CTL1) &= ~UCTR;
+  }
+  usciStateIrq(UCSTTIFG);
+  if (addrByte & 0x01) {
+    usciDataIrq(UCB0TXIFG);                 // 1st byte into TXBUF
+    usciLoad();                             // ... straight on into the shift register
+  }
+  return true;
+}
+
+static void usciWrite(uint8_t val) {
+  *mcuRaw8(SIM_UCB0RXBUF) = val;
+  usciDataIrq(UCB0RXIFG);
+}
+
+static uint8_t usciRead(bool ack) {
+  uint8_t val = usciShift;
+
+  if (ack) {
+    usciLoad();
+  }
+  return val;
+}
+
+static void usciStop(void) {
+  usciStateIrq(UCSTPIFG);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// Host backend
+//////////////////////////////////////////////////////////////////////////////
+
+static bool hostStart(uint8_t addrByte, bool repeated) {
+  return i2cHostStart(addrByte, repeated);
+}
+
+static void hostWrite(uint8_t val) {
+  i2cHostWrite(val);
+}
+
+static uint8_t hostRead(bool ack) {
+  return i2cHostRead(ack);
+}
+
+static const HalBus halUsi = {"USI", usiStart, usiWrite, usiRead, busStop};
+static const HalBus halUsci = {"USCI_B0", usciStart, usciWrite, usciRead, usciStop};
+static const HalBus halHost = {"host", hostStart, hostWrite, hostRead, i2cHostStop};
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Snapshot and FIFO contents of every run
+///
+//////////////////////////////////////////////////////////////////////////////
+static void slaveContents(void) {
+  volatile uint8_t* tx = beginTxData();
+  putTxData16(tx, I2C_REG_VALUE, 0x7412);
+  putTxData16(tx, I2C_REG_MIN, 0x7400);
+  putTxData16(tx, I2C_REG_MAX, 0x7433);
+  putTxData16(tx, I2C_REG_COUNT, 0x1234);
+  tx[I2C_REG_STATUS] = I2C_STATUS_RUNNING;
+  commitTxData();
+  histInit();
+  for (uint16_t i = 0; i < BENCH_SAMPLES; ++i) {
+    histPush(0x1000 + i, 0x7400 + (i & 0x03));
+  }
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Read from a register: pointer write, repeated START, read
+///
+//////////////////////////////////////////////////////////////////////////////
+static uint16_t readFrom(const HalBus& bus, uint8_t reg, uint8_t len, uint8_t* out) {
+  uint16_t n = 0;
+
+  if (bus.start(SLAVE_ADDR << 1, false)) {
+    bus.write(reg);
+    if (bus.start((SLAVE_ADDR << 1) | 0x01, true)) {
+      for (uint8_t i = 0; i < len; ++i) {
+        out[n++] = bus.read(i + 1 < len);
+      }
+    }
+  }
+  bus.stop();
+  return n;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief The transactions of one run
+///
+/// @param out        Bytes seen by the master
+/// @return uint16_t  Number of bytes
+//////////////////////////////////////////////////////////////////////////////
+static uint16_t runTransactions(const HalBus& bus, uint8_t* out) {
+  uint16_t n = 0;
+
+  n += readFrom(bus, I2C_REG_VALUE, I2C_NUM_REGS + 1, out + n);   // Map + PEC
+  n += readFrom(bus, I2C_REG_FIFO, BENCH_FIFO_READ, out + n);      // FIFO, PEC every block
+  if (bus.start(SLAVE_ADDR << 1, false)) {                           // Register write
+    bus.write(I2C_REG_ADDR);
+    bus.write(SLAVE_ADDR);
+  }
+  bus.stop();
+  n += readFrom(bus, I2C_REG_ADDR, 2, out + n);                      // ADDR + PEC
+  if (bus.start((SLAVE_ADDR << 1) | 0x01, false)) {                  // No pointer write:
+    out[n++] = bus.read(true);                                       // back at VALUE
+    out[n++] = bus.read(false);
+  }
+  bus.stop();
+  return n;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Slave reset for one backend
+///
+//////////////////////////////////////////////////////////////////////////////
+static void slaveReset(const HalBus& bus) {
+  simReset(16000000, 400000);
+  i2cSlaveSetup();
+  if (&bus == &halUsci) {
+    usciSetup();
+  }
+  slaveContents();
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief HAL benchmark
+///
+/// @param loops      Host timing runs (x 10)
+//////////////////////////////////////////////////////////////////////////////
+void benchHal(uint32_t loops) {
+  const HalBus* buses[] = {&halUsi, &halUsci, &halHost};
+  uint8_t ref[BENCH_BYTES];
+  uint8_t got[BENCH_BYTES];
+  uint16_t refLen = 0;
+  uint32_t usiRuns = 0;
+  uint64_t usiCycles = 0;
+
+  printf("Backend  | bytes | same as USI | ISR runs\n");
+  for (const HalBus* bus : buses) {
+    slaveReset(*bus);
+    mcuResetStats();
+    usciIsrRuns = 0;
+    uint16_t len = runTransactions(*bus, got);
+    uint32_t runs = 0;
+    if (bus == &halUsi) {
+      memcpy(ref, got, len);
+      refLen = len;
+      usiRuns = runs = mcuStats.isrCalls[SIM_IRQ_USI];
+      usiCycles = mcuStats.isrCycles[SIM_IRQ_USI];
+    } else if (bus == &halUsci) {
+      runs = usciIsrRuns;
+    }
+    bool same = len == refLen && memcmp(got, ref, len) == 0;
+    printf("%-8s | %5u | %-11s | %lu\n", bus->name, len, same ? "yes" : "WRONG",
+           (unsigned long)runs);
+  }
+
+  // Host backend: the protocol alone
+  uint32_t runs = loops * 10;
+  slaveReset(halHost);
+  auto t0 = std::chrono::steady_clock::now();
+  for (uint32_t i = 0; i < runs; ++i) {
+    slaveContents();
+    runTransactions(halHost, got);
+  }
+  double ns = std::chrono::duration<double, std::nano>(
+      std::chrono::steady_clock::now() - t0).count() / runs;
+  printf("Per run (%u bytes, 5 transactions): host backend %.0f ns (incl. refill), "
+         "USI %lu ISR runs, %llu cycles (%s ISR, model)\n",
+         refLen, ns, (unsigned long)usiRuns, (unsigned long long)usiCycles, USI_CYCLES.name);
+}
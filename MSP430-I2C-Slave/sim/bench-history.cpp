@@ -0,0 +1,131 @@
+//////////////////////////////////////////////////////////////////////////////
+/// @file bench-history.cpp
+/// @brief Sample history: the slave pushes every median into the FIFO of
+///        lib/sample-history, the master drains it every poll interval
+///        with long reads of I2C_REG_FIFO and rebuilds the series with
+///        HistoryDecoder (Arduino-I2C-Master-Slave/lib/historyDecoder).
+///
+///        The slave loop is the one of src/main.c (timer paced, LPM0). The
+///        master drain is the one of drainHistory() in main.cpp. Every
+///        decoded sample is compared with the pushed one.
+///
+//////////////////////////////////////////////////////////////////////////////
+
+#include <stdio.h>
+#include <string.h>
+
+#include <Wire.h>
+#include "slaveProtocol.h"
+#include "historyDecoder.h"
+#include "msp430-i2c.h"
+#include "running-median.h"
+#include "sample-history.h"
+#include "sd16-acq.h"
+#include "virtual-bus.h"
+#include "bench.h"
+
+#ifdef WITH_PEC
+#define BENCH_CHUNK   24                    // Bytes per read (+ 3 PEC bytes: Wire buffer)
+#else
+#define BENCH_CHUNK   32                    // Bytes per read (Wire buffer)
+#endif
+#define BENCH_READS   4                     // Max. reads per drain
+
+static uint16_t pushed[0x10000];            // Pushed medians by sequence number
+static uint32_t mismatches;
+
+static void checkSample(uint16_t seq, uint16_t value) {
+  if (pushed[seq] != value) {
+    mismatches++;
+  }
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Drain the FIFO like drainHistory() of the master.
+///
+/// @return uint32_t  Stream bytes (without padding)
+//////////////////////////////////////////////////////////////////////////////
+static uint32_t drain(HistoryDecoder& dec) {
+  uint8_t buf[BENCH_CHUNK];
+  uint32_t bytes = 0;
+
+  for (uint8_t i = 0; i < BENCH_READS; ++i) {
+    uint8_t len = readRegisters(Wire, I2C_SLAVE_ADDRESS, I2C_REG_FIFO, buf, BENCH_CHUNK);
+    if (len != BENCH_CHUNK) {
+      dec.reset();
+      break;
+    }
+    uint8_t pads = dec.feed(buf, len, checkSample);
+    bytes += len - pads;
+    if (pads > 0) {
+      break;
+    }
+  }
+  return bytes;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Run the slave for a number of samples and drain the history every
+///        pollMs. Prints one result line.
+///
+//////////////////////////////////////////////////////////////////////////////
+static void runHistory(uint32_t pollMs, uint32_t samples) {
+  uint16_t values[MEDIAN_WINDOW];
+  uint8_t slots[MEDIAN_WINDOW];
+  RunningMedian filter;
+  HistoryDecoder dec;
+  uint16_t seq = 0;
+  uint32_t bytes = 0;
+
+  simReset(1000000, 100000);
+  histInit();
+  i2cSlaveSetup();
+  sd16Setup();
+  medianInit(&filter, values, slots, MEDIAN_WINDOW, sd16Convert());
+  acqStart();
+  Wire.begin();
+  mismatches = 0;
+
+  SimTime poll = (SimTime)pollMs * (SIM_PS_PER_SEC / 1000);
+  SimTime nextPoll = simNow() + poll;
+  for (uint32_t i = 0; i < samples; ++i) {
+    uint16_t median = medianPush(&filter, acqWait());
+    seq++;
+    pushed[seq] = median;
+    histPush(seq, median);
+    volatile uint8_t* tx = beginTxData();
+    putTxData16(tx, I2C_REG_VALUE, median);
+    putTxData16(tx, I2C_REG_COUNT, seq);
+    commitTxData();
+    if (simNow() >= nextPoll) {
+      bytes += drain(dec);
+      nextPoll += poll;
+    }
+  }
+  bytes += drain(dec);
+
+  double seconds = (double)simNow() / SIM_PS_PER_SEC;
+  printf("%7lu ms | %7lu %7lu %7lu %5lu | %6.2f %% | %5.2f | %7.1f %8.1f\n",
+         (unsigned long)pollMs, (unsigned long)samples, (unsigned long)dec.samples,
+         (unsigned long)dec.dropped, (unsigned long)mismatches,
+         100.0 * (samples - dec.samples) / samples,
+         dec.samples ? (double)bytes / dec.samples : 0.0,
+         busStats.transactions / seconds, busStats.bytes / seconds);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief History benchmark for several drain intervals.
+///
+/// @param loops      Number of samples per run
+//////////////////////////////////////////////////////////////////////////////
+void benchHistory(uint32_t loops) {
+  printf("ACQ_SAMPLE_RATE = %u Hz, HIST_SIZE = %u bytes, read = %u bytes, bus 100 kHz\n",
+         (unsigned)ACQ_SAMPLE_RATE, (unsigned)HIST_SIZE, (unsigned)BENCH_CHUNK);
+  printf("Drain      | samples decoded dropped wrong | lost     | B/smp | trans/s   bytes/s\n");
+  const uint32_t polls[] = {20, 50, 100, 200, 500, 1000};
+  for (uint32_t p : polls) {
+    runHistory(p, loops);
+  }
+  printf("Polling VALUE once per sample: %u trans/s, %u bytes/s (address + 2 data bytes)\n",
+         (unsigned)ACQ_SAMPLE_RATE, (unsigned)(ACQ_SAMPLE_RATE * 3));
+}
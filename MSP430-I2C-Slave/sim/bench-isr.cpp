@@ -0,0 +1,185 @@
+//////////////////////////////////////////////////////////////////////////////
+/// @file bench-isr.cpp
+/// @brief USI ISR: standard vs. fast mode, from the per-state cycle table
+///        (usi-cycles.h, counted by hand, the native env cannot run MSP430
+///        code).
+///
+///        1. Per-state cycles until SCL is released and until reti.
+///        2. Worst-case ISR time and SCL hold at 1/16 MHz, 100/400 kHz:
+///           hold of a state plus what the previous ISR still had to do
+///           after the bits it set up were on the bus.
+///        3. Register map and FIFO reads on the virtual bus with the built
+///           ISR: measured SCL hold and ISR runs per state.
+///
+//////////////////////////////////////////////////////////////////////////////
+
+#include <stdio.h>
+
+#include <Wire.h>
+#include "slaveProtocol.h"
+#include "msp430-i2c.h"
+#include "sample-history.h"
+#include "virtual-bus.h"
+#include "usi-cycles.h"
+#include "bench.h"
+
+#define FIFO_READ     24                    // Bytes per FIFO read (3 PEC blocks)
+
+//////////////////////////////////////////////////////////////////////////////
+/// State graph: traced state (| 1: short branch), bits on the bus until
+/// the next ISR, traced state of that ISR
+//////////////////////////////////////////////////////////////////////////////
+
+#define START_NEXT    0xFF                  // A START (then I2C_ADDRESS)
+
+typedef struct IsrEdgeStruct {
+  uint8_t from;
+  uint8_t bits;
+  uint8_t to;
+} IsrEdge;
+
+static const IsrEdge edges[] = {
+  {I2C_ADDRESS,             8, I2C_PROCESS_ADDRESS},
+  {I2C_ADDRESS,             8, I2C_PROCESS_ADDRESS | 1},
+  {I2C_PROCESS_ADDRESS,     1, I2C_TX_DATA},            // Read
+  {I2C_PROCESS_ADDRESS | 1, 1, I2C_RX_DATA},            // Write
+  {I2C_PROCESS_ADDRESS | 1, 1, I2C_PREP_START},         // NACK
+  {I2C_RX_DATA,             8, I2C_RX_CHECK},
+  {I2C_RX_DATA,             1, START_NEXT},             // Sr or P S after the ACK
+  {I2C_RX_CHECK,            1, I2C_RX_DATA},
+  {I2C_TX_DATA,             8, I2C_ACK_NACK},
+  {I2C_ACK_NACK,            1, I2C_TX_CHECK},
+  {I2C_ACK_NACK,            1, I2C_TX_CHECK | 1},
+  {I2C_TX_CHECK,            8, I2C_ACK_NACK},
+  {I2C_TX_CHECK | 1,        1, START_NEXT},             // P S after the NACK
+  {I2C_PREP_START,          1, START_NEXT},
+  {I2C_IDLE,                1, START_NEXT},
+};
+
+static uint32_t releaseOf(const UsiCycleModel& m, uint8_t state) {
+  if (state == START_NEXT) {
+    return m.startRelease + USI_STATS_START_CYCLES + m.state[I2C_ADDRESS / 2].release + USI_STATS_CYCLES;
+  }
+  const UsiCycles& c = m.state[state / 2];
+  return ((state & 1) ? c.altRelease : c.release) + USI_STATS_CYCLES;
+}
+
+static uint32_t totalOf(const UsiCycleModel& m, uint8_t state) {
+  const UsiCycles& c = m.state[state / 2];
+  uint32_t total = ((state & 1) ? c.altTotal : c.total) + USI_STATS_CYCLES;
+  return (state / 2 == I2C_ADDRESS / 2) ? total + m.startTotal + USI_STATS_START_CYCLES : total;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Worst-case SCL stretch as seen by the master, in cycles: release
+///        of the ISR plus the spill of the ISR before it (work left when
+///        its bits are done), less the low phase the master drives anyway
+///        (half a bit, a whole bit after a START). The spill does not add
+///        up over several ISRs, the bus waits for every release.
+///
+/// @param m          Cycle model
+/// @param cpb        MCLK cycles per SCL period
+//////////////////////////////////////////////////////////////////////////////
+static double worstHold(const UsiCycleModel& m, double cpb) {
+  double worst = releaseOf(m, START_NEXT) - cpb;
+
+  for (const IsrEdge& e : edges) {
+    double busy = (double)totalOf(m, e.from) - releaseOf(m, e.from);
+    if (e.from == I2C_ADDRESS) {
+      busy -= m.startRelease + USI_STATS_START_CYCLES;  // START block is in totalOf()
+    }
+    double spill = busy - (e.bits - 0.5) * cpb;
+    spill = (spill > 0) ? spill : 0;
+    double hold = spill + releaseOf(m, e.to) - ((e.to == START_NEXT) ? cpb : cpb / 2);
+    worst = (hold > worst) ? hold : worst;
+  }
+  return (worst > 0) ? worst : 0;
+}
+
+static uint32_t worstTotal(const UsiCycleModel& m) {
+  uint32_t worst = 0;
+  for (uint8_t s = 0; s < 2 * USI_STATES; ++s) {
+    worst = (totalOf(m, s) > worst) ? totalOf(m, s) : worst;
+  }
+  return worst;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Map and FIFO reads with the built ISR at one clock combination.
+///        Prints one result line.
+///
+//////////////////////////////////////////////////////////////////////////////
+static void runReads(uint32_t busHz, uint32_t cpuHz, uint32_t loops) {
+  uint8_t regs[FIFO_READ];
+  uint32_t errors = 0;
+
+  simReset(cpuHz, busHz);
+  histInit();
+  i2cSlaveSetup();
+  setTxData16(0x1234);
+  Wire.begin();
+  busResetStats();
+  for (uint32_t i = 0; i < loops; ++i) {
+    for (uint8_t k = 0; k < FIFO_READ / 2; ++k) {
+      histPush((uint16_t)(i * (FIFO_READ / 2) + k), (uint16_t)((i + k) * 997));
+    }
+    errors += readRegisters(Wire, I2C_SLAVE_ADDRESS, I2C_REG_VALUE, regs, I2C_NUM_REGS) != I2C_NUM_REGS;
+    errors += readRegisters(Wire, I2C_SLAVE_ADDRESS, I2C_REG_FIFO, regs, FIFO_READ) != FIFO_READ;
+  }
+
+  double bound = worstHold(USI_CYCLES, (double)cpuHz / busHz);
+  printf("%4lu kHz %3lu MHz | %8.2f %8.2f | %6lu %6lu | %lu\n",
+         (unsigned long)(busHz / 1000), (unsigned long)(cpuHz / 1000000),
+         busStats.sclHoldMax / 1e6, bound * 1e6 / cpuHz,
+         (unsigned long)mcuStats.isrMaxCycles[SIM_IRQ_USI], (unsigned long)worstTotal(USI_CYCLES),
+         (unsigned long)errors);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief USI ISR benchmark
+///
+/// @param loops      Map + FIFO reads per clock combination
+//////////////////////////////////////////////////////////////////////////////
+void benchIsr(uint32_t loops) {
+  const UsiCycleModel* models[] = {&usiCyclesStandard, &usiCyclesFast};
+
+  printf("Cycle model (MSP430 at -Os, estimated), built ISR: %s\n", USI_CYCLES.name);
+  printf("State           | standard     | fast\n");
+  printf("                | hold  total  | hold  total\n");
+  printf("%-15s | %4u  %5u  | %4u  %5u\n", "(START, added)",
+         usiCyclesStandard.startRelease, usiCyclesStandard.startTotal,
+         usiCyclesFast.startRelease, usiCyclesFast.startTotal);
+  for (uint8_t s = 0; s < USI_STATES; ++s) {
+    printf("%-15s | %4u  %5u  | %4u  %5u\n", usiCyclesFast.state[s].name,
+           usiCyclesStandard.state[s].release, usiCyclesStandard.state[s].total,
+           usiCyclesFast.state[s].release, usiCyclesFast.state[s].total);
+  }
+
+  printf("WITH_STATS: %u cycles more per state, %u per START (included below)\n",
+         (unsigned)USI_STATS_CYCLES, (unsigned)USI_STATS_START_CYCLES);
+  printf("Worst case      | ISR [us]        | SCL hold [us]\n");
+  printf("                | 1 MHz   16 MHz  | 100k/1M 100k/16M 400k/1M 400k/16M\n");
+  for (const UsiCycleModel* m : models) {
+    uint32_t total = worstTotal(*m);
+    printf("%-15s | %6.1f  %6.2f  | %7.1f %8.2f %7.1f %8.2f\n", m->name,
+           total / 1.0, total / 16.0,
+           worstHold(*m, 10) / 1.0, worstHold(*m, 160) / 16.0,
+           worstHold(*m, 2.5) / 1.0, worstHold(*m, 40) / 16.0);
+  }
+
+  printf("Map + FIFO reads, %s ISR:\n", USI_CYCLES.name);
+  printf("Bus      CPU     | SCL hold [us]     | ISR [cyc]     | errors\n");
+  printf("                 | measured bound    | max    bound  |\n");
+  const uint32_t busClocks[] = {100000, 400000};
+  const uint32_t cpuClocks[] = {1000000, 16000000};
+  for (uint32_t bus : busClocks) {
+    for (uint32_t cpu : cpuClocks) {
+      runReads(bus, cpu, loops);
+    }
+  }
+  printf("ISR runs per state (last run):");
+  for (uint8_t s = 0; s < USI_STATES; ++s) {
+    printf(" %s %lu", USI_CYCLES.state[s].name, (unsigned long)mcuStats.usiStateCalls[s]);
+  }
+  printf(", START %lu\n", (unsigned long)mcuStats.usiStarts);
+}
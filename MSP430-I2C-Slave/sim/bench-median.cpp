@@ -0,0 +1,105 @@
+//////////////////////////////////////////////////////////////////////////////
+/// @file bench-median.cpp
+/// @brief Cycles per sample of the batch bubble-sort median (getMedian)
+///        compared with the streaming running median (medianPush).
+///
+///        The batch routine publishes one value per window; the running
+///        median publishes one value per sample. Both are fed with the same
+///        noisy ADC-like data. The result of medianPush is checked against
+///        a full sort of the current window.
+///
+//////////////////////////////////////////////////////////////////////////////
+
+#include <stdio.h>
+#include <string.h>
+
+#include "running-median.h"
+#include "bench.h"
+
+#define BENCH_MAX_WINDOW 31
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Deterministic ADC-like test data: slow ramp plus noise and spikes.
+///
+//////////////////////////////////////////////////////////////////////////////
+static uint16_t nextSample(uint32_t* seed) {
+  *seed = *seed * 1103515245u + 12345u;
+  uint16_t noise = (uint16_t)((*seed >> 16) & 0x00FF);
+  uint16_t val = (uint16_t)(30000 + ((*seed >> 24) & 0x07) * 10 + noise);
+  if ((*seed & 0x3F00) == 0) {
+    val ^= 0x4000;                          // Occasional spike
+  }
+  return val;
+}
+
+void benchMedian(uint32_t loops) {
+  uint32_t samples = loops * 10;
+  if (samples < 1000) {
+    samples = 1000;
+  }
+  samples -= samples % (3 * 5 * 7 * 11 * 13);
+  samples += 3 * 5 * 7 * 11 * 13;           // Multiple of most window sizes
+
+  printf("Window | getMedian   getMedian  | medianPush | speed-up  | check\n");
+  printf("       | [cyc/sample] [cyc/value] | [cyc/value] | per value |\n");
+  for (uint8_t n = 5; n <= BENCH_MAX_WINDOW; n += 2) {
+    uint16_t batch[BENCH_MAX_WINDOW];
+    uint16_t values[BENCH_MAX_WINDOW];
+    uint8_t slots[BENCH_MAX_WINDOW];
+    uint16_t history[BENCH_MAX_WINDOW];
+    RunningMedian rm;
+    volatile uint16_t sink = 0;
+    uint32_t seed = 1;
+    uint32_t published = 0;
+    uint32_t errors = 0;
+    uint8_t idx = 0;
+
+    // Batch median as in the former main loop
+    uint64_t t0 = hostCycles();
+    for (uint32_t i = 0; i < samples; ++i) {
+      batch[idx++] = nextSample(&seed);
+      if (idx == n) {
+        sink = getMedian(batch, n);
+        published++;
+        idx = 0;
+      }
+    }
+    uint64_t batchCycles = hostCycles() - t0;
+
+    // Running median, one value per sample
+    seed = 1;
+    medianInit(&rm, values, slots, n, nextSample(&seed));
+    t0 = hostCycles();
+    for (uint32_t i = 1; i < samples; ++i) {
+      sink = medianPush(&rm, nextSample(&seed));
+    }
+    uint64_t runCycles = hostCycles() - t0;
+
+    // Check against a full sort of the window
+    seed = 1;
+    uint16_t first = nextSample(&seed);
+    medianInit(&rm, values, slots, n, first);
+    for (uint8_t k = 0; k < n; ++k) {
+      history[k] = first;
+    }
+    for (uint32_t i = 1; i < 4000; ++i) {
+      uint16_t s = nextSample(&seed);
+      history[i % n] = s;
+      uint16_t got = medianPush(&rm, s);
+      memcpy(batch, history, n * sizeof(uint16_t));
+      if (got != getMedian(batch, n)) {
+        errors++;
+      }
+    }
+    (void)sink;
+
+    double perSampleBatch = (double)batchCycles / samples;
+    double perValueBatch = (double)batchCycles / published;
+    double perValueRun = (double)runCycles / (samples - 1);
+    printf("  %2u   | %10.1f  %10.1f  | %10.1f  | %7.1fx  | %s\n", n,
+           perSampleBatch, perValueBatch, perValueRun,
+           perValueBatch / perValueRun, errors ? "FAIL" : "ok");
+  }
+  printf("Cycles are host cycles (TSC). Per sample the batch routine is the\n"
+         "average over a window, but it only publishes once per window.\n");
+}
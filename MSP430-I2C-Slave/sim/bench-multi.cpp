@@ -0,0 +1,189 @@
+//////////////////////////////////////////////////////////////////////////////
+/// @file bench-multi.cpp
+/// @brief Multi-slave bus: the master scans the bus and polls every node
+///        it found with its own task (register mode).
+///
+///        Node 0x24 is the USI slave of lib/msp430-i2c, the other nodes
+///        are byte-level models of the same register map (peer-node.h).
+///        All nodes publish a new sample every 10 ms. The master setup()
+///        and loop() run unmodified.
+///
+//////////////////////////////////////////////////////////////////////////////
+
+#include <stdio.h>
+
+#include <Arduino.h>
+#include "info-flash.h"
+#include "msp430-i2c.h"
+#include "peer-node.h"
+#include "sample-history.h"
+#include "virtual-bus.h"
+#include "bench.h"
+
+#define BENCH_SAMPLE_US   10000             // Sample period of all nodes
+#define BENCH_NEW_ADDR    0x30              // Address change test
+#define BENCH_MAX_NODES   8                 // MAX_SLAVES of the master
+
+//////////////////////////////////////////////////////////////////////////////
+/// Forward declaration(s)
+//////////////////////////////////////////////////////////////////////////////
+
+void setup(void);
+void loop(void);
+void simMasterSetPollPeriod(uint32_t us);
+uint8_t simMasterNode(uint8_t idx, uint8_t* addr, uint32_t* reads, uint32_t* errors);
+
+static PeerNode peerNodes[BENCH_MAX_NODES];
+static SimTime nextSample;
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Slave main loop of src/main.c: publish a sample, handle the
+///        address request of the master.
+///
+//////////////////////////////////////////////////////////////////////////////
+static void usiNodeSample(uint16_t seq, uint16_t value) {
+  histPush(seq, value);
+  volatile uint8_t* tx = beginTxData();
+  putTxData16(tx, I2C_REG_VALUE, value);
+  putTxData16(tx, I2C_REG_COUNT, seq);
+  tx[I2C_REG_STATUS] = I2C_STATUS_RUNNING;
+  commitTxData();
+  if (I2C_CTRL(I2C_REG_CONFIG) & I2C_CFG_SAVE_ADDR) {
+    I2C_CTRL(I2C_REG_CONFIG) &= ~I2C_CFG_SAVE_ADDR;
+    uint8_t addr = I2C_CTRL(I2C_REG_ADDR);
+    if (infoSetSlaveAddr(addr)) {
+      i2cSetAddress(addr);
+    } else {
+      I2C_CTRL(I2C_REG_ADDR) = i2cGetAddress();
+    }
+  }
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Set up the USI slave and numNodes - 1 peers at the following
+///        addresses, then the master (bus scan).
+///
+//////////////////////////////////////////////////////////////////////////////
+static void setupBus(uint32_t busHz, uint8_t numNodes) {
+  simReset(1000000, busHz);
+  histInit();
+  i2cSlaveSetup();
+  i2cSetAddress(SLAVE_ADDR);
+  for (uint8_t i = 1; i < numNodes; ++i) {
+    peerNodeInit(&peerNodes[i], SLAVE_ADDR + i);
+    busAddPeer(&peerNodes[i].peer);
+  }
+  setup();
+  nextSample = simNow();
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Run master and nodes for some virtual time.
+///
+/// @param until      Virtual end time
+/// @param numNodes   Nodes on the bus
+/// @param seq        Sequence number of the samples
+//////////////////////////////////////////////////////////////////////////////
+static void runNodes(SimTime until, uint8_t numNodes, uint16_t& seq) {
+  while (simNow() < until) {
+    loop();
+    while (simNow() >= nextSample) {
+      seq++;
+      usiNodeSample(seq, 0x7400 + (seq & 0x0F));
+      for (uint8_t i = 1; i < numNodes; ++i) {
+        peerNodePublish(&peerNodes[i], 0x7400 + i * 0x100 + (seq & 0x0F), seq);
+      }
+      nextSample += (SimTime)BENCH_SAMPLE_US * (SIM_PS_PER_SEC / 1000000);
+    }
+  }
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief One bus configuration. Prints one result line.
+///
+//////////////////////////////////////////////////////////////////////////////
+static void runMulti(uint32_t busHz, uint8_t numNodes, uint32_t pollUs, uint32_t seconds) {
+  uint16_t seq = 0;
+
+  setupBus(busHz, numNodes);
+  SimTime scanTime = simNow();
+  simMasterSetPollPeriod(pollUs);
+  busResetStats();
+
+  SimTime start = simNow();
+  runNodes(start + (SimTime)seconds * SIM_PS_PER_SEC, numNodes, seq);
+  double elapsed = (double)(simNow() - start) / SIM_PS_PER_SEC;
+
+  uint8_t found = simMasterNode(0, NULL, NULL, NULL);
+  uint32_t total = 0, minRate = 0xFFFFFFFF, maxRate = 0, errors = 0;
+  for (uint8_t i = 0; i < found; ++i) {
+    uint8_t addr;
+    uint32_t reads, err;
+    simMasterNode(i, &addr, &reads, &err);
+    uint32_t rate = (uint32_t)(reads / elapsed);
+    total += reads;
+    errors += err;
+    minRate = rate < minRate ? rate : minRate;
+    maxRate = rate > maxRate ? rate : maxRate;
+  }
+  printf("%4lu kHz %5lu us %2u | %2u %6.1f | %7.0f %6lu %6lu %6lu | %5.1f %%\n",
+         (unsigned long)(busHz / 1000), (unsigned long)pollUs, numNodes, found,
+         (double)scanTime / (SIM_PS_PER_SEC / 1000),
+         total / elapsed, (unsigned long)(found ? minRate : 0), (unsigned long)maxRate,
+         (unsigned long)errors, 100.0 * (double)busStats.busTime / (double)(simNow() - start));
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Address change over the serial command "addr": the USI node
+///        moves from SLAVE_ADDR to BENCH_NEW_ADDR, the master finds it
+///        there after the rescan.
+///
+//////////////////////////////////////////////////////////////////////////////
+static void runAddrChange(void) {
+  uint16_t seq = 0;
+  uint8_t addr = 0;
+  uint32_t reads = 0, errors = 0;
+  char cmd[16];
+
+  setupBus(100000, 2);
+  snprintf(cmd, sizeof(cmd), "addr %x %x\n", SLAVE_ADDR, BENCH_NEW_ADDR);
+  simSerialInput(cmd);
+  runNodes(simNow() + SIM_PS_PER_SEC / 2, 2, seq);     // Command, settle, rescan
+
+  uint8_t found = simMasterNode(0, NULL, NULL, NULL);
+  bool moved = false;
+  for (uint8_t i = 0; i < found; ++i) {
+    simMasterNode(i, &addr, &reads, &errors);
+    moved = moved || (addr == BENCH_NEW_ADDR && reads > 0);
+  }
+  printf("Address change 0x%02X -> 0x%02X: %s (info flash 0x%02X, %u nodes after rescan)\n",
+         SLAVE_ADDR, BENCH_NEW_ADDR, moved && infoSlaveAddr() == BENCH_NEW_ADDR ? "ok" : "FAILED",
+         infoSlaveAddr(), found);
+
+  infoSetSlaveAddr(SLAVE_ADDR);             // Back to the default for the other benchmarks
+  i2cSetAddress(SLAVE_ADDR);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Multi-slave benchmark: 1 .. 8 nodes at 100 kHz and 400 kHz.
+///
+/// @param loops      Virtual run time per combination in 1/100 s
+//////////////////////////////////////////////////////////////////////////////
+void benchMulti(uint32_t loops) {
+  uint32_t seconds = loops / 100 ? loops / 100 : 1;
+
+  printf("%lu s per run, node sample period %u us, register read = %u bytes\n",
+         (unsigned long)seconds, (unsigned)BENCH_SAMPLE_US, (unsigned)I2C_NUM_REGS);
+  printf("Bus    period    nodes| found scan ms| reads/s  min/node max/node errors | bus busy\n");
+  const uint32_t busClocks[] = {100000, 400000};
+  const uint8_t counts[] = {1, 2, 4, 8};
+  const uint32_t polls[] = {20000, 5000};
+  for (uint32_t bus : busClocks) {
+    for (uint32_t p : polls) {
+      for (uint8_t n : counts) {
+        runMulti(bus, n, p, seconds);
+      }
+    }
+  }
+  runAddrChange();
+}
@@ -0,0 +1,172 @@
+//////////////////////////////////////////////////////////////////////////////
+/// @file bench-pec.cpp
+/// @brief SMBus PEC: the CRC-8 implementations of the slave (smbus-pec.c,
+///        all three built with PEC_ALL_IMPL) and of the master (smbusPec.h).
+///
+///        1. Host cycles per byte of every implementation.
+///        2. MSP430 cycles per byte (estimates of smbus-pec.c) and what they
+///           add to the SCL stretch of the USI ISR.
+///        3. Register reads of the USI slave with bit errors injected on
+///           the bus: how many corrupted transfers the PEC catches.
+///
+///        The implementations are checked by test/test_pec.
+///
+//////////////////////////////////////////////////////////////////////////////
+
+#include <stdio.h>
+#include <string.h>
+
+#include <Wire.h>
+#include "slaveProtocol.h"
+#include "msp430-i2c.h"
+#include "sample-history.h"
+#include "smbus-pec.h"
+#include "smbusPec.h"
+#include "virtual-bus.h"
+#include "bench.h"
+
+#define BENCH_BYTES   4096                  // Bytes per timing run
+
+static uint8_t data[BENCH_BYTES];
+static volatile uint8_t sink;
+
+static uint32_t rngState = 0x2468ACE1;      // State of nextRandom() (bench.h)
+
+static uint8_t slaveTable(uint8_t crc, uint8_t val) {
+  return pecTable[(uint8_t)(crc ^ val)];    // What pecUpdate() expands to
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Host cycles per byte of one implementation
+///
+//////////////////////////////////////////////////////////////////////////////
+template <uint8_t (*UPDATE)(uint8_t, uint8_t)>
+static double hostCyclesPerByte(uint32_t loops) {
+  uint64_t best = UINT64_MAX;
+
+  for (uint32_t l = 0; l < loops; ++l) {
+    uint8_t crc = 0;
+    uint64_t t0 = hostCycles();
+    for (uint16_t i = 0; i < BENCH_BYTES; ++i) {
+      crc = UPDATE(crc, data[i]);
+    }
+    uint64_t t = hostCycles() - t0;
+    sink = crc;
+    if (t < best) {
+      best = t;
+    }
+  }
+  return (double)best / BENCH_BYTES;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// Fault injection: every bit read by the master flips with a probability
+//////////////////////////////////////////////////////////////////////////////
+
+static uint32_t flipThreshold;              // Probability * 2^32
+static bool flipped;                        // A bit of this transfer flipped
+
+static uint8_t flipBits(uint8_t val) {
+  for (uint8_t b = 0; b < 8; ++b) {
+    if (nextRandom(rngState) < flipThreshold) {
+      val ^= (uint8_t)(1 << b);
+      flipped = true;
+    }
+  }
+  return val;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Register reads (VALUE .. ADDR + PEC) of the USI slave at a bit
+///        error rate. Prints one result line.
+///
+//////////////////////////////////////////////////////////////////////////////
+static void runErrors(double bitErrorRate, uint32_t reads) {
+  uint8_t expected[I2C_NUM_REGS];
+  uint8_t regs[I2C_NUM_REGS];
+  uint32_t corrupted = 0;
+  uint32_t detected = 0;
+  uint32_t accepted = 0;                    // Wrong data passed as good
+  uint32_t lost = 0;                        // Short reads (address NACK ...)
+
+  simReset(1000000, 100000);
+  histInit();
+  i2cSlaveSetup();
+  volatile uint8_t* tx = beginTxData();
+  putTxData16(tx, I2C_REG_VALUE, 0x7412);
+  putTxData16(tx, I2C_REG_MIN, 0x7400);
+  putTxData16(tx, I2C_REG_MAX, 0x7433);
+  putTxData16(tx, I2C_REG_COUNT, 0x1234);
+  tx[I2C_REG_STATUS] = I2C_STATUS_RUNNING;
+  commitTxData();
+  Wire.begin();
+  readRegisters(Wire, I2C_SLAVE_ADDRESS, I2C_REG_VALUE, expected, I2C_NUM_REGS);
+  readRegisters(Wire, I2C_SLAVE_ADDRESS, I2C_REG_VALUE, expected, I2C_NUM_REGS); // 1st took I2C_STATUS_NEW
+
+  flipThreshold = (uint32_t)(bitErrorRate * 4294967295.0);
+  busReadHook = flipBits;
+  busResetStats();
+  for (uint32_t i = 0; i < reads; ++i) {
+    flipped = false;
+    uint8_t result = readRegisters(Wire, I2C_SLAVE_ADDRESS, I2C_REG_VALUE, regs, I2C_NUM_REGS);
+    corrupted += flipped;
+    if (result == I2C_PEC_ERROR) {
+      detected++;
+    } else if (result != I2C_NUM_REGS) {
+      lost++;
+    } else if (memcmp(regs, expected, I2C_NUM_REGS) != 0) {
+      accepted++;
+    }
+  }
+  busReadHook = NULL;
+
+  printf("%8.0e | %7lu %9lu %8lu %8lu %5lu | %5.2f\n", bitErrorRate,
+         (unsigned long)reads, (unsigned long)corrupted, (unsigned long)detected,
+         (unsigned long)accepted, (unsigned long)lost, (double)busStats.bytes / reads);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief PEC benchmark
+///
+/// @param loops      Timing runs per implementation, reads per error rate
+//////////////////////////////////////////////////////////////////////////////
+void benchPec(uint32_t loops) {
+  for (uint16_t i = 0; i < BENCH_BYTES; ++i) {
+    data[i] = (uint8_t)nextRandom(rngState);
+  }
+
+  // MSP430 estimates (smbus-pec.c): cycles per byte and flash (code + table)
+  struct Impl {
+    const char* name;
+    double host;
+    double hostMaster;
+    uint16_t mspCycles;
+    uint16_t mspFlash;
+  } impls[] = {
+    {"bitwise", hostCyclesPerByte<pecBitwise>(loops),
+                hostCyclesPerByte<Pec<PecImpl::Bitwise>::update>(loops), 70, 30},
+    {"nibble",  hostCyclesPerByte<pecNibble>(loops),
+                hostCyclesPerByte<Pec<PecImpl::Nibble>::update>(loops), 35, 16 + 40},
+    {"table",   hostCyclesPerByte<slaveTable>(loops),
+                hostCyclesPerByte<Pec<PecImpl::Table>::update>(loops), 5, 256 + 6},
+  };
+
+  // A read of the register map: addr+W, ptr, addr+R, 11 data bytes, PEC
+  const uint32_t pecBytes = 3 + I2C_NUM_REGS + 1;
+  printf("Impl    | host cyc/B       | MSP430 (est.)       | per map read   | SCL hold/B [us]\n");
+  printf("        | slave  master    | cyc/B  flash  F2013 | cycles         |  1 MHz  16 MHz\n");
+  for (const Impl& m : impls) {
+    printf("%-7s | %5.2f  %5.2f     | %5u  %4u B %4.1f %% | %6lu         | %6.1f  %6.2f\n",
+           m.name, m.host, m.hostMaster, m.mspCycles, m.mspFlash, 100.0 * m.mspFlash / 2048,
+           (unsigned long)(m.mspCycles * pecBytes), m.mspCycles / 1.0, m.mspCycles / 16.0);
+  }
+  printf("(1 bit at 100 kHz = 10 us, at 400 kHz = 2.5 us; the ISR frame alone is ~%u cycles)\n",
+         (unsigned)(SIM_IRQ_LATENCY_CYCLES + SIM_ISR_FRAME_CYCLES + SIM_ISR_BODY_CYCLES));
+
+  printf("Register reads with bit errors (100 kHz, table on the master):\n");
+  printf("BER      |   reads corrupted detected accepted  lost | B/read\n");
+  const double rates[] = {0, 1e-4, 1e-3, 1e-2};
+  for (double r : rates) {
+    runErrors(r, loops);
+  }
+}
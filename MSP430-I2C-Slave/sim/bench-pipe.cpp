@@ -0,0 +1,382 @@
+//////////////////////////////////////////////////////////////////////////////
+/// @file bench-pipe.cpp
+/// @brief Dual-core pipeline of the master (DUAL_CORE, RP2040): SpscQueue
+///        and CorePipe of Arduino-I2C-Master-Slave.
+///
+///        Queue: cost of a push and a pop on one thread, then one thread
+///        pushes a counter through the queue and another checks the order.
+///
+///        Pipeline (virtual time): the slave produces samples at a fixed
+///        rate into the history FIFO of lib/sample-history (HIST_SIZE
+///        bytes). The bus core reads it in chunks of BENCH_CHUNK bytes like
+///        readHistory() (again at once while the FIFO is not drained, else
+///        after BENCH_POLL_US), a read takes BENCH_BUS_US. The output core
+///        works like pipeTask(): it decodes the chunks with HistoryDecoder
+///        and formats every sample as text like printSample() (OUT_TEXT),
+///        which takes format us on the M0+. The single core master does
+///        both in turn, the dual core master hands the chunks through
+///        CorePipe; the core with the earlier clock always takes the next
+///        step. Every BENCH_STATUS_MS the bus core hands over a status line
+///        of two pipe items.
+///        At the end the text is parsed again: every sample in order with
+///        its value (gaps only where the decoder counted dropped samples:
+///        FIFO overflow), every status line whole.
+///
+///        Threads: the same pipeline at host speed with the bus core and
+///        the output core on two threads, output checked the same way. The
+///        bus core waits while the pipe is full and keeps the FIFO from
+///        overflowing: nothing may be lost.
+///
+//////////////////////////////////////////////////////////////////////////////
+
+#include <stdio.h>
+#include <string.h>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <string>
+#include <thread>
+
+#include "corePipe.h"
+#include "historyDecoder.h"
+#include "sample-history.h"
+#include "spscQueue.h"
+#include "bench.h"
+
+#define BENCH_QUEUE_DEPTH     64            // Slots of the queue test
+#define BENCH_PIPE_DEPTH      64            // PIPE_DEPTH of main.cpp
+#define BENCH_CHUNK           8             // HISTORY_CHUNK of main.cpp
+#define BENCH_BUS_US          270           // Chunk read: 12 bytes at 400 kHz
+#define BENCH_POLL_US         100           // Bus core: next look at a drained FIFO
+#define BENCH_STATUS_MS       100           // Status line of the bus core
+#define BENCH_ADDR            0x24
+
+typedef std::chrono::steady_clock Clock;
+
+static double secsSince(Clock::time_point t0) {
+  return std::chrono::duration<double>(Clock::now() - t0).count();
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Push and pop on one thread, then the counter through two threads
+///
+//////////////////////////////////////////////////////////////////////////////
+static void runQueue(uint32_t items) {
+  static SpscQueue<uint32_t, BENCH_QUEUE_DEPTH> queue;
+  volatile uint32_t sink = 0;
+  uint32_t full = 0;
+  uint32_t wrong = 0;
+
+  queue.clear();
+  Clock::time_point t0 = Clock::now();
+  for (uint32_t i = 0; i < items; ++i) {
+    queue.push(i);
+    sink = sink + *queue.front();
+    queue.pop();
+  }
+  double pairNs = secsSince(t0) * 1e9 / items;
+
+  queue.clear();
+  t0 = Clock::now();
+  std::thread consumer([&]() {
+    for (uint32_t expect = 0; expect < items;) {
+      uint32_t* val = queue.front();
+      if (val == nullptr) {
+        std::this_thread::yield();          // One host CPU: let the producer run
+        continue;
+      }
+      wrong += *val != expect++;
+      queue.pop();
+    }
+  });
+  for (uint32_t i = 0; i < items; ++i) {
+    while (!queue.push(i)) {
+      full++;
+      std::this_thread::yield();
+    }
+  }
+  consumer.join();
+  double secs = secsSince(t0);
+  printf("Queue %u slots, push + pop on one thread: %.1f host ns\n", (unsigned)BENCH_QUEUE_DEPTH, pairNs);
+  printf("Two threads (%u host CPUs): %lu items, %.2f M items/s, found full %lu times, max depth %u, wrong order %lu\n",
+         std::thread::hardware_concurrency(), (unsigned long)items, items / secs / 1e6,
+         (unsigned long)full, queue.maxDepth, (unsigned long)wrong);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// Pipeline
+//////////////////////////////////////////////////////////////////////////////
+
+static const char statusText[] = "the rest of this line fills two pipe items";
+
+static CorePipe<BENCH_PIPE_DEPTH> testPipe;
+static HistoryDecoder benchDecoder;
+static std::string serialOut;               // What would leave the serial port
+static uint16_t pushed[0x10000];            // Pushed values by sequence number
+static uint32_t produced;                   // Samples pushed by the slave
+static uint64_t* formatClock;               // Clock of the core that formats (ns)
+static uint64_t formatNs;                   // M0+ time of printSample()
+
+static void printSample(uint16_t seq, uint16_t value) {
+  char outText[48];
+  int len = snprintf(outText, sizeof(outText), "0x%02X #%u: %u -> %1.4f V\r\n",
+                     BENCH_ADDR, seq, value, (0.6 / 65535) * value);
+  serialOut.append(outText, len);
+  *formatClock += formatNs;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Output stage: one item like pipeTask() of main.cpp
+///
+//////////////////////////////////////////////////////////////////////////////
+static void outputItem(const PipeItem& item) {
+  if (item.type == PIPE_TEXT) {
+    serialOut.append((const char*)item.data, item.len);
+    if (item.flags & PIPE_EOL) {
+      serialOut.append("\r\n");
+    }
+    return;
+  }
+  if (item.flags & PIPE_NEW) {
+    benchDecoder = HistoryDecoder();
+  } else if (item.flags & PIPE_RESET) {
+    benchDecoder.reset();
+  }
+  benchDecoder.feed(item.data, item.len, printSample);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Slave: push the samples due until count
+///
+//////////////////////////////////////////////////////////////////////////////
+static void slaveProduce(uint32_t count) {
+  for (; produced < count; ++produced) {
+    uint16_t seq = (uint16_t)(produced + 1);
+    pushed[seq] = (uint16_t)(pushed[(uint16_t)(seq - 1)] + (seq * 2473u) % 61 - 30);
+    histPush(seq, pushed[seq]);
+  }
+}
+
+static int statusLine(char* text, size_t size, uint32_t status) {
+  return snprintf(text, size, "Status %lu: %s", (unsigned long)status, statusText);
+}
+
+static void pipeStart(void) {
+  histInit();
+  produced = 0;
+  testPipe.clear();
+  benchDecoder = HistoryDecoder();
+  serialOut.clear();
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Parse the output again
+///
+/// @return uint32_t  Errors
+//////////////////////////////////////////////////////////////////////////////
+static uint32_t checkOutput(uint32_t* samples, uint32_t* lines) {
+  uint32_t errors = 0;
+  uint32_t gaps = 0;
+  uint32_t lastStatus = 0;
+  bool first = true;
+  uint16_t next = 0;
+  size_t pos = 0;
+
+  *samples = *lines = 0;
+  while (pos < serialOut.size()) {
+    size_t end = serialOut.find("\r\n", pos);
+    if (end == std::string::npos) {
+      errors++;
+      break;
+    }
+    std::string line = serialOut.substr(pos, end - pos);
+    pos = end + 2;
+    unsigned addr, seq, value;
+    unsigned long status;
+    int text = 0;
+    if (sscanf(line.c_str(), "0x%x #%u: %u ->", &addr, &seq, &value) == 3) {
+      if (!first && seq != next) {
+        gaps += (uint16_t)(seq - next);
+      }
+      first = false;
+      next = seq + 1;
+      errors += addr != BENCH_ADDR || pushed[seq] != value;
+      (*samples)++;
+    } else if (sscanf(line.c_str(), "Status %lu: %n", &status, &text) == 1 && text &&
+               !strcmp(line.c_str() + text, statusText)) {
+      errors += (*lines && status <= lastStatus);
+      lastStatus = status;
+      (*lines)++;
+    } else {
+      errors++;
+    }
+  }
+  return errors + (gaps != benchDecoder.dropped);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Run slave and master in virtual time. Prints one line.
+///
+/// @param dual       Bus core and output core
+/// @param rate       Slave samples/s
+/// @param format     M0+ time of printSample() (us)
+/// @param ms         Run time
+//////////////////////////////////////////////////////////////////////////////
+static void runPipe(bool dual, uint32_t rate, uint32_t format, uint32_t ms) {
+  std::deque<uint64_t> stamps;              // Publish time of the items in the pipe
+  uint64_t busClock = 0;
+  uint64_t outClock = 0;
+  uint64_t outBusy = 0;
+  uint64_t end = ms * 1000000ULL;
+  uint64_t nextStatus = BENCH_STATUS_MS * 1000000ULL;
+  uint32_t status = 0;
+  uint8_t flags = PIPE_NEW;
+  uint32_t samples, lines;
+  char text[80];
+
+  pipeStart();
+  formatNs = format * 1000ULL;
+  while (busClock < end) {
+    if (dual && outClock < busClock) {      // Output core
+      PipeItem* item = testPipe.queue.front();
+      if (item == nullptr) {
+        outClock = busClock;                // Idle until the bus core hands over more
+        continue;
+      }
+      if (stamps.front() > outClock) {
+        outClock = stamps.front();
+      }
+      uint64_t t = outClock;
+      formatClock = &outClock;
+      outputItem(*item);
+      outBusy += outClock - t;
+      testPipe.queue.pop();
+      stamps.pop_front();
+      continue;
+    }
+    slaveProduce((uint32_t)(busClock * rate / 1000000000ULL));
+    if (busClock >= nextStatus) {
+      nextStatus += BENCH_STATUS_MS * 1000000ULL;
+      int len = statusLine(text, sizeof(text), ++status);
+      if (!dual) {
+        serialOut.append(text, len);
+        serialOut.append("\r\n");
+      } else if (testPipe.text((const uint8_t*)text, len, true)) {
+        stamps.insert(stamps.end(), (len + PIPE_DATA - 1) / PIPE_DATA, busClock);
+      }
+    }
+    PipeItem local;
+    uint8_t* chunk = local.data;
+    if (histLevel() == 0 || (dual && (chunk = testPipe.beginChunk(0, BENCH_ADDR, flags)) == nullptr)) {
+      busClock += BENCH_POLL_US * 1000ULL;  // Pipe full: the data stays in the FIFO
+      continue;
+    }
+    busClock += BENCH_BUS_US * 1000ULL;
+    slaveProduce((uint32_t)(busClock * rate / 1000000000ULL));
+    for (uint8_t i = 0; i < BENCH_CHUNK; ++i) {
+      chunk[i] = histRead();
+    }
+    if (dual) {
+      testPipe.commitChunk(BENCH_CHUNK);
+      stamps.push_back(busClock);
+    } else {
+      local.type = PIPE_CHUNK;
+      local.flags = flags;
+      local.len = BENCH_CHUNK;
+      uint64_t t = busClock;
+      formatClock = &busClock;
+      outputItem(local);
+      outBusy += busClock - t;
+    }
+    flags = 0;
+  }
+  uint32_t errors = checkOutput(&samples, &lines);
+  double secs = busClock / 1e9;
+  printf("%-9s | %6lu %6u | %9.0f | %6.2f %% | %5.1f %% | %5u | %8lu | %7lu | %6lu | %lu\n",
+         dual ? "two cores" : "one core", (unsigned long)rate, (unsigned)format, samples / secs,
+         100.0 * benchDecoder.dropped / produced, 100.0 * outBusy / busClock,
+         testPipe.queue.maxDepth, (unsigned long)testPipe.chunksFull, (unsigned long)testPipe.textDropped,
+         (unsigned long)lines, (unsigned long)errors);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Bus core and output core on two threads, host speed
+///
+/// @param chunks     Chunk reads
+//////////////////////////////////////////////////////////////////////////////
+static void runThreads(uint32_t chunks) {
+  std::atomic<bool> done(false);
+  uint32_t samples, lines;
+  uint32_t status = 0;
+  char text[80];
+
+  pipeStart();
+  formatNs = 0;
+  std::thread output([&]() {
+    uint64_t clock = 0;
+    formatClock = &clock;
+    for (;;) {
+      bool last = done.load(std::memory_order_acquire);
+      PipeItem* item = testPipe.queue.front();
+      if (item == nullptr) {
+        if (last) {
+          break;
+        }
+        std::this_thread::yield();
+        continue;
+      }
+      outputItem(*item);
+      testPipe.queue.pop();
+    }
+  });
+  Clock::time_point t0 = Clock::now();
+  uint8_t flags = PIPE_NEW;
+  for (uint32_t i = 0; i < chunks; ++i) {
+    while (histLevel() < HIST_SIZE - HIST_KEY_LEN) {   // Keep the FIFO full, no overflow
+      slaveProduce(produced + 1);
+    }
+    if (i % 100 == 0) {
+      int len = statusLine(text, sizeof(text), ++status);
+      while (!testPipe.text((const uint8_t*)text, len, true)) {
+        std::this_thread::yield();
+      }
+    }
+    uint8_t* chunk;
+    while ((chunk = testPipe.beginChunk(0, BENCH_ADDR, flags)) == nullptr) {
+      std::this_thread::yield();
+    }
+    for (uint8_t j = 0; j < BENCH_CHUNK; ++j) {
+      chunk[j] = histRead();
+    }
+    testPipe.commitChunk(BENCH_CHUNK);
+    flags = 0;
+  }
+  done.store(true, std::memory_order_release);
+  output.join();
+  double secs = secsSince(t0);
+  uint32_t errors = checkOutput(&samples, &lines);
+  printf("Two threads: %lu samples, %.2f M samples/s, max depth %u, status lines %lu of %lu, dropped %lu, errors %lu\n",
+         (unsigned long)samples, samples / secs / 1e6, testPipe.queue.maxDepth, (unsigned long)lines,
+         (unsigned long)status, (unsigned long)benchDecoder.dropped, (unsigned long)errors);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Pipeline benchmark
+///
+/// @param loops      Queue items / 1000, virtual run time per master in ms
+//////////////////////////////////////////////////////////////////////////////
+void benchPipe(uint32_t loops) {
+  static const uint32_t configs[][2] = {{4000, 50}, {12000, 50}, {12000, 100}};
+
+  runQueue(loops * 1000);
+  printf("%lu ms per master, FIFO %u bytes, chunk %u bytes, bus %u us per chunk read, pipe %u items of %u bytes\n",
+         (unsigned long)loops, (unsigned)HIST_SIZE, (unsigned)BENCH_CHUNK, (unsigned)BENCH_BUS_US,
+         (unsigned)BENCH_PIPE_DEPTH, (unsigned)sizeof(PipeItem));
+  printf("Master    | rate   format | samples/s | dropped  | format  | max   | chunk    | lines   | status | errors\n");
+  printf("          | 1/s    us     |           | (FIFO)   | busy    | depth | put off  | dropped | lines  |\n");
+  for (const uint32_t* c : configs) {
+    runPipe(false, c[0], c[1], loops);
+    runPipe(true, c[0], c[1], loops);
+  }
+  runThreads(loops * 5);
+}
@@ -0,0 +1,195 @@
+//////////////////////////////////////////////////////////////////////////////
+/// @file bench-profiles.cpp
+/// @brief Acquisition profiles of lib/sd16-acq (WITH_PROFILES): samples per
+///        second, noise floor, step response and CPU duty of every profile.
+///
+///        The master selects the profile over I2C (setProfile()), the slave
+///        runs slaveStep() of src/main.c with all features of the build
+///        (median window per profile, run time from the cycle model of
+///        mcu-model.h). The achieved rate is the one the master sees: COUNT
+///        read at the begin and the end of the measurement.
+///
+///        Noise model of the ADC input (assumption, replace by the values
+///        of a board): a constant level plus white gaussian noise per
+///        conversion result,
+///          sigma(OSR) = sqrt(FLOOR^2 + (Q * (256 / OSR)^2.5)^2) LSB,
+///        a floor (reference, input stage) and the quantization noise of
+///        the 2nd order modulator behind the sinc3 filter, which falls
+///        with OSR^2.5. The noise floor is the rms of the published values
+///        around their mean; noise-free bits = log2(65536 / (6.6 * rms)).
+///        1 LSB = 0.6 V / 65536 = 9.16 uV (unipolar, gain 1).
+///
+//////////////////////////////////////////////////////////////////////////////
+
+#include <math.h>
+#include <stdio.h>
+
+#include <Wire.h>
+#include "slaveProtocol.h"
+#include "msp430-i2c.h"
+#include "sd16-acq.h"
+#include "virtual-bus.h"
+#include "bench.h"
+
+#define BENCH_NOISE_FLOOR     1.2           // LSB rms, independent of the OSR
+#define BENCH_NOISE_Q         4.8           // LSB rms of the quantization noise at OSR 256
+#define BENCH_LEVEL           29696.37      // Input level (LSB)
+#define BENCH_STEP            4096.0        // Input step for the step response (LSB)
+#define BENCH_UV_PER_LSB      (600000.0 / 65536)
+
+#ifdef WITH_PROFILES
+
+// Copy of acqProfiles (sd16-acq.c), the median window is profileWindow (slave-loop.h)
+struct BenchProfile {
+  const char* name;
+  uint16_t osr;
+  uint8_t decimate;
+  uint8_t order;
+};
+static const BenchProfile profileTable[ACQ_PROFILES] = {
+  {"normal", 256,  0,  1},
+  {"fast",   256,  4,  1},
+  {"smooth", 512,  16, 1},
+  {"slow",   1024, 64, 2},
+};
+
+static double benchInput;                   // Level of the ADC input
+
+static uint32_t rngState = 0x2468ACE1;      // State of nextRandom() (bench.h)
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Standard normal random number (Box-Muller)
+///
+//////////////////////////////////////////////////////////////////////////////
+static double nextGauss(void) {
+  double u1 = (nextRandom(rngState) + 1.0) / 4294967297.0;
+  double u2 = nextRandom(rngState) / 4294967296.0;
+  return sqrt(-2.0 * log(u1)) * cos(2.0 * M_PI * u2);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Noise of one conversion result at an OSR (see file header)
+///
+//////////////////////////////////////////////////////////////////////////////
+static double noiseSigma(uint16_t osr) {
+  double q = BENCH_NOISE_Q * pow(256.0 / osr, 2.5);
+  return sqrt(BENCH_NOISE_FLOOR * BENCH_NOISE_FLOOR + q * q);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief ADC model input: benchInput plus the noise of the OSR set in
+///        SD16CCTL0.
+///
+//////////////////////////////////////////////////////////////////////////////
+static uint16_t noiseAdc(void) {
+  uint16_t ctl = *mcuRaw16(SIM_SD16CCTL0);
+  uint16_t osr = (ctl & SD16XOSR) ? ((ctl & SD16OSR_128) ? 1024 : 512) : 256 >> ((ctl >> 8) & 0x03);
+  double v = floor(benchInput + noiseSigma(osr) * nextGauss() + 0.5);
+
+  return v < 0 ? 0 : (v > 65535 ? 65535 : (uint16_t)v);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Switch to a profile over I2C, measure it. Prints one line.
+///
+/// @param profile    ACQ_PROFILE_x
+/// @param samples    Outputs of the noise measurement
+//////////////////////////////////////////////////////////////////////////////
+static void runProfile(uint8_t profile, uint32_t samples) {
+  const BenchProfile& p = profileTable[profile];
+  uint16_t count0 = 0;
+  uint16_t count1 = 0;
+  uint8_t active = 0xFF;
+  double sum = 0;
+  double sumSq = 0;
+
+  simReset(1000000, 100000);
+  mcuSetAdcSource(noiseAdc);
+  benchInput = BENCH_LEVEL;
+  benchSlaveStart();
+  Wire.begin();
+  bool ok = setProfile(Wire, I2C_SLAVE_ADDRESS, profile);
+  slaveStep(&benchSlave);                 // Takes the profile over
+  ok = ok && readProfile(Wire, I2C_SLAVE_ADDRESS, active) && active == profile;
+  for (uint8_t i = 0; i < 2 * profileWindow[profile] + 4; ++i) {
+    slaveStep(&benchSlave);               // Settle: SD16 filter, CIC, median
+  }
+
+  mcuResetStats();
+  SimTime t0 = simNow();
+  ok = ok && readRegister16(Wire, I2C_SLAVE_ADDRESS, I2C_REG_COUNT, count0);
+  for (uint32_t i = 0; i < samples; ++i) {
+    double v = slaveStep(&benchSlave);
+    sum += v;
+    sumSq += v * v;
+  }
+  ok = ok && readRegister16(Wire, I2C_SLAVE_ADDRESS, I2C_REG_COUNT, count1);
+  double total = (double)(simNow() - t0);
+  double isr = (double)simCycles((uint32_t)mcuStats.sleepIsrCycles);    // The ISRs in the main loop are in its time
+  double duty = (total - (double)mcuStats.sleepTime + isr) / total;
+  double rate = (uint16_t)(count1 - count0) / (total / SIM_PS_PER_SEC);
+  double mean = sum / samples;
+  double rms = sqrt(fmax(sumSq / samples - mean * mean, 0));
+
+  // Step response: input step, time until the published value is at 90 %
+  SimTime tStep = simNow();
+  benchInput = BENCH_LEVEL + BENCH_STEP;
+  SimTime settle = 0;
+  for (uint32_t i = 0; i < 100000 && !settle; ++i) {
+    if (slaveStep(&benchSlave) >= BENCH_LEVEL + 0.9 * BENCH_STEP) {
+      settle = simNow() - tStep;
+    }
+  }
+
+  double nominal = p.decimate ? 1e6 / p.osr / p.decimate : ACQ_SAMPLE_RATE;
+  printf("%u %-6s | %4u | %2u x %u | %6u | %8.1f | %8.1f | %5.2f | %6.2f | %6.1f | %9.1f | %6.2f %% | %s\n",
+         (unsigned)profile, p.name, (unsigned)p.osr, (unsigned)(p.decimate ? p.decimate : 1),
+         (unsigned)p.order, (unsigned)profileWindow[profile], nominal, rate, rms, rms * BENCH_UV_PER_LSB,
+         rms > 0 ? log2(65536.0 / (6.6 * rms)) : 16.0, (double)settle * 1e3 / SIM_PS_PER_SEC,
+         100.0 * duty, ok ? "ok" : "FAILED");
+  mcuSetAdcSource(NULL);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief An invalid profile is rejected, the active one stays
+///
+//////////////////////////////////////////////////////////////////////////////
+static void runInvalid(void) {
+  uint8_t active = 0xFF;
+
+  simReset(1000000, 100000);
+  benchSlaveStart();
+  Wire.begin();
+  bool ok = setProfile(Wire, I2C_SLAVE_ADDRESS, ACQ_PROFILE_SMOOTH);
+  slaveStep(&benchSlave);
+  uint8_t invalid = ACQ_PROFILES + 3;       // setProfile() refuses it: raw register write
+  ok = ok && writeRegisters(Wire, I2C_SLAVE_ADDRESS, I2C_REG_PROFILE, &invalid, 1);
+  slaveStep(&benchSlave);
+  ok = ok && readProfile(Wire, I2C_SLAVE_ADDRESS, active);
+  printf("Invalid profile %u: %s, active %u\n", (unsigned)invalid,
+         ok && active == ACQ_PROFILE_SMOOTH ? "rejected" : "FAILED", (unsigned)active);
+}
+#endif
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Acquisition profile benchmark
+///
+/// @param loops      Outputs per profile for the noise measurement
+//////////////////////////////////////////////////////////////////////////////
+void benchProfiles(uint32_t loops) {
+#ifdef WITH_PROFILES
+  printf("Noise model per result: %.1f LSB floor, %.1f LSB at OSR 256 (%.2f / %.2f / %.2f LSB rms at OSR 256 / 512 / 1024)\n",
+         BENCH_NOISE_FLOOR, BENCH_NOISE_Q, noiseSigma(256), noiseSigma(512), noiseSigma(1024));
+  printf("MCLK = SMCLK = 1 MHz, bus 100 kHz, main loop %lu cycles per sample, rate from COUNT read by the master\n",
+         (unsigned long)mcuStepCycles());
+  printf("Profile  | OSR  | R x CIC | median | S/s nom. | S/s      | LSB   | uV rms | noise- | step 90%% | CPU      | switch\n");
+  printf("         |      |         | window |          | achieved | rms   |        | free b | ms        | duty     | (I2C)\n");
+  for (uint8_t p = 0; p < ACQ_PROFILES; ++p) {
+    runProfile(p, loops);
+  }
+  runInvalid();
+#else
+  (void)loops;
+  printf("Slave built without WITH_PROFILES: OSR 256, ACQ_SAMPLE_RATE only\n");
+#endif
+}
@@ -0,0 +1,159 @@
+//////////////////////////////////////////////////////////////////////////////
+/// @file bench-scan.cpp
+/// @brief Channel scan of lib/sd16-acq (WITH_SCAN): every timer period
+///        converts all channels, each goes through its own median filter
+///        and the master reads all of them in one transaction from the
+///        channel block I2C_REG_SCAN (readNodeScan()).
+///
+///        The slave loop is the one of src/main.c. Every input of the ADC
+///        model delivers a ramp of its own (base + 16 per scan), so the
+///        median of a window W lags (W - 1) / 2 scans behind. Every block
+///        read is checked: all channels have to belong to the scan given
+///        by the COUNT of the same block.
+///
+//////////////////////////////////////////////////////////////////////////////
+
+#include <stdio.h>
+
+#include <Wire.h>
+#include "slaveProtocol.h"
+#include "msp430-i2c.h"
+#include "running-median.h"
+#include "sd16-acq.h"
+#include "virtual-bus.h"
+#include "bench.h"
+
+#define BENCH_MEDIAN_CYCLES   120           // medianPush() per channel
+#define BENCH_PUBLISH_CYCLES  150           // Publishing incl. channel block
+#define BENCH_STEP            16            // Ramp step per scan
+
+#ifdef WITH_SCAN
+
+// Inputs of scanTable (sd16-acq.c) and the ramp base of every channel
+static const uint8_t benchInput[SCAN_CHANNELS] = {SD16INCH_1, SD16INCH_5, SD16INCH_6, SD16INCH_2};
+static const uint16_t benchBase[SCAN_CHANNELS] = {0x7400, 0x2600, 0x8100, 0x1000};
+static uint16_t benchScans;                 // Scans started (channel 0 conversions)
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief ADC model input: a ramp per channel, selected by the mux.
+///
+//////////////////////////////////////////////////////////////////////////////
+static uint16_t scanAdc(void) {
+  uint8_t input = *mcuRaw8(SIM_SD16INCTL0) & 0x07;
+
+  for (uint8_t ch = 0; ch < SCAN_CHANNELS; ++ch) {
+    if (benchInput[ch] == input) {
+      if (ch == 0) {
+        benchScans++;
+      }
+      return benchBase[ch] + BENCH_STEP * (uint16_t)(benchScans - 1);
+    }
+  }
+  return 0;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Median of channel ch after scan count (see file header).
+///
+//////////////////////////////////////////////////////////////////////////////
+static uint16_t expected(uint8_t ch, uint16_t count) {
+  uint16_t lag = ((ch == 0 ? MEDIAN_WINDOW : SCAN_WINDOW) - 1) / 2;
+  return benchBase[ch] + BENCH_STEP * (count > lag ? count - lag : 0);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Run the loop of src/main.c for a number of scans, the master
+///        reads the channel block after every scan. Prints one line.
+///
+//////////////////////////////////////////////////////////////////////////////
+static void runScan(uint32_t busHz, uint32_t scans) {
+  uint16_t values[MEDIAN_WINDOW + (SCAN_CHANNELS - 1) * SCAN_WINDOW];
+  uint8_t slots[MEDIAN_WINDOW + (SCAN_CHANNELS - 1) * SCAN_WINDOW];
+  RunningMedian filter[SCAN_CHANNELS];
+  uint16_t scan[SCAN_CHANNELS];
+  uint32_t reads = 0;
+  uint32_t failed = 0;
+  uint32_t wrong = 0;
+  SimTime wakeMax = 0;
+  SimTime readTime = 0;
+
+  simReset(1000000, busHz);
+  mcuSetAdcSource(scanAdc);
+  benchScans = 0;
+  i2cSlaveSetup();
+  sd16Setup();
+  sd16Scan(scan);
+  medianInit(&filter[0], values, slots, MEDIAN_WINDOW, scan[0]);
+  for (uint8_t ch = 1; ch < SCAN_CHANNELS; ++ch) {
+    medianInit(&filter[ch], values + MEDIAN_WINDOW + (ch - 1) * SCAN_WINDOW,
+               slots + MEDIAN_WINDOW + (ch - 1) * SCAN_WINDOW, SCAN_WINDOW, scan[ch]);
+  }
+  acqStart();
+  SimTime t0 = simNow();
+  Wire.begin();
+  mcuResetStats();
+  for (uint32_t i = 1; i <= scans; ++i) {
+    acqWaitScan(scan);
+    SimTime wake = (simNow() - t0) % (SIM_PS_PER_SEC / ACQ_SAMPLE_RATE);
+    if (wake > wakeMax) {
+      wakeMax = wake;
+    }
+    for (uint8_t ch = 0; ch < SCAN_CHANNELS; ++ch) {
+      scan[ch] = medianPush(&filter[ch], scan[ch]);
+    }
+    simDelayCycles(SCAN_CHANNELS * BENCH_MEDIAN_CYCLES + BENCH_PUBLISH_CYCLES);
+    volatile uint8_t* tx = beginTxData();
+    putTxData16(tx, I2C_REG_VALUE, scan[0]);
+    putTxData16(tx, I2C_REG_COUNT, (uint16_t)i);
+    putTxData16(tx, I2C_SCAN_DATA(I2C_REG_SCAN), (uint16_t)i);
+    for (uint8_t ch = 0; ch < SCAN_CHANNELS; ++ch) {
+      putTxData16(tx, I2C_SCAN_DATA(I2C_REG_SCAN + 2 + 2 * ch), scan[ch]);
+    }
+    commitTxData();
+
+    NodeScan block;
+    SimTime r0 = simNow();
+    bool ok = readNodeScan(Wire, I2C_SLAVE_ADDRESS, block);
+    readTime += simNow() - r0;
+    reads++;
+    if (!ok) {
+      failed++;
+      continue;
+    }
+    for (uint8_t ch = 0; ch < SCAN_CHANNELS; ++ch) {
+      if (block.value[ch] != expected(ch, block.count)) {
+        wrong++;
+        break;
+      }
+    }
+  }
+
+  printf("%3lu kHz  | %9.2f | %7.2f | %10.1f | %10.1f | %5lu | %6lu | %lu\n",
+         (unsigned long)(busHz / 1000), (double)mcuStats.conversions / scans,
+         (double)wakeMax * 1e3 / SIM_PS_PER_SEC,
+         (double)mcuStats.isrCycles[SIM_IRQ_SD16] / scans,
+         (double)readTime * 1e6 / SIM_PS_PER_SEC / reads,
+         (unsigned long)reads, (unsigned long)failed, (unsigned long)wrong);
+  mcuSetAdcSource(NULL);
+}
+#endif
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Channel scan benchmark at 100 and 400 kHz
+///
+/// @param loops      Number of scans per run
+//////////////////////////////////////////////////////////////////////////////
+void benchScan(uint32_t loops) {
+#ifdef WITH_SCAN
+  printf("SCAN_CHANNELS = %u, ACQ_SAMPLE_RATE = %u Hz, windows %u / %u, block %u bytes, MCLK = 1 MHz\n",
+         (unsigned)SCAN_CHANNELS, (unsigned)ACQ_SAMPLE_RATE, (unsigned)MEDIAN_WINDOW,
+         (unsigned)SCAN_WINDOW, (unsigned)SCAN_SIZE);
+  printf("Bus      | conv/scan | scan ms | SD16 ISR   | block read | reads | failed | wrong\n");
+  printf("         |           | (wake)  | cyc./scan  |  us (1 tx) |       |        |\n");
+  runScan(100000, loops);
+  runScan(400000, loops);
+#else
+  (void)loops;
+  printf("Slave built without WITH_SCAN: single input A1\n");
+#endif
+}
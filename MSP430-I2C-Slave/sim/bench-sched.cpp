@@ -0,0 +1,161 @@
+//////////////////////////////////////////////////////////////////////////////
+/// @file bench-sched.cpp
+/// @brief Cooperative scheduler of the master (register mode): release to
+///        start latency of every task at poll periods down to 1 ms, with
+///        the slave at 1 MHz and 16 MHz.
+///
+///        The master setup()/loop() run unmodified. The slave publishes a
+///        new sample (registers and history FIFO) every 10 ms between two
+///        loop() runs; its acquisition is not simulated here. The master
+///        CPU time is not modelled except for the clock reads, so the
+///        latency comes from the bus transactions and the serial stage.
+///
+//////////////////////////////////////////////////////////////////////////////
+
+#include <stdio.h>
+
+#include <Arduino.h>
+#include "historyDecoder.h"
+#include "msp430-i2c.h"
+#include "sample-history.h"
+#include "taskScheduler.h"
+#include "virtual-bus.h"
+#include "bench.h"
+
+#define BENCH_SAMPLE_US   10000             // Slave sample period
+
+//////////////////////////////////////////////////////////////////////////////
+/// Forward declaration(s)
+//////////////////////////////////////////////////////////////////////////////
+
+void setup(void);
+void loop(void);
+void simMasterSetPollPeriod(uint32_t us);
+uint8_t simMasterTasks(const SchedTask** tasks);
+const HistoryDecoder* simMasterHistory(void);
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Latency below which 99 % of the releases started (upper limit
+///        of the histogram bin).
+///
+//////////////////////////////////////////////////////////////////////////////
+static const char* p99(const SchedTask& t) {
+  static char text[16];
+  uint32_t sum = 0;
+  for (uint8_t b = 0; b < SCHED_HIST_BINS; ++b) {
+    sum += t.hist[b];
+    if (sum * 100ULL >= t.runs * 99ULL) {
+      if (b == SCHED_HIST_BINS - 1) {
+        snprintf(text, sizeof(text), ">%lu", (unsigned long)schedBinLimits[b - 1]);
+      } else {
+        snprintf(text, sizeof(text), "<=%lu", (unsigned long)schedBinLimits[b]);
+      }
+      return text;
+    }
+  }
+  return "-";
+}
+
+static const SchedTask* findTask(const char* name) {
+  const SchedTask* tasks;
+  uint8_t n = simMasterTasks(&tasks);
+  for (uint8_t i = 0; i < n; ++i) {
+    if (!strncmp(tasks[i].name, name, strlen(name))) {   // "poll" finds "poll24"
+      return &tasks[i];
+    }
+  }
+  return NULL;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Run master and slave for some seconds of virtual time.
+///
+/// @param mclk       MSP430 clock (SCL stretching of the slave)
+/// @param busHz      SCL frequency
+/// @param pollUs     Period of the register poll task
+/// @param seconds    Virtual run time
+/// @param details    Print the histograms of all tasks
+//////////////////////////////////////////////////////////////////////////////
+static void runSched(uint32_t mclk, uint32_t busHz, uint32_t pollUs, uint32_t seconds, bool details) {
+  uint16_t seq = 0;
+  uint16_t value = 0x7400;
+
+  simReset(mclk, busHz);
+  histInit();
+  i2cSlaveSetup();
+  setup();
+  simMasterSetPollPeriod(pollUs);
+
+  SimTime end = simNow() + (SimTime)seconds * SIM_PS_PER_SEC;
+  SimTime nextSample = simNow() + (SimTime)BENCH_SAMPLE_US * (SIM_PS_PER_SEC / 1000000);
+  while (simNow() < end) {
+    loop();
+    while (simNow() >= nextSample) {        // Slave main loop: publish
+      seq++;
+      value += (uint16_t)((seq * 7) % 9) - 4;
+      histPush(seq, value);
+      volatile uint8_t* tx = beginTxData();
+      putTxData16(tx, I2C_REG_VALUE, value);
+      putTxData16(tx, I2C_REG_COUNT, seq);
+      commitTxData();
+      nextSample += (SimTime)BENCH_SAMPLE_US * (SIM_PS_PER_SEC / 1000000);
+    }
+  }
+
+  const SchedTask* poll = findTask("poll");
+  const SchedTask* fifo = findTask("fifo");
+  const HistoryDecoder* hist = simMasterHistory();
+  printf("%2lu MHz %4lu kHz %5lu us | %6lu %5lu %6lu %7s | %5lu %6lu | %6lu %6lu %5lu\n",
+         (unsigned long)(mclk / 1000000), (unsigned long)(busHz / 1000), (unsigned long)pollUs,
+         (unsigned long)poll->runs, (unsigned long)poll->misses,
+         (unsigned long)poll->maxLatency, p99(*poll),
+         (unsigned long)fifo->misses, (unsigned long)fifo->maxRun,
+         (unsigned long)seq, (unsigned long)hist->samples, (unsigned long)hist->dropped);
+
+  if (details) {
+    const SchedTask* tasks;
+    uint8_t n = simMasterTasks(&tasks);
+    printf("  Task      period   runs  miss latmax runmax | latency [us]:");
+    for (uint8_t b = 0; b < SCHED_HIST_BINS - 1; ++b) {
+      printf(" <=%lu", (unsigned long)schedBinLimits[b]);
+    }
+    printf(" more\n");
+    for (uint8_t i = 0; i < n; ++i) {
+      const SchedTask& t = tasks[i];
+      printf("  %-8s %7lu %6lu %5lu %6lu %6lu |              ", t.name,
+             (unsigned long)t.period, (unsigned long)t.runs, (unsigned long)t.misses,
+             (unsigned long)t.maxLatency, (unsigned long)t.maxRun);
+      for (uint8_t b = 0; b < SCHED_HIST_BINS; ++b) {
+        printf(" %lu", (unsigned long)t.hist[b]);
+      }
+      printf("\n");
+    }
+  }
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Scheduler benchmark at 100 kHz and 400 kHz, the slave at 1 MHz
+///        and 16 MHz and poll periods from 10 ms down to 1 ms.
+///
+/// @param loops      Virtual run time per combination in 1/100 s
+//////////////////////////////////////////////////////////////////////////////
+void benchSched(uint32_t loops) {
+  uint32_t seconds = loops / 100 ? loops / 100 : 1;
+
+  printf("%lu s per run, slave sample period %u us, HIST_SIZE = %u bytes\n",
+         (unsigned long)seconds, (unsigned)BENCH_SAMPLE_US, (unsigned)HIST_SIZE);
+  printf("MCLK   Bus    poll      |          poll task          |  fifo task   |     history\n");
+  printf("                         |   runs  miss latmax    p99  |  miss runmax | pushed decoded dropped\n");
+  const uint32_t clocks[] = {1000000, 16000000};
+  const uint32_t busClocks[] = {100000, 400000};
+  const uint32_t polls[] = {10000, 5000, 4000, 3000, 2000, 1000};
+  for (uint32_t mclk : clocks) {
+    for (uint32_t bus : busClocks) {
+      for (uint32_t p : polls) {
+        runSched(mclk, bus, p, seconds, false);
+      }
+    }
+  }
+  printf("All tasks, MCLK 1 MHz, 100 kHz, poll 5000 us:\n");
+  runSched(1000000, 100000, 5000, seconds, true);
+}
@@ -0,0 +1,189 @@
+//////////////////////////////////////////////////////////////////////////////
+/// @file bench-serial.cpp
+/// @brief Serial output formats of the master: text with sprintf("%f"),
+///        text with the integer fixed-point formatter and COBS framed
+///        binary records (Arduino-I2C-Master-Slave/lib/serialRecord).
+///
+///        The decode stage of the master (printSample) is fed with samples
+///        as fast as the text buffer takes them, the serial stage drains it
+///        at 115200 baud. Everything that leaves the UART is parsed again
+///        and checked (sequence, value, CRC).
+///
+//////////////////////////////////////////////////////////////////////////////
+
+#include <stdio.h>
+
+#include <Arduino.h>
+#include "msp430-i2c.h"
+#include "serialRecord.h"
+#include "virtual-bus.h"
+#include "bench.h"
+
+#define BENCH_SECONDS     2                 // Virtual run time per format
+#define BENCH_SPACE       64                // Free buffer space before a sample is formatted
+
+//////////////////////////////////////////////////////////////////////////////
+/// Forward declaration(s)
+//////////////////////////////////////////////////////////////////////////////
+
+void setup(void);
+void simMasterSetFormat(uint8_t format);
+uint16_t simMasterOutFree(void);
+void simMasterSerial(void);
+void simMasterPrintSample(uint16_t seq, uint16_t value);
+
+static const char* formatNames[] = {"text", "fixed", "cobs"};
+
+//////////////////////////////////////////////////////////////////////////////
+/// Receiver: parses the serial output of the master
+//////////////////////////////////////////////////////////////////////////////
+
+static uint8_t rxFormat;
+static uint8_t rxBuf[REC_FRAME_MAX + 64];
+static uint16_t rxLen;
+static uint32_t rxRecords;                  // Samples received
+static uint32_t rxErrors;                   // Damaged records, wrong sequence or value
+static uint16_t rxSeq;
+
+static uint16_t benchValue(uint16_t seq) {
+  return (uint16_t)(seq * 2473u);           // All byte values incl. 0x00
+}
+
+static void rxSample(uint16_t seq, uint16_t value) {
+  if (seq != (uint16_t)(rxSeq + 1) || value != benchValue(seq)) {
+    rxErrors++;
+  }
+  rxSeq = seq;
+  rxRecords++;
+}
+
+static void rxRecord(void) {
+  if (rxFormat == 2) {                      // COBS frame
+    uint8_t rec[REC_FRAME_MAX];
+    uint16_t n = unframeRecord(rxBuf, rxLen, rec);
+    if (n == REC_SAMPLE_LEN && rec[0] == REC_SAMPLE) {
+      rxSample(((uint16_t)rec[2] << 8) | rec[3], ((uint16_t)rec[4] << 8) | rec[5]);
+    } else {
+      rxErrors++;
+    }
+  } else {                                  // "0x24 #seq: value -> x.xxxx V"
+    unsigned addr, seq, value;
+    rxBuf[rxLen] = 0;
+    if (sscanf((const char*)rxBuf, "0x%x #%u: %u", &addr, &seq, &value) == 3) {
+      rxSample((uint16_t)seq, (uint16_t)value);
+    } else {
+      rxErrors++;
+    }
+  }
+}
+
+static void rxTap(const uint8_t* data, size_t len) {
+  uint8_t end = (rxFormat == 2) ? 0x00 : '\n';
+  for (size_t i = 0; i < len; ++i) {
+    if (data[i] == end) {
+      rxRecord();
+      rxLen = 0;
+    } else if (rxLen < sizeof(rxBuf) - 1) {
+      rxBuf[rxLen++] = data[i];
+    }
+  }
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Run one output format. Prints one result line.
+///
+//////////////////////////////////////////////////////////////////////////////
+static void runFormat(uint8_t format) {
+  uint16_t seq = 0;
+  uint64_t cycles = 0;
+
+  simReset(1000000, 100000);
+  i2cSlaveSetup();
+  setup();                                  // Scan finds the USI slave
+  simMasterSetFormat(format);
+  while (simMasterOutFree() < 2047) {       // Drain the setup output
+    simMasterSerial();
+    simWait(SIM_PS_PER_SEC / 10000);
+  }
+  uint32_t bytes0 = Serial.bytesWritten;
+  rxFormat = format;
+  rxLen = 0;
+  rxRecords = rxErrors = 0;
+  rxSeq = 0;
+  simSerialTap = rxTap;
+
+  SimTime end = simNow() + (SimTime)BENCH_SECONDS * SIM_PS_PER_SEC;
+  while (simNow() < end) {
+    if (simMasterOutFree() >= BENCH_SPACE) {
+      seq++;
+      uint64_t t0 = hostCycles();
+      simMasterPrintSample(seq, benchValue(seq));
+      cycles += hostCycles() - t0;
+    } else {
+      simMasterSerial();
+      simWait(SIM_PS_PER_SEC / 20000);      // 50 us
+    }
+  }
+  simSerialTap = NULL;
+
+  uint32_t bytes = Serial.bytesWritten - bytes0;
+  double perRecord = rxRecords ? (double)bytes / rxRecords : 0.0;
+  printf("%-6s | %6.1f | %8.0f | %8.0f %8.0f | %6lu\n", formatNames[format],
+         perRecord, seq ? (double)cycles / seq : 0.0,
+         (double)rxRecords / BENCH_SECONDS, perRecord ? 11520.0 / perRecord : 0.0,
+         (unsigned long)rxErrors);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Fixed-point formatter against sprintf("%1.4f") for every 16 bit
+///        value, COBS round trip for records with 0x00 bytes.
+///
+//////////////////////////////////////////////////////////////////////////////
+static void checkFormatters(void) {
+  uint32_t textDiff = 0;
+  uint32_t cobsErrors = 0;
+  char ref[16];
+  char fix[16];
+
+  for (uint32_t v = 0; v <= 0xFFFF; ++v) {
+    snprintf(ref, sizeof(ref), "%1.4f", (0.6 / 65535) * v);
+    *appendFixed(fix, scaleRaw16((uint16_t)v, 6000), 4) = 0;
+    if (strcmp(ref, fix)) {
+      textDiff++;
+    }
+  }
+  for (uint16_t n = 1; n <= REC_MAX_LEN; ++n) {
+    uint8_t rec[REC_MAX_LEN + 2], frame[REC_FRAME_MAX], back[REC_FRAME_MAX];
+    for (uint16_t i = 0; i < n; ++i) {
+      rec[i] = (uint8_t)((i * 37 + n) % 5 ? i * 11 + n : 0);
+    }
+    uint8_t copy[REC_MAX_LEN];
+    memcpy(copy, rec, n);
+    uint16_t len = frameRecord(rec, n, frame);
+    bool clean = frame[len - 1] == 0 && memchr(frame, 0, len - 1) == NULL;
+    if (!clean || unframeRecord(frame, len - 1, back) != n || memcmp(back, copy, n)) {
+      cobsErrors++;
+    }
+    frame[len / 2] ^= 0x10;                 // Damaged frame must be rejected
+    if (unframeRecord(frame, len - 1, back) == n && !memcmp(back, copy, n)) {
+      cobsErrors++;
+    }
+  }
+  printf("Fixed-point text differs from sprintf(\"%%1.4f\") for %lu of 65536 values, "
+         "COBS/CRC round trip errors: %lu\n", (unsigned long)textDiff, (unsigned long)cobsErrors);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Serial output benchmark
+///
+//////////////////////////////////////////////////////////////////////////////
+void benchSerial(uint32_t loops) {
+  (void)loops;
+  checkFormatters();
+  printf("%d s per format, 115200 baud 8N1 (11520 bytes/s)\n", BENCH_SECONDS);
+  printf("Format | B/rec  | cyc/rec  | records/s   limit  | errors\n");
+  for (uint8_t f = 0; f < 3; ++f) {
+    runFormat(f);
+  }
+  printf("cyc/rec: host cycles of printSample() incl. queueing\n");
+}
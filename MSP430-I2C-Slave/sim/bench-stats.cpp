@@ -0,0 +1,153 @@
+//////////////////////////////////////////////////////////////////////////////
+/// @file bench-stats.cpp
+/// @brief Slave counters (lib/slave-stats) read over I2C, compared with
+///        what the native env counted itself.
+///
+///        The acquisition loop of src/main.c runs timer paced; after every
+///        sample the master reads the register map, every 5th sample a
+///        FIFO block. Injected on the bus:
+///        - a transfer to another address (NACK) every 10th sample
+///        - a read that is cut by a repeated START every 25th sample
+///          (abort), continued with another address (NACK)
+///        At the end the master reads the counter window with
+///        readNodeStats() (the "dump" command) and prints them next to the
+///        sim counts before and after that read (the ISR keeps counting
+///        while the window is read). The module itself is checked by
+///        test/test_stats.
+///
+//////////////////////////////////////////////////////////////////////////////
+
+#include <stdio.h>
+
+#include <Wire.h>
+#include "slaveProtocol.h"
+#include "msp430-i2c.h"
+#include "running-median.h"
+#include "sample-history.h"
+#include "sd16-acq.h"
+#include "slave-stats.h"
+#include "virtual-bus.h"
+#include "bench.h"
+
+#define BENCH_PROCESS_CYCLES  250           // medianPush() + publishing
+#define BENCH_OTHER_ADDR      0x30          // Nobody answers there
+#define BENCH_UNMAPPED_REG    0x2E          // Reads 0xFF: SDA stays free for the cut
+
+#ifdef WITH_STATS
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief A read of two unmapped registers, cut after the 1st byte by a
+///        repeated START to another address.
+///
+//////////////////////////////////////////////////////////////////////////////
+static void abortedRead(void) {
+  busStart();
+  busWriteByte(I2C_SLAVE_ADDRESS << 1);
+  busWriteByte(BENCH_UNMAPPED_REG);
+  busStart();
+  busWriteByte((I2C_SLAVE_ADDRESS << 1) | 0x01);
+  busReadByte(true);                        // The slave goes on with the 2nd byte
+  busStart();
+  busWriteByte(BENCH_OTHER_ADDR << 1);
+  busStop();
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Run the slave with bus traffic for a number of samples, then
+///        read and check the counters. Prints the comparison.
+///
+//////////////////////////////////////////////////////////////////////////////
+static void runStats(uint32_t busHz, uint32_t samples) {
+  uint16_t values[MEDIAN_WINDOW];
+  uint8_t slots[MEDIAN_WINDOW];
+  RunningMedian filter;
+  uint8_t regs[I2C_PEC_BLOCK];
+  uint32_t nacks = 0;
+  uint32_t aborts = 0;
+  uint32_t errors = 0;
+  SimTime latency = 0;
+  NodeStats stats;
+
+  simReset(1000000, busHz);
+  histInit();
+  i2cSlaveSetup();
+  sd16Setup();
+  medianInit(&filter, values, slots, MEDIAN_WINDOW, sd16Convert());
+  acqStart();
+  acqWait();                                // A previous run may have left a result
+  Wire.begin();
+  mcuResetStats();
+  statsClear();
+  for (uint32_t i = 1; i <= samples; ++i) {
+    uint16_t median = medianPush(&filter, acqWait());
+    simDelayCycles(BENCH_PROCESS_CYCLES);
+    histPush((uint16_t)i, median);
+    setTxData16(median);
+    STATS_PUBLISHED();
+    if (simNow() - mcuStats.lastConversion > latency) {
+      latency = simNow() - mcuStats.lastConversion;
+    }
+    errors += readRegisters(Wire, I2C_SLAVE_ADDRESS, I2C_REG_VALUE, regs, 2) != 2;
+    if (i % 5 == 0) {
+      errors += readRegisters(Wire, I2C_SLAVE_ADDRESS, I2C_REG_FIFO, regs, I2C_PEC_BLOCK) != I2C_PEC_BLOCK;
+    }
+    if (i % 10 == 0) {
+      readRegisters(Wire, BENCH_OTHER_ADDR, I2C_REG_VALUE, regs, 2);
+      nacks++;
+    }
+    if (i % 25 == 0) {
+      abortedRead();
+      aborts++;
+      nacks++;
+    }
+  }
+
+  McuStats before = mcuStats;
+  errors += !readNodeStats(Wire, I2C_SLAVE_ADDRESS, stats);
+  McuStats after = mcuStats;
+
+  printf("Bus %lu kHz, %lu samples, bus errors %lu\n",
+         (unsigned long)(busHz / 1000), (unsigned long)samples, (unsigned long)errors);
+  printf("Counter          |  sim before      I2C  sim after\n");
+  for (uint8_t s = 0; s < STATS_STATES; ++s) {
+    printf("ISR %-12s | %11lu %8u %10lu\n", USI_CYCLES.state[s].name,
+           (unsigned long)before.usiStateCalls[s], stats.isrState[s],
+           (unsigned long)after.usiStateCalls[s]);
+  }
+  printf("%-16s | %11lu %8u %10lu\n", "NACKed", (unsigned long)nacks, stats.nacks,
+         (unsigned long)nacks);
+  printf("%-16s | %11lu %8u %10lu\n", "aborted", (unsigned long)aborts, stats.aborts,
+         (unsigned long)aborts);
+  printf("%-16s | %11lu %8u %10lu\n", "conversions",
+         (unsigned long)before.conversions, stats.conversions, (unsigned long)after.conversions);
+
+  // The slave stamps in the SD16 ISR, after the end of the conversion
+  double tick = 1e6 / ACQ_TIMER_HZ;
+  double simUs = (double)latency * 1e6 / SIM_PS_PER_SEC;
+  double slaveUs = stats.latencyMax * tick;
+  printf("Latency max      | sim %.1f us, counter %u ticks = %.1f us (tick %.1f us)\n",
+         simUs, stats.latencyMax, slaveUs, tick);
+
+  clearNodeStats(Wire, I2C_SLAVE_ADDRESS);
+  readNodeStats(Wire, I2C_SLAVE_ADDRESS, stats);
+  printf("After clearNodeStats(): NACKed %u aborted %u conversions %u latency %u\n",
+         stats.nacks, stats.aborts, stats.conversions, stats.latencyMax);
+}
+#endif
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Counter benchmark at 100 and 400 kHz
+///
+/// @param loops      Number of samples per run
+//////////////////////////////////////////////////////////////////////////////
+void benchStats(uint32_t loops) {
+#ifdef WITH_STATS
+  printf("STATS_SIZE = %u bytes, ISR cost %u cycles per state, %u per START (model)\n",
+         (unsigned)STATS_SIZE, (unsigned)USI_STATS_CYCLES, (unsigned)USI_STATS_START_CYCLES);
+  runStats(100000, loops);
+  runStats(400000, loops);
+#else
+  (void)loops;
+  printf("Slave built without WITH_STATS: no counters, no code\n");
+#endif
+}
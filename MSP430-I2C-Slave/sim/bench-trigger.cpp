@@ -0,0 +1,233 @@
+//////////////////////////////////////////////////////////////////////////////
+/// @file bench-trigger.cpp
+/// @brief Triggered conversions of the slave (WITH_TRIGGER) vs. reading
+///        the timer paced median: trigger to data latency and the age of
+///        the value the master gets.
+///
+///        The slave runs slaveStep() of src/main.c (timer paced at
+///        ACQ_SAMPLE_RATE, median window MEDIAN_WINDOW, a triggered burst
+///        published as it is); it is released whenever an ISR leaves LPM0,
+///        also between the bytes of a transfer. The master runs a
+///        control cycle of BENCH_CYCLE_US, its clock BENCH_MASTER_PPM fast
+///        against the slave. Per cycle it either reads the map (paced) or
+///        writes I2C_CFG_TRIGGER and reads the map until STATUS has
+///        I2C_STATUS_TRIGGERED: back to back, every 500 us, once
+///        BENCH_WAIT_US after the write or on the data-ready line (a pulse
+///        before the end of the write is a paced sample). The master CPU
+///        is not modelled, but it does not act while slaveStep() runs (1.6
+///        ms per sample with the native build): a read that has the loop
+///        between two of its bytes takes that much longer.
+///
+///        The ADC input is a ramp of 1 LSB per BENCH_RAMP_US, so every
+///        value tells when it was converted (a burst mean: the middle of
+///        the burst). Age: from then to the end of the read that returns
+///        it. Latency: from the begin of the trigger write to the end of
+///        that read. A triggered value converted before the trigger is
+///        stale; a read without BUSY or TRIGGERED after a trigger, or none
+///        within BENCH_TIMEOUT_US, is an error.
+///
+//////////////////////////////////////////////////////////////////////////////
+
+#include <stdio.h>
+
+#include <Arduino.h>
+#include <Wire.h>
+#include "slaveProtocol.h"
+#include "msp430-i2c.h"
+#include "sd16-acq.h"
+#include "virtual-bus.h"
+#include "bench.h"
+
+#define BENCH_STEP_US         10            // Time step of the master between its events
+#define BENCH_MASTER_PPM      3700          // Master clock fast against the slave DCO
+#define BENCH_CYCLE_US        20000         // Control cycle of the master
+#define BENCH_RAMP_US         4             // ADC input: 1 LSB per 4 us, wraps after 262 ms
+#define BENCH_TIMEOUT_US      10000         // No result: error
+#define BENCH_WAIT_US         2000          // Burst of 4 at OSR 256: 1.8 ms
+
+#define US(x)                 ((SimTime)(x) * (SIM_PS_PER_SEC / 1000000))
+
+#ifdef WITH_TRIGGER
+
+enum BenchMode {
+  MODE_PACED,                               // Read the map, no trigger
+  MODE_POLL,                                // Trigger, read again at once while BUSY
+  MODE_POLL_500,                            // Trigger, read every 500 us
+  MODE_WAIT,                                // Trigger, wait for the burst, read (again after 200 us)
+  MODE_DRDY,                                // Trigger, read on the data-ready line
+};
+
+static uint32_t benchWakeups;
+static volatile bool benchReady;
+
+static uint16_t rampAdc(void) {
+  return (uint16_t)(simNow() / US(BENCH_RAMP_US));
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Time when the ramp had the value last
+///
+//////////////////////////////////////////////////////////////////////////////
+static SimTime rampTime(uint16_t value) {
+  uint64_t k = simNow() / US(BENCH_RAMP_US);
+  k -= (uint16_t)((uint16_t)k - value);
+  return k * US(BENCH_RAMP_US);
+}
+
+static void onReady(void) {
+  benchReady = true;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Slave main loop released? (also the byte hook of the bus)
+///
+//////////////////////////////////////////////////////////////////////////////
+static void slaveService(void) {
+  if (mcuStats.wakeups != benchWakeups) {
+    benchWakeups = mcuStats.wakeups;
+    slaveStep(&benchSlave);
+  }
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Run slave and master for some control cycles. Prints one line.
+///
+//////////////////////////////////////////////////////////////////////////////
+static void runMaster(BenchMode mode, const char* name, uint32_t cycles) {
+  uint32_t done = 0, reads = 0, stale = 0, errors = 0;
+  double latSum = 0, ageSum = 0;
+  SimTime latMax = 0, ageMax = 0, busTime = 0;
+
+  simReset(1000000, 100000);
+  mcuSetAdcSource(rampAdc);
+  benchSlaveStart();
+  benchReady = false;
+  Wire.begin();
+  uint8_t regs[I2C_NUM_REGS];
+  readRegisters(Wire, I2C_SLAVE_ADDRESS, I2C_REG_VALUE, regs, I2C_NUM_REGS);  // Whatever a previous run left
+  if (mode == MODE_DRDY) {
+    attachInterrupt(digitalPinToInterrupt(SIM_DRDY_PIN), onReady, FALLING);
+  }
+  SimTime cyclePs = US(BENCH_CYCLE_US) / 1000000 * (1000000 - BENCH_MASTER_PPM);
+  SimTime next = simNow() + US(200000);     // Median filled
+  bool waiting = false;
+  SimTime trigAt = 0, readAt = 0;
+  mcuResetStats();
+  benchWakeups = 0;
+  busByteHook = slaveService;
+  SimTime t0 = simNow();
+
+  while (done + errors < cycles) {
+    slaveService();
+    SimTime now = simNow();
+    if (!waiting && now >= next) {          // Next control cycle
+      next += cyclePs;
+      if (mode == MODE_PACED) {
+        waiting = true;
+        readAt = now;
+      } else {
+        SimTime b0 = simNow();
+        trigAt = b0;
+        if (!triggerConversion(Wire, I2C_SLAVE_ADDRESS)) {
+          errors++;
+          continue;
+        }
+        busTime += simNow() - b0;
+        benchReady = false;                 // Set before: a paced sample
+        waiting = true;
+        readAt = mode == MODE_POLL ? simNow() : mode == MODE_POLL_500 ? simNow() + US(500) :
+                 mode == MODE_WAIT ? simNow() + US(BENCH_WAIT_US) : SIM_NEVER;
+      }
+      continue;
+    }
+    if (waiting && mode == MODE_DRDY && benchReady) {
+      benchReady = false;
+      readAt = simNow();
+    }
+    if (!waiting || simNow() < readAt) {
+      SimTime t = simNow() + US(BENCH_STEP_US);
+      SimTime until = waiting ? readAt : next;
+      simWaitUntil(until < t ? until : t);
+      if (waiting && mode != MODE_PACED && simNow() - trigAt > US(BENCH_TIMEOUT_US)) {
+        errors++;
+        waiting = false;
+      }
+      continue;
+    }
+    SimTime b0 = simNow();
+    reads++;
+    uint8_t result = readRegisters(Wire, I2C_SLAVE_ADDRESS, I2C_REG_VALUE, regs, I2C_NUM_REGS);
+    busTime += simNow() - b0;
+    if (result != I2C_NUM_REGS) {
+      errors++;
+      waiting = false;
+      continue;
+    }
+    uint8_t status = regs[I2C_REG_STATUS];
+    uint16_t value = decodeInt<uint16_t>(regs + I2C_REG_VALUE);
+    if (mode != MODE_PACED) {
+      if (status & I2C_STATUS_BUSY) {       // Not yet: read again
+        readAt = mode == MODE_POLL ? simNow() : mode == MODE_DRDY ? SIM_NEVER : simNow() +
+                 (mode == MODE_POLL_500 ? US(500) : US(200));
+        continue;
+      }
+      if (!(status & I2C_STATUS_TRIGGERED)) {
+        errors++;
+        waiting = false;
+        continue;
+      }
+      SimTime lat = simNow() - trigAt;
+      latSum += (double)lat;
+      latMax = lat > latMax ? lat : latMax;
+    }
+    SimTime at = rampTime(value);
+    SimTime age = simNow() - at;
+    ageSum += (double)age;
+    ageMax = age > ageMax ? age : ageMax;
+    stale += mode != MODE_PACED && at < trigAt;
+    done++;
+    waiting = false;
+  }
+  if (mode == MODE_DRDY) {
+    detachInterrupt(digitalPinToInterrupt(SIM_DRDY_PIN));
+  }
+  busByteHook = NULL;
+  mcuSetAdcSource(NULL);
+  double secs = (double)(simNow() - t0) / SIM_PS_PER_SEC;
+
+  char lat[32] = "      -        -";
+  if (mode != MODE_PACED && done) {
+    snprintf(lat, sizeof(lat), "%7.2f  %7.2f", latSum / done * 1e3 / SIM_PS_PER_SEC,
+             (double)latMax * 1e3 / SIM_PS_PER_SEC);
+  }
+  printf("%-16s | %s | %7.2f  %7.2f | %5.2f | %6.2f | %6.0f | %7.0f | %5lu | %lu\n", name, lat,
+         done ? ageSum / done * 1e3 / SIM_PS_PER_SEC : 0.0, (double)ageMax * 1e3 / SIM_PS_PER_SEC,
+         done ? (double)reads / done : 0.0, done ? (double)busTime * 1e3 / SIM_PS_PER_SEC / done : 0.0,
+         mcuStats.conversions / secs, (double)mcuStats.isrCycles[SIM_IRQ_USI] / secs, (unsigned long)stale, (unsigned long)errors);
+}
+#endif
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Trigger benchmark
+///
+/// @param loops      Control cycles per master / 10
+//////////////////////////////////////////////////////////////////////////////
+void benchTrigger(uint32_t loops) {
+#ifdef WITH_TRIGGER
+  uint32_t cycles = loops / 10 ? loops / 10 : 1;
+
+  printf("%lu cycles of %u ms per master, %u samples/s, median of %u, burst of %u, bus 100 kHz, MCLK 1 MHz\n",
+         (unsigned long)cycles, BENCH_CYCLE_US / 1000, (unsigned)ACQ_SAMPLE_RATE, (unsigned)MEDIAN_WINDOW,
+         (unsigned)TRIG_BURST);
+  printf("Master           | latency ms       | age of value ms  | reads | bus ms | SD16/s | USI     | stale | errors\n");
+  printf("                 |     avg      max |     avg      max | /cycle| /cycle |        | cyc/s   |       |\n");
+  runMaster(MODE_PACED, "paced median", cycles);
+  runMaster(MODE_POLL, "trigger, poll", cycles);
+  runMaster(MODE_POLL_500, "trigger, 500 us", cycles);
+  runMaster(MODE_WAIT, "trigger, 2 ms", cycles);
+  runMaster(MODE_DRDY, "trigger, drdy", cycles);
+#else
+  (void)loops;
+  printf("Slave built without WITH_TRIGGER\n");
+#endif
+}
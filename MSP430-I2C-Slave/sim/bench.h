@@ -0,0 +1,63 @@
+//////////////////////////////////////////////////////////////////////////////
+/// @file bench.h
+/// @brief Benchmarks of the native env.
+///
+///        The benchmarks that need the slave firmware run its main loop
+///        (slaveStep() on benchSlave) as src/main.c does.
+///
+//////////////////////////////////////////////////////////////////////////////
+
+#ifndef _BENCH_H_
+#define _BENCH_H_
+
+#include <stdint.h>
+#include "slave-loop.h"
+
+//////////////////////////////////////////////////////////////////////////////
+/// Global variables
+//////////////////////////////////////////////////////////////////////////////
+
+extern SlaveLoop benchSlave;                // State of the slave main loop
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Pseudo random numbers (xorshift32), every benchmark has its own
+///        state, so its numbers do not depend on the others.
+///
+/// @param state      Seed, then the state of the generator
+/// @return uint32_t  Next number
+//////////////////////////////////////////////////////////////////////////////
+static inline uint32_t nextRandom(uint32_t& state) {
+  state ^= state << 13;
+  state ^= state >> 17;
+  state ^= state << 5;
+  return state;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// Forward declaration(s)
+//////////////////////////////////////////////////////////////////////////////
+
+uint64_t hostCycles(void);
+void benchSlaveStart(void);
+
+void benchBus(uint32_t loops);
+void benchMedian(uint32_t loops);
+void benchAcq(uint32_t loops);
+void benchHistory(uint32_t loops);
+void benchSched(uint32_t loops);
+void benchMulti(uint32_t loops);
+void benchSerial(uint32_t loops);
+void benchDecode(uint32_t loops);
+void benchPec(uint32_t loops);
+void benchIsr(uint32_t loops);
+void benchStats(uint32_t loops);
+void benchScan(uint32_t loops);
+void benchCal(uint32_t loops);
+void benchProfiles(uint32_t loops);
+void benchAgg(uint32_t loops);
+void benchDrdy(uint32_t loops);
+void benchPipe(uint32_t loops);
+void benchHal(uint32_t loops);
+void benchTrigger(uint32_t loops);
+
+#endif
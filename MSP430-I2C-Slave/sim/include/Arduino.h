@@ -0,0 +1,114 @@
+//////////////////////////////////////////////////////////////////////////////
+/// @file Arduino.h
+/// @brief Host stand-in for the Arduino core (native env only).
+///
+///        Just enough of the Arduino API to build the master program of
+///        Arduino-I2C-Master-Slave against the virtual bus. Time is the
+///        virtual bus time. The serial port is modelled as a TX FIFO that
+///        drains at the configured baud rate, so output costs the same
+///        time it would cost on the real link. Reading the clock
+///        (millis/micros) costs SIM_CLOCK_READ_US, so a loop() that only
+///        polls the clock makes progress. Received characters are injected
+///        with simSerialInput(). Pin interrupts run their handler at once
+///        when simPinWrite() changes the level of the pin; the data-ready
+///        line of the USI slave (port 2) drives SIM_DRDY_PIN as soon as a
+///        handler is attached.
+///
+//////////////////////////////////////////////////////////////////////////////
+
+#ifndef _SIM_ARDUINO_H_
+#define _SIM_ARDUINO_H_
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+//////////////////////////////////////////////////////////////////////////////
+/// Global definitions
+//////////////////////////////////////////////////////////////////////////////
+
+typedef uint8_t byte;
+
+#define OUTPUT        1
+#define INPUT         0
+#define INPUT_PULLUP  2
+#define HIGH          1
+#define LOW           0
+#define PIN_LED       2
+#define CHANGE        1                     // attachInterrupt() modes
+#define FALLING       2
+#define RISING        3
+#define NOT_AN_INTERRUPT -1
+#define SIM_PINS      20
+#define digitalPinToInterrupt(p)  ((p) < SIM_PINS ? (p) : NOT_AN_INTERRUPT)   // Every GPIO (ESP8266, RP2040)
+#define SIM_DRDY_PIN  14                    // Wired to P2.6 of the USI slave (WITH_DRDY), pull-up (DATA_READY_PIN)
+
+#define SIM_SERIAL_FIFO   128               // TX FIFO size of the modelled UART
+#define SIM_CLOCK_READ_US 1                 // Cost of millis()/micros() incl. loop overhead
+#define SIM_SERIAL_RX     128               // RX buffer for simSerialInput()
+
+extern bool simDelayEnabled;                // false: delay() returns at once
+extern bool simSerialEcho;                  // true: serial output to stdout
+extern void (*simSerialTap)(const uint8_t* data, size_t len);   // Serial output, or NULL
+
+//////////////////////////////////////////////////////////////////////////////
+/// Stand-in for the serial port
+//////////////////////////////////////////////////////////////////////////////
+class HardwareSerial {
+  public:
+    void begin(unsigned long baud);
+    size_t write(const uint8_t* data, size_t len);
+    size_t write(uint8_t data) { return write(&data, 1); }
+    int availableForWrite(void);
+    int available(void);
+    int read(void);
+
+    size_t print(const char* text) { return write((const uint8_t*)text, strlen(text)); }
+    size_t print(long val) { return printf_("%ld", val); }
+    size_t print(unsigned long val) { return printf_("%lu", val); }
+    size_t print(int val) { return print((long)val); }
+    size_t print(unsigned int val) { return print((unsigned long)val); }
+    size_t print(double val) { return printf_("%.2f", val); }
+    template <typename T>
+    size_t println(T val) { size_t n = print(val); return n + print("\r\n"); }
+    size_t println(void) { return print("\r\n"); }
+
+    uint32_t bytesWritten;                  // Total bytes sent
+    uint32_t bytesWhileBlocked;             // Bytes that had to wait for FIFO space
+
+  private:
+    size_t printf_(const char* fmt, ...);
+    unsigned long baudRate = 115200;
+};
+
+extern HardwareSerial Serial;
+
+//////////////////////////////////////////////////////////////////////////////
+/// Stand-in for the RP2040 object of the pico core (DUAL_CORE of the
+/// master builds, but the sim runs it on core 0 only)
+//////////////////////////////////////////////////////////////////////////////
+class SimRp2040 {
+  public:
+    int cpuid(void) { return 0; }
+};
+
+extern SimRp2040 rp2040;
+
+//////////////////////////////////////////////////////////////////////////////
+/// Forward declaration(s)
+//////////////////////////////////////////////////////////////////////////////
+
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+unsigned long millis(void);
+unsigned long micros(void);
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t val);
+int digitalRead(uint8_t pin);
+void attachInterrupt(uint8_t irq, void (*isr)(void), int mode);
+void detachInterrupt(uint8_t irq);
+void simPinWrite(uint8_t pin, uint8_t level);
+void simSerialInput(const char* text);
+
+#endif
@@ -0,0 +1,39 @@
+//////////////////////////////////////////////////////////////////////////////
+/// @file Wire.h
+/// @brief Host stand-in for the Arduino Wire library (native env only).
+///
+///        All transfers are clocked bit by bit over the virtual bus.
+///
+//////////////////////////////////////////////////////////////////////////////
+
+#ifndef _SIM_WIRE_H_
+#define _SIM_WIRE_H_
+
+#include <Arduino.h>
+
+#define SIM_WIRE_BUFFER   32                // Same as the AVR/ESP8266 cores
+
+class TwoWire {
+  public:
+    void begin(void) {}
+    void setClock(uint32_t hz);
+    uint8_t requestFrom(int address, int quantity, int sendStop = 1);
+    void beginTransmission(int address);
+    size_t write(uint8_t data);
+    size_t write(const uint8_t* data, size_t len);
+    uint8_t endTransmission(bool sendStop = true);
+    int available(void) { return rxLen - rxIdx; }
+    int read(void) { return (rxIdx < rxLen) ? rxBuf[rxIdx++] : -1; }
+
+  private:
+    uint8_t rxBuf[SIM_WIRE_BUFFER];
+    uint8_t rxLen = 0;
+    uint8_t rxIdx = 0;
+    uint8_t txBuf[SIM_WIRE_BUFFER];
+    uint8_t txLen = 0;
+    uint8_t txAddr = 0;
+};
+
+extern TwoWire Wire;
+
+#endif
@@ -0,0 +1,277 @@
+//////////////////////////////////////////////////////////////////////////////
+/// @file msp430.h
+/// @brief Host stand-in for the msp430.h device header (native env only).
+///
+///        Every peripheral register is mapped onto a mocked register file.
+///        The access goes through simReg8()/simReg16(), so the MCU model
+///        can count the register accesses of an ISR for its cycle model,
+///        let time pass in the main loop and update peripheral state
+///        (TAR, SD16MEM0) on access.
+///
+//////////////////////////////////////////////////////////////////////////////
+
+#ifndef _SIM_MSP430_H_
+#define _SIM_MSP430_H_
+
+#include <stdint.h>
+
+#define __MSP430_HAS_USI__                  // Both I2C backends build (I2C_ALL_BACKENDS)
+#define __MSP430_HAS_USCI__
+
+#ifdef __cplusplus
+extern "C" {
+#endif //__cplusplus
+
+//////////////////////////////////////////////////////////////////////////////
+/// Mocked register file
+//////////////////////////////////////////////////////////////////////////////
+
+typedef enum SimRegEnum {                   // 8 bit registers
+  SIM_USICTL0 = 0,
+  SIM_USICTL1,
+  SIM_USICKCTL,
+  SIM_USICNT,
+  SIM_USISRL,
+  SIM_P1OUT,
+  SIM_P1DIR,
+  SIM_P1SEL,
+  SIM_P2OUT,
+  SIM_P2DIR,
+  SIM_P2SEL,
+  SIM_SD16INCTL0,
+  SIM_SD16AE,
+  SIM_P1SEL2,
+  SIM_UCB0CTL0,
+  SIM_UCB0CTL1,
+  SIM_UCB0STAT,
+  SIM_UCB0RXBUF,
+  SIM_UCB0TXBUF,
+  SIM_UCB0I2CIE,
+  SIM_IE2,
+  SIM_IFG2,
+  SIM_NUM_REGS
+} SimReg;
+
+typedef enum SimReg16Enum {                 // 16 bit registers
+  SIM_TACTL = 0,
+  SIM_TAR,
+  SIM_TACCTL0,
+  SIM_TACCR0,
+  SIM_SD16CTL,
+  SIM_SD16CCTL0,
+  SIM_SD16MEM0,
+  SIM_FCTL1,
+  SIM_FCTL2,
+  SIM_FCTL3,
+  SIM_UCB0I2COA,
+  SIM_NUM_REGS16
+} SimReg16;
+
+volatile uint8_t* simReg8(SimReg reg);
+volatile uint16_t* simReg16(SimReg16 reg);
+void simSetGie(uint8_t on);
+void simBisSr(uint16_t bits);
+void simBicSrOnExit(uint16_t bits);
+void simDelayCycles(unsigned long cycles);
+void simIsrState(uint8_t state);
+void simSlaveStep(uint8_t point);
+
+#define I2C_STATE_TRACE(state)  simIsrState(state)   // USI cycle model (usi-cycles.h)
+#define SLAVE_STEP_TRACE(point) simSlaveStep(point)  // Main loop cycle model (mcu-model.h)
+
+#define USICTL0     (*simReg8(SIM_USICTL0))
+#define USICTL1     (*simReg8(SIM_USICTL1))
+#define USICKCTL    (*simReg8(SIM_USICKCTL))
+#define USICNT      (*simReg8(SIM_USICNT))
+#define USISRL      (*simReg8(SIM_USISRL))
+#define P1OUT       (*simReg8(SIM_P1OUT))
+#define P1DIR       (*simReg8(SIM_P1DIR))
+#define P1SEL       (*simReg8(SIM_P1SEL))
+#define P2OUT       (*simReg8(SIM_P2OUT))
+#define P2DIR       (*simReg8(SIM_P2DIR))
+#define P2SEL       (*simReg8(SIM_P2SEL))
+#define SD16INCTL0  (*simReg8(SIM_SD16INCTL0))
+#define SD16AE      (*simReg8(SIM_SD16AE))
+#define P1SEL2      (*simReg8(SIM_P1SEL2))  // USCI_B0 (MSP430G2xx3, i2c-usci.c)
+#define UCB0CTL0    (*simReg8(SIM_UCB0CTL0))
+#define UCB0CTL1    (*simReg8(SIM_UCB0CTL1))
+#define UCB0STAT    (*simReg8(SIM_UCB0STAT))
+#define UCB0RXBUF   (*simReg8(SIM_UCB0RXBUF))
+#define UCB0TXBUF   (*simReg8(SIM_UCB0TXBUF))
+#define UCB0I2CIE   (*simReg8(SIM_UCB0I2CIE))
+#define IE2         (*simReg8(SIM_IE2))
+#define IFG2        (*simReg8(SIM_IFG2))
+
+#define TACTL       (*simReg16(SIM_TACTL))
+#define TAR         (*simReg16(SIM_TAR))
+#define TACCTL0     (*simReg16(SIM_TACCTL0))
+#define TACCR0      (*simReg16(SIM_TACCR0))
+#define SD16CTL     (*simReg16(SIM_SD16CTL))
+#define SD16CCTL0   (*simReg16(SIM_SD16CCTL0))
+#define SD16MEM0    (*simReg16(SIM_SD16MEM0))
+#define FCTL1       (*simReg16(SIM_FCTL1))
+#define FCTL2       (*simReg16(SIM_FCTL2))
+#define FCTL3       (*simReg16(SIM_FCTL3))
+#define UCB0I2COA   (*simReg16(SIM_UCB0I2COA))
+
+//////////////////////////////////////////////////////////////////////////////
+/// Register bits
+//////////////////////////////////////////////////////////////////////////////
+
+#define BIT0        0x01
+#define BIT1        0x02
+#define BIT2        0x04
+#define BIT3        0x08
+#define BIT4        0x10
+#define BIT5        0x20
+#define BIT6        0x40
+#define BIT7        0x80
+
+#define GIE         0x0008                  // Status register
+#define CPUOFF      0x0010
+#define OSCOFF      0x0020
+#define SCG0        0x0040
+#define SCG1        0x0080
+#define LPM0_bits   (CPUOFF)
+
+#define USIPE7      0x80                    // USICTL0
+#define USIPE6      0x40
+#define USIPE5      0x20
+#define USILSB      0x10
+#define USIMST      0x08
+#define USIGE       0x04
+#define USIOE       0x02
+#define USISWRST    0x01
+
+#define USICKPH     0x80                    // USICTL1
+#define USII2C      0x40
+#define USISTTIE    0x20
+#define USIIE       0x10
+#define USIAL       0x08
+#define USISTP      0x04
+#define USISTTIFG   0x02
+#define USIIFG      0x01
+
+#define USICKPL     0x02                    // USICKCTL
+#define USISWCLK    0x01
+
+#define USISCLREL   0x80                    // USICNT
+#define USI16B      0x40
+#define USIIFGCC    0x20
+
+#define UCMODE_3    0x06                    // UCB0CTL0
+#define UCSYNC      0x01
+#define UCTR        0x10                    // UCB0CTL1
+#define UCSWRST     0x01
+#define UCBBUSY     0x10                    // UCB0STAT
+#define UCSTPIFG    0x04
+#define UCSTTIFG    0x02
+#define UCSTPIE     0x04                    // UCB0I2CIE
+#define UCSTTIE     0x02
+#define UCB0TXIE    0x08                    // IE2
+#define UCB0RXIE    0x04
+#define UCB0TXIFG   0x08                    // IFG2
+#define UCB0RXIFG   0x04
+
+#define TASSEL_1    0x0100                  // TACTL
+#define TASSEL_2    0x0200
+#define ID_0        0x0000
+#define ID_1        0x0040
+#define ID_2        0x0080
+#define ID_3        0x00C0
+#define MC_0        0x0000
+#define MC_1        0x0010
+#define MC_2        0x0020
+#define TACLR       0x0004
+#define TAIE        0x0002
+#define TAIFG       0x0001
+
+#define CCIE        0x0010                  // TACCTLx
+#define CCIFG       0x0001
+
+#define SD16XDIV_0  0x0000                  // SD16CTL
+#define SD16DIV_0   0x0000
+#define SD16SSEL_1  0x0010
+#define SD16REFON   0x0004
+#define SD16VMIDON  0x0002
+
+#define SD16UNI     0x1000                  // SD16CCTL0
+#define SD16XOSR    0x0800
+#define SD16SNGL    0x0400
+#define SD16OSR_256 0x0000
+#define SD16OSR_128 0x0100
+#define SD16OSR_64  0x0200
+#define SD16OSR_32  0x0300
+#define SD16OSR_512  (SD16XOSR | SD16OSR_256)
+#define SD16OSR_1024 (SD16XOSR | SD16OSR_128)
+#define SD16OVIFG   0x0010
+#define SD16IE      0x0008
+#define SD16IFG     0x0004
+#define SD16SC      0x0002
+
+#define SD16INTDLY_0 0x00                   // SD16INCTL0
+#define SD16INTDLY_1 0x40
+#define SD16INTDLY_2 0x80
+#define SD16INTDLY_3 0xC0
+#define SD16GAIN_1  0x00
+#define SD16GAIN_2  0x08
+#define SD16GAIN_4  0x10
+#define SD16GAIN_8  0x18
+#define SD16GAIN_16 0x20
+#define SD16GAIN_32 0x28
+#define SD16INCH_0  0x00
+#define SD16INCH_1  0x01
+#define SD16INCH_2  0x02
+#define SD16INCH_3  0x03
+#define SD16INCH_4  0x04
+#define SD16INCH_5  0x05
+#define SD16INCH_6  0x06
+#define SD16INCH_7  0x07
+
+#define SD16AE0     0x01                    // SD16AE
+#define SD16AE1     0x02
+#define SD16AE2     0x04
+#define SD16AE3     0x08
+#define SD16AE4     0x10
+#define SD16AE5     0x20
+#define SD16AE6     0x40
+#define SD16AE7     0x80
+
+#define FWKEY       0xA500                  // FCTLx password
+#define ERASE       0x0002                  // FCTL1
+#define MERAS       0x0004
+#define WRT         0x0040
+#define FSSEL_0     0x0000                  // FCTL2
+#define FSSEL_1     0x0040
+#define FSSEL_2     0x0080
+#define FN0         0x0001
+#define FN1         0x0002
+#define FN2         0x0004
+#define BUSY        0x0001                  // FCTL3
+#define LOCK        0x0010
+#define LOCKA       0x0040
+
+//////////////////////////////////////////////////////////////////////////////
+/// Vectors and intrinsics
+//////////////////////////////////////////////////////////////////////////////
+
+#define USI_VECTOR      (4 * 2u)
+#define SD16_VECTOR     (5 * 2u)
+#define TIMERA0_VECTOR  (9 * 2u)
+#define USCIAB0TX_VECTOR (6 * 2u)           // MSP430G2xx3
+#define USCIAB0RX_VECTOR (7 * 2u)
+
+#define __interrupt
+#define __enable_interrupt()            simSetGie(1)
+#define __disable_interrupt()           simSetGie(0)
+#define __bis_SR_register(x)            simBisSr(x)
+#define __bic_SR_register_on_exit(x)    simBicSrOnExit(x)
+#define __delay_cycles(n)               simDelayCycles(n)
+#define __no_operation()
+#define __even_in_range(x, y)           (x)
+
+#ifdef __cplusplus
+}
+#endif //__cplusplus
+
+#endif
@@ -0,0 +1,147 @@
+//////////////////////////////////////////////////////////////////////////////
+/// @file main.cpp
+/// @brief Benchmark driver of the native env.
+///
+///        Usage: program [--bench all|bus|median|acq|history|sched|multi|serial|decode|pec|isr|stats|scan|cal|profiles|agg|drdy|pipe|hal|trigger] [--loops N] [--echo]
+///
+//////////////////////////////////////////////////////////////////////////////
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include <Arduino.h>
+#include "bench.h"
+
+SlaveLoop benchSlave;
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Host cycle counter (TSC on x86, nanoseconds elsewhere).
+///
+//////////////////////////////////////////////////////////////////////////////
+uint64_t hostCycles(void) {
+#if defined(__x86_64__) || defined(__i386__)
+  return __rdtsc();
+#else
+  return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Slave firmware up to its main loop, as src/main.c (default
+///        address). Call after simReset().
+///
+//////////////////////////////////////////////////////////////////////////////
+void benchSlaveStart(void) {
+#ifdef WITH_HISTORY
+  histInit();
+#endif
+  i2cSlaveSetup();
+#ifdef WITH_CAL
+  calInit();
+#endif
+  sd16Setup();
+  slaveLoopInit(&benchSlave);
+}
+
+int main(int argc, char* argv[]) {
+  const char* bench = "all";
+  uint32_t loops = 1000;
+
+  for (int i = 1; i < argc; ++i) {
+    if (!strcmp(argv[i], "--bench") && i + 1 < argc) {
+      bench = argv[++i];
+    } else if (!strcmp(argv[i], "--loops") && i + 1 < argc) {
+      loops = (uint32_t)strtoul(argv[++i], NULL, 0);
+    } else if (!strcmp(argv[i], "--echo")) {
+      simSerialEcho = true;
+    } else {
+      printf("Usage: %s [--bench all|bus|median|acq|history|sched|multi|serial|decode|pec|isr|stats|scan|cal|profiles|agg|drdy|pipe|hal|trigger] [--loops N] [--echo]\n", argv[0]);
+      return 1;
+    }
+  }
+
+  bool all = !strcmp(bench, "all");
+  if (all || !strcmp(bench, "bus")) {
+    printf("\n== Virtual bus: master loop() <-> USI slave ==\n");
+    benchBus(loops);
+  }
+  if (all || !strcmp(bench, "median")) {
+    printf("\n== Median filter: bubble sort vs. running median ==\n");
+    benchMedian(loops);
+  }
+  if (all || !strcmp(bench, "acq")) {
+    printf("\n== Acquisition: polling vs. timer paced LPM0 ==\n");
+    benchAcq(loops);
+  }
+  if (all || !strcmp(bench, "history")) {
+    printf("\n== Sample history: FIFO drained by long reads ==\n");
+    benchHistory(loops);
+  }
+  if (all || !strcmp(bench, "sched")) {
+    printf("\n== Master scheduler: task latency ==\n");
+    benchSched(loops);
+  }
+  if (all || !strcmp(bench, "multi")) {
+    printf("\n== Multi-slave bus: scan and fan-in polling ==\n");
+    benchMulti(loops);
+  }
+  if (all || !strcmp(bench, "serial")) {
+    printf("\n== Serial output: text vs. fixed-point vs. COBS records ==\n");
+    benchSerial(loops);
+  }
+  if (all || !strcmp(bench, "decode")) {
+    printf("\n== Decoder: bufferToInt16/32 vs. decodeInt/PackedRecord ==\n");
+    benchDecode(loops);
+  }
+  if (all || !strcmp(bench, "pec")) {
+    printf("\n== SMBus PEC: CRC-8 bitwise vs. nibble vs. table ==\n");
+    benchPec(loops);
+  }
+  if (all || !strcmp(bench, "isr")) {
+    printf("\n== USI ISR: standard vs. fast mode, per-state cycles ==\n");
+    benchIsr(loops);
+  }
+  if (all || !strcmp(bench, "stats")) {
+    printf("\n== Slave counters: read over I2C vs. sim ==\n");
+    benchStats(loops);
+  }
+  if (all || !strcmp(bench, "scan")) {
+    printf("\n== Channel scan: per-channel filters, one block read ==\n");
+    benchScan(loops);
+  }
+  if (all || !strcmp(bench, "cal")) {
+    printf("\n== Calibration: slave Q0.16 vs. master float ==\n");
+    benchCal(loops);
+  }
+  if (all || !strcmp(bench, "profiles")) {
+    printf("\n== Acquisition profiles: samples/s vs. noise ==\n");
+    benchProfiles(loops);
+  }
+  if (all || !strcmp(bench, "agg")) {
+    printf("\n== Window statistics: slave block vs. polling every sample ==\n");
+    benchAgg(loops);
+  }
+  if (all || !strcmp(bench, "drdy")) {
+    printf("\n== Data-ready line vs. fixed interval polling ==\n");
+    benchDrdy(loops);
+  }
+  if (all || !strcmp(bench, "pipe")) {
+    printf("\n== Dual-core pipeline: bus core -> output core ==\n");
+    benchPipe(loops);
+  }
+  if (all || !strcmp(bench, "hal")) {
+    printf("\n== Slave state machine: USI vs. USCI_B0 vs. host backend ==\n");
+    benchHal(loops);
+  }
+  if (all || !strcmp(bench, "trigger")) {
+    printf("\n== Triggered conversion vs. paced median: latency and age of the value ==\n");
+    benchTrigger(loops);
+  }
+  return 0;
+}
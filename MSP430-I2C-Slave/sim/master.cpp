@@ -0,0 +1,124 @@
+//////////////////////////////////////////////////////////////////////////////
+/// @file master.cpp
+/// @brief Builds the unmodified master program of Arduino-I2C-Master-Slave
+///        against the stand-in Arduino.h/Wire.h of the native env.
+///
+//////////////////////////////////////////////////////////////////////////////
+
+#include "../../Arduino-I2C-Master-Slave/src/main.cpp"
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Value the master decoded in its last loop() run.
+///
+//////////////////////////////////////////////////////////////////////////////
+uint16_t simMasterValue(void) {
+#ifdef READ_REGISTERS
+  return RegisterMap::get<0>(nodes[0].regs);
+#else
+  return decodeInt<uint16_t>(buffer);
+#endif
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Run loop() until the master has done one register read.
+///
+//////////////////////////////////////////////////////////////////////////////
+void simMasterStep(void) {
+#ifdef READ_REGISTERS
+  uint32_t polls = regReads + busErrors;
+  while (regReads + busErrors == polls) {
+    loop();
+  }
+#else
+  loop();
+#endif
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Change the period of the register poll tasks of all nodes
+///        (0 = back to back).
+///
+//////////////////////////////////////////////////////////////////////////////
+void simMasterSetPollPeriod(uint32_t us) {
+#ifdef READ_REGISTERS
+  uint32_t now = micros();
+  for (uint8_t i = 0; i < nodeCount; ++i) {
+    nodes[i].period = nodes[i].pollTask->period = us;
+    nodes[i].pollTask->due = now + i * us / nodeCount;
+  }
+#else
+  (void)us;
+#endif
+}
+
+#ifdef READ_REGISTERS
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Task table of the master scheduler.
+///
+/// @return uint8_t   Number of tasks
+//////////////////////////////////////////////////////////////////////////////
+uint8_t simMasterTasks(const SchedTask** tasks) {
+  *tasks = scheduler.tasks;
+  return scheduler.count;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Entry of the slave table of the master. Pointers may be NULL.
+///
+/// @return uint8_t   Number of nodes found by the last scan
+//////////////////////////////////////////////////////////////////////////////
+uint8_t simMasterNode(uint8_t idx, uint8_t* addr, uint32_t* reads, uint32_t* errors) {
+  if (idx < nodeCount) {
+    if (addr) {
+      *addr = nodes[idx].addr;
+    }
+    if (reads) {
+      *reads = nodes[idx].reads;
+    }
+    if (errors) {
+      *errors = nodes[idx].errors;
+    }
+  }
+  return nodeCount;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Select the serial output format (OUT_TEXT, OUT_FIXED, OUT_COBS).
+///
+//////////////////////////////////////////////////////////////////////////////
+void simMasterSetFormat(uint8_t format) {
+  outFormat = format;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Free space of the text buffer and one run of the serial stage.
+///
+//////////////////////////////////////////////////////////////////////////////
+uint16_t simMasterOutFree(void) {
+  return outFree();
+}
+
+void simMasterSerial(void) {
+  serialTask();
+}
+#endif
+
+#ifdef READ_HISTORY
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Format a sample of the first node like the decode stage does.
+///
+//////////////////////////////////////////////////////////////////////////////
+void simMasterPrintSample(uint16_t seq, uint16_t value) {
+  decodeAddr = nodes[0].addr;
+  printSample(seq, value);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief History decoder of the first node.
+///
+//////////////////////////////////////////////////////////////////////////////
+const HistoryDecoder* simMasterHistory(void) {
+  return &nodeHistory(0);
+}
+#endif
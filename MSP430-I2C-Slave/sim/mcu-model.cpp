@@ -0,0 +1,454 @@
+//////////////////////////////////////////////////////////////////////////////
+/// @file mcu-model.cpp
+/// @brief Time base, register file, interrupt dispatch, Timer_A and SD16_A
+///        models of the simulated MSP430.
+///
+//////////////////////////////////////////////////////////////////////////////
+
+#include <string.h>
+
+#include "mcu-model.h"
+#include "sd16-acq.h"
+#include "slave-loop.h"
+
+extern "C" void USI_TXRX(void);
+extern "C" void TIMERA0_ISR(void);
+extern "C" void SD16_ISR(void);
+
+//////////////////////////////////////////////////////////////////////////////
+/// Module global variables
+//////////////////////////////////////////////////////////////////////////////
+
+McuStats mcuStats;
+void (*mcuPortHook)(uint8_t p2dir, uint8_t p2out) = NULL;
+void (*mcuStepHook)(uint8_t point) = NULL;
+
+static volatile uint8_t regs8[SIM_NUM_REGS];
+static volatile uint16_t regs16[SIM_NUM_REGS16];
+static unsigned long regAccesses = 0;
+static uint16_t sr = 0;                     // GIE and LPM bits
+static bool inIsr = false;
+
+static SimTime now = 0;
+static SimTime cpuBusyUntil = 0;            // End of the running ISR
+static SimTime usiReleaseAt = 0;            // USIIFG cleared by the last USI ISR
+static uint8_t usiState = 0xFF;             // Traced USI state, 0xFF: none
+static uint32_t cpuClock = 1000000;         // MCLK = SMCLK = DCO
+static SimTime timerBase = 0;               // Time of TAR = 0
+static SimTime sd16Done = SIM_NEVER;        // End of the running conversion
+
+static uint32_t adcSeed = 1;
+static uint8_t portDir = 0;                 // Port 2 as last reported to mcuPortHook
+static uint8_t portOut = 0;
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Default ADC input: constant voltage plus some noise.
+///
+//////////////////////////////////////////////////////////////////////////////
+static uint16_t defaultAdc(void) {
+  adcSeed = adcSeed * 1103515245u + 12345u;
+  return (uint16_t)(0x7400 + ((adcSeed >> 16) & 0x3F));
+}
+
+static uint16_t (*adcSource)(void) = defaultAdc;
+
+static uint64_t isrCyclesAll(void) {
+  uint64_t cycles = 0;
+  for (uint8_t irq = 0; irq < SIM_IRQ_NUM; ++irq) {
+    cycles += mcuStats.isrCycles[irq];
+  }
+  return cycles;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// Peripheral models
+//////////////////////////////////////////////////////////////////////////////
+
+static SimTime timerTick(void) {
+  uint16_t ctl = regs16[SIM_TACTL];
+  if (!(ctl & (MC_1 | MC_2)) || !(ctl & TASSEL_2)) {
+    return 0;
+  }
+  return SIM_PS_PER_SEC * (1u << ((ctl >> 6) & 0x03)) / cpuClock;
+}
+
+static uint16_t timerCount(void) {
+  SimTime tick = timerTick();
+  return tick ? (uint16_t)((now - timerBase) / tick) : regs16[SIM_TAR];
+}
+
+static SimTime timerMatch(void) {
+  SimTime tick = timerTick();
+  if (!tick || !(regs16[SIM_TACCTL0] & CCIE)) {
+    return SIM_NEVER;
+  }
+  SimTime k = (now - timerBase) / tick;
+  uint32_t delta = (uint16_t)(regs16[SIM_TACCR0] - (uint16_t)k);
+  if (!delta) {
+    delta = 0x10000;
+  }
+  return timerBase + (k + delta) * tick;
+}
+
+static uint16_t sd16Osr(void) {
+  static const uint16_t osr[] = {256, 128, 64, 32};
+  static const uint16_t xosr[] = {512, 1024, 1024, 1024};   // SD16XOSR: 10, 11 reserved
+  uint16_t ctl = regs16[SIM_SD16CCTL0];
+  return ((ctl & SD16XOSR) ? xosr : osr)[(ctl >> 8) & 0x03];
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Report a change of port 2 (written since the last access).
+///
+//////////////////////////////////////////////////////////////////////////////
+static void syncPorts(void) {
+  if (regs8[SIM_P2DIR] != portDir || regs8[SIM_P2OUT] != portOut) {
+    portDir = regs8[SIM_P2DIR];
+    portOut = regs8[SIM_P2OUT];
+    if (mcuPortHook) {
+      mcuPortHook(portDir, portOut);
+    }
+  }
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Take over register writes: TACLR, the start of a conversion and
+///        port 2.
+///
+//////////////////////////////////////////////////////////////////////////////
+static void syncPeripherals(void) {
+  syncPorts();
+  if (regs16[SIM_TACTL] & TACLR) {
+    regs16[SIM_TACTL] &= ~TACLR;
+    timerBase = now;
+  }
+  if ((regs16[SIM_SD16CCTL0] & SD16SC) && sd16Done == SIM_NEVER) {
+    uint8_t samples = 4 - ((regs8[SIM_SD16INCTL0] >> 6) & 0x03);
+    sd16Done = now + (SimTime)samples * sd16Osr() * SIM_PS_PER_SEC / cpuClock;
+  }
+  if (!(regs16[SIM_SD16CCTL0] & SD16SC)) {
+    sd16Done = SIM_NEVER;
+  }
+}
+
+static void sd16Finish(void) {
+  regs16[SIM_SD16MEM0] = adcSource();
+  regs16[SIM_SD16CCTL0] |= SD16IFG;
+  mcuStats.conversions++;
+  mcuStats.lastConversion = now;
+  if (regs16[SIM_SD16CCTL0] & SD16SNGL) {
+    regs16[SIM_SD16CCTL0] &= ~SD16SC;
+    sd16Done = SIM_NEVER;
+  } else {                                  // Continuous: 1 sample per result
+    sd16Done = now + (SimTime)sd16Osr() * SIM_PS_PER_SEC / cpuClock;
+  }
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// Interrupt dispatch
+//////////////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Cycles of the USI ISR from the per-state table (usi-cycles.h).
+///        An odd traced state is the short branch of state - 1.
+///
+/// @param start      ISR ran for a START condition
+/// @param release    Out: cycles until SCL is released
+/// @return uint32_t  Cycles until reti
+//////////////////////////////////////////////////////////////////////////////
+static uint32_t usiCycles(bool start, uint32_t* release) {
+  const UsiCycles& c = USI_CYCLES.state[(usiState / 2) % USI_STATES];
+  *release = ((usiState & 1) ? c.altRelease : c.release) + USI_STATS_CYCLES;
+  uint32_t total = ((usiState & 1) ? c.altTotal : c.total) + USI_STATS_CYCLES;
+  if (start) {
+    *release += USI_CYCLES.startRelease + USI_STATS_START_CYCLES;
+    total += USI_CYCLES.startTotal + USI_STATS_START_CYCLES;
+    mcuStats.usiStarts++;
+  }
+  mcuStats.usiStateCalls[(usiState / 2) % USI_STATES]++;
+  return total;
+}
+
+static void runIsr(SimIrq irq, void (*isr)(void)) {
+  SimTime start = now + simCycles(SIM_IRQ_LATENCY_CYCLES);
+  if (cpuBusyUntil > start) {
+    start = cpuBusyUntil;
+  }
+  bool usiStart = (regs8[SIM_USICTL1] & USISTTIFG) != 0;
+  unsigned long acc = regAccesses;
+  usiState = 0xFF;
+  inIsr = true;
+  isr();
+  inIsr = false;
+  uint32_t cycles;
+  if (irq == SIM_IRQ_USI && usiState != 0xFF) {
+    uint32_t release;
+    start = (cpuBusyUntil > now) ? cpuBusyUntil : now;  // Acceptance is in the table
+    cycles = usiCycles(usiStart, &release);
+    usiReleaseAt = start + simCycles(release);
+  } else {
+    cycles = SIM_ISR_FRAME_CYCLES + SIM_ISR_BODY_CYCLES +
+             (uint32_t)(regAccesses - acc) * SIM_REG_ACCESS_CYCLES;
+    usiReleaseAt = start + simCycles(cycles);
+  }
+  cpuBusyUntil = start + simCycles(cycles);
+  mcuStats.isrCalls[irq]++;
+  mcuStats.isrCycles[irq] += cycles;
+  if (cycles > mcuStats.isrMaxCycles[irq]) {
+    mcuStats.isrMaxCycles[irq] = cycles;
+  }
+  syncPeripherals();
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Run all pending and enabled ISRs in priority order.
+///
+//////////////////////////////////////////////////////////////////////////////
+void mcuServicePending(void) {
+  for (uint8_t tries = 0; tries < 8 && (sr & GIE) && !inIsr; ++tries) {
+    uint8_t usi = regs8[SIM_USICTL1];
+    if ((regs16[SIM_TACCTL0] & (CCIE | CCIFG)) == (CCIE | CCIFG)) {
+      regs16[SIM_TACCTL0] &= ~CCIFG;        // CCR0 flag is reset on service
+      runIsr(SIM_IRQ_TIMERA0, TIMERA0_ISR);
+    } else if ((regs16[SIM_SD16CCTL0] & (SD16IE | SD16IFG)) == (SD16IE | SD16IFG)) {
+      runIsr(SIM_IRQ_SD16, SD16_ISR);
+    } else if (((usi & USIIE) && (usi & USIIFG)) ||
+               ((usi & USISTTIE) && (usi & USISTTIFG))) {
+      uint8_t cnt = regs8[SIM_USICNT] & 0x1F;
+      runIsr(SIM_IRQ_USI, USI_TXRX);
+      if (!cnt && (regs8[SIM_USICNT] & 0x1F)) {
+        regs8[SIM_USICTL1] &= ~USISTP;      // Loading USICNT clears USISTP
+      }
+    } else {
+      break;
+    }
+  }
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// Mocked register file and intrinsics (msp430.h)
+//////////////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Accesses of the main program wait for a running ISR and cost
+///        SIM_REG_ACCESS_CYCLES. ISR accesses are counted for the model.
+///
+//////////////////////////////////////////////////////////////////////////////
+static void regAccess(void) {
+  regAccesses++;
+  syncPorts();                            // Writes of the previous access
+  if (!inIsr) {
+    simWaitUntil(cpuBusyUntil);
+    simWait(simCycles(SIM_REG_ACCESS_CYCLES));
+  }
+}
+
+extern "C" volatile uint8_t* simReg8(SimReg reg) {
+  regAccess();
+  return &regs8[reg];
+}
+
+extern "C" volatile uint16_t* simReg16(SimReg16 reg) {
+  regAccess();
+  if (reg == SIM_TAR) {
+    regs16[SIM_TAR] = timerCount();
+  } else if (reg == SIM_SD16MEM0) {
+    regs16[SIM_SD16CCTL0] &= ~SD16IFG;      // Reading SD16MEM0 clears SD16IFG
+  }
+  return &regs16[reg];
+}
+
+extern "C" void simSetGie(uint8_t on) {
+  if (on) {
+    sr |= GIE;
+    syncPeripherals();
+    mcuServicePending();
+  } else {
+    sr &= ~GIE;
+  }
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief __bis_SR_register(): with CPUOFF the time runs on until an ISR
+///        clears the LPM bits on exit.
+///
+//////////////////////////////////////////////////////////////////////////////
+extern "C" void simBisSr(uint16_t bits) {
+  if (bits & GIE) {
+    simSetGie(1);
+  }
+  if (!(bits & CPUOFF)) {
+    return;
+  }
+  SimTime t0 = now;
+  uint64_t isr0 = isrCyclesAll();
+  sr |= CPUOFF;
+  mcuServicePending();
+  syncPeripherals();
+  while (sr & CPUOFF) {
+    SimTime t = timerMatch();
+    if (sd16Done < t) {
+      t = sd16Done;
+    }
+    if (t == SIM_NEVER) {
+      sr &= ~CPUOFF;                        // Nothing would ever wake us up
+      break;
+    }
+    simWaitUntil(t);
+  }
+  simWaitUntil(cpuBusyUntil);
+  mcuStats.sleepTime += now - t0;
+  mcuStats.sleepIsrCycles += isrCyclesAll() - isr0;
+}
+
+extern "C" void simBicSrOnExit(uint16_t bits) {
+  if (bits & CPUOFF) {
+    mcuStats.wakeups++;
+  }
+  sr &= ~bits;
+}
+
+extern "C" void simDelayCycles(unsigned long cycles) {
+  simWait(simCycles(cycles));
+}
+
+extern "C" void simIsrState(uint8_t state) {
+  usiState = state;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Run the main loop for some cycles. ISRs that run meanwhile
+///        preempt it: their cycles are added until none is left.
+///
+//////////////////////////////////////////////////////////////////////////////
+static void runMainCycles(uint32_t cycles) {
+  uint64_t isr = isrCyclesAll();
+
+  while (cycles) {
+    simWait(simCycles(cycles));
+    uint64_t isrNow = isrCyclesAll();
+    cycles = (uint32_t)(isrNow - isr);
+    isr = isrNow;
+  }
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Main loop at a SLAVE_TRACE_x point: charge its cycles, then
+///        tell the benchmark.
+///
+//////////////////////////////////////////////////////////////////////////////
+extern "C" void simSlaveStep(uint8_t point) {
+  if (point == SLAVE_TRACE_SAMPLE) {
+    runMainCycles(mcuStepCycles());
+  } else if (point == SLAVE_TRACE_WINDOW) {
+    runMainCycles(SIM_STEP_WINDOW_CYCLES);
+  }
+  if (mcuStepHook) {
+    mcuStepHook(point);
+  }
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// Time base
+//////////////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Reset time, registers and statistics.
+///
+/// @param cpuHz      MCLK/SMCLK of the simulated MSP430
+//////////////////////////////////////////////////////////////////////////////
+void mcuReset(uint32_t cpuHz) {
+  memset((void*)regs8, 0, sizeof(regs8));
+  memset((void*)regs16, 0, sizeof(regs16));
+  regs8[SIM_USICTL0] = USISWRST;
+  sr = 0;
+  inIsr = false;
+  now = cpuBusyUntil = usiReleaseAt = timerBase = 0;
+  sd16Done = SIM_NEVER;
+  cpuClock = cpuHz;
+  adcSeed = 1;
+  portDir = portOut = 0;
+  mcuResetStats();
+}
+
+void mcuResetStats(void) {
+  memset(&mcuStats, 0, sizeof(mcuStats));
+}
+
+void mcuSetAdcSource(uint16_t (*source)(void)) {
+  adcSource = source ? source : defaultAdc;
+}
+
+SimTime mcuCpuBusyUntil(void) {
+  return cpuBusyUntil;
+}
+
+SimTime mcuUsiReleaseAt(void) {
+  return usiReleaseAt;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Modelled cycles of one pass of the main loop of this build,
+///        without the close of a statistics window.
+///
+//////////////////////////////////////////////////////////////////////////////
+uint32_t mcuStepCycles(void) {
+  uint32_t cycles = SIM_STEP_CYCLES + SCAN_CHANNELS * SIM_STEP_MEDIAN_CYCLES;
+
+#ifdef WITH_CAL
+  cycles += SCAN_CHANNELS * SIM_STEP_CAL_CYCLES;
+#endif
+#ifdef WITH_AGG
+  cycles += SIM_STEP_AGG_CYCLES;
+#endif
+  return cycles;
+}
+
+volatile uint8_t* mcuRaw8(SimReg reg) {
+  return &regs8[reg];
+}
+
+volatile uint16_t* mcuRaw16(SimReg16 reg) {
+  return &regs16[reg];
+}
+
+SimTime simNow(void) {
+  return now;
+}
+
+void simWait(SimTime dt) {
+  simWaitUntil(now + dt);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Let the time run up to t and process all peripheral events
+///        on the way.
+///
+//////////////////////////////////////////////////////////////////////////////
+void simWaitUntil(SimTime t) {
+  syncPeripherals();
+  while (true) {
+    SimTime tm = timerMatch();
+    SimTime ts = sd16Done;
+    SimTime e = (tm < ts) ? tm : ts;
+    if (e > t) {
+      break;
+    }
+    now = e;
+    if (tm == e) {
+      regs16[SIM_TACCTL0] |= CCIFG;
+    }
+    if (ts == e) {
+      sd16Finish();
+    }
+    mcuServicePending();
+    syncPeripherals();
+  }
+  if (t > now) {
+    now = t;
+  }
+}
+
+SimTime simCycles(uint32_t cycles) {
+  return (SimTime)cycles * SIM_PS_PER_SEC / cpuClock;
+}
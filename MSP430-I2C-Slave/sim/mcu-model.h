@@ -0,0 +1,103 @@
+//////////////////////////////////////////////////////////////////////////////
+/// @file mcu-model.h
+/// @brief Time base, register file, interrupt dispatch and the Timer_A and
+///        SD16_A models of the simulated MSP430 (native env).
+///
+///        Time is virtual and counted in picoseconds. Peripheral events
+///        (Timer_A CCR0 match, end of an SD16 conversion) are processed
+///        whenever time advances. ISRs run to completion at the time of
+///        their event; their run time is estimated with a cycle model
+///        (see SIM_* constants) and blocks the CPU for that long.
+///        The USI ISR reports its state (I2C_STATE_TRACE) and is timed
+///        with the per-state table of usi-cycles.h instead; SCL is free
+///        again when the ISR clears USIIFG, which can be before its end.
+///
+///        Writes to P2DIR/P2OUT are reported to mcuPortHook with the next
+///        register access or time step, so a pin pulse of a few cycles is
+///        seen as one edge pair at the time of the write.
+///
+///        The main loop (slaveStep() of lib/slave-loop) reports its
+///        progress (SLAVE_STEP_TRACE) and is charged the SIM_STEP_*
+///        cycles there, plus the cycles of the ISRs that preempt it
+///        meanwhile; mcuStepHook sees the same points.
+///
+///        Register accesses of the main program cost SIM_REG_ACCESS_CYCLES
+///        of virtual time, so polling loops make progress. LPM0 is entered
+///        with __bis_SR_register() and lets time run until an ISR clears
+///        the LPM bits with __bic_SR_register_on_exit().
+///
+//////////////////////////////////////////////////////////////////////////////
+
+#ifndef _MCU_MODEL_H_
+#define _MCU_MODEL_H_
+
+#include <stdint.h>
+#include <msp430.h>
+#include "usi-cycles.h"
+
+//////////////////////////////////////////////////////////////////////////////
+/// Global definitions
+//////////////////////////////////////////////////////////////////////////////
+
+typedef uint64_t SimTime;                   // Virtual time in picoseconds
+
+#define SIM_PS_PER_SEC        1000000000000ULL
+#define SIM_NEVER             UINT64_MAX
+
+// Cycle model of an ISR (MSP430 at -Os, values are estimates)
+#define SIM_IRQ_LATENCY_CYCLES    6         // Interrupt acceptance
+#define SIM_ISR_FRAME_CYCLES      24        // Register push/pop + reti
+#define SIM_ISR_BODY_CYCLES       12        // State dispatch and bookkeeping
+#define SIM_REG_ACCESS_CYCLES     4         // Per peripheral register access
+
+// Cycle model of the main loop (slaveStep(), values are estimates)
+#define SIM_STEP_CYCLES           130       // Requests, min/max and publishing of VALUE .. STATUS
+#define SIM_STEP_MEDIAN_CYCLES    120       // medianPush() per channel
+#define SIM_STEP_CAL_CYCLES       200       // calApply() per channel: libgcc 16 x 16 multiply ~ 170 + ~ 30
+#define SIM_STEP_AGG_CYCLES       200       // runStatsPush(): libgcc 16 x 16 multiply ~ 170 + ~ 30
+#define SIM_STEP_WINDOW_CYCLES    4000      // runStatsResult(): 64 bit multiply and 3 divisions
+
+typedef enum SimIrqEnum {                   // Interrupt sources, by priority
+  SIM_IRQ_TIMERA0 = 0,
+  SIM_IRQ_SD16,
+  SIM_IRQ_USI,
+  SIM_IRQ_NUM
+} SimIrq;
+
+typedef struct McuStatsStruct {
+  uint32_t isrCalls[SIM_IRQ_NUM];           // ISR invocations
+  uint64_t isrCycles[SIM_IRQ_NUM];          // Sum of modelled ISR cycles
+  uint32_t isrMaxCycles[SIM_IRQ_NUM];       // Worst single ISR run
+  uint32_t usiStateCalls[USI_STATES];       // USI ISR runs per state (index: state / 2)
+  uint32_t usiStarts;                       // USI ISR runs for a START
+  SimTime sleepTime;                        // Time in LPM0 (incl. ISRs)
+  uint64_t sleepIsrCycles;                  // Of isrCycles: ISRs in LPM0
+  uint32_t conversions;                     // Finished SD16 conversions
+  SimTime lastConversion;                   // Time of the last finished conversion
+  uint32_t wakeups;                         // ISR exits that leave LPM0 (main loop released)
+} McuStats;
+
+extern McuStats mcuStats;
+extern void (*mcuPortHook)(uint8_t p2dir, uint8_t p2out);   // Port 2 changed (data-ready line), or NULL
+extern void (*mcuStepHook)(uint8_t point);  // Main loop at SLAVE_TRACE_x, or NULL
+
+//////////////////////////////////////////////////////////////////////////////
+/// Forward declaration(s)
+//////////////////////////////////////////////////////////////////////////////
+
+void mcuReset(uint32_t cpuHz);
+void mcuResetStats(void);
+void mcuSetAdcSource(uint16_t (*source)(void));
+void mcuServicePending(void);
+SimTime mcuCpuBusyUntil(void);
+SimTime mcuUsiReleaseAt(void);
+uint32_t mcuStepCycles(void);
+volatile uint8_t* mcuRaw8(SimReg reg);
+volatile uint16_t* mcuRaw16(SimReg16 reg);
+
+SimTime simNow(void);
+void simWait(SimTime dt);
+void simWaitUntil(SimTime t);
+SimTime simCycles(uint32_t cycles);
+
+#endif
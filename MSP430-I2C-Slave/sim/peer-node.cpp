@@ -0,0 +1,123 @@
+//////////////////////////////////////////////////////////////////////////////
+/// @file peer-node.cpp
+/// @brief Behavioural sensor node model (see peer-node.h).
+///
+//////////////////////////////////////////////////////////////////////////////
+
+#include <string.h>
+
+#include "peer-node.h"
+
+static bool nodeStart(void* ctx, uint8_t addrByte) {
+  PeerNode* node = (PeerNode*)ctx;
+  if ((addrByte >> 1) != node->addr) {
+    return false;
+  }
+  node->reading = addrByte & 0x01;
+  node->firstByte = !node->reading;
+  if (!node->reading || !node->pointerOnly) {
+    node->pec = 0;                          // New transaction
+  }
+  node->pec = pecUpdate(node->pec, addrByte);
+  node->pecCount = 0;
+  node->pointerOnly = false;
+  if (node->reading) {
+    node->reads++;
+  }
+  return true;
+}
+
+static bool nodeWrite(void* ctx, uint8_t data) {
+  PeerNode* node = (PeerNode*)ctx;
+  node->pec = pecUpdate(node->pec, data);
+  node->pointerOnly = node->firstByte;
+  if (node->firstByte) {
+    node->firstByte = false;
+    node->ptr = data;
+  } else {
+    if (node->ptr == I2C_REG_CONFIG) {
+      node->regs[I2C_REG_CONFIG] |= data;   // Requests, like writeReg()
+    } else if (node->ptr >= I2C_CTRL_BASE && node->ptr < I2C_NUM_REGS) {
+      node->regs[node->ptr] = data;
+    }
+    node->ptr++;
+  }
+  return true;
+}
+
+static uint8_t nodeRead(void* ctx) {
+  PeerNode* node = (PeerNode*)ctx;
+  uint8_t val;
+#ifdef WITH_PEC
+  if (node->ptr == I2C_REG_PEC ||
+      (node->ptr == I2C_REG_FIFO && node->pecCount++ == I2C_PEC_BLOCK)) {
+    val = node->pec;
+    node->pecCount = 0;
+  } else if (node->ptr >= I2C_NUM_REGS) {
+    val = (node->ptr == I2C_REG_FIFO) ? 0x00 : 0xFF;    // FIFO: padding
+  } else {
+    val = node->regs[node->ptr];
+    node->ptr = (node->ptr == I2C_REG_ADDR) ? I2C_REG_PEC : node->ptr + 1;
+  }
+  node->pec = pecUpdate(node->pec, val);
+#else
+  if (node->ptr >= I2C_NUM_REGS) {
+    return (node->ptr == I2C_REG_FIFO) ? 0x00 : 0xFF;   // FIFO: padding
+  }
+  val = node->regs[node->ptr++];
+#endif
+  return val;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief End of a transfer. The pointer falls back to VALUE after a read,
+///        the control registers are handled like in the main loop.
+///
+//////////////////////////////////////////////////////////////////////////////
+static void nodeStop(void* ctx) {
+  PeerNode* node = (PeerNode*)ctx;
+  if (node->reading) {
+    node->ptr = I2C_REG_VALUE;
+  }
+  if (node->regs[I2C_REG_CONFIG] & I2C_CFG_RESET_MINMAX) {
+    node->regs[I2C_REG_CONFIG] &= ~I2C_CFG_RESET_MINMAX;
+  }
+  if (node->regs[I2C_REG_CONFIG] & I2C_CFG_SAVE_ADDR) {
+    node->regs[I2C_REG_CONFIG] &= ~I2C_CFG_SAVE_ADDR;
+    uint8_t addr = node->regs[I2C_REG_ADDR];
+    if (addr >= 0x08 && addr <= 0x77) {
+      node->addr = addr;
+    } else {
+      node->regs[I2C_REG_ADDR] = node->addr;
+    }
+  }
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Initialise a node. Attach it with busAddPeer(&node->peer).
+///
+/// @param node       Node
+/// @param addr       7 bit address
+//////////////////////////////////////////////////////////////////////////////
+void peerNodeInit(PeerNode* node, uint8_t addr) {
+  memset(node, 0, sizeof(*node));
+  node->peer.start = nodeStart;
+  node->peer.write = nodeWrite;
+  node->peer.read = nodeRead;
+  node->peer.stop = nodeStop;
+  node->peer.ctx = node;
+  node->addr = addr;
+  node->regs[I2C_REG_ADDR] = addr;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief New sample: update VALUE, COUNT and STATUS.
+///
+//////////////////////////////////////////////////////////////////////////////
+void peerNodePublish(PeerNode* node, uint16_t value, uint16_t count) {
+  node->regs[I2C_REG_VALUE] = value >> 8;
+  node->regs[I2C_REG_VALUE + 1] = value & 0xFF;
+  node->regs[I2C_REG_COUNT] = count >> 8;
+  node->regs[I2C_REG_COUNT + 1] = count & 0xFF;
+  node->regs[I2C_REG_STATUS] = I2C_STATUS_RUNNING;
+}
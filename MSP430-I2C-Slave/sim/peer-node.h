@@ -0,0 +1,49 @@
+//////////////////////////////////////////////////////////////////////////////
+/// @file peer-node.h
+/// @brief Behavioural model of a sensor node for the virtual bus.
+///
+///        Same register map as lib/msp430-i2c (snapshot of VALUE .. STATUS,
+///        control registers CONFIG and ADDR, register pointer with
+///        auto-increment), attached as byte-level BusPeer. The history
+///        FIFO is always empty (reads padding). I2C_CFG_SAVE_ADDR takes
+///        effect at the STOP, flash timing is not modelled.
+///
+///        WITH_PEC: reads carry the PEC like lib/msp430-i2c. The peer does
+///        not see STOP conditions, so a read continues the CRC only after
+///        a write of the pointer alone (combined read).
+///
+//////////////////////////////////////////////////////////////////////////////
+
+#ifndef _PEER_NODE_H_
+#define _PEER_NODE_H_
+
+#include <stdint.h>
+#include "msp430-i2c.h"
+#include "smbus-pec.h"
+#include "virtual-bus.h"
+
+//////////////////////////////////////////////////////////////////////////////
+/// Global definitions
+//////////////////////////////////////////////////////////////////////////////
+
+typedef struct PeerNodeStruct {
+  BusPeer peer;
+  uint8_t addr;                             // 7 bit address
+  uint8_t regs[I2C_NUM_REGS];
+  uint8_t ptr;                              // Register pointer
+  bool reading;                             // Addressed with R/W = 1
+  bool firstByte;                           // Next written byte is the pointer
+  bool pointerOnly;                         // Last write set the pointer only
+  uint8_t pec;                              // CRC of the transaction so far
+  uint8_t pecCount;                         // FIFO bytes since the last PEC
+  uint32_t reads;                           // Read transfers served
+} PeerNode;
+
+//////////////////////////////////////////////////////////////////////////////
+/// Forward declaration(s)
+//////////////////////////////////////////////////////////////////////////////
+
+void peerNodeInit(PeerNode* node, uint8_t addr);
+void peerNodePublish(PeerNode* node, uint16_t value, uint16_t count);
+
+#endif
@@ -0,0 +1,95 @@
+//////////////////////////////////////////////////////////////////////////////
+/// @file usi-cycles.h
+/// @brief Per-state cycle counts of USI_TXRX (lib/msp430-i2c) for the cycle
+///        model of the native env. Same numbers as the table at the end of
+///        i2c-usi.c.
+///
+///        release: cycles from the interrupt request until USIIFG (or
+///                 USISTTIFG) is cleared, i.e. how long SCL is held
+///        total:   cycles until reti, the CPU is busy meanwhile
+///
+///        Worst branch of every state, WITH_PEC (PEC_TABLE), WITH_HISTORY
+///        and WITH_LED. States with a short branch (address NACK or write,
+///        data NACK) trace it as state | 1, that is the "alt" pair.
+///        "start" is added when the ISR runs for a START condition (it
+///        then continues with I2C_ADDRESS).
+///        WITH_STATS adds USI_STATS_CYCLES to every state (before the
+///        switch, so to release and total) and USI_STATS_START_CYCLES to
+///        a START.
+///
+//////////////////////////////////////////////////////////////////////////////
+
+#ifndef _USI_CYCLES_H_
+#define _USI_CYCLES_H_
+
+#include <stdint.h>
+#include "msp430-i2c.h"
+#include "slave-stats.h"
+
+//////////////////////////////////////////////////////////////////////////////
+/// Global definitions
+//////////////////////////////////////////////////////////////////////////////
+
+#define USI_STATES        9                 // I2C_IDLE .. I2C_PREP_START (even values)
+
+typedef struct UsiCyclesStruct {
+  const char* name;
+  uint16_t release;
+  uint16_t total;
+  uint16_t altRelease;                      // Short branch (state | 1)
+  uint16_t altTotal;
+} UsiCycles;
+
+typedef struct UsiCycleModelStruct {
+  const char* name;
+  uint16_t startRelease;                    // START block (added)
+  uint16_t startTotal;
+  UsiCycles state[USI_STATES];              // Index: state / 2
+} UsiCycleModel;
+
+// Standard ISR: all work before the final USIIFG clear, SCL held meanwhile
+//   state            release total    alt: release total
+static const UsiCycleModel usiCyclesStandard = {
+  "standard", 36, 36, {
+    {"IDLE",             39,  54,   39,  54},
+    {"ADDRESS",          57,  72,   57,  72},
+    {"PROCESS_ADDRESS",  94, 109,   94, 109},
+    {"RX_DATA",          51,  66,   51,  66},
+    {"RX_CHECK",        110, 125,  110, 125},
+    {"TX_DATA",         150, 165,  150, 165},
+    {"ACK_NACK",         52,  67,   52,  67},
+    {"TX_CHECK",        160, 175,   66,  81},
+    {"PREP_START",       56,  71,   56,  71},
+  }
+};
+
+// Fast mode: next transfer set up and SCL released first, the rest after
+static const UsiCycleModel usiCyclesFast = {
+  "fast", 32, 32, {
+    {"IDLE",             35,  50,   35,  50},
+    {"ADDRESS",          41, 128,   41, 128},
+    {"PROCESS_ADDRESS",  59, 105,   59,  96},
+    {"RX_DATA",          44,  63,   44,  63},
+    {"RX_CHECK",         51, 115,   51, 115},
+    {"TX_DATA",          46, 179,   46, 179},
+    {"ACK_NACK",         44,  64,   44,  64},
+    {"TX_CHECK",         56, 189,   41,  64},
+    {"PREP_START",       39,  58,   39,  58},
+  }
+};
+
+#ifdef WITH_STATS
+#define USI_STATS_CYCLES        5           // STATS_STATE(): add #1 to an indexed word
+#define USI_STATS_START_CYCLES  12          // Abort check in the START block
+#else
+#define USI_STATS_CYCLES        0
+#define USI_STATS_START_CYCLES  0
+#endif
+
+#ifdef I2C_FAST_MODE
+#define USI_CYCLES        usiCyclesFast     // Model of the built ISR
+#else
+#define USI_CYCLES        usiCyclesStandard
+#endif
+
+#endif
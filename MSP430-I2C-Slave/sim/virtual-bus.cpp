@@ -0,0 +1,303 @@
+//////////////////////////////////////////////////////////////////////////////
+/// @file virtual-bus.cpp
+/// @brief Bit-level virtual I2C bus and USI peripheral model.
+///
+///        Line levels are wired-AND: true means released (high).
+///        The USI model follows the slave mode behaviour used by
+///        lib/msp430-i2c:
+///        - SDA falling while SCL is high  -> USISTTIFG
+///        - SDA rising while SCL is high   -> USISTP
+///        - SCL rising edge                -> shift in SDA, USICNT--
+///        - SCL falling edge               -> USIIFG if USICNT hit 0
+///        - SCL low                        -> output latch follows the MSB
+///                                            of USISRL (if USIOE is set)
+///        - USIIFG or USISTTIFG pending    -> SCL is held low
+///
+///        Peers see whole bytes: the first byte after a START is offered to
+///        every peer as address, the addressed one takes the following
+///        bytes. Its ACK and read data are ANDed with the USI side.
+///
+//////////////////////////////////////////////////////////////////////////////
+
+#include <string.h>
+
+#include "virtual-bus.h"
+
+#define USI_REG(reg)  (*mcuRaw8(reg))       // Peripheral side register access
+
+//////////////////////////////////////////////////////////////////////////////
+/// Module global variables
+//////////////////////////////////////////////////////////////////////////////
+
+BusStats busStats;
+void (*busByteHook)(void) = NULL;
+uint8_t (*busReadHook)(uint8_t data) = NULL;
+
+static SimTime halfBit = 0;                 // Half SCL period
+
+static bool mSda = true;                    // Master SDA driver
+static bool mScl = true;                    // Master SCL driver
+static bool sSda = true;                    // Slave (USI) SDA driver
+static bool sdaLine = true;
+static bool sclLine = true;
+static uint8_t outLatch = 1;                // USI output latch
+static bool cntExpired = false;             // USICNT reached 0 on last edge
+static SimTime sclFreeAt = 0;               // Slave releases SCL at this time
+
+static const BusPeer* peers[BUS_MAX_PEERS]; // Byte-level slaves
+static uint8_t peerCount = 0;
+static const BusPeer* peerActive = NULL;    // Addressed peer
+static bool addrPhase = false;              // Next byte is an address byte
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Reset the MCU model, the lines and the statistics.
+///
+/// @param cpuHz      MCLK of the simulated MSP430
+/// @param busHz      SCL frequency of the master
+//////////////////////////////////////////////////////////////////////////////
+void simReset(uint32_t cpuHz, uint32_t busHz) {
+  mcuReset(cpuHz);
+  busSetClock(busHz);
+  mSda = mScl = sSda = sdaLine = sclLine = true;
+  outLatch = 1;
+  cntExpired = false;
+  sclFreeAt = 0;
+  peerCount = 0;
+  peerActive = NULL;
+  addrPhase = false;
+  busResetStats();
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Attach a byte-level slave. simReset() removes all peers.
+///
+/// @param peer       Peer (must stay valid)
+/// @return bool      false if the peer table is full
+//////////////////////////////////////////////////////////////////////////////
+bool busAddPeer(const BusPeer* peer) {
+  if (peerCount >= BUS_MAX_PEERS) {
+    return false;
+  }
+  peers[peerCount++] = peer;
+  return true;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief End of the transfer of the addressed peer (STOP or repeated
+///        START).
+///
+//////////////////////////////////////////////////////////////////////////////
+static void peerRelease(void) {
+  if (peerActive) {
+    peerActive->stop(peerActive->ctx);
+    peerActive = NULL;
+  }
+}
+
+void busSetClock(uint32_t busHz) {
+  halfBit = SIM_PS_PER_SEC / busHz / 2;
+}
+
+void busResetStats(void) {
+  memset(&busStats, 0, sizeof(busStats));
+  mcuResetStats();
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Recalculate the slave SDA driver. The output latch is transparent
+///        while SCL is low and frozen while SCL is high.
+///
+//////////////////////////////////////////////////////////////////////////////
+static void updateSlaveSda(void) {
+  if (!sclLine) {
+    outLatch = (USI_REG(SIM_USISRL) >> 7) & 0x01;
+  }
+  sSda = !(USI_REG(SIM_USICTL0) & USIOE) || outLatch;
+  sdaLine = mSda && sSda;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Dispatch pending interrupts. SCL stays held until the USI ISR
+///        clears the USI flags (cycle model: mcuUsiReleaseAt()).
+///
+//////////////////////////////////////////////////////////////////////////////
+static void usiService(void) {
+  mcuServicePending();
+  if (USI_REG(SIM_USICTL1) & (USIIFG | USISTTIFG)) {
+    sclFreeAt = SIM_NEVER;
+  } else {
+    sclFreeAt = mcuUsiReleaseAt();
+  }
+  updateSlaveSda();
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Set the master SDA driver and detect START/STOP conditions.
+///
+//////////////////////////////////////////////////////////////////////////////
+static void setSda(bool level) {
+  bool old = sdaLine;
+  mSda = level;
+  sdaLine = mSda && sSda;
+  if (!sclLine || old == sdaLine || (USI_REG(SIM_USICTL0) & USISWRST)) {
+    return;
+  }
+  if (!sdaLine) {
+    USI_REG(SIM_USICTL1) |= USISTTIFG;     // START condition
+  } else {
+    USI_REG(SIM_USICTL1) |= USISTP;        // STOP condition
+  }
+  usiService();
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Pull SCL low. A counter that expired on the preceding rising edge
+///        raises USIIFG now, so the ISR always runs with SCL held low.
+///
+//////////////////////////////////////////////////////////////////////////////
+static void sclLow(void) {
+  mScl = false;
+  sclLine = false;
+  updateSlaveSda();
+  if (cntExpired) {
+    cntExpired = false;
+    USI_REG(SIM_USICTL1) |= USIIFG;
+    usiService();
+  }
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Release SCL. The rising edge is delayed while the slave
+///        stretches the clock.
+///
+//////////////////////////////////////////////////////////////////////////////
+static void sclRelease(void) {
+  mScl = true;
+  SimTime t0 = simNow();
+  if (sclFreeAt == SIM_NEVER) {
+    busStats.stuck++;
+    simWait(halfBit * 2);
+  } else if (sclFreeAt > t0) {
+    simWaitUntil(sclFreeAt);
+  }
+  SimTime hold = simNow() - t0;
+  if (hold) {
+    busStats.sclHoldTotal += hold;
+    if (hold > busStats.sclHoldMax) {
+      busStats.sclHoldMax = hold;
+    }
+  }
+  sclLine = true;
+  uint8_t cnt = USI_REG(SIM_USICNT) & 0x1F;
+  if (cnt && !(USI_REG(SIM_USICTL0) & USISWRST)) {
+    USI_REG(SIM_USISRL) = (uint8_t)((USI_REG(SIM_USISRL) << 1) | (sdaLine ? 1 : 0));
+    cnt--;
+    USI_REG(SIM_USICNT) = (USI_REG(SIM_USICNT) & 0xE0) | cnt;
+    cntExpired = (cnt == 0);
+  }
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Clock one bit. SCL is low on entry and on exit.
+///
+/// @param bit        Level driven by the master (true = released)
+/// @return bool      Level of SDA sampled while SCL is high
+//////////////////////////////////////////////////////////////////////////////
+static bool clockBit(bool bit) {
+  setSda(bit);
+  simWait(halfBit);
+  sclRelease();
+  bool sample = sdaLine;
+  simWait(halfBit);
+  sclLow();
+  return sample;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief START or repeated START condition. SCL is low on exit.
+///
+//////////////////////////////////////////////////////////////////////////////
+void busStart(void) {
+  peerRelease();
+  addrPhase = true;
+  if (!sclLine) {                           // Repeated start
+    setSda(true);
+    simWait(halfBit);
+    sclRelease();
+    simWait(halfBit);
+  }
+  setSda(false);
+  simWait(halfBit);
+  sclLow();
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief STOP condition followed by the bus free time.
+///
+//////////////////////////////////////////////////////////////////////////////
+void busStop(void) {
+  peerRelease();
+  addrPhase = false;
+  setSda(false);
+  simWait(halfBit);
+  sclRelease();
+  simWait(halfBit);
+  setSda(true);
+  simWait(halfBit);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Send one byte and read the (N)ACK bit of the slave.
+///
+/// @param data       Byte to send
+/// @return bool      true if the slave acknowledged
+//////////////////////////////////////////////////////////////////////////////
+bool busWriteByte(uint8_t data) {
+  uint8_t bits = data;
+  for (uint8_t i = 0; i < 8; ++i) {
+    clockBit(bits & 0x80);
+    bits <<= 1;
+  }
+  bool ack = !clockBit(true);
+  if (addrPhase) {
+    addrPhase = false;
+    for (uint8_t i = 0; i < peerCount && !peerActive; ++i) {
+      if (peers[i]->start(peers[i]->ctx, data)) {
+        peerActive = peers[i];
+      }
+    }
+    ack = ack || peerActive != NULL;
+  } else if (peerActive) {
+    ack = peerActive->write(peerActive->ctx, data) || ack;
+  }
+  busStats.bytes++;
+  if (busByteHook) {
+    busByteHook();
+  }
+  return ack;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Receive one byte and answer with ACK or NACK.
+///
+/// @param ack        true: ACK (more bytes follow), false: NACK
+/// @return uint8_t   Received byte
+//////////////////////////////////////////////////////////////////////////////
+uint8_t busReadByte(bool ack) {
+  uint8_t data = 0;
+  for (uint8_t i = 0; i < 8; ++i) {
+    data = (uint8_t)((data << 1) | (clockBit(true) ? 1 : 0));
+  }
+  if (peerActive) {
+    data &= peerActive->read(peerActive->ctx);    // Wired-AND
+  }
+  if (busReadHook) {
+    data = busReadHook(data);
+  }
+  clockBit(!ack);
+  busStats.bytes++;
+  if (busByteHook) {
+    busByteHook();
+  }
+  return data;
+}
@@ -0,0 +1,68 @@
+//////////////////////////////////////////////////////////////////////////////
+/// @file virtual-bus.h
+/// @brief Bit-level virtual I2C bus for the native env.
+///
+///        The bus connects a bit-banging master (used by the stand-in Wire
+///        class) with a model of the MSP430 USI peripheral. The USI model
+///        shifts on the SCL edges, detects START/STOP, stretches SCL while
+///        USIIFG/USISTTIFG are pending and calls the real USI_TXRX() ISR
+///        from lib/msp430-i2c.
+///
+///        Time, interrupt dispatch and the ISR cycle model are provided
+///        by the MCU model (mcu-model.h).
+///
+///        Further slaves can be attached as byte-level peers (BusPeer).
+///        They take part in address arbitration and wired-AND data, but
+///        never stretch SCL.
+///
+//////////////////////////////////////////////////////////////////////////////
+
+#ifndef _VIRTUAL_BUS_H_
+#define _VIRTUAL_BUS_H_
+
+#include <stdint.h>
+#include "mcu-model.h"
+
+//////////////////////////////////////////////////////////////////////////////
+/// Global definitions
+//////////////////////////////////////////////////////////////////////////////
+
+typedef struct BusStatsStruct {
+  uint32_t transactions;                    // Completed master transactions
+  uint32_t failures;                        // NACKed or short transactions
+  uint32_t bytes;                           // Bytes on the bus (incl. address)
+  SimTime busTime;                          // Time spent in bus transactions
+  SimTime sclHoldTotal;                     // Sum of all SCL stretches
+  SimTime sclHoldMax;                       // Worst-case SCL stretch
+  uint32_t stuck;                           // SCL never released by the slave
+} BusStats;
+
+typedef struct BusPeerStruct {              // Byte-level slave on the bus
+  bool (*start)(void* ctx, uint8_t addrByte);     // true: addressed (ACK)
+  bool (*write)(void* ctx, uint8_t data);         // Master -> peer, true: ACK
+  uint8_t (*read)(void* ctx);                     // Peer -> master
+  void (*stop)(void* ctx);                        // STOP or repeated START
+  void* ctx;
+} BusPeer;
+
+#define BUS_MAX_PEERS   16
+
+extern BusStats busStats;
+extern void (*busByteHook)(void);           // Called after every byte, or NULL
+extern uint8_t (*busReadHook)(uint8_t data);  // Byte seen by the master (fault injection), or NULL
+
+//////////////////////////////////////////////////////////////////////////////
+/// Forward declaration(s)
+//////////////////////////////////////////////////////////////////////////////
+
+void simReset(uint32_t cpuHz, uint32_t busHz);
+
+void busSetClock(uint32_t busHz);
+void busResetStats(void);
+bool busAddPeer(const BusPeer* peer);
+void busStart(void);
+void busStop(void);
+bool busWriteByte(uint8_t data);
+uint8_t busReadByte(bool ack);
+
+#endif
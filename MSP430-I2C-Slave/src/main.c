@@ -1,7 +1,26 @@
 
 //////////////////////////////////////////////////////////////////////////////
 /// @file Sample program for i2c communication.
-///       The program represents an I2C slave that can only send data.
+///       The program represents an I2C slave with a small register map
+///       (latest median, min/max, sample counter, status and config, see
+///       msp430-i2c.h) and a history FIFO of all medians (sample-history.h).
+///       With WITH_SCAN (sd16-acq.h) every input of the channel scan has its
+///       own median filter, all filtered channels are published together
+///       in the channel block I2C_REG_SCAN.
+///       With WITH_CAL (calibration.h) the filtered channels are also
+///       published in engineering units (0.1 mV ...) in the value block
+///       I2C_REG_UNITS, the coefficients come from info flash.
+///       With WITH_PROFILES (sd16-acq.h) the master selects the acquisition
+///       profile (I2C_REG_PROFILE), every profile has its own median window
+///       on channel 0.
+///       With WITH_AGG (running-stats.h) min, max, mean and variance of the
+///       medians of channel 0 are published per window in the statistics
+///       block I2C_REG_AGG, so the master does not have to poll every one.
+///       With WITH_TRIGGER (sd16-acq.h) the master starts a conversion burst
+///       with I2C_CFG_TRIGGER; its mean is published as VALUE without the
+///       median filter, STATUS reads I2C_STATUS_BUSY until then.
+///       The loop itself is slaveStep() (slave-loop.h), the benchmarks of
+///       the native env run the same one.
 ///
 /// @author Kai R.
 /// @brief 
@@ -23,26 +42,12 @@
 //////////////////////////////////////////////////////////////////////////////
 
 #include <msp430.h>
+#include "calibration.h"
+#include "info-flash.h"
 #include "msp430-i2c.h"
-
-//////////////////////////////////////////////////////////////////////////////
-/// Global definitions
-//////////////////////////////////////////////////////////////////////////////
-
-#define NUM_OF_ADCVALUES 11               // Value has to be odd
-
-//////////////////////////////////////////////////////////////////////////////
-/// Module global variables
-//////////////////////////////////////////////////////////////////////////////
-
-//uint8_t slvData[NUMBER_OF_BYTES] = {'A','1','C','2'};   // Data buffer (extern in msp430-i2c.c) !!!
-
-//////////////////////////////////////////////////////////////////////////////
-/// Forward declaration(s)
-//////////////////////////////////////////////////////////////////////////////
-
-void sd16Setup(void);
-uint16_t getMedian(uint16_t* data, uint8_t items); 
+#include "sample-history.h"
+#include "sd16-acq.h"
+#include "slave-loop.h"
 
 //////////////////////////////////////////////////////////////////////////////
 /// @brief Mainprogram:  Reading of voltage data on the ADC and 
@@ -60,7 +65,7 @@ int main(void)
   DCOCTL = 0;                             // Select lowest DCOx and MODx settings
   BCSCTL1 = CALBC1_1MHZ;                  // Set DCO
   DCOCTL = CALDCO_1MHZ;
-  BCSCTL1 = BIT7;                         // switch XT2 off
+  BCSCTL1 |= BIT7;                        // switch XT2 off (keep calibrated RSEL)
   
   // The specific pin configuration is done in the setup routines.
   P1OUT = 0;                              // Unused pins as outputs saves energy
@@ -68,70 +73,21 @@ int main(void)
   P2OUT = 0;
   P2DIR = BIT6 | BIT7;
   
-  uint16_t median;              
-  uint16_t adcValues[NUM_OF_ADCVALUES];   // Array with the data for which 
-                                          // the meriadian is to be found
-  uint8_t idx = 0;
+  SlaveLoop loop;                         // State of the main loop (slave-loop.h)
+  uint8_t addr;
 
+#ifdef WITH_HISTORY
+  histInit();
+#endif
   i2cSlaveSetup();
+  addr = infoSlaveAddr();                 // Address stored by the master
+  i2cSetAddress(addr ? addr : SLAVE_ADDR);
+#ifdef WITH_CAL
+  calInit();                              // Coefficients stored by the master
+#endif
   sd16Setup();
+  slaveLoopInit(&loop);                   // Initial values of all filters
   while(1) {
-    SD16CCTL0 &= ~SD16IFG;                // clear ADC Interrupt Flag
-    SD16CCTL0 |= SD16SC;                  // start ADC
-    while (!(SD16CCTL0 & SD16IFG)) { 
-    }                                     // AD conversion ended? 
-    adcValues[idx] = SD16MEM0;            
-    idx++;
-    if (idx == NUM_OF_ADCVALUES) {
-      median = getMedian(adcValues, NUM_OF_ADCVALUES); 
-      __disable_interrupt();
-      setTxData16(median);                // Update ADC value to I2C Databuffer
-      __enable_interrupt();
-      __delay_cycles(25000);
-      idx = 0;
-    }
+    slaveStep(&loop);                     // Sleeps in LPM0 until the next sample
   }  
- // LPM0;                                   // CPU off, await USI interrupt
- // __no_operation();
-}
-
-//////////////////////////////////////////////////////////////////////////////
-/// @brief Set up ADC in single mode without interrupt
-/// 
-//////////////////////////////////////////////////////////////////////////////
-void sd16Setup() {
-  //             no division       | of SMCLK   | internal reference 1200mV
-  SD16CTL = SD16XDIV_0 | SD16DIV_0 | SD16SSEL_1 | SD16REFON;  
-  //          Unipolar| Single   | OSR = 256    
-  SD16CCTL0 = SD16UNI | SD16SNGL | SD16OSR_256; // No interrupts (SD16IE)
-  //           gain = 1   | ADC-in A1+ 
-  SD16INCTL0 = SD16GAIN_1 | SD16INCH_1;         // No interrupt and stop (SD16INTDLY_X)
-  SD16AE = SD16AE2;           // Connect A1- to internal GND
-  P1SEL = BIT3;               // Enable VRef to external capacitor
-}
-
-//////////////////////////////////////////////////////////////////////////////
-/// @brief Determining the median from a list of measured values
-/// 
-/// @param data           Measured values
-/// @param items          Number of measured values
-/// @return uint16_t      Return median value 
-//////////////////////////////////////////////////////////////////////////////
-uint16_t getMedian(uint16_t* data, uint8_t items)
-{ 
-  uint16_t tmp;
-  uint8_t i, j;
-
-  for (i = 0; i < items; ++i) {
-    for (j = 0; j < items - i - 1; ++j) {
-      if (data[j] > data[j + 1]) {
-        tmp = data[j];
-        data[j] = data[j + 1];
-        data[j + 1] = tmp;
-      }
-    }
-  }
-  tmp = (items >> 1);                     // items/2
-  return data[tmp];                       // The result set is odd. Simply return 
-                                          // the mean value of the set of values.
 }
@@ -0,0 +1,179 @@
+//////////////////////////////////////////////////////////////////////////////
+/// @file test_decode.cpp
+/// @brief Host unit tests of decodeInt() and PackedRecord (bufferToInt.h
+///        of the master) against a plain shift/or reference: widths 1 .. 4,
+///        signed and unsigned, both byte orders, sign extension of short
+///        fields and record layouts.
+///
+///        Run with: pio test -e native
+///
+//////////////////////////////////////////////////////////////////////////////
+
+#include <stdint.h>
+#include <unity.h>
+
+#include "bufferToInt.h"
+#include "slaveProtocol.h"
+
+#define RANDOM_PATTERNS   100000            // Random patterns per width above 16 bit
+
+static uint32_t rngState;
+
+static uint32_t nextRandom(void) {
+  rngState ^= rngState << 13;
+  rngState ^= rngState >> 17;
+  rngState ^= rngState << 5;
+  return rngState;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Reference: unsigned value of n bytes, big or little endian
+///
+//////////////////////////////////////////////////////////////////////////////
+static uint32_t refRaw(const uint8_t* p, uint8_t n, bool big) {
+  uint32_t v = 0;
+  for (uint8_t i = 0; i < n; ++i) {
+    v = (v << 8) | p[big ? i : n - 1 - i];
+  }
+  return v;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Reference: two's complement of an n byte field
+///
+//////////////////////////////////////////////////////////////////////////////
+static int32_t refSigned(uint32_t raw, uint8_t n) {
+  if (n == 4) {
+    return (int32_t)raw;
+  }
+  uint32_t sign = 1UL << (8 * n - 1);
+  return (raw & sign) ? (int32_t)raw - (int32_t)(sign << 1) : (int32_t)raw;
+}
+
+void setUp(void) {
+  rngState = 0x12345678;
+}
+
+void tearDown(void) {
+}
+
+void test_width1(void) {
+  uint8_t b[1];
+
+  for (uint16_t v = 0; v <= 0xFF; ++v) {
+    b[0] = (uint8_t)v;
+    TEST_ASSERT_EQUAL_UINT8(v, decodeInt<uint8_t>(b));
+    TEST_ASSERT_EQUAL_INT8((int8_t)v, decodeInt<int8_t>(b));
+    TEST_ASSERT_EQUAL_UINT8(v, (decodeInt<uint8_t, Endian::Little>(b)));
+    TEST_ASSERT_EQUAL_INT32(refSigned(v, 1), (decodeInt<int32_t, Endian::Big, 1>(b)));
+    TEST_ASSERT_EQUAL_INT16(refSigned(v, 1), (decodeInt<int16_t, Endian::Little, 1>(b)));
+    TEST_ASSERT_EQUAL_UINT32(v, (decodeInt<uint32_t, Endian::Big, 1>(b)));
+  }
+}
+
+void test_width2(void) {
+  uint8_t b[2];
+
+  for (uint32_t v = 0; v <= 0xFFFF; ++v) {
+    b[0] = (uint8_t)(v >> 8);
+    b[1] = (uint8_t)v;
+    TEST_ASSERT_EQUAL_UINT16(refRaw(b, 2, true), decodeInt<uint16_t>(b));
+    TEST_ASSERT_EQUAL_INT16(refSigned(refRaw(b, 2, true), 2), decodeInt<int16_t>(b));
+    TEST_ASSERT_EQUAL_UINT16(refRaw(b, 2, false), (decodeInt<uint16_t, Endian::Little>(b)));
+    TEST_ASSERT_EQUAL_INT16(refSigned(refRaw(b, 2, false), 2), (decodeInt<int16_t, Endian::Little>(b)));
+    TEST_ASSERT_EQUAL_INT32(refSigned(refRaw(b, 2, true), 2), (decodeInt<int32_t, Endian::Big, 2>(b)));
+    TEST_ASSERT_EQUAL_UINT32(refRaw(b, 2, false), (decodeInt<uint32_t, Endian::Little, 2>(b)));
+  }
+}
+
+void test_width3(void) {
+  uint8_t b[3];
+
+  for (uint32_t i = 0; i < RANDOM_PATTERNS; ++i) {
+    uint32_t v = nextRandom();
+    b[0] = (uint8_t)(v >> 16);
+    b[1] = (uint8_t)(v >> 8);
+    b[2] = (uint8_t)v;
+    TEST_ASSERT_EQUAL_UINT32(refRaw(b, 3, true), (decodeInt<uint32_t, Endian::Big, 3>(b)));
+    TEST_ASSERT_EQUAL_INT32(refSigned(refRaw(b, 3, true), 3), (decodeInt<int32_t, Endian::Big, 3>(b)));
+    TEST_ASSERT_EQUAL_UINT32(refRaw(b, 3, false), (decodeInt<uint32_t, Endian::Little, 3>(b)));
+    TEST_ASSERT_EQUAL_INT32(refSigned(refRaw(b, 3, false), 3), (decodeInt<int32_t, Endian::Little, 3>(b)));
+  }
+}
+
+void test_width4(void) {
+  uint8_t b[4];
+
+  for (uint32_t i = 0; i < RANDOM_PATTERNS; ++i) {
+    uint32_t v = nextRandom();
+    b[0] = (uint8_t)(v >> 24);
+    b[1] = (uint8_t)(v >> 16);
+    b[2] = (uint8_t)(v >> 8);
+    b[3] = (uint8_t)v;
+    TEST_ASSERT_EQUAL_UINT32(v, decodeInt<uint32_t>(b));
+    TEST_ASSERT_EQUAL_INT32((int32_t)v, decodeInt<int32_t>(b));
+    TEST_ASSERT_EQUAL_UINT32(refRaw(b, 4, false), (decodeInt<uint32_t, Endian::Little>(b)));
+    TEST_ASSERT_EQUAL_INT32((int32_t)refRaw(b, 4, false), (decodeInt<int32_t, Endian::Little>(b)));
+  }
+}
+
+void test_sign_extension_edges(void) {
+  const uint8_t min24[3] = {0x80, 0x00, 0x00};
+  const uint8_t max24[3] = {0x7F, 0xFF, 0xFF};
+  const uint8_t minus1[3] = {0xFF, 0xFF, 0xFF};
+
+  TEST_ASSERT_EQUAL_INT32(-8388608, (decodeInt<int32_t, Endian::Big, 3>(min24)));
+  TEST_ASSERT_EQUAL_INT32(8388607, (decodeInt<int32_t, Endian::Big, 3>(max24)));
+  TEST_ASSERT_EQUAL_INT32(-1, (decodeInt<int32_t, Endian::Little, 3>(minus1)));
+  TEST_ASSERT_EQUAL_INT32(-128, (decodeInt<int32_t, Endian::Big, 1>(min24)));
+  TEST_ASSERT_EQUAL_INT16(-32768, (decodeInt<int16_t>(min24)));
+}
+
+void test_packed_record_mixed(void) {
+  typedef PackedRecord<Field<uint16_t>, Field<int32_t, Endian::Little, 3>, Field<int8_t>> Mixed;
+  const uint8_t rec[6] = {0x12, 0x34, 0xFE, 0xFF, 0x80, 0x9C};
+  uint16_t a;
+  int32_t c;
+  int8_t d;
+
+  static_assert(Mixed::size == 6 && Mixed::count == 3, "Mixed size");
+  TEST_ASSERT_EQUAL(0, Mixed::offset<0>());
+  TEST_ASSERT_EQUAL(2, Mixed::offset<1>());
+  TEST_ASSERT_EQUAL(5, Mixed::offset<2>());
+  Mixed::decode(rec, a, c, d);
+  TEST_ASSERT_EQUAL_HEX16(0x1234, a);
+  TEST_ASSERT_EQUAL_INT32((int32_t)0xFF80FFFE, c);
+  TEST_ASSERT_EQUAL_INT8(-100, d);
+  TEST_ASSERT_EQUAL_HEX16(a, Mixed::get<0>(rec));
+  TEST_ASSERT_EQUAL_INT32(c, Mixed::get<1>(rec));
+  TEST_ASSERT_EQUAL_INT8(d, Mixed::get<2>(rec));
+}
+
+void test_packed_record_register_map(void) {
+  uint8_t regs[I2C_NUM_REGS];
+
+  for (uint8_t i = 0; i < I2C_NUM_REGS; ++i) {
+    regs[i] = (uint8_t)(0xA0 + i);
+  }
+  TEST_ASSERT_EQUAL(I2C_NUM_REGS, RegisterMap::size);
+  TEST_ASSERT_EQUAL(I2C_REG_MIN, RegisterMap::offset<1>());
+  TEST_ASSERT_EQUAL(I2C_REG_MAX, RegisterMap::offset<2>());
+  TEST_ASSERT_EQUAL(I2C_REG_STATUS, RegisterMap::offset<4>());
+  TEST_ASSERT_EQUAL(I2C_REG_CONFIG, RegisterMap::offset<5>());
+  TEST_ASSERT_EQUAL_HEX16(0xA0A1, RegisterMap::get<0>(regs));
+  TEST_ASSERT_EQUAL_HEX16(0xA6A7, RegisterMap::get<3>(regs));
+  TEST_ASSERT_EQUAL_HEX8(0xA8, RegisterMap::get<4>(regs));
+  TEST_ASSERT_EQUAL_HEX8(0xAA, RegisterMap::get<6>(regs));
+}
+
+int main(void) {
+  UNITY_BEGIN();
+  RUN_TEST(test_width1);
+  RUN_TEST(test_width2);
+  RUN_TEST(test_width3);
+  RUN_TEST(test_width4);
+  RUN_TEST(test_sign_extension_edges);
+  RUN_TEST(test_packed_record_mixed);
+  RUN_TEST(test_packed_record_register_map);
+  return UNITY_END();
+}
@@ -0,0 +1,112 @@
+//////////////////////////////////////////////////////////////////////////////
+/// @file test_pec.cpp
+/// @brief Host unit tests of the SMBus PEC: the three CRC-8 implementations
+///        of the slave (smbus-pec.c, built with PEC_ALL_IMPL) and of the
+///        master (smbusPec.h) against a reference, on every CRC/byte pair
+///        and on random buffers, and known SMBus vectors.
+///
+///        Run with: pio test -e native
+///
+//////////////////////////////////////////////////////////////////////////////
+
+#include <stdint.h>
+#include <unity.h>
+
+#include "smbus-pec.h"
+#include "smbusPec.h"
+
+#define RANDOM_BUFFERS    2000              // Random buffers of 1 .. 254 bytes (+ PEC)
+
+static uint32_t rngState;
+
+static uint32_t nextRandom(void) {
+  rngState ^= rngState << 13;
+  rngState ^= rngState >> 17;
+  rngState ^= rngState << 5;
+  return rngState;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Reference: CRC-8, polynomial 0x07, one message bit at a time
+///
+//////////////////////////////////////////////////////////////////////////////
+static uint8_t refCrc(uint8_t crc, const uint8_t* buf, uint16_t len) {
+  for (uint16_t i = 0; i < len; ++i) {
+    for (int8_t b = 7; b >= 0; --b) {
+      uint8_t top = (uint8_t)((crc >> 7) ^ (buf[i] >> b)) & 0x01;
+      crc = (uint8_t)(crc << 1) ^ (top ? PEC_POLY : 0);
+    }
+  }
+  return crc;
+}
+
+void setUp(void) {
+  rngState = 0x2468ACE1;
+}
+
+void tearDown(void) {
+}
+
+void test_all_pairs(void) {
+  for (uint16_t crc = 0; crc < 256; ++crc) {
+    for (uint16_t val = 0; val < 256; ++val) {
+      uint8_t b = (uint8_t)val;
+      uint8_t ref = refCrc((uint8_t)crc, &b, 1);
+      TEST_ASSERT_EQUAL_HEX8(ref, pecBitwise((uint8_t)crc, b));
+      TEST_ASSERT_EQUAL_HEX8(ref, pecNibble((uint8_t)crc, b));
+      TEST_ASSERT_EQUAL_HEX8(ref, pecTable[(uint8_t)(crc ^ b)]);
+      TEST_ASSERT_EQUAL_HEX8(ref, pecUpdate((uint8_t)crc, b));
+      TEST_ASSERT_EQUAL_HEX8(ref, Pec<PecImpl::Bitwise>::update((uint8_t)crc, b));
+      TEST_ASSERT_EQUAL_HEX8(ref, Pec<PecImpl::Nibble>::update((uint8_t)crc, b));
+      TEST_ASSERT_EQUAL_HEX8(ref, Pec<PecImpl::Table>::update((uint8_t)crc, b));
+    }
+  }
+}
+
+void test_random_buffers(void) {
+  uint8_t buf[256];
+
+  for (uint16_t n = 0; n < RANDOM_BUFFERS; ++n) {
+    uint8_t len = (uint8_t)(1 + nextRandom() % 254);
+    for (uint8_t i = 0; i < len; ++i) {
+      buf[i] = (uint8_t)nextRandom();
+    }
+    uint8_t ref = refCrc(0, buf, len);
+    uint8_t bitwise = 0, nibble = 0, table = 0;
+    for (uint8_t i = 0; i < len; ++i) {
+      bitwise = pecBitwise(bitwise, buf[i]);
+      nibble = pecNibble(nibble, buf[i]);
+      table = pecTable[(uint8_t)(table ^ buf[i])];
+    }
+    TEST_ASSERT_EQUAL_HEX8(ref, bitwise);
+    TEST_ASSERT_EQUAL_HEX8(ref, nibble);
+    TEST_ASSERT_EQUAL_HEX8(ref, table);
+    TEST_ASSERT_EQUAL_HEX8(ref, pecBlock<PecImpl::Bitwise>(0, buf, len));
+    TEST_ASSERT_EQUAL_HEX8(ref, pecBlock<PecImpl::Nibble>(0, buf, len));
+    TEST_ASSERT_EQUAL_HEX8(ref, pecBlock<PecImpl::Table>(0, buf, len));
+
+    buf[len] = ref;                         // Message followed by its PEC checks to 0
+    TEST_ASSERT_EQUAL_HEX8(0, pecBlock(0, buf, (uint8_t)(len + 1)));
+  }
+}
+
+void test_known_vectors(void) {
+  const uint8_t check[] = {'1', '2', '3', '4', '5', '6', '7', '8', '9'};
+  const uint8_t readWord[] = {0xB4, 0x07, 0xB5, 0xD2, 0x3A};    // Read word 0x07 of 0x5A, data 0x3AD2
+  const uint8_t readWordPec[] = {0xB4, 0x07, 0xB5, 0xD2, 0x3A, 0x30};
+
+  TEST_ASSERT_EQUAL_HEX8(0xF4, pecBlock<PecImpl::Bitwise>(0, check, sizeof(check)));  // CRC-8/SMBUS check value
+  TEST_ASSERT_EQUAL_HEX8(0xF4, pecBlock<PecImpl::Table>(0, check, sizeof(check)));
+  TEST_ASSERT_EQUAL_HEX8(0x30, pecBlock<PecImpl::Nibble>(0, readWord, sizeof(readWord)));
+  TEST_ASSERT_EQUAL_HEX8(0x00, pecBlock(0, readWordPec, sizeof(readWordPec)));
+  TEST_ASSERT_EQUAL_HEX8(0x00, pecBitwise(0, 0x00));
+  TEST_ASSERT_EQUAL_HEX8(PEC_POLY, pecNibble(0, 0x01));
+}
+
+int main(void) {
+  UNITY_BEGIN();
+  RUN_TEST(test_all_pairs);
+  RUN_TEST(test_random_buffers);
+  RUN_TEST(test_known_vectors);
+  return UNITY_END();
+}
@@ -0,0 +1,172 @@
+//////////////////////////////////////////////////////////////////////////////
+/// @file test_stats.cpp
+/// @brief Host unit tests of the slave counters (lib/slave-stats): layout of
+///        the counter window against the master (readNodeStats()), the
+///        latch of the high/low byte, staging with statsPeek()/statsTake(),
+///        statsClear() and the worst publish latency.
+///
+///        Run with: pio test -e native (the env builds WITH_STATS)
+///
+//////////////////////////////////////////////////////////////////////////////
+
+#include <stddef.h>
+#include <stdint.h>
+#include <unity.h>
+
+#include <msp430.h>
+#include "slave-stats.h"
+#include "slaveProtocol.h"
+
+#define TEST_ADDR         0x48              // Address of the node under test
+
+//////////////////////////////////////////////////////////////////////////////
+/// Timer_A of the mocked register file: statsPublished() reads TAR
+//////////////////////////////////////////////////////////////////////////////
+
+static volatile uint16_t regs16[SIM_NUM_REGS16];
+
+extern "C" volatile uint16_t* simReg16(SimReg16 reg) {
+  return &regs16[reg];
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// @brief Wire stand-in: a read of I2C_REG_STATS gets the bytes of
+///        statsRead(), followed by the PEC of the transaction (WITH_PEC)
+///
+//////////////////////////////////////////////////////////////////////////////
+struct StatsWire {
+  uint8_t addr;
+  uint8_t reg;
+  uint8_t bytes[I2C_STATS_SIZE + 1];
+  uint8_t len;
+  uint8_t pos;
+
+  void beginTransmission(uint8_t a) { addr = a; }
+  void write(uint8_t r) { reg = r; }
+  uint8_t endTransmission(bool) { return reg >= I2C_REG_STATS && reg < I2C_REG_STATS + I2C_STATS_SIZE ? 0 : 2; }
+  uint8_t requestFrom(uint8_t a, uint8_t n) {
+    uint8_t crc = pecByte(pecByte(pecByte(0, a << 1), reg), (a << 1) | 0x01);
+
+    for (len = 0; len < n && reg + len < I2C_REG_STATS + I2C_STATS_SIZE; ++len) {
+      bytes[len] = statsRead(reg - I2C_REG_STATS + len);
+      crc = pecByte(crc, bytes[len]);
+    }
+#ifdef WITH_PEC
+    bytes[len++] = crc;
+#endif
+    pos = 0;
+    return len;
+  }
+  int available() { return len - pos; }
+  uint8_t read() { return bytes[pos++]; }
+};
+
+void setUp(void) {
+  statsClear();
+  statsRead(1);                             // Latch 0
+  regs16[SIM_TAR] = 0;
+  statsConvStamp = 0;
+}
+
+void tearDown(void) {
+}
+
+void test_layout(void) {
+  TEST_ASSERT_EQUAL(STATS_STATES, I2C_STATS_STATES);
+  TEST_ASSERT_EQUAL(STATS_SIZE, I2C_STATS_SIZE);
+  TEST_ASSERT_EQUAL(STATS_SIZE, sizeof(SlaveStats));
+  TEST_ASSERT_EQUAL(2 * STATS_STATES, offsetof(SlaveStats, nacks));
+  TEST_ASSERT_EQUAL(2 * STATS_STATES + 2, offsetof(SlaveStats, aborts));
+  TEST_ASSERT_EQUAL(2 * STATS_STATES + 4, offsetof(SlaveStats, conversions));
+  TEST_ASSERT_EQUAL(2 * STATS_STATES + 6, offsetof(SlaveStats, latencyMax));
+}
+
+void test_window_big_endian(void) {
+  slaveStats.nacks = 0x1234;
+  TEST_ASSERT_EQUAL_HEX8(0x12, statsRead(offsetof(SlaveStats, nacks)));
+  TEST_ASSERT_EQUAL_HEX8(0x34, statsRead(offsetof(SlaveStats, nacks) + 1));
+}
+
+void test_read_node_stats(void) {
+  StatsWire wire;
+  NodeStats stats;
+
+  for (uint8_t s = 0; s < STATS_STATES; ++s) {
+    slaveStats.isrState[s] = (uint16_t)(0x0101 * (s + 1));
+  }
+  slaveStats.nacks = 0xA1B2;
+  slaveStats.aborts = 0x00FF;
+  slaveStats.conversions = 0xFF00;
+  slaveStats.latencyMax = 0x8001;
+  TEST_ASSERT_TRUE(readNodeStats(wire, TEST_ADDR, stats));
+  for (uint8_t s = 0; s < STATS_STATES; ++s) {
+    TEST_ASSERT_EQUAL_HEX16(slaveStats.isrState[s], stats.isrState[s]);
+  }
+  TEST_ASSERT_EQUAL_HEX16(0xA1B2, stats.nacks);
+  TEST_ASSERT_EQUAL_HEX16(0x00FF, stats.aborts);
+  TEST_ASSERT_EQUAL_HEX16(0xFF00, stats.conversions);
+  TEST_ASSERT_EQUAL_HEX16(0x8001, stats.latencyMax);
+}
+
+void test_latch(void) {
+  uint8_t off = offsetof(SlaveStats, conversions);
+
+  slaveStats.conversions = 0x12FF;
+  uint8_t hi = statsRead(off);
+  slaveStats.conversions++;                 // Changes between the two bytes
+  uint8_t lo = statsRead(off + 1);
+  TEST_ASSERT_EQUAL_HEX16(0x12FF, (uint16_t)(hi << 8 | lo));
+  TEST_ASSERT_EQUAL_HEX8(0x13, statsRead(off));
+  TEST_ASSERT_EQUAL_HEX8(0x00, statsRead(off + 1));
+}
+
+void test_peek_take(void) {
+  uint8_t off = offsetof(SlaveStats, aborts);
+
+  slaveStats.aborts = 0x5678;
+  TEST_ASSERT_EQUAL_HEX8(0x56, statsPeek(off));
+  TEST_ASSERT_EQUAL_HEX8(0x00, statsRead(off + 1));    // Not sent: the latch stays
+  TEST_ASSERT_EQUAL_HEX8(0x56, statsPeek(off));
+  slaveStats.aborts = 0x9ABC;
+  statsTake(off);                           // The staged high byte goes out
+  TEST_ASSERT_EQUAL_HEX8(0x78, statsPeek(off + 1));    // Low byte of the same value
+  statsTake(off + 1);
+  TEST_ASSERT_EQUAL_HEX8(0x78, statsRead(off + 1));
+}
+
+void test_clear(void) {
+  for (uint8_t i = 0; i < STATS_SIZE / 2; ++i) {
+    ((volatile uint16_t*)&slaveStats)[i] = 0xFFFF;
+  }
+  statsClear();
+  for (uint8_t i = 0; i < STATS_SIZE; ++i) {
+    TEST_ASSERT_EQUAL_HEX8(0, statsRead(i));
+  }
+}
+
+void test_latency_max(void) {
+  statsConvStamp = 100;
+  regs16[SIM_TAR] = 150;
+  statsPublished();
+  TEST_ASSERT_EQUAL_UINT16(50, slaveStats.latencyMax);
+  statsConvStamp = 200;
+  regs16[SIM_TAR] = 230;
+  statsPublished();
+  TEST_ASSERT_EQUAL_UINT16(50, slaveStats.latencyMax);
+  statsConvStamp = 0xFFF0;                  // TAR wraps around
+  regs16[SIM_TAR] = 0x0040;
+  statsPublished();
+  TEST_ASSERT_EQUAL_UINT16(0x50, slaveStats.latencyMax);
+}
+
+int main(void) {
+  UNITY_BEGIN();
+  RUN_TEST(test_layout);
+  RUN_TEST(test_window_big_endian);
+  RUN_TEST(test_read_node_stats);
+  RUN_TEST(test_latch);
+  RUN_TEST(test_peek_take);
+  RUN_TEST(test_clear);
+  RUN_TEST(test_latency_max);
+  return UNITY_END();
+}